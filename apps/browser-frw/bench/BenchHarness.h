@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Self-registering benchmarks; bench/main.cpp runs them all, or those whose
+// name contains its first argument. Each prints its own figures.
+namespace BenchHarness {
+    using Clock = std::chrono::steady_clock;
+
+    struct Benchmark {
+        const char* name;
+        std::function<void(const std::vector<std::string>& args)> run;
+    };
+
+    std::vector<Benchmark>& Benchmarks();
+
+    struct Registrar {
+        Registrar(const char* name, std::function<void(const std::vector<std::string>&)> run) {
+            Benchmarks().push_back({name, std::move(run)});
+        }
+    };
+
+    inline double SecondsSince(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // A fresh directory under the system temp directory, removed by the destructor
+    class ScratchDirectory {
+    public:
+        ScratchDirectory();
+        ~ScratchDirectory();
+        const std::string& Path() const { return path_; }
+
+    private:
+        std::string path_;
+    };
+
+    // Keeps the optimizer from discarding a computed value
+    void Consume(uint64_t value);
+}
+
+// |args| holds the command-line arguments after the benchmark filter
+#define FRW_BENCHMARK(name)                                                      \
+    static void name(const std::vector<std::string>& args);                      \
+    static BenchHarness::Registrar name##Registrar(#name, name);                 \
+    static void name(const std::vector<std::string>& args)
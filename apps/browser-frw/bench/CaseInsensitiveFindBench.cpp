@@ -0,0 +1,121 @@
+#include "BenchHarness.h"
+#include "CaseInsensitiveFinder.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Mixed-case words, so folding has work to do on every string
+std::string RandomText(std::mt19937_64& random, size_t size) {
+    static const char* const kWords[] = {"The", "news", "GitHub", "of", "Weather", "FRW", "docs", "and", "Video",
+                                         "forum", "Search", "release", "notes", "page", "Map", "index", "blog"};
+    std::string text;
+    while (text.size() < size) {
+        if (!text.empty()) text += random() % 4 == 0 ? '/' : ' ';
+        text += kWords[random() % (sizeof(kWords) / sizeof(kWords[0]))];
+    }
+    text.resize(size);
+    return text;
+}
+
+// What history search does per string before the finder: lowercase a
+// copy, then find the lowercased query in it
+size_t CountLowercaseFind(const std::vector<std::string>& strings, const std::string& needle) {
+    std::string lower_needle = needle;
+    std::transform(lower_needle.begin(), lower_needle.end(), lower_needle.begin(), ::tolower);
+    size_t matches = 0;
+    for (const auto& text : strings) {
+        std::string lower = text;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        if (lower.find(lower_needle) != std::string::npos) matches++;
+    }
+    return matches;
+}
+
+size_t CountFinder(const std::vector<std::string>& strings, const std::string& needle) {
+    CaseInsensitiveFinder finder(needle);
+    size_t matches = 0;
+    for (const auto& text : strings) {
+        if (finder.IsIn(text)) matches++;
+    }
+    return matches;
+}
+
+// Best of a few rounds, in seconds
+template <typename Search>
+double Time(Search search, size_t& matches) {
+    double best = 1e9;
+    for (int round = 0; round < 3; ++round) {
+        auto start = BenchHarness::Clock::now();
+        matches = search();
+        best = std::min(best, BenchHarness::SecondsSince(start));
+    }
+    return best;
+}
+
+// MB/s counts every byte of every string, including those after an early
+// match that the search never reads
+void Report(const std::string& label, size_t strings, size_t bytes, double seconds, double baseline,
+            size_t matches) {
+    std::cout << "    " << std::left << std::setw(16) << label << std::right << std::fixed << std::setprecision(1)
+              << std::setw(8) << bytes / seconds / (1024.0 * 1024.0) << " MB/s " << std::setw(8)
+              << seconds * 1e9 / strings << " ns/string " << std::setprecision(2) << std::setw(7)
+              << baseline / seconds << "x   " << matches << " matches\n";
+}
+
+void RunSet(const char* title, const std::vector<std::string>& strings, const std::vector<std::string>& needles) {
+    size_t bytes = 0;
+    for (const auto& text : strings) bytes += text.size();
+    std::cout << "  " << title << ": " << strings.size() << " strings, " << bytes / (1024 * 1024) << " MB\n";
+
+    std::string original = CaseInsensitiveFinder::Implementation();
+    for (const auto& needle : needles) {
+        std::cout << "   \"" << needle << "\"\n";
+        size_t expected = 0;
+        double baseline = Time([&]() { return CountLowercaseFind(strings, needle); }, expected);
+        Report("tolower + find", strings.size(), bytes, baseline, baseline, expected);
+
+        for (const auto& kernel : CaseInsensitiveFinder::Implementations()) {
+            CaseInsensitiveFinder::UseImplementation(kernel);
+            size_t matches = 0;
+            double seconds = Time([&]() { return CountFinder(strings, needle); }, matches);
+            Report("finder " + kernel, strings.size(), bytes, seconds, baseline, matches);
+            if (matches != expected) std::cout << "    MISMATCH: the " << kernel << " kernel disagrees\n";
+        }
+    }
+    CaseInsensitiveFinder::UseImplementation(original);
+}
+
+} // namespace
+
+// Compares CaseInsensitiveFinder, once per kernel this CPU runs, with
+// lowercasing and std::string::find over 1M URL-and-title sized strings and
+// 10k strings of 2 KB. Arguments: [short strings [long strings]].
+FRW_BENCHMARK(CaseInsensitiveFind) {
+    size_t short_count = !args.empty() ? std::stoul(args[0]) : 1000000;
+    size_t long_count = args.size() > 1 ? std::stoul(args[1]) : 10000;
+    // A common word, a rarer one whose first and last bytes still match
+    // often, and one that never occurs
+    const std::vector<std::string> needles = {"github", "Release Notes", "xylophone"};
+
+    std::mt19937_64 random(5);
+    std::vector<std::string> short_strings;
+    short_strings.reserve(short_count);
+    for (size_t i = 0; i < short_count; ++i) {
+        short_strings.push_back("https://" + RandomText(random, 40 + random() % 60));
+    }
+    RunSet("URLs and titles", short_strings, needles);
+
+    std::vector<std::string> long_strings;
+    long_strings.reserve(long_count);
+    for (size_t i = 0; i < long_count; ++i) {
+        long_strings.push_back(RandomText(random, 2048));
+    }
+    RunSet("2 KB strings", long_strings, needles);
+}
@@ -0,0 +1,181 @@
+#include "BenchHarness.h"
+#include "ContentStore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct Access {
+    std::string key;
+    uint64_t size;
+};
+
+// One "<key> <size-in-bytes>" per line; anything after the size is ignored
+bool LoadTrace(const std::string& path, std::vector<Access>& out) {
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        Access access;
+        if (fields >> access.key >> access.size) out.push_back(std::move(access));
+    }
+    return !out.empty();
+}
+
+// Daily browsing of a few sites (Zipf-distributed small assets, about 6 MB
+// in all) interrupted by scans of 20 MB videos in 256 KiB segments, each
+// watched once
+std::vector<Access> SyntheticTrace() {
+    const size_t kAssets = 600;
+    const size_t kRequests = 40000;
+    const size_t kScanEvery = 4000;
+    const size_t kScanSegments = 80;
+
+    std::mt19937_64 random(42);
+    std::vector<uint64_t> sizes(kAssets);
+    std::vector<double> cumulative(kAssets);
+    double total = 0.0;
+    for (size_t i = 0; i < kAssets; ++i) {
+        sizes[i] = 2048 + random() % 16384;
+        total += 1.0 / std::pow(static_cast<double>(i + 1), 0.8);
+        cumulative[i] = total;
+    }
+
+    std::vector<Access> trace;
+    std::uniform_real_distribution<double> pick(0.0, total);
+    for (size_t i = 0; i < kRequests; ++i) {
+        if (i % kScanEvery == kScanEvery / 2) {
+            for (size_t segment = 0; segment < kScanSegments; ++segment) {
+                trace.push_back({"video" + std::to_string(i) + "/" + std::to_string(segment), 256 * 1024});
+            }
+        }
+        size_t asset = std::lower_bound(cumulative.begin(), cumulative.end(), pick(random)) - cumulative.begin();
+        trace.push_back({"asset" + std::to_string(asset), sizes[asset]});
+    }
+    return trace;
+}
+
+struct Result {
+    uint64_t hits = 0;
+    uint64_t requests = 0;
+    uint64_t hitBytes = 0;
+    uint64_t bytes = 0;
+
+    void Count(bool hit, uint64_t size) {
+        requests++;
+        bytes += size;
+        if (hit) {
+            hits++;
+            hitBytes += size;
+        }
+    }
+};
+
+// Plain LRU with the same two budgets, as the store used before W-TinyLFU
+Result ReplayLru(const std::vector<Access>& trace, uint64_t max_bytes, size_t max_entries) {
+    std::list<std::pair<std::string, uint64_t>> order; // front = most recent
+    std::unordered_map<std::string, decltype(order)::iterator> index;
+    uint64_t used = 0;
+    Result result;
+    for (const auto& access : trace) {
+        auto it = index.find(access.key);
+        result.Count(it != index.end(), access.size);
+        if (it != index.end()) {
+            order.splice(order.begin(), order, it->second);
+            continue;
+        }
+        if (access.size > max_bytes) continue;
+        order.emplace_front(access.key, access.size);
+        index[access.key] = order.begin();
+        used += access.size;
+        while (used > max_bytes || index.size() > max_entries) {
+            used -= order.back().second;
+            index.erase(order.back().first);
+            order.pop_back();
+        }
+    }
+    return result;
+}
+
+// The real ContentStore, in a scratch directory; a miss stores the object
+Result ReplayContentStore(const std::vector<Access>& trace, uint64_t max_bytes, size_t max_entries) {
+    BenchHarness::ScratchDirectory directory;
+    ContentStore& store = ContentStore::Instance();
+    store.SetMaxSize(max_bytes);
+    store.SetMaxEntries(max_entries);
+    store.Open(directory.Path());
+
+    Result result;
+    std::string content;
+    for (const auto& access : trace) {
+        bool hit = store.Map("bafytrace", "/" + access.key) != nullptr;
+        result.Count(hit, access.size);
+        if (hit) continue;
+        // Distinct bytes per key, so deduplication does not skew the budget
+        content.assign(static_cast<size_t>(access.size), '\0');
+        uint64_t seed = std::hash<std::string>()(access.key) | 1;
+        for (size_t i = 0; i + 8 <= content.size(); i += 8) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            std::memcpy(&content[i], &seed, 8);
+        }
+        store.Put("bafytrace", "/" + access.key, content);
+    }
+
+    store.Clear();
+    store.Close();
+    return result;
+}
+
+void Report(const char* policy, const Result& result, double seconds) {
+    std::cout << "  " << std::left << std::setw(12) << policy << std::right << std::fixed << std::setprecision(1)
+              << "hit ratio " << std::setw(5) << 100.0 * result.hits / std::max<uint64_t>(result.requests, 1)
+              << "%   byte hit ratio " << std::setw(5)
+              << 100.0 * result.hitBytes / std::max<uint64_t>(result.bytes, 1) << "%   (" << std::setprecision(2)
+              << seconds << " s)\n";
+}
+
+} // namespace
+
+// Replays an access trace through each eviction policy and reports hit
+// ratios. Arguments: [trace file [cache MB [max entries]]]; without a trace
+// a synthetic one of daily browsing plus video scans is used, against 10 MB.
+FRW_BENCHMARK(EvictionTraceReplay) {
+    std::vector<Access> trace;
+    if (!args.empty() && args[0] != "-") {
+        if (!LoadTrace(args[0], trace)) {
+            std::cout << "  could not read a trace from " << args[0] << "\n";
+            return;
+        }
+    } else {
+        trace = SyntheticTrace();
+    }
+    uint64_t max_bytes = (args.size() > 1 ? std::stoull(args[1]) : 10) * 1024 * 1024;
+    size_t max_entries = args.size() > 2 ? std::stoul(args[2]) : 65536;
+
+    uint64_t bytes = 0;
+    for (const auto& access : trace) bytes += access.size;
+    std::cout << "  " << trace.size() << " requests, " << bytes / (1024 * 1024) << " MB requested, cache "
+              << max_bytes / (1024 * 1024) << " MB / " << max_entries << " entries\n";
+
+    auto start = BenchHarness::Clock::now();
+    Result lru = ReplayLru(trace, max_bytes, max_entries);
+    Report("LRU", lru, BenchHarness::SecondsSince(start));
+
+    start = BenchHarness::Clock::now();
+    Result tinylfu = ReplayContentStore(trace, max_bytes, max_entries);
+    Report("W-TinyLFU", tinylfu, BenchHarness::SecondsSince(start));
+}
@@ -0,0 +1,155 @@
+#include "BenchHarness.h"
+#include "SuggestionIndex.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// As many as HistoryManager asks for
+const size_t kSuggestions = 10;
+
+struct History {
+    std::vector<std::string> urls;
+    std::vector<double> scores;
+};
+
+std::string RandomName(std::mt19937_64& random, size_t syllables) {
+    static const char* const kSyllables[] = {"ka", "ro", "mi", "tel", "on", "sa", "ve", "lin", "da", "pu",
+                                             "ne", "gor", "fi", "wa", "ex", "st", "qu", "ber", "zo", "ham"};
+    std::string name;
+    for (size_t i = 0; i < syllables; ++i) {
+        name += kSyllables[random() % (sizeof(kSyllables) / sizeof(kSyllables[0]))];
+    }
+    return name;
+}
+
+// |entries| URLs over |hosts| sites, with visits spread Zipf-like across
+// the sites as in real history; some are frw:// names
+History MakeHistory(size_t entries, size_t hosts) {
+    std::mt19937_64 random(7);
+    std::vector<std::string> names(hosts);
+    std::vector<double> cumulative(hosts);
+    double total = 0.0;
+    for (size_t i = 0; i < hosts; ++i) {
+        names[i] = RandomName(random, 2 + random() % 3) + std::to_string(i);
+        total += 1.0 / std::pow(static_cast<double>(i + 1), 0.9);
+        cumulative[i] = total;
+    }
+
+    History history;
+    history.urls.reserve(entries);
+    history.scores.reserve(entries);
+    std::uniform_real_distribution<double> pick(0.0, total);
+    std::exponential_distribution<double> score(0.5);
+    for (size_t i = 0; i < entries; ++i) {
+        size_t host = std::lower_bound(cumulative.begin(), cumulative.end(), pick(random)) - cumulative.begin();
+        std::string url;
+        switch (host % 10) {
+            case 0: url = "frw://" + names[host] + "/"; break;
+            case 1: url = "http://" + names[host] + ".org/"; break;
+            default: url = "https://www." + names[host] + ".com/"; break;
+        }
+        url += RandomName(random, 1 + random() % 3) + "/" + std::to_string(i);
+        history.urls.push_back(std::move(url));
+        history.scores.push_back(score(random));
+    }
+    return history;
+}
+
+// GetSuggestions before the index: every URL lowercased on each keystroke,
+// the first strict prefix matches in insertion order. Text typed without
+// its scheme matched nothing, so these scans run the whole history.
+std::vector<std::string> LinearScan(const std::vector<std::string>& urls, const std::string& typed) {
+    std::vector<std::string> suggestions;
+    std::string lower_typed = typed;
+    std::transform(lower_typed.begin(), lower_typed.end(), lower_typed.begin(), ::tolower);
+    for (const auto& url : urls) {
+        std::string lower_url = url;
+        std::transform(lower_url.begin(), lower_url.end(), lower_url.begin(), ::tolower);
+        if (lower_url.find(lower_typed) == 0) {
+            suggestions.push_back(url);
+            if (suggestions.size() >= kSuggestions) break;
+        }
+    }
+    return suggestions;
+}
+
+void Report(const char* label, std::vector<double> micros) {
+    std::sort(micros.begin(), micros.end());
+    double sum = 0.0;
+    for (double value : micros) sum += value;
+    size_t under = std::lower_bound(micros.begin(), micros.end(), 1000.0) - micros.begin();
+    auto at = [&micros](double quantile) { return micros[static_cast<size_t>(quantile * (micros.size() - 1))]; };
+    std::cout << "  " << std::left << std::setw(24) << label << std::right << std::fixed << std::setprecision(2)
+              << "mean " << std::setw(9) << sum / micros.size() << " us   p50 " << std::setw(9) << at(0.5)
+              << " us   p99 " << std::setw(9) << at(0.99) << " us   max " << std::setw(9) << micros.back()
+              << " us   under 1 ms " << std::setprecision(1) << 100.0 * under / micros.size() << "%  ("
+              << micros.size() << " keystrokes)\n";
+}
+
+} // namespace
+
+// Types URLs from the history one character at a time and times the lookup
+// after each keystroke, while visits keep changing scores. Arguments:
+// [entries [hosts [scanned keystrokes]]], by default 1000000 over 60000 hosts;
+// the old linear scan is timed on the first 200 keystrokes only.
+FRW_BENCHMARK(SuggestionLatency) {
+    size_t entries = !args.empty() ? std::stoul(args[0]) : 1000000;
+    size_t hosts = args.size() > 1 ? std::stoul(args[1]) : 60000;
+    size_t scanned = args.size() > 2 ? std::stoul(args[2]) : 200;
+    History history = MakeHistory(entries, std::max<size_t>(hosts, 1));
+
+    auto start = BenchHarness::Clock::now();
+    SuggestionIndex index;
+    for (size_t i = 0; i < entries; ++i) {
+        index.Update(history.urls[i], history.scores[i]);
+    }
+    std::cout << "  " << index.Size() << " URLs over " << hosts << " hosts, indexed in " << std::fixed
+              << std::setprecision(2) << BenchHarness::SecondsSince(start) << " s\n";
+
+    // Typed as the user would: without the scheme, then up to 24 characters
+    std::mt19937_64 random(11);
+    std::vector<std::string> keystrokes;
+    while (keystrokes.size() < 20000) {
+        std::string target = SuggestionIndex::Normalize(history.urls[random() % entries]);
+        for (size_t length = 1; length <= std::min<size_t>(target.size(), 24); ++length) {
+            keystrokes.push_back(target.substr(0, length));
+        }
+    }
+
+    // A visit between keystrokes moves a URL up, as in a live session
+    std::vector<double> lookups;
+    std::vector<double> updates;
+    uint64_t found = 0;
+    for (const auto& typed : keystrokes) {
+        size_t visited = random() % entries;
+        history.scores[visited] += 1.0;
+        start = BenchHarness::Clock::now();
+        index.Update(history.urls[visited], history.scores[visited]);
+        updates.push_back(BenchHarness::SecondsSince(start) * 1e6);
+
+        start = BenchHarness::Clock::now();
+        std::vector<std::string> suggestions = index.Lookup(typed, kSuggestions);
+        lookups.push_back(BenchHarness::SecondsSince(start) * 1e6);
+        found += suggestions.size();
+    }
+    BenchHarness::Consume(found);
+    Report("SuggestionIndex lookup", lookups);
+    Report("score update", updates);
+
+    std::vector<double> scans;
+    for (size_t i = 0; i < std::min(scanned, keystrokes.size()); ++i) {
+        start = BenchHarness::Clock::now();
+        std::vector<std::string> suggestions = LinearScan(history.urls, keystrokes[i]);
+        scans.push_back(BenchHarness::SecondsSince(start) * 1e6);
+        BenchHarness::Consume(suggestions.size());
+    }
+    if (!scans.empty()) Report("linear scan (before)", scans);
+}
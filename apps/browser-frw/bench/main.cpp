@@ -0,0 +1,46 @@
+#include "BenchHarness.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+std::vector<BenchHarness::Benchmark>& BenchHarness::Benchmarks() {
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+BenchHarness::ScratchDirectory::ScratchDirectory() {
+    auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+    path_ = (std::filesystem::temp_directory_path() / ("frw-bench-" + std::to_string(stamp))).string();
+    std::filesystem::create_directories(path_);
+}
+
+BenchHarness::ScratchDirectory::~ScratchDirectory() {
+    std::error_code ec;
+    std::filesystem::remove_all(path_, ec);
+}
+
+void BenchHarness::Consume(uint64_t value) {
+    static std::atomic<uint64_t> sink{0};
+    sink.fetch_xor(value, std::memory_order_relaxed);
+}
+
+// frw-browser-bench [name-filter [benchmark arguments...]]
+int main(int argc, char** argv) {
+    std::vector<std::string> args(argv + std::min(argc, 2), argv + argc);
+    int run = 0;
+    for (const auto& benchmark : BenchHarness::Benchmarks()) {
+        if (argc > 1 && !std::strstr(benchmark.name, argv[1])) continue;
+        std::cout << "== " << benchmark.name << std::endl;
+        benchmark.run(args);
+        run++;
+    }
+    if (run == 0) {
+        std::cerr << "No benchmark matches; available:\n";
+        for (const auto& benchmark : BenchHarness::Benchmarks()) std::cerr << "  " << benchmark.name << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include "BandwidthScheduler.h"
+#include "CancellationToken.h"
+#include "UI/SettingsManager.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+using Clock = BandwidthScheduler::Clock;
+
+const double kRateWindowSeconds = 0.25;
+const double kSmoothing = 0.6;            // Weight of the newest sample
+const double kBurstSeconds = 0.1;         // Bucket depth, in seconds of its rate
+const double kMinBurst = 16 * 1024;
+// Smaller reads cost more in per-call overhead than they help with pacing
+const size_t kMinGrant = 4 * 1024;
+const double kShareOfCapacity = 0.1;      // What a class gets while it gives way
+const double kMinShareRate = 32 * 1024;   // Before any capacity has been seen
+const double kCapacityHalfLifeSeconds = 60.0;
+const auto kPollInterval = std::chrono::milliseconds(10);
+
+double Seconds(Clock::duration duration) {
+    return std::chrono::duration<double>(duration).count();
+}
+
+} // namespace
+
+void BandwidthScheduler::Meter::Add(uint64_t bytes, Clock::time_point now) {
+    Roll(now);
+    bytes_ += bytes;
+}
+
+double BandwidthScheduler::Meter::Rate(Clock::time_point now) {
+    Roll(now);
+    return rate_;
+}
+
+void BandwidthScheduler::Meter::Roll(Clock::time_point now) {
+    if (windowStart_ == Clock::time_point()) {
+        windowStart_ = now;
+        return;
+    }
+    double elapsed = Seconds(now - windowStart_);
+    if (elapsed < kRateWindowSeconds) return;
+
+    double sample = static_cast<double>(bytes_) / elapsed;
+    // After an idle gap the old rate says nothing about the current one
+    rate_ = elapsed > 4 * kRateWindowSeconds ? sample : kSmoothing * sample + (1.0 - kSmoothing) * rate_;
+    bytes_ = 0;
+    windowStart_ = now;
+}
+
+void BandwidthScheduler::Bucket::Refill(double rate, Clock::time_point now) {
+    double depth = std::max(rate * kBurstSeconds, kMinBurst);
+    if (refilled == Clock::time_point()) {
+        tokens = depth;
+    } else {
+        tokens = std::min(depth, tokens + rate * Seconds(now - refilled));
+    }
+    refilled = now;
+}
+
+BandwidthScheduler::Transfer::Transfer(TrafficClass traffic_class) : class_(traffic_class) {
+    auto& scheduler = BandwidthScheduler::Instance();
+    std::lock_guard<std::mutex> lock(scheduler.mutex_);
+    scheduler.active_[static_cast<int>(class_)]++;
+}
+
+BandwidthScheduler::Transfer::~Transfer() {
+    auto& scheduler = BandwidthScheduler::Instance();
+    {
+        std::lock_guard<std::mutex> lock(scheduler.mutex_);
+        scheduler.active_[static_cast<int>(class_)]--;
+    }
+    scheduler.wake_.notify_all();
+}
+
+BandwidthScheduler& BandwidthScheduler::Instance() {
+    static BandwidthScheduler instance;
+    return instance;
+}
+
+size_t BandwidthScheduler::Acquire(TrafficClass traffic_class, BandwidthFlow* flow, size_t want,
+                                   const std::shared_ptr<CancellationToken>& cancel) {
+    const int index = static_cast<int>(traffic_class);
+    const double global_limit = SettingsManager::Instance().GetSettings().bandwidthLimitKBps * 1024.0;
+    const double flow_limit = flow ? static_cast<double>(flow->Limit()) : 0.0;
+    const double needed = static_cast<double>(std::min(want, kMinGrant));
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    size_t granted = 0;
+    Clock::time_point now;
+    while (want > 0 && !(cancel && cancel->IsCancelled())) {
+        now = Clock::now();
+        UpdateCapacity(now);
+
+        double allowed = static_cast<double>(want);
+        if (flow_limit > 0) {
+            flow->bucket_.Refill(flow_limit, now);
+            allowed = std::min(allowed, flow->bucket_.tokens);
+        }
+        if (global_limit > 0) {
+            global_.Refill(global_limit, now);
+            allowed = std::min(allowed, global_.tokens);
+        }
+        bool gives_way = GivesWay(index);
+        if (gives_way) {
+            shares_[index].Refill(ShareRate(global_limit), now);
+            allowed = std::min(allowed, shares_[index].tokens);
+        }
+
+        if (allowed >= needed) {
+            granted = static_cast<size_t>(allowed);
+            if (flow_limit > 0) flow->bucket_.tokens -= granted;
+            if (global_limit > 0) global_.tokens -= granted;
+            if (gives_way) shares_[index].tokens -= granted;
+            break;
+        }
+        wake_.wait_for(lock, kPollInterval);
+    }
+
+    if (granted > 0) {
+        meters_[index].Add(granted, now);
+        total_.Add(granted, now);
+        if (flow) flow->meter_.Add(granted, now);
+    }
+    return granted;
+}
+
+double BandwidthScheduler::Rate(TrafficClass traffic_class) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return meters_[static_cast<int>(traffic_class)].Rate(Clock::now());
+}
+
+double BandwidthScheduler::Rate(BandwidthFlow& flow) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return flow.meter_.Rate(Clock::now());
+}
+
+bool BandwidthScheduler::GivesWay(int traffic_class) const {
+    for (int i = 0; i < traffic_class; ++i) {
+        if (active_[i] > 0) return true;
+    }
+    return false;
+}
+
+double BandwidthScheduler::ShareRate(double global_limit) const {
+    double capacity = global_limit > 0 ? global_limit : capacity_;
+    return std::max(capacity * kShareOfCapacity, kMinShareRate);
+}
+
+void BandwidthScheduler::UpdateCapacity(Clock::time_point now) {
+    double elapsed = capacityUpdated_ == Clock::time_point() ? 0.0 : Seconds(now - capacityUpdated_);
+    capacityUpdated_ = now;
+
+    // While some class gives way the total is held down on purpose and says
+    // nothing about what the link could carry, so the estimate only decays
+    // when nothing is throttled
+    bool throttled = false;
+    for (int i = 0; i < kClasses; ++i) {
+        throttled = throttled || (active_[i] > 0 && GivesWay(i));
+    }
+    if (!throttled) capacity_ *= std::pow(0.5, elapsed / kCapacityHalfLifeSeconds);
+    capacity_ = std::max(capacity_, total_.Rate(now));
+}
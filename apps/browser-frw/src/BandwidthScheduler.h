@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+
+class CancellationToken;
+class BandwidthFlow;
+
+// What a transfer is for, most urgent first
+enum class TrafficClass {
+    RenderBlocking, // Documents, stylesheets, scripts and fonts a page waits on; name lookups
+    PageAsset,      // Anything else a page asked for
+    Prefetch,       // Fetched ahead of need: preloads and site bundles
+    Download,
+    Count
+};
+
+// Shares the link among all HTTP transfers. ResolverBridge::HttpGet asks
+// for tokens before every read, so a connection receives only as fast as it
+// is allowed to and TCP flow control slows the sender down to match:
+// - a global token bucket enforces bandwidth_limit_kbps;
+// - while a more urgent class has transfers in flight, a class is held to a
+//   small share of the link (the global cap, or the highest rate seen), so a
+//   large download cannot crowd out a page that is loading, yet never stalls;
+// - a BandwidthFlow caps one transfer across all of its connections.
+// Granted bytes feed smoothed per-class and per-flow rates.
+class BandwidthScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Bytes per second, sampled over short windows and smoothed
+    class Meter {
+    public:
+        void Add(uint64_t bytes, Clock::time_point now);
+        double Rate(Clock::time_point now);
+
+    private:
+        Clock::time_point windowStart_;
+        uint64_t bytes_ = 0;
+        double rate_ = 0.0;
+
+        void Roll(Clock::time_point now);
+    };
+
+    // Refills at a given rate, up to a short burst
+    struct Bucket {
+        double tokens = 0.0;
+        Clock::time_point refilled;
+
+        void Refill(double rate, Clock::time_point now);
+    };
+
+    // Counts a transfer as in flight for its lifetime
+    class Transfer {
+    public:
+        explicit Transfer(TrafficClass traffic_class);
+        ~Transfer();
+
+        Transfer(const Transfer&) = delete;
+        Transfer& operator=(const Transfer&) = delete;
+
+    private:
+        TrafficClass class_;
+    };
+
+    static BandwidthScheduler& Instance();
+
+    // Blocks until some of |want| bytes may be received and returns how many
+    // (at least one); returns 0 once |cancel| is cancelled. |flow| may be null.
+    size_t Acquire(TrafficClass traffic_class, BandwidthFlow* flow, size_t want,
+                   const std::shared_ptr<CancellationToken>& cancel);
+
+    double Rate(TrafficClass traffic_class);
+    double Rate(BandwidthFlow& flow);
+
+private:
+    BandwidthScheduler() = default;
+
+    static const int kClasses = static_cast<int>(TrafficClass::Count);
+
+    std::mutex mutex_;
+    std::condition_variable wake_; // A transfer ended
+    int active_[kClasses] = {};
+    Bucket global_;
+    Bucket shares_[kClasses];      // Used while the class gives way
+    Meter meters_[kClasses];
+    Meter total_;
+    double capacity_ = 0.0;        // Highest total rate seen, decaying while unthrottled
+    Clock::time_point capacityUpdated_;
+
+    bool GivesWay(int traffic_class) const;
+    double ShareRate(double global_limit) const;
+    void UpdateCapacity(Clock::time_point now);
+};
+
+// Caps one logical transfer, such as a download, across all of its
+// connections, and measures their combined rate
+class BandwidthFlow {
+public:
+    explicit BandwidthFlow(int64_t limit = 0) : limit_(limit) {}
+
+    // Bytes per second; 0 for no cap
+    void SetLimit(int64_t limit) { limit_ = limit; }
+    int64_t Limit() const { return limit_.load(); }
+    double Rate() { return BandwidthScheduler::Instance().Rate(*this); }
+
+private:
+    friend class BandwidthScheduler;
+
+    std::atomic<int64_t> limit_;
+    // Guarded by the scheduler's lock
+    BandwidthScheduler::Bucket bucket_;
+    BandwidthScheduler::Meter meter_;
+};
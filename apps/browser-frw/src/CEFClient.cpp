@@ -10,12 +10,14 @@
 #include "UI/TabManager.h"
 #include "UI/HistoryManager.h"
 #include "UI/PrivacyManager.h"
+#include "FrwProviderChain.h"
 
 // CefClient methods
 CefRefPtr<CefLifeSpanHandler> FrwClient::GetLifeSpanHandler() { return this; }
 CefRefPtr<CefDisplayHandler> FrwClient::GetDisplayHandler() { return this; }
 CefRefPtr<CefLoadHandler> FrwClient::GetLoadHandler() { return this; }
 CefRefPtr<CefContextMenuHandler> FrwClient::GetContextMenuHandler() { return this; }
+CefRefPtr<CefRequestHandler> FrwClient::GetRequestHandler() { return this; }
 
 // CefLifeSpanHandler methods
 void FrwClient::OnAfterCreated(CefRefPtr<CefBrowser> browser) {
@@ -28,6 +30,8 @@ void FrwClient::OnAfterCreated(CefRefPtr<CefBrowser> browser) {
 }
 
 void FrwClient::OnBeforeClose(CefRefPtr<CefBrowser> browser) {
+    FrwProviderChain::Instance().OnBrowserClosed(browser->GetIdentifier());
+
     // Update tab manager
     auto& tabManager = TabManager::Instance();
     auto tabs = tabManager.GetAllTabs();
@@ -63,9 +67,9 @@ void FrwClient::OnTitleChange(CefRefPtr<CefBrowser> browser,
         }
     }
     
-    // Update history
+    // Only the title; the visit was counted when the address changed
     std::string url = browser->GetMainFrame()->GetURL().ToString();
-    HistoryManager::Instance().AddEntry(url, title.ToString());
+    HistoryManager::Instance().UpdateTitle(url, title.ToString());
 }
 
 void FrwClient::OnAddressChange(CefRefPtr<CefBrowser> browser,
@@ -80,6 +84,11 @@ void FrwClient::OnAddressChange(CefRefPtr<CefBrowser> browser,
             break;
         }
     }
+
+    // One visit per navigation of the page; its title follows separately
+    if (frame->IsMain()) {
+        HistoryManager::Instance().AddEntry(url.ToString(), std::string());
+    }
     
     // Update menu states
     MenuManager::Instance().UpdateMenuStates();
@@ -125,3 +134,31 @@ void FrwClient::OnContextMenuDismissed(CefRefPtr<CefBrowser> browser,
                                 CefRefPtr<CefFrame> frame) {
     ContextMenuManager::Instance().OnContextMenuDismissed(browser, frame);
 }
+
+// CefRequestHandler methods
+CefRefPtr<CefResourceRequestHandler> FrwClient::GetResourceRequestHandler(CefRefPtr<CefBrowser> browser,
+                                                                          CefRefPtr<CefFrame> frame,
+                                                                          CefRefPtr<CefRequest> request,
+                                                                          bool is_navigation,
+                                                                          bool is_download,
+                                                                          const CefString& request_initiator,
+                                                                          bool& disable_default_handling) {
+    // Only frw:// requests go through the provider chain
+    std::string url = request->GetURL().ToString();
+    if (url.compare(0, 6, "frw://") != 0) return nullptr;
+    return this;
+}
+
+// CefResourceRequestHandler methods
+cef_return_value_t FrwClient::OnBeforeResourceLoad(CefRefPtr<CefBrowser> browser,
+                                                   CefRefPtr<CefFrame> frame,
+                                                   CefRefPtr<CefRequest> request,
+                                                   CefRefPtr<CefCallback> callback) {
+    return FrwProviderChain::Instance().OnBeforeResourceLoad(browser, frame, request, callback);
+}
+
+CefRefPtr<CefResourceHandler> FrwClient::GetResourceHandler(CefRefPtr<CefBrowser> browser,
+                                                            CefRefPtr<CefFrame> frame,
+                                                            CefRefPtr<CefRequest> request) {
+    return FrwProviderChain::Instance().GetResourceHandler(browser, frame, request);
+}
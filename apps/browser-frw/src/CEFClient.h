@@ -1,12 +1,16 @@
 #pragma once
 
 #include "cef_client.h"
+#include "cef_request_handler.h"
+#include "cef_resource_request_handler.h"
 
 class FrwClient : public CefClient,
                  public CefLifeSpanHandler,
                  public CefDisplayHandler,
                  public CefLoadHandler,
-                 public CefContextMenuHandler {
+                 public CefContextMenuHandler,
+                 public CefRequestHandler,
+                 public CefResourceRequestHandler {
 public:
     FrwClient() = default;
 
@@ -15,6 +19,7 @@ public:
     CefRefPtr<CefDisplayHandler> GetDisplayHandler() override;
     CefRefPtr<CefLoadHandler> GetLoadHandler() override;
     CefRefPtr<CefContextMenuHandler> GetContextMenuHandler() override;
+    CefRefPtr<CefRequestHandler> GetRequestHandler() override;
 
     // CefLifeSpanHandler methods
     void OnAfterCreated(CefRefPtr<CefBrowser> browser) override;
@@ -46,6 +51,24 @@ public:
     void OnContextMenuDismissed(CefRefPtr<CefBrowser> browser,
                                 CefRefPtr<CefFrame> frame) override;
 
+    // CefRequestHandler methods
+    CefRefPtr<CefResourceRequestHandler> GetResourceRequestHandler(CefRefPtr<CefBrowser> browser,
+                                                                   CefRefPtr<CefFrame> frame,
+                                                                   CefRefPtr<CefRequest> request,
+                                                                   bool is_navigation,
+                                                                   bool is_download,
+                                                                   const CefString& request_initiator,
+                                                                   bool& disable_default_handling) override;
+
+    // CefResourceRequestHandler methods
+    cef_return_value_t OnBeforeResourceLoad(CefRefPtr<CefBrowser> browser,
+                                            CefRefPtr<CefFrame> frame,
+                                            CefRefPtr<CefRequest> request,
+                                            CefRefPtr<CefCallback> callback) override;
+    CefRefPtr<CefResourceHandler> GetResourceHandler(CefRefPtr<CefBrowser> browser,
+                                                     CefRefPtr<CefFrame> frame,
+                                                     CefRefPtr<CefRequest> request) override;
+
 private:
     IMPLEMENT_REFCOUNTING(FrwClient);
     DISALLOW_COPY_AND_ASSIGN(FrwClient);
@@ -0,0 +1,26 @@
+#include "CancellationToken.h"
+
+void CancellationToken::Cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cancelled_.exchange(true)) return;
+    for (auto& callback : callbacks_) {
+        callback.second();
+    }
+    callbacks_.clear();
+}
+
+int CancellationToken::Register(std::function<void()> on_cancel) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cancelled_.load()) {
+        on_cancel();
+        return 0;
+    }
+    int id = nextId_++;
+    callbacks_.emplace(id, std::move(on_cancel));
+    return id;
+}
+
+void CancellationToken::Unregister(int id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    callbacks_.erase(id);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <atomic>
+
+// Shared flag used to abandon in-flight work. Blocking operations register a
+// callback that interrupts them (e.g. closing a WinHTTP handle), so they stop
+// as soon as Cancel() runs instead of at their next check.
+class CancellationToken {
+public:
+    CancellationToken() = default;
+
+    CancellationToken(const CancellationToken&) = delete;
+    CancellationToken& operator=(const CancellationToken&) = delete;
+
+    void Cancel();
+    bool IsCancelled() const { return cancelled_.load(); }
+
+    // Runs |on_cancel| when Cancel() is called, or right away if it already
+    // was. Callbacks run under the token's lock and must not call back into
+    // it. Returns an id for Unregister, or 0 if the callback already ran.
+    int Register(std::function<void()> on_cancel);
+    // Once this returns the callback is neither running nor going to run
+    void Unregister(int id);
+
+private:
+    std::mutex mutex_;
+    std::atomic<bool> cancelled_{false};
+    std::map<int, std::function<void()>> callbacks_;
+    int nextId_ = 1;
+};
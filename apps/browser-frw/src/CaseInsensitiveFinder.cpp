@@ -0,0 +1,225 @@
+#include "CaseInsensitiveFinder.h"
+
+#include <atomic>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define FRW_FINDER_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define FRW_TARGET(isa) __attribute__((target(isa)))
+#define FRW_FORCE_INLINE inline __attribute__((always_inline))
+#else
+#define FRW_TARGET(isa)
+#define FRW_FORCE_INLINE __forceinline
+#endif
+
+namespace {
+
+using Kernel = size_t (*)(const char* data, size_t size, const char* folded, const char* bits, size_t length);
+
+// ORing 0x20 into an uppercase letter lowercases it and leaves a lowercase
+// one as it is, so (byte | 0x20) == 'k' holds exactly for 'k' and 'K'
+inline bool RestMatches(const char* data, const char* folded, const char* bits, size_t length) {
+    for (size_t i = 1; i + 1 < length; ++i) {
+        if ((data[i] | bits[i]) != folded[i]) return false;
+    }
+    return true;
+}
+
+size_t FindScalar(const char* data, size_t size, const char* folded, const char* bits, size_t length) {
+    char first = folded[0], firstBit = bits[0];
+    char last = folded[length - 1], lastBit = bits[length - 1];
+    for (size_t i = 0; i + length <= size; ++i) {
+        if ((data[i] | firstBit) == first && (data[i + length - 1] | lastBit) == last &&
+            RestMatches(data + i, folded, bits, length)) {
+            return i;
+        }
+    }
+    return std::string::npos;
+}
+
+#ifdef FRW_FINDER_X86
+
+inline int LowestBit(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Inlined into both kernels: the AVX2 one must not call SSE code compiled
+// for the older encoding, as switching between the two stalls the CPU
+FRW_TARGET("sse2") FRW_FORCE_INLINE
+size_t FindBy16(const char* data, size_t size, const char* folded, const char* bits, size_t length) {
+    const __m128i first = _mm_set1_epi8(folded[0]);
+    const __m128i firstBit = _mm_set1_epi8(bits[0]);
+    const __m128i last = _mm_set1_epi8(folded[length - 1]);
+    const __m128i lastBit = _mm_set1_epi8(bits[length - 1]);
+
+    size_t i = 0;
+    // Both loads stay inside the haystack
+    for (; i + length - 1 + 16 <= size; i += 16) {
+        __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + length - 1));
+        __m128i hits = _mm_and_si128(_mm_cmpeq_epi8(_mm_or_si128(head, firstBit), first),
+                                     _mm_cmpeq_epi8(_mm_or_si128(tail, lastBit), last));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+        while (mask) {
+            int offset = LowestBit(mask);
+            if (RestMatches(data + i + offset, folded, bits, length)) return i + offset;
+            mask &= mask - 1;
+        }
+    }
+    size_t rest = FindScalar(data + i, size - i, folded, bits, length);
+    return rest == std::string::npos ? rest : i + rest;
+}
+
+FRW_TARGET("sse2")
+size_t FindSse2(const char* data, size_t size, const char* folded, const char* bits, size_t length) {
+    return FindBy16(data, size, folded, bits, length);
+}
+
+FRW_TARGET("avx2")
+size_t FindAvx2(const char* data, size_t size, const char* folded, const char* bits, size_t length) {
+    const __m256i first = _mm256_set1_epi8(folded[0]);
+    const __m256i firstBit = _mm256_set1_epi8(bits[0]);
+    const __m256i last = _mm256_set1_epi8(folded[length - 1]);
+    const __m256i lastBit = _mm256_set1_epi8(bits[length - 1]);
+
+    size_t i = 0;
+    for (; i + length - 1 + 32 <= size; i += 32) {
+        __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + length - 1));
+        __m256i hits = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_or_si256(head, firstBit), first),
+                                        _mm256_cmpeq_epi8(_mm256_or_si256(tail, lastBit), last));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+        while (mask) {
+            int offset = LowestBit(mask);
+            if (RestMatches(data + i + offset, folded, bits, length)) return i + offset;
+            mask &= mask - 1;
+        }
+    }
+    // Short strings, and the end of long ones, go 16 at a time
+    size_t rest = FindBy16(data + i, size - i, folded, bits, length);
+    return rest == std::string::npos ? rest : i + rest;
+}
+
+void CpuId(int info[4], int leaf) {
+#ifdef _MSC_VER
+    __cpuidex(info, leaf, 0);
+#else
+    unsigned a, b, c, d;
+    __cpuid_count(leaf, 0, a, b, c, d);
+    info[0] = static_cast<int>(a);
+    info[1] = static_cast<int>(b);
+    info[2] = static_cast<int>(c);
+    info[3] = static_cast<int>(d);
+#endif
+}
+
+bool HasSse2() {
+    int info[4];
+    CpuId(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+}
+
+bool HasAvx2() {
+    int info[4];
+    CpuId(info, 0);
+    if (info[0] < 7) return false;
+    CpuId(info, 1);
+    // The OS must also save the YMM registers across context switches
+    bool osSavesAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28));
+    if (!osSavesAvx) return false;
+#ifdef _MSC_VER
+    unsigned long long xcr0 = _xgetbv(0);
+#else
+    unsigned eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    unsigned long long xcr0 = (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+    if ((xcr0 & 6) != 6) return false;
+    CpuId(info, 7);
+    return (info[1] & (1 << 5)) != 0;
+}
+
+#endif // FRW_FINDER_X86
+
+struct Dispatch {
+    Kernel kernel;
+    const char* name;
+};
+
+const Dispatch kScalar = {FindScalar, "scalar"};
+#ifdef FRW_FINDER_X86
+const Dispatch kSse2 = {FindSse2, "sse2"};
+const Dispatch kAvx2 = {FindAvx2, "avx2"};
+#endif
+
+// The kernels this CPU can run, best first
+std::vector<const Dispatch*> Supported() {
+    std::vector<const Dispatch*> supported;
+#ifdef FRW_FINDER_X86
+    if (HasAvx2()) supported.push_back(&kAvx2);
+    if (HasSse2()) supported.push_back(&kSse2);
+#endif
+    supported.push_back(&kScalar);
+    return supported;
+}
+
+std::atomic<const Dispatch*>& Current() {
+    static std::atomic<const Dispatch*> current{Supported().front()};
+    return current;
+}
+
+const Dispatch& PickKernel() {
+    return *Current().load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+CaseInsensitiveFinder::CaseInsensitiveFinder(const std::string& needle) : folded_(needle), caseBits_(needle.size(), 0) {
+    for (size_t i = 0; i < folded_.size(); ++i) {
+        char c = folded_[i];
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        if (c >= 'a' && c <= 'z') caseBits_[i] = 0x20;
+        folded_[i] = c;
+    }
+}
+
+size_t CaseInsensitiveFinder::FindIn(const char* data, size_t size) const {
+    if (folded_.empty()) return 0;
+    if (folded_.size() > size) return std::string::npos;
+    return PickKernel().kernel(data, size, folded_.data(), caseBits_.data(), folded_.size());
+}
+
+const char* CaseInsensitiveFinder::Implementation() {
+    return PickKernel().name;
+}
+
+std::vector<std::string> CaseInsensitiveFinder::Implementations() {
+    std::vector<std::string> names;
+    for (const Dispatch* dispatch : Supported()) {
+        names.push_back(dispatch->name);
+    }
+    return names;
+}
+
+bool CaseInsensitiveFinder::UseImplementation(const std::string& name) {
+    for (const Dispatch* dispatch : Supported()) {
+        if (name != dispatch->name) continue;
+        Current().store(dispatch, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Finds a string inside others, ignoring the case of ASCII letters; every
+// other byte, UTF-8 included, must match exactly (as with tolower in the C
+// locale). The needle is prepared once and then searched for in as many
+// strings as needed without copying or lowercasing them.
+//
+// The search compares the needle's first and last bytes against 32 (AVX2)
+// or 16 (SSE2) positions at a time and checks the rest only where both
+// match. The kernel is picked once for the CPU it runs on; other CPUs use a
+// scalar loop doing the same checks.
+class CaseInsensitiveFinder {
+public:
+    explicit CaseInsensitiveFinder(const std::string& needle);
+
+    // Offset of the first match, or std::string::npos
+    size_t FindIn(const char* data, size_t size) const;
+    size_t FindIn(const std::string& haystack) const { return FindIn(haystack.data(), haystack.size()); }
+    bool IsIn(const std::string& haystack) const { return FindIn(haystack) != std::string::npos; }
+
+    // The kernel in use: "avx2", "sse2" or "scalar"
+    static const char* Implementation();
+    // The kernels this CPU can run, best first
+    static std::vector<std::string> Implementations();
+    // Switches every finder to one of Implementations(), so benchmarks and
+    // tests can compare them; returns false for any other name
+    static bool UseImplementation(const std::string& name);
+
+private:
+    std::string folded_;   // The needle, lowercased
+    std::string caseBits_; // 0x20 under each letter, 0 elsewhere: (byte | bit) == folded byte
+};
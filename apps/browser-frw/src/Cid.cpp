@@ -0,0 +1,171 @@
+#include "Cid.h"
+#include "Sha256.h"
+#include <vector>
+
+namespace {
+
+const char kBase32Alphabet[] = "abcdefghijklmnopqrstuvwxyz234567";
+const char kBase58Alphabet[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+bool DecodeBase32(const std::string& text, std::string& out) {
+    out.clear();
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (char c : text) {
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        const char* found = nullptr;
+        for (const char* p = kBase32Alphabet; *p; ++p) {
+            if (*p == c) {
+                found = p;
+                break;
+            }
+        }
+        if (!found) return false;
+        buffer = (buffer << 5) | static_cast<uint32_t>(found - kBase32Alphabet);
+        bits += 5;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back(static_cast<char>((buffer >> bits) & 0xff));
+        }
+    }
+    return true;
+}
+
+std::string EncodeBase32(const std::string& bytes) {
+    std::string out;
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (unsigned char c : bytes) {
+        buffer = (buffer << 8) | c;
+        bits += 8;
+        while (bits >= 5) {
+            bits -= 5;
+            out.push_back(kBase32Alphabet[(buffer >> bits) & 0x1f]);
+        }
+    }
+    if (bits > 0) {
+        out.push_back(kBase32Alphabet[(buffer << (5 - bits)) & 0x1f]);
+    }
+    return out;
+}
+
+bool DecodeBase58(const std::string& text, std::string& out) {
+    std::vector<uint8_t> result;
+    for (char c : text) {
+        const char* found = nullptr;
+        for (const char* p = kBase58Alphabet; *p; ++p) {
+            if (*p == c) {
+                found = p;
+                break;
+            }
+        }
+        if (!found) return false;
+
+        uint32_t carry = static_cast<uint32_t>(found - kBase58Alphabet);
+        for (auto it = result.rbegin(); it != result.rend(); ++it) {
+            carry += static_cast<uint32_t>(*it) * 58;
+            *it = static_cast<uint8_t>(carry & 0xff);
+            carry >>= 8;
+        }
+        while (carry > 0) {
+            result.insert(result.begin(), static_cast<uint8_t>(carry & 0xff));
+            carry >>= 8;
+        }
+    }
+
+    // Leading '1's encode leading zero bytes
+    size_t zeros = 0;
+    while (zeros < text.size() && text[zeros] == '1') ++zeros;
+    out.assign(zeros, '\0');
+    out.append(result.begin(), result.end());
+    return true;
+}
+
+} // namespace
+
+bool ReadVarint(const uint8_t*& pos, const uint8_t* end, uint64_t& out) {
+    out = 0;
+    for (int shift = 0; shift < 64 && pos < end; shift += 7) {
+        uint8_t byte = *pos++;
+        out |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+void AppendVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool Cid::Parse(const std::string& text, Cid& out) {
+    std::string bytes;
+    if (text.size() == 46 && text[0] == 'Q' && text[1] == 'm') {
+        if (!DecodeBase58(text, bytes)) return false;
+    } else if (!text.empty() && text[0] == 'b') {
+        if (!DecodeBase32(text.substr(1), bytes)) return false;
+    } else {
+        return false; // Other multibase encodings are not supported
+    }
+
+    const uint8_t* pos = reinterpret_cast<const uint8_t*>(bytes.data());
+    const uint8_t* end = pos + bytes.size();
+    return FromBytes(pos, end, out) && pos == end;
+}
+
+bool Cid::FromBytes(const uint8_t*& pos, const uint8_t* end, Cid& out) {
+    const uint8_t* start = pos;
+
+    // CIDv0 is a bare sha2-256 multihash
+    if (end - pos >= 34 && pos[0] == kHashSha256 && pos[1] == 32) {
+        out.version_ = 0;
+        out.codec_ = kCodecDagPb;
+        out.hashCode_ = kHashSha256;
+        out.digest_.assign(reinterpret_cast<const char*>(pos + 2), 32);
+        pos += 34;
+        out.bytes_.assign(reinterpret_cast<const char*>(start), 34);
+        return true;
+    }
+
+    uint64_t version = 0, codec = 0, hash_code = 0, digest_size = 0;
+    if (!ReadVarint(pos, end, version) || version != 1) return false;
+    if (!ReadVarint(pos, end, codec)) return false;
+    if (!ReadVarint(pos, end, hash_code)) return false;
+    if (!ReadVarint(pos, end, digest_size)) return false;
+    if (static_cast<uint64_t>(end - pos) < digest_size) return false;
+
+    out.version_ = 1;
+    out.codec_ = codec;
+    out.hashCode_ = hash_code;
+    out.digest_.assign(reinterpret_cast<const char*>(pos), static_cast<size_t>(digest_size));
+    pos += digest_size;
+    out.bytes_.assign(reinterpret_cast<const char*>(start), static_cast<size_t>(pos - start));
+    return true;
+}
+
+std::string Cid::ToString() const {
+    std::string bytes;
+    AppendVarint(bytes, 1);
+    AppendVarint(bytes, codec_);
+    AppendVarint(bytes, hashCode_);
+    AppendVarint(bytes, digest_.size());
+    bytes += digest_;
+    return "b" + EncodeBase32(bytes);
+}
+
+bool Cid::Verify(const char* block, size_t size) const {
+    if (hashCode_ == kHashSha256) {
+        return digest_.size() == Sha256::kDigestSize && Sha256::Hash(block, size) == digest_;
+    }
+    if (hashCode_ == kHashIdentity) {
+        return digest_.size() == size && digest_.compare(0, size, block, size) == 0;
+    }
+    return false;
+}
+
+bool Cid::IsVerifiable() const {
+    return hashCode_ == kHashSha256 || hashCode_ == kHashIdentity;
+}
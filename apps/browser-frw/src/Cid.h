@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+// Minimal IPFS content identifier support: CIDv0 (base58btc "Qm...") and
+// CIDv1 in base32 ("b..."), with sha2-256 and identity multihashes.
+class Cid {
+public:
+    static const uint64_t kCodecRaw = 0x55;
+    static const uint64_t kCodecDagPb = 0x70;
+    static const uint64_t kHashIdentity = 0x00;
+    static const uint64_t kHashSha256 = 0x12;
+
+    // Parse the textual form
+    static bool Parse(const std::string& text, Cid& out);
+    // Parse the binary form at |*pos|, advancing it past the CID
+    static bool FromBytes(const uint8_t*& pos, const uint8_t* end, Cid& out);
+
+    // CIDv1 base32 text form (v0 CIDs are upgraded), accepted by all gateways
+    std::string ToString() const;
+    // Binary form, usable as a map key
+    const std::string& Bytes() const { return bytes_; }
+
+    int Version() const { return version_; }
+    uint64_t Codec() const { return codec_; }
+    uint64_t HashCode() const { return hashCode_; }
+    const std::string& Digest() const { return digest_; }
+
+    // True if |block| hashes to this CID's multihash
+    bool Verify(const char* block, size_t size) const;
+    bool Verify(const std::string& block) const { return Verify(block.data(), block.size()); }
+    // True if blocks with this CID can be verified at all
+    bool IsVerifiable() const;
+
+private:
+    int version_ = 1;
+    uint64_t codec_ = kCodecRaw;
+    uint64_t hashCode_ = kHashSha256;
+    std::string digest_;
+    std::string bytes_;
+};
+
+// Unsigned LEB128 varints as used by multiformats and CAR files
+bool ReadVarint(const uint8_t*& pos, const uint8_t* end, uint64_t& out);
+void AppendVarint(std::string& out, uint64_t value);
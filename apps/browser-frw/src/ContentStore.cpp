@@ -0,0 +1,851 @@
+#include "ContentStore.h"
+#include "MappedFile.h"
+#include "Sha256.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <shlobj.h>
+#include "Utils.h"
+#endif
+
+namespace {
+
+// On-disk index log record. Fixed size so the log can be walked straight out
+// of the mapping without parsing. A put is followed by a 'K' record carrying
+// the object's identity in |cid|, then one 'B' record per block, which
+// carries the block's size and hex digest in |size| and |cid|.
+#pragma pack(push, 1)
+struct IndexRecord {
+    char op;            // 'P' = put, 'K' = identity and 'B' = block of the preceding put, 'D' = delete
+    char segment;       // Eviction segment as of the record
+    char reserved[2];
+    uint32_t blockCount;
+    uint64_t key;
+    uint64_t size;
+    int64_t lastAccess;
+    char cid[96];
+};
+#pragma pack(pop)
+
+static_assert(sizeof(IndexRecord) == 128, "IndexRecord must stay 128 bytes");
+
+int64_t NowSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string KeyToHex(uint64_t key) {
+    std::ostringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << key;
+    return ss.str();
+}
+
+std::string DigestToHex(const std::string& digest) {
+    static const char kHex[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(digest.size() * 2);
+    for (unsigned char c : digest) {
+        hex.push_back(kHex[c >> 4]);
+        hex.push_back(kHex[c & 0xF]);
+    }
+    return hex;
+}
+
+// The default UnixFS chunk size
+const uint64_t kBlockSize = 256 * 1024;
+
+uint64_t BlockCount(uint64_t size) {
+    return (size + kBlockSize - 1) / kBlockSize;
+}
+
+uint64_t BlockSize(uint64_t object_size, size_t index) {
+    return std::min(kBlockSize, object_size - index * kBlockSize);
+}
+
+// Writes through a temporary file and renames, so readers never see a
+// partial block. The temporary name is per thread because two puts may
+// write the same block at once; either copy is fine.
+bool WriteFileAtomically(const std::string& path, const char* data, size_t size) {
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    std::string tmpPath = path + "." + KeyToHex(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return false;
+        file.write(data, static_cast<std::streamsize>(size));
+        if (!file) {
+            file.close();
+            std::filesystem::remove(tmpPath, ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        // Replacing fails while another copy is mapped; that copy will do
+        std::filesystem::remove(tmpPath, ec);
+        return std::filesystem::exists(path, ec);
+    }
+    return true;
+}
+
+// Share of the budgets given to the admission window, and the protected
+// segment's share of the rest (the W-TinyLFU paper's 1% and 80%)
+const uint64_t kWindowPercent = 1;
+const uint64_t kProtectedPercent = 80;
+
+template <typename T>
+T PercentOf(T budget, uint64_t percent) {
+    return std::max<T>(static_cast<T>(budget / 100 * percent + budget % 100 * percent / 100), 1);
+}
+
+} // namespace
+
+ContentStore& ContentStore::Instance() {
+    static ContentStore instance;
+    return instance;
+}
+
+bool ContentStore::Open() {
+    return Open(GetStoreDirectory());
+}
+
+bool ContentStore::Open(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (opened_) return true;
+
+    storeDir_ = directory;
+    std::error_code ec;
+    std::filesystem::create_directories(storeDir_, ec);
+    if (ec) return false;
+
+    sketch_.EnsureCapacity(maxEntries_);
+
+    LoadIndex();
+    LoadPins();
+    opened_ = true;
+
+    // Close() leaves a compact log; anything more means the last session
+    // ended early and may have left blocks that nothing references
+    if (indexRecords_ != LiveRecords()) {
+        CompactIndex();
+        CollectGarbage();
+    }
+    EvictIfNeeded();
+    return true;
+}
+
+void ContentStore::Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!opened_) return;
+    CompactIndex();
+    SavePins();
+    opened_ = false;
+
+    // The next Open replays the index and pins rather than adding to these
+    entries_.clear();
+    for (int segment = 0; segment < kSegmentCount; ++segment) {
+        segments_[segment].clear();
+        segmentSize_[segment] = 0;
+    }
+    blocks_.clear();
+    storedSize_ = 0;
+    blockRefs_ = 0;
+    totalSize_ = 0;
+    siteRoots_.clear();
+    pinnedSites_.clear();
+    mappings_.clear();
+    stats_ = Stats();
+}
+
+bool ContentStore::Contains(const std::string& cid, const std::string& path) const {
+    std::string id = MakeId(cid, path);
+    std::lock_guard<std::mutex> lock(mutex_);
+    return FindEntry(id) != nullptr;
+}
+
+bool ContentStore::Get(const std::string& cid, const std::string& path, std::string& out_content) {
+    std::string id = MakeId(cid, path);
+    uint64_t key = KeyOf(id);
+    std::vector<std::string> blockPaths;
+    uint64_t expectedSize = 0;
+    uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!opened_) return false;
+        Entry* entry = FindEntry(id);
+        if (!entry) {
+            stats_.misses++;
+            sketch_.Increment(key);
+            return false;
+        }
+        stats_.hits++;
+        Touch(*entry);
+        blockPaths = GetBlockPaths(*entry);
+        expectedSize = entry->size;
+        generation = entry->generation;
+    }
+
+    // Blocks are immutable, so the read itself needs no lock
+    out_content.resize(static_cast<size_t>(expectedSize));
+    bool complete = true;
+    for (size_t i = 0; i < blockPaths.size() && complete; ++i) {
+        std::ifstream file(blockPaths[i], std::ios::binary);
+        complete = file.is_open() &&
+                   file.read(&out_content[i * kBlockSize],
+                             static_cast<std::streamsize>(BlockSize(expectedSize, i)));
+    }
+    if (complete) return true;
+
+    // A block file is missing or truncated; drop the stale entry, unless it
+    // was removed and put again while we read
+    out_content.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    EraseEntryIfUnchanged(id, generation);
+    return false;
+}
+
+std::shared_ptr<const MappedFile> ContentStore::Map(const std::string& cid, const std::string& path) {
+    std::string id = MakeId(cid, path);
+    uint64_t key = KeyOf(id);
+    std::vector<std::string> blockPaths;
+    uint64_t expectedSize = 0;
+    uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!opened_) return nullptr;
+        Entry* entry = FindEntry(id);
+        if (!entry) {
+            stats_.misses++;
+            sketch_.Increment(key);
+            return nullptr;
+        }
+        stats_.hits++;
+        Touch(*entry);
+
+        auto mapped = mappings_.find(key);
+        if (mapped != mappings_.end()) {
+            if (auto shared = mapped->second.lock()) return shared;
+            mappings_.erase(mapped);
+        }
+        blockPaths = GetBlockPaths(*entry);
+        expectedSize = entry->size;
+        generation = entry->generation;
+    }
+
+    // Every block is mapped in place; readers copy across block boundaries
+    auto file = std::make_shared<MappedFile>();
+    if (!file->OpenConcatenated(blockPaths) || file->Size() != expectedSize) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        EraseEntryIfUnchanged(id, generation);
+        return nullptr;
+    }
+
+    // Another reader may have mapped it meanwhile; prefer the existing mapping
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (mappings_.size() > 256) {
+        for (auto sweep = mappings_.begin(); sweep != mappings_.end();) {
+            sweep = sweep->second.expired() ? mappings_.erase(sweep) : std::next(sweep);
+        }
+    }
+    auto& slot = mappings_[key];
+    if (auto shared = slot.lock()) return shared;
+    slot = file;
+    return file;
+}
+
+bool ContentStore::Put(const std::string& cid, const std::string& path, const std::string& content) {
+    std::string id = MakeId(cid, path);
+    uint64_t key = KeyOf(id);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!opened_) return false;
+        if (entries_.count(key)) {
+            // Immutable, nothing to update; another object under the same
+            // key keeps its slot and this one goes uncached
+            return FindEntry(id) != nullptr;
+        }
+        if (content.size() > maxSize_) return false;
+    }
+
+    std::vector<std::string> digests;
+    for (size_t i = 0; i < BlockCount(content.size()); ++i) {
+        digests.push_back(DigestToHex(Sha256::Hash(content.data() + i * kBlockSize, BlockSize(content.size(), i))));
+    }
+
+    // Take the references first, so no eviction deletes a block we reuse
+    std::vector<std::string> blockPaths;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!opened_) return false;
+        for (size_t i = 0; i < digests.size(); ++i) {
+            AddBlockRef(digests[i], BlockSize(content.size(), i));
+            blockPaths.push_back(GetBlockPath(digests[i]));
+        }
+    }
+
+    // Only blocks no other object has stored yet are written
+    bool written = true;
+    std::error_code ec;
+    for (size_t i = 0; i < blockPaths.size() && written; ++i) {
+        if (std::filesystem::exists(blockPaths[i], ec)) continue;
+        written = WriteFileAtomically(blockPaths[i], content.data() + i * kBlockSize,
+                                      static_cast<size_t>(BlockSize(content.size(), i)));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!opened_ || !written || entries_.count(key)) {
+        for (const auto& digest : digests) ReleaseBlockRef(digest);
+        return opened_ && written && FindEntry(id) != nullptr;
+    }
+
+    Entry entry;
+    entry.key = key;
+    entry.id = id;
+    entry.cid = cid;
+    entry.size = content.size();
+    entry.lastAccess = NowSeconds();
+    entry.blocks = std::move(digests);
+    entry.generation = ++nextGeneration_;
+    auto inserted = entries_.emplace(key, std::move(entry)).first;
+    Insert(inserted->second, Segment::Window);
+    AppendIndexRecord('P', inserted->second);
+
+    EvictIfNeeded();
+    return true;
+}
+
+void ContentStore::Remove(const std::string& cid, const std::string& path) {
+    std::string id = MakeId(cid, path);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (FindEntry(id)) EraseEntry(KeyOf(id));
+}
+
+void ContentStore::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<uint64_t> keys;
+    keys.reserve(entries_.size());
+    for (const auto& pair : entries_) {
+        if (!IsCidPinned(pair.second.cid)) keys.push_back(pair.first);
+    }
+    for (uint64_t key : keys) {
+        EraseEntry(key);
+    }
+    CompactIndex();
+}
+
+void ContentStore::RecordSiteRoot(const std::string& name, const std::string& cid) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = siteRoots_.find(name);
+    if (it != siteRoots_.end() && it->second == cid) return;
+    siteRoots_[name] = cid;
+    if (opened_) SavePins();
+}
+
+bool ContentStore::LookupSiteRoot(const std::string& name, std::string& out_cid) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = siteRoots_.find(name);
+    if (it == siteRoots_.end()) return false;
+    out_cid = it->second;
+    return true;
+}
+
+void ContentStore::PinSite(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pinnedSites_.insert(name);
+    SavePins();
+}
+
+void ContentStore::UnpinSite(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pinnedSites_.erase(name);
+    SavePins();
+    EvictIfNeeded();
+}
+
+bool ContentStore::PinSiteForUrl(const std::string& url) {
+    const std::string prefix = "frw://";
+    if (url.compare(0, prefix.size(), prefix) != 0) return false;
+    std::string name = url.substr(prefix.size());
+    name = name.substr(0, name.find_first_of("/?#"));
+    if (name.empty()) return false;
+    PinSite(name);
+    return true;
+}
+
+bool ContentStore::IsSitePinned(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pinnedSites_.count(name) > 0;
+}
+
+void ContentStore::SetMaxSize(uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    maxSize_ = bytes;
+    EvictIfNeeded();
+}
+
+void ContentStore::SetMaxEntries(size_t entries) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    maxEntries_ = std::max<size_t>(entries, 1);
+    sketch_.EnsureCapacity(maxEntries_);
+    EvictIfNeeded();
+}
+
+uint64_t ContentStore::GetMaxSize() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return maxSize_;
+}
+
+uint64_t ContentStore::GetTotalSize() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return storedSize_;
+}
+
+size_t ContentStore::GetEntryCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+ContentStore::Stats ContentStore::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.logicalBytes = totalSize_;
+    stats.storedBytes = storedSize_;
+    stats.blocks = blocks_.size();
+    return stats;
+}
+
+std::string ContentStore::Summary() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t lookups = stats_.hits + stats_.misses;
+    const double mb = 1024.0 * 1024.0;
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1) << "content store: " << entries_.size() << " objects in "
+        << blocks_.size() << " blocks, " << storedSize_ / mb << " of " << maxSize_ / mb << " MB; dedup "
+        << std::setprecision(2) << (storedSize_ ? static_cast<double>(totalSize_) / storedSize_ : 1.0)
+        << "x (" << std::setprecision(1) << (totalSize_ - std::min(totalSize_, storedSize_)) / mb
+        << " MB saved); hits " << stats_.hits << "/" << lookups << " ("
+        << (lookups ? 100.0 * stats_.hits / lookups : 0.0) << "%); evicted " << stats_.evictions
+        << ", not admitted " << stats_.rejected;
+    return out.str();
+}
+
+std::string ContentStore::MakeId(const std::string& cid, const std::string& path) {
+    Sha256 hasher;
+    hasher.Update(cid.data(), cid.size());
+    hasher.Update("", 1);
+    hasher.Update(path.data(), path.size());
+    return DigestToHex(hasher.Finish());
+}
+
+uint64_t ContentStore::KeyOf(const std::string& id) {
+    return std::strtoull(id.substr(0, 16).c_str(), nullptr, 16);
+}
+
+ContentStore::Entry* ContentStore::FindEntry(const std::string& id) {
+    auto it = entries_.find(KeyOf(id));
+    return it != entries_.end() && it->second.id == id ? &it->second : nullptr;
+}
+
+const ContentStore::Entry* ContentStore::FindEntry(const std::string& id) const {
+    auto it = entries_.find(KeyOf(id));
+    return it != entries_.end() && it->second.id == id ? &it->second : nullptr;
+}
+
+std::string ContentStore::GetBlockPath(const std::string& digest) const {
+    // Shard on the first byte of the digest: blocks/ab/abcdef...
+    return storeDir_ + "/blocks/" + digest.substr(0, 2) + "/" + digest;
+}
+
+std::vector<std::string> ContentStore::GetBlockPaths(const Entry& entry) const {
+    std::vector<std::string> paths;
+    paths.reserve(entry.blocks.size());
+    for (const auto& digest : entry.blocks) {
+        paths.push_back(GetBlockPath(digest));
+    }
+    return paths;
+}
+
+std::string ContentStore::GetIndexFilePath() const {
+    return storeDir_ + "/index.log";
+}
+
+std::string ContentStore::GetPinsFilePath() const {
+    return storeDir_ + "/pins.txt";
+}
+
+std::string ContentStore::GetBundlePath(const std::string& cid) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!opened_) return "";
+    return storeDir_ + "/bundles/" + cid + ".zip";
+}
+
+std::string ContentStore::GetStoreDirectory() const {
+    std::string appDataDir;
+#ifdef _WIN32
+    wchar_t* path = nullptr;
+    if (SUCCEEDED(SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, nullptr, &path))) {
+        appDataDir = Utils::WStringToString(std::wstring(path, wcslen(path)));
+        CoTaskMemFree(path);
+    }
+    std::replace(appDataDir.begin(), appDataDir.end(), '\\', '/');
+#else
+    appDataDir = std::getenv("HOME") ? std::getenv("HOME") : "";
+#endif
+
+    return appDataDir + "/FRW Browser/content";
+}
+
+bool ContentStore::LoadIndex() {
+    MappedFile index;
+    if (!index.Open(GetIndexFilePath())) {
+        return true; // No index yet, that's OK
+    }
+
+    // Replay the log; later records win. A torn tail record is ignored.
+    size_t count = index.Size() / sizeof(IndexRecord);
+    for (size_t i = 0; i < count; ++i) {
+        IndexRecord record;
+        std::memcpy(&record, index.Data() + i * sizeof(IndexRecord), sizeof(IndexRecord));
+
+        if (record.op == 'D') {
+            entries_.erase(record.key);
+        } else if (record.op == 'P') {
+            Entry& entry = entries_[record.key];
+            entry.key = record.key;
+            entry.cid.assign(record.cid, strnlen(record.cid, sizeof(record.cid)));
+            entry.size = record.size;
+            entry.lastAccess = record.lastAccess;
+            entry.segment = record.segment >= 0 && record.segment < kSegmentCount
+                                ? static_cast<Segment>(record.segment)
+                                : Segment::Probation;
+            entry.id.clear();
+            entry.blocks.clear();
+        } else if (record.op == 'K') {
+            auto it = entries_.find(record.key);
+            if (it != entries_.end()) it->second.id.assign(record.cid, strnlen(record.cid, sizeof(record.cid)));
+        } else if (record.op == 'B') {
+            auto it = entries_.find(record.key);
+            if (it != entries_.end()) {
+                it->second.blocks.emplace_back(record.cid, strnlen(record.cid, sizeof(record.cid)));
+            }
+        }
+    }
+    indexRecords_ = count;
+
+    // Drop puts whose block records were torn off, objects from the older
+    // one-file-per-object layout (which had no block records), and those
+    // logged before identities were (whose keys were a plain FNV hash)
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        bool complete = it->second.blocks.size() == BlockCount(it->second.size) &&
+                        !it->second.id.empty() && KeyOf(it->second.id) == it->first;
+        it = complete ? std::next(it) : entries_.erase(it);
+    }
+
+    // Rebuild each segment's recency order from the persisted access times
+    std::vector<std::pair<int64_t, uint64_t>> byAccess;
+    for (const auto& pair : entries_) {
+        byAccess.emplace_back(pair.second.lastAccess, pair.first);
+    }
+    std::sort(byAccess.begin(), byAccess.end());
+    for (const auto& item : byAccess) {
+        Entry& entry = entries_[item.second];
+        entry.generation = ++nextGeneration_;
+        Insert(entry, entry.segment);
+        for (size_t i = 0; i < entry.blocks.size(); ++i) {
+            AddBlockRef(entry.blocks[i], BlockSize(entry.size, i));
+        }
+    }
+    return true;
+}
+
+bool ContentStore::CompactIndex() {
+    std::string indexPath = GetIndexFilePath();
+    std::string tmpPath = indexPath + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return false;
+
+        // Write least recently used first so replay order matches recency
+        size_t records = 0;
+        std::string buffer;
+        for (const auto& segment : segments_) {
+            for (auto it = segment.rbegin(); it != segment.rend(); ++it) {
+                buffer.clear();
+                records += EncodeRecords('P', entries_.at(*it), buffer);
+                file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            }
+        }
+        if (!file) return false;
+        indexRecords_ = records;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, indexPath, ec);
+    return !ec;
+}
+
+void ContentStore::AppendIndexRecord(char op, const Entry& entry) {
+    // A put and its block records go out in one write
+    std::string buffer;
+    size_t records = EncodeRecords(op, entry, buffer);
+
+    std::ofstream file(GetIndexFilePath(), std::ios::binary | std::ios::app);
+    if (file.is_open()) {
+        file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        indexRecords_ += records;
+    }
+
+    if (indexRecords_ > LiveRecords() * 2 + 1024) {
+        CompactIndex();
+    }
+}
+
+size_t ContentStore::EncodeRecords(char op, const Entry& entry, std::string& out) {
+    IndexRecord record = {};
+    record.op = op;
+    record.segment = static_cast<char>(entry.segment);
+    record.key = entry.key;
+    record.size = entry.size;
+    record.lastAccess = entry.lastAccess;
+    std::strncpy(record.cid, entry.cid.c_str(), sizeof(record.cid) - 1);
+    if (op != 'P') {
+        out.append(reinterpret_cast<const char*>(&record), sizeof(record));
+        return 1;
+    }
+
+    record.blockCount = static_cast<uint32_t>(entry.blocks.size());
+    out.append(reinterpret_cast<const char*>(&record), sizeof(record));
+
+    IndexRecord identity = {};
+    identity.op = 'K';
+    identity.key = entry.key;
+    std::strncpy(identity.cid, entry.id.c_str(), sizeof(identity.cid) - 1);
+    out.append(reinterpret_cast<const char*>(&identity), sizeof(identity));
+
+    for (size_t i = 0; i < entry.blocks.size(); ++i) {
+        IndexRecord block = {};
+        block.op = 'B';
+        block.key = entry.key;
+        block.size = BlockSize(entry.size, i);
+        std::strncpy(block.cid, entry.blocks[i].c_str(), sizeof(block.cid) - 1);
+        out.append(reinterpret_cast<const char*>(&block), sizeof(block));
+    }
+    return 2 + entry.blocks.size();
+}
+
+size_t ContentStore::LiveRecords() const {
+    return entries_.size() * 2 + blockRefs_;
+}
+
+void ContentStore::CollectGarbage() {
+    std::error_code ec;
+    // Objects of the one-file-per-object layout were dropped by LoadIndex
+    std::filesystem::remove_all(storeDir_ + "/objects", ec);
+
+    std::vector<std::filesystem::path> orphans;
+    for (std::filesystem::recursive_directory_iterator it(storeDir_ + "/blocks", ec), end; !ec && it != end;
+         it.increment(ec)) {
+        if (!it->is_regular_file(ec)) continue;
+        if (!blocks_.count(it->path().filename().string())) orphans.push_back(it->path());
+    }
+    for (const auto& path : orphans) {
+        std::filesystem::remove(path, ec);
+    }
+}
+
+bool ContentStore::LoadPins() {
+    std::ifstream file(GetPinsFilePath());
+    if (!file.is_open()) {
+        return true; // No pins yet, that's OK
+    }
+
+    // Format: one "name=rootCid" per line; a trailing '*' marks a pinned site
+    std::string line;
+    while (std::getline(file, line)) {
+        bool pinned = !line.empty() && line.back() == '*';
+        if (pinned) line.pop_back();
+        size_t pos = line.find('=');
+        if (pos == std::string::npos) continue;
+        std::string name = line.substr(0, pos);
+        std::string cid = line.substr(pos + 1);
+        if (!cid.empty()) siteRoots_[name] = cid;
+        if (pinned) pinnedSites_.insert(name);
+    }
+    return true;
+}
+
+bool ContentStore::SavePins() {
+    std::ofstream file(GetPinsFilePath(), std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    for (const auto& name : pinnedSites_) {
+        auto it = siteRoots_.find(name);
+        file << name << "=" << (it != siteRoots_.end() ? it->second : "") << "*\n";
+    }
+    // Unpinned roots are kept too, so sites resolve while offline
+    for (const auto& root : siteRoots_) {
+        if (!pinnedSites_.count(root.first)) file << root.first << "=" << root.second << "\n";
+    }
+    return true;
+}
+
+bool ContentStore::IsCidPinned(const std::string& cid) const {
+    for (const auto& name : pinnedSites_) {
+        auto it = siteRoots_.find(name);
+        if (it != siteRoots_.end() && it->second == cid) return true;
+    }
+    return false;
+}
+
+void ContentStore::AddBlockRef(const std::string& digest, uint64_t size) {
+    Block& block = blocks_[digest];
+    if (block.refs++ == 0) {
+        block.size = size;
+        storedSize_ += size;
+    }
+    blockRefs_++;
+}
+
+void ContentStore::ReleaseBlockRef(const std::string& digest) {
+    auto it = blocks_.find(digest);
+    if (it == blocks_.end()) return;
+    blockRefs_--;
+    if (--it->second.refs > 0) return;
+
+    std::error_code ec;
+    std::filesystem::remove(GetBlockPath(digest), ec);
+    storedSize_ -= it->second.size;
+    blocks_.erase(it);
+}
+
+void ContentStore::Insert(Entry& entry, Segment segment) {
+    auto& list = segments_[static_cast<int>(segment)];
+    list.push_front(entry.key);
+    entry.lruPos = list.begin();
+    entry.segment = segment;
+    segmentSize_[static_cast<int>(segment)] += entry.size;
+    totalSize_ += entry.size;
+}
+
+void ContentStore::MoveTo(Entry& entry, Segment segment) {
+    int from = static_cast<int>(entry.segment);
+    segments_[from].erase(entry.lruPos);
+    segmentSize_[from] -= entry.size;
+    totalSize_ -= entry.size;
+    Insert(entry, segment);
+}
+
+void ContentStore::Touch(Entry& entry) {
+    entry.lastAccess = NowSeconds();
+    sketch_.Increment(entry.key);
+
+    if (entry.segment != Segment::Probation) {
+        auto& list = segments_[static_cast<int>(entry.segment)];
+        list.splice(list.begin(), list, entry.lruPos);
+        return;
+    }
+
+    // A second hit in the main area earns protection
+    MoveTo(entry, Segment::Protected);
+    uint64_t mainBytes = maxSize_ - std::min(maxSize_, PercentOf(maxSize_, kWindowPercent));
+    size_t mainEntries = maxEntries_ - std::min(maxEntries_, PercentOf(maxEntries_, kWindowPercent));
+    auto& protectedList = segments_[static_cast<int>(Segment::Protected)];
+    while (protectedList.size() > 1 &&
+           (segmentSize_[static_cast<int>(Segment::Protected)] > PercentOf(mainBytes, kProtectedPercent) ||
+            protectedList.size() > PercentOf(mainEntries, kProtectedPercent))) {
+        MoveTo(entries_.at(protectedList.back()), Segment::Probation);
+    }
+}
+
+void ContentStore::EraseEntry(uint64_t key) {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) return;
+
+    // Drop the entry before logging, since the append may compact the log
+    Entry entry = std::move(it->second);
+    for (const auto& digest : entry.blocks) {
+        ReleaseBlockRef(digest);
+    }
+    int segment = static_cast<int>(entry.segment);
+    segments_[segment].erase(entry.lruPos);
+    segmentSize_[segment] -= entry.size;
+    totalSize_ -= entry.size;
+    entries_.erase(it);
+    mappings_.erase(key);
+    AppendIndexRecord('D', entry);
+}
+
+void ContentStore::EraseEntryIfUnchanged(const std::string& id, uint64_t generation) {
+    Entry* entry = FindEntry(id);
+    if (entry && entry->generation == generation) EraseEntry(entry->key);
+}
+
+bool ContentStore::OverBudget() const {
+    return storedSize_ > maxSize_ || entries_.size() > maxEntries_;
+}
+
+bool ContentStore::WindowOverBudget() const {
+    const int window = static_cast<int>(Segment::Window);
+    return !segments_[window].empty() && (segmentSize_[window] > PercentOf(maxSize_, kWindowPercent) ||
+                                          segments_[window].size() > PercentOf(maxEntries_, kWindowPercent));
+}
+
+bool ContentStore::FindVictim(uint64_t exclude, uint64_t& out_key) const {
+    // Least recently used of probation first, then protected, then the window
+    for (Segment segment : {Segment::Probation, Segment::Protected, Segment::Window}) {
+        const auto& list = segments_[static_cast<int>(segment)];
+        for (auto it = list.rbegin(); it != list.rend(); ++it) {
+            if (*it == exclude || IsCidPinned(entries_.at(*it).cid)) continue;
+            out_key = *it;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ContentStore::Admit(uint64_t candidate) {
+    while (OverBudget()) {
+        uint64_t victim = 0;
+        if (!FindVictim(candidate, victim)) return;
+
+        // The candidate has to be used more often than what it displaces
+        bool keep = IsCidPinned(entries_.at(candidate).cid) ||
+                    sketch_.Estimate(candidate) > sketch_.Estimate(victim);
+        if (!keep) {
+            EraseEntry(candidate);
+            stats_.rejected++;
+            return;
+        }
+        EraseEntry(victim);
+        stats_.evictions++;
+    }
+}
+
+void ContentStore::EvictIfNeeded() {
+    // Objects leaving the window compete with the main area's victims
+    const int window = static_cast<int>(Segment::Window);
+    while (WindowOverBudget()) {
+        uint64_t candidate = segments_[window].back();
+        MoveTo(entries_.at(candidate), Segment::Probation);
+        Admit(candidate);
+    }
+
+    // Anything still over (a smaller budget, an unpinned site) goes in LRU order
+    uint64_t victim = 0;
+    while (OverBudget() && FindVictim(0, victim)) {
+        EraseEntry(victim);
+        stats_.evictions++;
+    }
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <memory>
+#include <cstdint>
+
+#include "FrequencySketch.h"
+
+class MappedFile;
+
+// Local content-addressed store for IPFS content.
+// Objects are keyed by CID + path (immutable) and tracked by an append-only
+// index log that is memory-mapped at startup. Their bytes are split into
+// 256 KiB blocks, as the default UnixFS chunker splits files, and each block
+// is stored once under its SHA-256 in sharded directories with a reference
+// count. The same framework or font shipped by many sites costs its bytes once.
+//
+// Eviction is W-TinyLFU: new objects enter a small LRU window (1% of the
+// budget); when they leave it they must be used more often, by a frequency
+// sketch, than the object they would displace from the main area. The main
+// area is a segmented LRU (probation, then protected once hit again). A
+// one-off scan of a large video thus evicts itself, not the hot assets of
+// sites used daily. Bytes and entries have separate budgets.
+class ContentStore {
+public:
+    static ContentStore& Instance();
+
+    // Lifecycle
+    bool Open();
+    // Uses |directory| instead of the profile's store (benchmarks and tests)
+    bool Open(const std::string& directory);
+    void Close();
+
+    // Object access
+    bool Contains(const std::string& cid, const std::string& path) const;
+    bool Get(const std::string& cid, const std::string& path, std::string& out_content);
+    // Zero-copy access; concurrent readers of the same object share one mapping
+    std::shared_ptr<const MappedFile> Map(const std::string& cid, const std::string& path);
+    bool Put(const std::string& cid, const std::string& path, const std::string& content);
+    void Remove(const std::string& cid, const std::string& path);
+    void Clear();
+
+    // Pinning (pinned sites are never evicted). Site roots double as the
+    // persisted name cache that offline mode resolves from.
+    void RecordSiteRoot(const std::string& name, const std::string& cid);
+    bool LookupSiteRoot(const std::string& name, std::string& out_cid) const;
+    void PinSite(const std::string& name);
+    // Pins the site of an frw:// URL (e.g. when bookmarked); false for other URLs
+    bool PinSiteForUrl(const std::string& url);
+    void UnpinSite(const std::string& name);
+    bool IsSitePinned(const std::string& name) const;
+
+    // Whole-site archives live beside the objects, one per root CID, outside the LRU
+    std::string GetBundlePath(const std::string& cid) const;
+
+    // Size bounds
+    void SetMaxSize(uint64_t bytes);
+    void SetMaxEntries(size_t entries);
+    uint64_t GetMaxSize() const;
+    // Bytes on disk, after deduplication; this is what the size bound limits
+    uint64_t GetTotalSize() const;
+    size_t GetEntryCount() const;
+
+    struct Stats {
+        uint64_t hits = 0;      // Get/Map found the object
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t rejected = 0;  // New objects that lost admission to the main area
+        uint64_t logicalBytes = 0; // Sum of object sizes
+        uint64_t storedBytes = 0;  // Sum of distinct block sizes
+        size_t blocks = 0;
+    };
+    Stats GetStats() const;
+    // One line of size, hit ratio and eviction counts
+    std::string Summary() const;
+
+private:
+    ContentStore() = default;
+
+    // Values are persisted in the index log; 0 is what older logs hold
+    enum class Segment : char { Probation = 0, Protected = 1, Window = 2 };
+    static const int kSegmentCount = 3;
+
+    struct Entry {
+        uint64_t key;
+        std::string id;                       // See MakeId; compared on every lookup
+        std::string cid;
+        uint64_t size;
+        int64_t lastAccess;
+        Segment segment;
+        std::list<uint64_t>::iterator lruPos; // Within its segment's list
+        std::vector<std::string> blocks;      // Hex SHA-256 digests, in order
+        uint64_t generation;                  // Tells a re-put apart from the entry a reader saw
+    };
+
+    struct Block {
+        uint64_t size = 0;
+        uint32_t refs = 0;
+    };
+
+    mutable std::mutex mutex_;
+    bool opened_ = false;
+    std::string storeDir_;
+    std::unordered_map<uint64_t, Entry> entries_;
+    std::list<uint64_t> segments_[kSegmentCount]; // front = most recently used
+    uint64_t segmentSize_[kSegmentCount] = {};
+    std::unordered_map<std::string, Block> blocks_; // digest -> block
+    uint64_t storedSize_ = 0;
+    size_t blockRefs_ = 0;
+    FrequencySketch sketch_;
+    std::map<std::string, std::string> siteRoots_; // frw name -> root CID
+    std::set<std::string> pinnedSites_;
+    std::unordered_map<uint64_t, std::weak_ptr<const MappedFile>> mappings_;
+    uint64_t totalSize_ = 0; // Logical: sum of entry sizes
+    uint64_t maxSize_ = 1024ull * 1024 * 1024;
+    size_t maxEntries_ = 65536;
+    size_t indexRecords_ = 0;
+    uint64_t nextGeneration_ = 0;
+    Stats stats_;
+
+    // An object's identity is the hex SHA-256 of "cid\0path". Entries are
+    // indexed by its first 64 bits, which a hostile path could be crafted to
+    // collide on, so lookups go through FindEntry and compare all of it.
+    static std::string MakeId(const std::string& cid, const std::string& path);
+    static uint64_t KeyOf(const std::string& id);
+    Entry* FindEntry(const std::string& id);
+    const Entry* FindEntry(const std::string& id) const;
+    std::string GetBlockPath(const std::string& digest) const;
+    std::vector<std::string> GetBlockPaths(const Entry& entry) const;
+    std::string GetIndexFilePath() const;
+    std::string GetPinsFilePath() const;
+    std::string GetStoreDirectory() const;
+
+    bool LoadIndex();
+    bool CompactIndex();
+    void AppendIndexRecord(char op, const Entry& entry);
+    // Serialises |entry| as it is logged: a put with its block records, or a delete
+    static size_t EncodeRecords(char op, const Entry& entry, std::string& out);
+    size_t LiveRecords() const;
+    void CollectGarbage();
+    bool LoadPins();
+    bool SavePins();
+
+    bool IsCidPinned(const std::string& cid) const;
+    void AddBlockRef(const std::string& digest, uint64_t size);
+    void ReleaseBlockRef(const std::string& digest);
+    void Insert(Entry& entry, Segment segment);
+    void MoveTo(Entry& entry, Segment segment);
+    void Touch(Entry& entry);
+    void EraseEntry(uint64_t key);
+    // Erases |id| only if it is still the entry of that generation
+    void EraseEntryIfUnchanged(const std::string& id, uint64_t generation);
+
+    bool OverBudget() const;
+    bool WindowOverBudget() const;
+    bool FindVictim(uint64_t exclude, uint64_t& out_key) const;
+    void Admit(uint64_t candidate);
+    void EvictIfNeeded();
+};
@@ -0,0 +1,93 @@
+#include "ContentStream.h"
+#include <algorithm>
+#include <cstring>
+
+ContentStream::ContentStream(size_t total_size)
+    : total_(total_size), buffer_(total_size, '\0') {
+}
+
+void ContentStream::Write(size_t offset, const char* data, size_t size) {
+    if (offset >= total_ || size == 0) return;
+    size = std::min(size, total_ - offset);
+
+    std::function<void()> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (failed_) return;
+
+        // Producers own disjoint ranges, but readers only ever look below
+        // available_, so copying under the lock keeps the prefix consistent
+        std::memcpy(&buffer_[offset], data, size);
+
+        // Merge [offset, offset + size) into the filled interval map
+        size_t start = offset;
+        size_t end = offset + size;
+        auto it = filled_.upper_bound(start);
+        if (it != filled_.begin()) {
+            auto prev = std::prev(it);
+            if (prev->second >= start) {
+                start = prev->first;
+                end = std::max(end, prev->second);
+                it = filled_.erase(prev);
+            }
+        }
+        while (it != filled_.end() && it->first <= end) {
+            end = std::max(end, it->second);
+            it = filled_.erase(it);
+        }
+        filled_[start] = end;
+
+        if (start == 0) available_ = end;
+        NotifyLocked(ready);
+    }
+    if (ready) ready();
+}
+
+void ContentStream::Fail() {
+    std::function<void()> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        failed_ = true;
+        ready.swap(onReady_);
+    }
+    if (ready) ready();
+}
+
+size_t ContentStream::Available() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return available_;
+}
+
+bool ContentStream::IsComplete() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return available_ == total_;
+}
+
+bool ContentStream::HasFailed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return failed_;
+}
+
+size_t ContentStream::Read(size_t offset, char* out, size_t max_size) const {
+    size_t available = Available();
+    if (offset >= available) return 0;
+
+    // Bytes below available_ are never written again, so no lock is needed
+    size_t size = std::min(max_size, available - offset);
+    std::memcpy(out, buffer_.data() + offset, size);
+    return size;
+}
+
+bool ContentStream::WaitForData(size_t offset, std::function<void()> on_ready) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (offset < available_ || available_ == total_ || failed_) return true;
+    waitOffset_ = offset;
+    onReady_ = std::move(on_ready);
+    return false;
+}
+
+void ContentStream::NotifyLocked(std::function<void()>& out_ready) {
+    if (onReady_ && (waitOffset_ < available_ || available_ == total_)) {
+        out_ready.swap(onReady_);
+    }
+}
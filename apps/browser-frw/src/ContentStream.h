@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <functional>
+#include <cstddef>
+
+// Fixed-size response body that is filled in by one or more producers, in any
+// order, while a consumer reads the contiguous prefix that has arrived so far.
+class ContentStream {
+public:
+    explicit ContentStream(size_t total_size);
+
+    ContentStream(const ContentStream&) = delete;
+    ContentStream& operator=(const ContentStream&) = delete;
+
+    size_t TotalSize() const { return total_; }
+
+    // Producers
+    void Write(size_t offset, const char* data, size_t size);
+    void Fail();
+
+    // Consumers
+    size_t Available() const;
+    bool IsComplete() const;
+    bool HasFailed() const;
+    size_t Read(size_t offset, char* out, size_t max_size) const;
+
+    // Returns true if bytes at |offset| can be read now (or the stream has
+    // ended). Otherwise stores |on_ready| and runs it once that changes.
+    bool WaitForData(size_t offset, std::function<void()> on_ready);
+
+    // Whole body; only meaningful once IsComplete() is true
+    const std::string& Buffer() const { return buffer_; }
+    const char* Data() const { return buffer_.data(); }
+
+private:
+    const size_t total_;
+    std::string buffer_;
+
+    mutable std::mutex mutex_;
+    std::map<size_t, size_t> filled_; // start -> end (exclusive), merged
+    size_t available_ = 0;
+    bool failed_ = false;
+    size_t waitOffset_ = 0;
+    std::function<void()> onReady_;
+
+    void NotifyLocked(std::function<void()>& out_ready);
+};
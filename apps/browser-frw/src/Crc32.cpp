@@ -0,0 +1,37 @@
+#include "Crc32.h"
+
+#include <array>
+
+namespace {
+
+// Built once, on first use; a function-local static is initialized thread-safely
+const std::array<uint32_t, 256>& Table() {
+    static const std::array<uint32_t, 256> table = []() {
+        std::array<uint32_t, 256> entries = {};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[i] = c;
+        }
+        return entries;
+    }();
+    return table;
+}
+
+} // namespace
+
+uint32_t Crc32(const void* data, size_t size) {
+    const auto& table = Table();
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+uint32_t Crc32(const std::string& data) {
+    return Crc32(data.data(), data.size());
+}
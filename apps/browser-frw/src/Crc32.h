@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// CRC-32 as zip and the download journal use it (IEEE 802.3, reflected)
+uint32_t Crc32(const void* data, size_t size);
+uint32_t Crc32(const std::string& data);
@@ -0,0 +1,375 @@
+#include "DownloadJournal.h"
+#include "Crc32.h"
+#include "MappedFile.h"
+#include "PositionalFile.h"
+
+#include <cstring>
+#include <filesystem>
+
+namespace {
+
+// A frame is the payload's length and CRC-32, then the payload: an op
+// byte and its fields
+//   'A' id url filename savePath speedLimit
+//   'S' id state startTime endTime errorMessage
+//   'C' id total rangeable validator count {start end done}*count
+//   'R' id
+const size_t kFrameHeader = 8;
+const uint32_t kMaxPayload = 16 * 1024 * 1024;
+// Superseded records tolerated before a rewrite, beyond twice the live ones
+const size_t kCompactSlack = 1024;
+
+void PutInt(std::string& out, int64_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void PutString(std::string& out, const std::string& value) {
+    PutInt(out, static_cast<int64_t>(value.size()));
+    out += value;
+}
+
+// Reads fields back; any overrun leaves ok false
+struct FieldReader {
+    const char* data;
+    size_t size;
+    bool ok = true;
+
+    int64_t Int() {
+        int64_t value = 0;
+        if (size < sizeof(value)) {
+            ok = false;
+            return 0;
+        }
+        std::memcpy(&value, data, sizeof(value));
+        data += sizeof(value);
+        size -= sizeof(value);
+        return value;
+    }
+
+    std::string String() {
+        int64_t length = Int();
+        if (!ok || length < 0 || static_cast<uint64_t>(length) > size) {
+            ok = false;
+            return std::string();
+        }
+        std::string value(data, static_cast<size_t>(length));
+        data += length;
+        size -= static_cast<size_t>(length);
+        return value;
+    }
+};
+
+void AppendFrame(std::string& out, const std::string& payload) {
+    uint32_t header[2] = {static_cast<uint32_t>(payload.size()), Crc32(payload.data(), payload.size())};
+    out.append(reinterpret_cast<const char*>(header), sizeof(header));
+    out += payload;
+}
+
+std::string MetadataPayload(const DownloadRecord& record) {
+    std::string payload(1, 'A');
+    PutInt(payload, record.id);
+    PutString(payload, record.url);
+    PutString(payload, record.filename);
+    PutString(payload, record.savePath);
+    PutInt(payload, record.speedLimit);
+    return payload;
+}
+
+std::string StatePayload(int id, int state, int64_t start_time, int64_t end_time, const std::string& error) {
+    std::string payload(1, 'S');
+    PutInt(payload, id);
+    PutInt(payload, state);
+    PutInt(payload, start_time);
+    PutInt(payload, end_time);
+    PutString(payload, error);
+    return payload;
+}
+
+std::string CheckpointPayload(int id, const DownloadCheckpoint& checkpoint) {
+    std::string payload(1, 'C');
+    PutInt(payload, id);
+    PutInt(payload, checkpoint.total);
+    PutInt(payload, checkpoint.rangeable ? 1 : 0);
+    PutString(payload, checkpoint.validator);
+    PutInt(payload, static_cast<int64_t>(checkpoint.segments.size()));
+    for (const auto& segment : checkpoint.segments) {
+        PutInt(payload, segment.start);
+        PutInt(payload, segment.end);
+        PutInt(payload, segment.done);
+    }
+    return payload;
+}
+
+// A finished download still has its size to show
+bool HasCheckpoint(const DownloadRecord& record) {
+    return record.checkpoint.total >= 0 || !record.checkpoint.segments.empty();
+}
+
+// Writes everything there is to know about |record|; returns the number of
+// frames
+size_t AppendRecord(std::string& out, const DownloadRecord& record) {
+    AppendFrame(out, MetadataPayload(record));
+    AppendFrame(out, StatePayload(record.id, record.state, record.startTime, record.endTime, record.errorMessage));
+    if (!HasCheckpoint(record)) return 2;
+    AppendFrame(out, CheckpointPayload(record.id, record.checkpoint));
+    return 3;
+}
+
+// Applies one payload to |records|; false if it does not parse
+bool ApplyPayload(std::map<int, DownloadRecord>& records, const char* data, size_t size) {
+    if (size == 0) return false;
+    char op = data[0];
+    FieldReader reader{data + 1, size - 1};
+    int id = static_cast<int>(reader.Int());
+
+    if (op == 'A') {
+        DownloadRecord record;
+        record.url = reader.String();
+        record.filename = reader.String();
+        record.savePath = reader.String();
+        record.speedLimit = reader.Int();
+        if (!reader.ok) return false;
+        DownloadRecord& entry = records[id];
+        entry.id = id;
+        entry.url = std::move(record.url);
+        entry.filename = std::move(record.filename);
+        entry.savePath = std::move(record.savePath);
+        entry.speedLimit = record.speedLimit;
+        return true;
+    }
+    if (op == 'S') {
+        int state = static_cast<int>(reader.Int());
+        int64_t start_time = reader.Int();
+        int64_t end_time = reader.Int();
+        std::string error = reader.String();
+        if (!reader.ok) return false;
+        auto it = records.find(id);
+        if (it != records.end()) {
+            it->second.state = state;
+            it->second.startTime = start_time;
+            it->second.endTime = end_time;
+            it->second.errorMessage = std::move(error);
+        }
+        return true;
+    }
+    if (op == 'C') {
+        DownloadCheckpoint checkpoint;
+        checkpoint.total = reader.Int();
+        checkpoint.rangeable = reader.Int() != 0;
+        checkpoint.validator = reader.String();
+        int64_t count = reader.Int();
+        if (!reader.ok || count < 0 || static_cast<uint64_t>(count) > reader.size / (3 * sizeof(int64_t))) {
+            return false;
+        }
+        for (int64_t i = 0; i < count; ++i) {
+            int64_t start = reader.Int();
+            int64_t end = reader.Int();
+            int64_t done = reader.Int();
+            checkpoint.segments.push_back({start, end, done});
+        }
+        if (!reader.ok) return false;
+        // A transfer may still report in after its download was removed
+        auto it = records.find(id);
+        if (it != records.end()) it->second.checkpoint = std::move(checkpoint);
+        return true;
+    }
+    if (op == 'R') {
+        if (!reader.ok) return false;
+        records.erase(id);
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+DownloadJournal::~DownloadJournal() {
+    Close();
+}
+
+bool DownloadJournal::Open(const std::string& path, std::vector<DownloadRecord>& records) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (opened_) return false;
+    path_ = path;
+    records_.clear();
+    fileRecords_ = 0;
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path_).parent_path(), ec);
+
+    // Replay up to the first frame that is cut short or fails its checksum;
+    // nothing after it can be trusted to follow on
+    bool torn = false;
+    size_t intact = 0;
+    {
+        MappedFile journal;
+        if (journal.Open(path_)) {
+            const char* data = journal.Data();
+            size_t size = journal.Size();
+            size_t offset = 0;
+            while (offset < size) {
+                uint32_t header[2];
+                if (size - offset < kFrameHeader) break;
+                std::memcpy(header, data + offset, sizeof(header));
+                if (header[0] > kMaxPayload || size - offset - kFrameHeader < header[0]) break;
+                const char* payload = data + offset + kFrameHeader;
+                if (Crc32(payload, header[0]) != header[1] || !ApplyPayload(records_, payload, header[0])) break;
+                offset += kFrameHeader + header[0];
+                fileRecords_++;
+            }
+            torn = offset < size;
+            intact = offset;
+        }
+    }
+
+    // Appending after a torn tail would hide the new records behind it, so
+    // when the rewrite fails the torn bytes are cut off instead
+    if ((torn || fileRecords_ != LiveRecords()) && !Compact(lock) && torn) {
+        std::filesystem::resize_file(path_, intact, ec);
+        if (ec) return false;
+    }
+    file_.open(path_, std::ios::binary | std::ios::app);
+    if (!file_.is_open()) return false;
+
+    records.clear();
+    for (const auto& pair : records_) {
+        records.push_back(pair.second);
+    }
+    opened_ = true;
+    retryAt_ = 0;
+    compactor_ = std::thread(&DownloadJournal::RunCompactor, this);
+    return true;
+}
+
+void DownloadJournal::Close() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!opened_) return;
+    opened_ = false;
+    wake_.notify_all();
+    lock.unlock();
+    if (compactor_.joinable()) compactor_.join();
+    lock.lock();
+
+    if (fileRecords_ != LiveRecords()) Compact(lock);
+    file_.close();
+    records_.clear();
+}
+
+void DownloadJournal::Add(const DownloadRecord& record) {
+    Append(MetadataPayload(record));
+    Append(StatePayload(record.id, record.state, record.startTime, record.endTime, record.errorMessage));
+}
+
+void DownloadJournal::SetSpeedLimit(int id, int64_t speed_limit) {
+    std::string payload;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = records_.find(id);
+        if (it == records_.end()) return;
+        DownloadRecord record = it->second;
+        record.speedLimit = speed_limit;
+        payload = MetadataPayload(record);
+    }
+    Append(payload);
+}
+
+void DownloadJournal::SetState(int id, int state, int64_t start_time, int64_t end_time, const std::string& error) {
+    Append(StatePayload(id, state, start_time, end_time, error));
+}
+
+void DownloadJournal::SetCheckpoint(int id, const DownloadCheckpoint& checkpoint) {
+    Append(CheckpointPayload(id, checkpoint));
+}
+
+void DownloadJournal::Remove(int id) {
+    std::string payload(1, 'R');
+    PutInt(payload, id);
+    Append(payload);
+}
+
+void DownloadJournal::Append(const std::string& payload) {
+    std::string frame;
+    AppendFrame(frame, payload);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!opened_) return;
+    ApplyPayload(records_, payload.data(), payload.size());
+    // Flushed record by record: a crash of the process loses nothing that
+    // was appended, and a torn write only costs the last record
+    file_.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+    file_.flush();
+    fileRecords_++;
+    if (compacting_) {
+        pending_ += frame;
+        pendingRecords_++;
+    }
+    if (CompactionDue()) wake_.notify_all();
+}
+
+size_t DownloadJournal::LiveRecords() const {
+    size_t count = 0;
+    for (const auto& pair : records_) {
+        count += HasCheckpoint(pair.second) ? 3 : 2;
+    }
+    return count;
+}
+
+bool DownloadJournal::CompactionDue() const {
+    return !compacting_ && fileRecords_ >= retryAt_ && fileRecords_ > LiveRecords() * 2 + kCompactSlack;
+}
+
+void DownloadJournal::RunCompactor() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this]() { return !opened_ || CompactionDue(); });
+        if (!opened_) return;
+        // Should the rewrite fail, wait for as much again before retrying
+        if (!Compact(lock)) retryAt_ = fileRecords_ + kCompactSlack;
+    }
+}
+
+bool DownloadJournal::Compact(std::unique_lock<std::mutex>& lock) {
+    std::string snapshot;
+    size_t records = 0;
+    for (const auto& pair : records_) {
+        records += AppendRecord(snapshot, pair.second);
+    }
+    compacting_ = true;
+    pending_.clear();
+    pendingRecords_ = 0;
+
+    // Appends carry on into the old file while the snapshot is written.
+    // It reaches the disk before the rename, or a crash right after could
+    // leave an empty journal in place of the old one.
+    std::string tmpPath = path_ + ".tmp";
+    lock.unlock();
+    std::error_code ec;
+    std::filesystem::remove(tmpPath, ec); // Open does not truncate
+    PositionalFile tmp;
+    bool ok = tmp.Open(tmpPath) && tmp.WriteAt(0, snapshot.data(), snapshot.size()) && tmp.Flush();
+    lock.lock();
+    compacting_ = false;
+
+    if (ok && !pending_.empty()) {
+        ok = tmp.WriteAt(snapshot.size(), pending_.data(), pending_.size()) && tmp.Flush();
+    }
+    tmp.Close();
+    records += pendingRecords_;
+    pending_.clear();
+    pendingRecords_ = 0;
+
+    if (ok) {
+        // Windows cannot replace a file that is open
+        bool reopen = file_.is_open();
+        file_.close();
+        std::filesystem::rename(tmpPath, path_, ec);
+        if (reopen) file_.open(path_, std::ios::binary | std::ios::app);
+        ok = !ec;
+    }
+    if (!ok) {
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    fileRecords_ = records;
+    return true;
+}
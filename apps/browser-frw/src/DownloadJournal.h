@@ -0,0 +1,78 @@
+#pragma once
+
+#include "DownloadTask.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <fstream>
+#include <cstdint>
+
+// What the journal keeps of one download: enough to list it again and to
+// resume its transfer
+struct DownloadRecord {
+    int id = 0;
+    std::string url;
+    std::string filename;
+    std::string savePath;
+    int64_t speedLimit = 0;
+    int state = 0;          // DownloadState
+    int64_t startTime = 0;  // Milliseconds since the epoch
+    int64_t endTime = 0;
+    std::string errorMessage;
+    DownloadCheckpoint checkpoint;
+};
+
+// Append-only log of DownloadManager's list. Every change is one framed,
+// checksummed record written as it happens; replay keeps the last word on
+// each download and stops at the first record that a crash tore or never
+// finished. Once most records are superseded, a background thread rewrites
+// the log from the live state and swaps it in.
+class DownloadJournal {
+public:
+    DownloadJournal() = default;
+    ~DownloadJournal();
+
+    DownloadJournal(const DownloadJournal&) = delete;
+    DownloadJournal& operator=(const DownloadJournal&) = delete;
+
+    // Replays |path| into |records|, ordered by id, and appends to it from
+    // then on
+    bool Open(const std::string& path, std::vector<DownloadRecord>& records);
+    // Compacts and stops appending
+    void Close();
+
+    // Everything but the checkpoint is taken from |record|
+    void Add(const DownloadRecord& record);
+    void SetSpeedLimit(int id, int64_t speed_limit);
+    void SetState(int id, int state, int64_t start_time, int64_t end_time, const std::string& error);
+    // Safe to call from transfer threads
+    void SetCheckpoint(int id, const DownloadCheckpoint& checkpoint);
+    void Remove(int id);
+
+private:
+    std::mutex mutex_;
+    std::condition_variable wake_; // Compaction due, or closing
+    std::string path_;
+    std::ofstream file_;
+    bool opened_ = false;
+    std::map<int, DownloadRecord> records_; // The live state, for compaction
+    size_t fileRecords_ = 0;
+    // Records appended while a compaction writes, replayed onto its result
+    bool compacting_ = false;
+    std::string pending_;
+    size_t pendingRecords_ = 0;
+    size_t retryAt_ = 0; // After a failed compaction, not before this many records
+    std::thread compactor_;
+
+    void Append(const std::string& record);
+    size_t LiveRecords() const;
+    bool CompactionDue() const;
+    void RunCompactor();
+    // Writes the live state to a new file and swaps it in; |lock| is
+    // released while the bulk is written
+    bool Compact(std::unique_lock<std::mutex>& lock);
+};
@@ -0,0 +1,629 @@
+#include "DownloadTask.h"
+#include "ResolverBridge.h"
+#include "CancellationToken.h"
+#include "Sha256.h"
+#include "UI/SettingsManager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <limits>
+#include <regex>
+#include <thread>
+
+namespace {
+
+const int64_t kUnknownEnd = std::numeric_limits<int64_t>::max();
+// Files are split no finer than this, and a connection only takes over
+// the tail of another segment when both halves stay at least this large
+const int64_t kMinSegmentSize = 1024 * 1024;
+const int kMaxRetries = 4;
+const std::chrono::seconds kRetryDelay(1);
+// A crash costs at most this much per download, and the flush that comes
+// with each checkpoint stays rare
+const int64_t kCheckpointBytes = 8 * 1024 * 1024;
+
+} // namespace
+
+DownloadTask::DownloadTask(std::string url, std::string save_path, int max_segments)
+    : url_(std::move(url)), savePath_(std::move(save_path)), maxSegments_(std::max(max_segments, 1)),
+      flow_(std::make_shared<BandwidthFlow>()) {
+    // Path gateways (https://gw/ipfs/<cid>/path) and subdomain gateways
+    // (https://<cid>.ipfs.gw/path)
+    std::regex path_regex(R"(^(https?://[^/?#]+)/ipfs/([^/?#]+)([^?#]*))");
+    std::regex subdomain_regex(R"(^https?://([a-z0-9]+)\.ipfs\.[^/?#]+([^?#]*))");
+    std::smatch match;
+    std::string origin;
+    if (std::regex_search(url_, match, path_regex)) {
+        origin = match[1].str();
+        ipfsCid_ = match[2].str();
+        ipfsPath_ = match[3].str();
+    } else if (std::regex_search(url_, match, subdomain_regex)) {
+        ipfsCid_ = match[1].str();
+        ipfsPath_ = match[2].str();
+    } else {
+        return;
+    }
+
+    gateways_.push_back(origin);
+    for (std::string gateway : SettingsManager::Instance().GetIPFSGateways()) {
+        while (!gateway.empty() && gateway.back() == '/') gateway.pop_back();
+        if (!gateway.empty() && std::find(gateways_.begin(), gateways_.end(), gateway) == gateways_.end()) {
+            gateways_.push_back(gateway);
+        }
+    }
+}
+
+void DownloadTask::Start(std::function<void(bool success, const std::string& error)> on_done) {
+    bool expected = false;
+    if (!running_.compare_exchange_strong(expected, true)) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancel_ = std::make_shared<CancellationToken>();
+    }
+
+    auto self = shared_from_this();
+    std::thread([self, on_done]() { self->Run(on_done); }).detach();
+}
+
+void DownloadTask::Cancel() {
+    std::shared_ptr<CancellationToken> cancel;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancel = cancel_;
+    }
+    if (cancel) cancel->Cancel();
+}
+
+double DownloadTask::Speed() const {
+    return running_ ? flow_->Rate() : 0.0;
+}
+
+void DownloadTask::DiscardPartial() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_) {
+            discard_ = true;
+            return;
+        }
+        Reset();
+    }
+    std::error_code ec;
+    std::filesystem::remove(PartPath(), ec);
+}
+
+void DownloadTask::Restore(const DownloadCheckpoint& checkpoint) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_ || checkpoint.segments.empty()) return;
+
+    // Prepare() still starts over if the part file does not match
+    segments_.clear();
+    int64_t received = 0;
+    for (const auto& saved : checkpoint.segments) {
+        int64_t done = std::max(saved.start, std::min(saved.done, saved.end));
+        segments_.push_back(std::make_shared<Segment>(Segment{saved.start, saved.end, done, done, false, 0}));
+        received += done - saved.start;
+    }
+    probed_ = true;
+    rangeable_ = checkpoint.rangeable;
+    validator_ = checkpoint.validator;
+    total_ = checkpoint.total;
+    received_ = received;
+    checkpointed_ = received;
+}
+
+void DownloadTask::SetCheckpointCallback(std::function<void(const DownloadCheckpoint&)> on_checkpoint) {
+    std::lock_guard<std::mutex> lock(checkpointMutex_);
+    onCheckpoint_ = std::move(on_checkpoint);
+}
+
+void DownloadTask::Run(std::function<void(bool, const std::string&)> on_done) {
+    // Wakes workers waiting for a segment on cancel
+    int link = cancel_->Register([this]() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wake_.notify_all();
+    });
+
+    std::string error;
+    bool success = false;
+    bool ready = Probe(error);
+    if (ready) {
+        MapContent();
+        ready = Prepare(error);
+    }
+    if (ready) {
+        SaveCheckpoint(true);
+        std::vector<std::thread> threads;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            workers_ = rangeable_ ? maxSegments_ : 1;
+            for (int i = 0; i < workers_; ++i) {
+                threads.emplace_back(&DownloadTask::RunWorker, this);
+            }
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        success = IsComplete() && Finish(error);
+        if (!success && error.empty()) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (changed_) {
+                error = "The file changed on the server; retry to download it again";
+                Reset();
+            } else if (cancel_->IsCancelled()) {
+                error = "Cancelled";
+            } else if (mismatches_ > 0) {
+                error = "The data did not match its CID on any gateway";
+            } else {
+                error = "Connection lost";
+            }
+        }
+        SaveCheckpoint(true);
+    }
+    cancel_->Unregister(link);
+    file_.Close();
+
+    bool discard = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        discard = discard_ && !success;
+        if (discard) Reset();
+        discard_ = false;
+        running_ = false;
+    }
+    if (discard) {
+        std::error_code ec;
+        std::filesystem::remove(PartPath(), ec);
+    }
+    if (on_done) on_done(success, error);
+}
+
+bool DownloadTask::Probe(std::string& error) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (probed_) return true;
+    }
+
+    // A one-byte range tells whether the server can resume, and the length
+    HttpRequest request;
+    request.url = url_;
+    request.headers.emplace_back("Range", "bytes=0-0");
+    request.cancel = cancel_;
+    request.trafficClass = TrafficClass::Download;
+    request.flow = flow_;
+    request.onResponse = [](const HttpResponse&) { return false; }; // Headers are enough
+
+    HttpResponse response;
+    if (!ResolverBridge::HttpGet(request, response) || cancel_->IsCancelled()) {
+        error = cancel_->IsCancelled() ? "Cancelled" : "Could not connect";
+        return false;
+    }
+
+    bool rangeable = false;
+    int64_t total = -1;
+    if (response.status == 206) {
+        auto it = response.headers.find("content-range");
+        int64_t first = 0, last = 0;
+        rangeable = it != response.headers.end() &&
+                    ResolverBridge::ParseContentRange(it->second, first, last, total) && total >= 0;
+    } else if (response.status == 200) {
+        auto it = response.headers.find("content-length");
+        if (it != response.headers.end()) total = std::strtoll(it->second.c_str(), nullptr, 10);
+    } else if (response.status != 416) { // 416: an empty file has no byte 0
+        error = "The server answered " + std::to_string(response.status);
+        return false;
+    }
+
+    // If-Range needs a strong validator. Content under a CID never changes,
+    // and other gateways would not share this one's tags anyway.
+    std::string validator;
+    auto etag = response.headers.find("etag");
+    auto modified = response.headers.find("last-modified");
+    if (ipfsCid_.empty()) {
+        if (etag != response.headers.end() && etag->second.compare(0, 2, "W/") != 0) {
+            validator = etag->second;
+        } else if (modified != response.headers.end()) {
+            validator = modified->second;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    probed_ = true;
+    rangeable_ = rangeable;
+    validator_ = validator;
+    total_ = total;
+    return true;
+}
+
+void DownloadTask::MapContent() {
+    int64_t total = total_.load();
+    std::vector<std::string> gateways;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (ipfsCid_.empty() || mapped_ || total < 0) return;
+        for (const auto& gateway : gateways_) {
+            if (!gateway.empty()) gateways.push_back(gateway);
+        }
+    }
+
+    // Only the inner nodes of the DAG are fetched here; the file bytes
+    // still arrive over the segmented transfer
+    std::vector<FileSpan> spans;
+    TrustlessFetcher fetcher(gateways, cancel_, TrafficClass::Download);
+    bool ok = fetcher.MapFile(ipfsCid_, ipfsPath_, static_cast<uint64_t>(total), spans) == TrustlessResult::Ok;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cancel_->IsCancelled()) return; // Tried again on the next run
+    mapped_ = true;
+    spans_ = ok ? std::move(spans) : std::vector<FileSpan>();
+    verified_ = ok;
+}
+
+bool DownloadTask::Prepare(std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!file_.Open(PartPath())) {
+        error = "Could not write " + PartPath();
+        return false;
+    }
+
+    int64_t total = total_.load();
+    // Without ranges there is nothing to resume; a part file that changed
+    // size behind our back cannot be trusted either
+    bool fresh = segments_.empty() || !rangeable_ ||
+                 (total >= 0 && file_.Size() != static_cast<uint64_t>(total));
+    // A verified transfer only ever stops between spans
+    if (verified_) {
+        for (const auto& segment : segments_) {
+            fresh = fresh || AlignToSpan(segment->start) != segment->start ||
+                    AlignToSpan(segment->done) != segment->done || AlignToSpan(segment->end) != segment->end;
+        }
+    }
+    if (fresh) {
+        segments_.clear();
+        if (!file_.Preallocate(total >= 0 ? static_cast<uint64_t>(total) : 0)) {
+            error = "Not enough disk space";
+            return false;
+        }
+
+        int64_t count = 1;
+        if (rangeable_) count = std::max<int64_t>(1, std::min<int64_t>(maxSegments_, total / kMinSegmentSize));
+        int64_t size = total >= 0 ? total / count : 0;
+        for (int64_t i = 0; i < count; ++i) {
+            int64_t start = i * size;
+            int64_t end = i + 1 == count ? (total >= 0 ? total : kUnknownEnd) : start + size;
+            if (verified_) {
+                start = AlignToSpan(start);
+                end = AlignToSpan(end);
+                if (start >= end && !segments_.empty()) continue;
+            }
+            segments_.push_back(std::make_shared<Segment>(Segment{start, end, start, start, false, 0}));
+        }
+    }
+
+    // Writes that never reached the disk are taken back
+    int64_t received = 0;
+    for (auto& segment : segments_) {
+        segment->next = segment->done;
+        segment->active = false;
+        received += segment->done - segment->start;
+    }
+    received_ = received;
+    checkpointed_ = received;
+    changed_ = false;
+    mismatches_ = 0;
+    return true;
+}
+
+void DownloadTask::RunWorker() {
+    int failures = 0;
+    while (auto segment = NextSegment()) {
+        bool ok = FetchSegment(segment);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            segment->active = false;
+        }
+        wake_.notify_all();
+
+        if (ok) {
+            failures = 0;
+            continue;
+        }
+        if (cancel_->IsCancelled() || ++failures > kMaxRetries) break;
+
+        // Dropped connections are usually transient; back off and resume
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait_for(lock, kRetryDelay * failures, [this]() { return cancel_->IsCancelled(); });
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    workers_--;
+    wake_.notify_all();
+}
+
+std::shared_ptr<DownloadTask::Segment> DownloadTask::NextSegment() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        if (cancel_->IsCancelled() || changed_) return nullptr;
+
+        for (auto& segment : segments_) {
+            if (!segment->active && segment->next < segment->end) {
+                segment->active = true;
+                return segment;
+            }
+        }
+
+        // Nothing unowned: take over half of the largest remainder
+        std::shared_ptr<Segment> victim;
+        bool any_active = false;
+        for (const auto& segment : segments_) {
+            if (!segment->active) continue;
+            any_active = true;
+            if (segment->end == kUnknownEnd) continue;
+            int64_t remaining = segment->end - segment->next;
+            if (remaining >= kMinSegmentSize * 2 && (!victim || remaining > victim->end - victim->next)) {
+                victim = segment;
+            }
+        }
+        int64_t middle = victim ? victim->next + (victim->end - victim->next) / 2 : 0;
+        // A verifying connection hashes whole spans, so split between them
+        if (victim && verified_) middle = AlignToSpan(middle);
+        if (victim && middle < victim->end) {
+            auto segment = std::make_shared<Segment>(Segment{middle, victim->end, middle, middle, true,
+                                                             victim->gateway});
+            victim->end = middle;
+            segments_.push_back(segment);
+            return segment;
+        }
+
+        // A connection that fails hands its segment back; wait for that
+        if (!any_active) return nullptr;
+        wake_.wait(lock);
+    }
+}
+
+bool DownloadTask::FetchSegment(const std::shared_ptr<Segment>& segment) {
+    HttpRequest request;
+    request.cancel = cancel_;
+    request.trafficClass = TrafficClass::Download;
+    request.flow = flow_;
+
+    int64_t start = 0;
+    bool rangeable = false;
+    bool verify = false;
+    std::string validator;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Without ranges every attempt starts over from the first byte
+        if (!rangeable_ && segment->done > segment->start) {
+            received_ -= segment->done - segment->start;
+            segment->next = segment->done = segment->start;
+        }
+        // Bytes of a span that was never completed cannot be checked
+        if (verified_) segment->next = segment->done;
+        start = segment->next;
+        rangeable = rangeable_;
+        verify = verified_;
+        validator = validator_;
+        request.url = SegmentUrl(*segment);
+        if (rangeable) {
+            // A thief may still lower the end; the transfer then stops early
+            request.headers.emplace_back("Range", "bytes=" + std::to_string(start) + "-" +
+                                                      std::to_string(segment->end - 1));
+            if (!validator.empty()) request.headers.emplace_back("If-Range", validator);
+        }
+    }
+
+    bool changed = false;
+    request.onResponse = [&](const HttpResponse& response) {
+        if (!rangeable) return response.status == 200;
+        // If-Range answers with the whole new file when ours is outdated
+        if (response.status == 200 && !validator.empty()) {
+            changed = true;
+            return false;
+        }
+        if (response.status != 206) return false;
+        auto it = response.headers.find("content-range");
+        int64_t first = 0, last = 0, total = 0;
+        return it != response.headers.end() && ResolverBridge::ParseContentRange(it->second, first, last, total) &&
+               first == start;
+    };
+
+    // Spans are hashed from the same buffers that are written, so nothing
+    // is read back from disk
+    Sha256 hasher;
+    size_t span = 0;
+    if (verify) {
+        span = SpanAt(start);
+        hasher.Update(spans_[span].prefix.data(), spans_[span].prefix.size());
+    }
+
+    bool write_failed = false;
+    bool mismatch = false;
+    request.onData = [&](const char* data, size_t size) {
+        int64_t position = 0;
+        size_t count = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            position = segment->next;
+            if (position >= segment->end) return false;
+            count = static_cast<size_t>(std::min<int64_t>(static_cast<int64_t>(size), segment->end - position));
+            segment->next = position + static_cast<int64_t>(count);
+        }
+
+        // Disjoint ranges, so the write itself needs no lock
+        bool written = file_.WriteAt(static_cast<uint64_t>(position), data, count);
+
+        if (!written) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            segment->next = position;
+            write_failed = true;
+            return false;
+        }
+        if (!verify) {
+            bool more = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                segment->done = position + static_cast<int64_t>(count);
+                received_ += static_cast<int64_t>(count);
+                more = segment->done < segment->end;
+            }
+            SaveCheckpoint(!more);
+            return more;
+        }
+
+        // Close each span this chunk completes; a span still open is on
+        // disk but not counted as done
+        int64_t checked_end = -1;
+        int64_t checked_bytes = 0;
+        int64_t at = position;
+        while (count > 0) {
+            const FileSpan& current = spans_[span];
+            int64_t span_end = static_cast<int64_t>(current.offset + current.size);
+            size_t take = static_cast<size_t>(std::min<int64_t>(static_cast<int64_t>(count), span_end - at));
+            hasher.Update(data, take);
+            data += take;
+            count -= take;
+            at += static_cast<int64_t>(take);
+            if (at < span_end) break;
+
+            hasher.Update(current.suffix.data(), current.suffix.size());
+            bool match = hasher.Finish() == current.digest;
+            hasher.Reset();
+            if (!match) {
+                mismatch = true;
+                break;
+            }
+            checked_end = span_end;
+            checked_bytes += static_cast<int64_t>(current.size);
+            if (++span < spans_.size()) hasher.Update(spans_[span].prefix.data(), spans_[span].prefix.size());
+        }
+
+        bool more = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (checked_end >= 0) {
+                segment->done = checked_end;
+                received_ += checked_bytes;
+            }
+            if (mismatch) {
+                segment->next = segment->done;
+                return false;
+            }
+            more = segment->done < segment->end;
+        }
+        if (checked_end >= 0) SaveCheckpoint(!more);
+        return more;
+    };
+
+    HttpResponse response;
+    bool ok = ResolverBridge::HttpGet(request, response);
+
+    if (changed) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            changed_ = true;
+        }
+        cancel_->Cancel();
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (mismatch) {
+        // Corrupted by this gateway or on the way; the next one refetches it
+        mismatches_++;
+        segment->gateway = (segment->gateway + 1) % gateways_.size();
+        return false;
+    }
+    // Without a length, the end of the response is the end of the file
+    if (segment->end == kUnknownEnd && ok && response.complete && response.status == 200 && !write_failed &&
+        !cancel_->IsCancelled()) {
+        segment->end = segment->done;
+        total_ = segment->done;
+    }
+    return segment->done >= segment->end;
+}
+
+std::string DownloadTask::SegmentUrl(const Segment& segment) const {
+    if (segment.gateway == 0 || segment.gateway >= gateways_.size()) return url_;
+    return gateways_[segment.gateway] + "/ipfs/" + ipfsCid_ + ipfsPath_;
+}
+
+int64_t DownloadTask::AlignToSpan(int64_t position) const {
+    auto it = std::lower_bound(spans_.begin(), spans_.end(), position, [](const FileSpan& span, int64_t value) {
+        return static_cast<int64_t>(span.offset) < value;
+    });
+    return it == spans_.end() ? total_.load() : static_cast<int64_t>(it->offset);
+}
+
+size_t DownloadTask::SpanAt(int64_t position) const {
+    auto it = std::upper_bound(spans_.begin(), spans_.end(), position, [](int64_t value, const FileSpan& span) {
+        return value < static_cast<int64_t>(span.offset);
+    });
+    return static_cast<size_t>(it - spans_.begin()) - 1;
+}
+
+void DownloadTask::SaveCheckpoint(bool force) {
+    if (!force && received_.load() - checkpointed_.load() < kCheckpointBytes) return;
+
+    std::lock_guard<std::mutex> order(checkpointMutex_);
+    if (!onCheckpoint_) return;
+    DownloadCheckpoint checkpoint;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int64_t received = received_.load();
+        // Another thread got here first
+        if (!force && received - checkpointed_.load() < kCheckpointBytes) return;
+        checkpointed_ = received;
+        checkpoint.total = total_.load();
+        checkpoint.rangeable = rangeable_;
+        checkpoint.validator = validator_;
+        for (const auto& segment : segments_) {
+            checkpoint.segments.push_back({segment->start, segment->end, segment->done});
+        }
+    }
+
+    if (file_.IsOpen()) file_.Flush();
+    onCheckpoint_(checkpoint);
+}
+
+bool DownloadTask::IsComplete() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& segment : segments_) {
+        if (segment->done < segment->end) return false;
+    }
+    return true;
+}
+
+bool DownloadTask::Finish(std::string& error) {
+    file_.Flush();
+    file_.Close();
+
+    std::error_code ec;
+    std::filesystem::rename(PartPath(), savePath_, ec);
+    if (ec) {
+        error = "Could not move the download to " + savePath_;
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    segments_.clear();
+    probed_ = false;
+    mapped_ = false;
+    spans_.clear();
+    return true;
+}
+
+void DownloadTask::Reset() {
+    segments_.clear();
+    probed_ = false;
+    rangeable_ = false;
+    changed_ = false;
+    validator_.clear();
+    mapped_ = false;
+    spans_.clear();
+    verified_ = false;
+    total_ = -1;
+    received_ = 0;
+    checkpointed_ = 0;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "PositionalFile.h"
+#include "BandwidthScheduler.h"
+#include "TrustlessFetcher.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+
+class CancellationToken;
+
+// What a transfer needs to pick up where it stopped, in this session or a
+// later one
+struct DownloadCheckpoint {
+    struct Segment {
+        int64_t start;
+        int64_t end;
+        int64_t done; // Bytes in [start, done) are on disk
+    };
+
+    int64_t total = -1;
+    bool rangeable = false;
+    std::string validator;
+    std::vector<Segment> segments; // Empty when there is nothing to resume
+};
+
+// Transfers one file for DownloadManager. When the server honours byte
+// ranges the file is split into segments fetched over parallel connections
+// and written with positional writes into a preallocated "<path>.part";
+// idle connections take over half of the largest remaining segment. Only
+// bytes that reached the file count as done, so Start() after a failure or
+// Cancel() resumes from there. If-Range makes sure a file that changed on
+// the server is not stitched together from two versions.
+// Content under /ipfs/<cid> is checked against its CID while it is written:
+// each leaf block of the file is hashed as its bytes arrive, and a range
+// that fails is fetched again from the next configured gateway.
+class DownloadTask : public std::enable_shared_from_this<DownloadTask> {
+public:
+    DownloadTask(std::string url, std::string save_path, int max_segments);
+
+    // Runs the transfer on background threads; |on_done| gets the outcome.
+    // Ignored while a transfer is already running.
+    void Start(std::function<void(bool success, const std::string& error)> on_done);
+    void Cancel();
+    bool IsRunning() const { return running_.load(); }
+
+    // Deletes the partial file, now or once the running transfer stops
+    void DiscardPartial();
+
+    // Takes up a checkpoint saved by an earlier session; the next Start()
+    // resumes from it without probing again. Call before Start().
+    void Restore(const DownloadCheckpoint& checkpoint);
+    // Called from transfer threads, in order, once the layout is settled,
+    // when a segment completes, every few MiB and when the transfer stops.
+    // The part file is flushed first, so a checkpoint never counts bytes
+    // that a power cut could still take back. Set before Start().
+    void SetCheckpointCallback(std::function<void(const DownloadCheckpoint&)> on_checkpoint);
+
+    // Lock-free, so the UI can poll while transfer threads write
+    int64_t TotalSize() const { return total_.load(); } // -1 while unknown
+    int64_t ReceivedSize() const { return received_.load(); }
+    // Bytes per second over all connections, as measured by BandwidthScheduler
+    double Speed() const;
+    // Every byte written so far was checked against the CID
+    bool IsVerified() const { return verified_.load(); }
+    // Caps all connections of this download together; 0 for no cap
+    void SetSpeedLimit(int64_t bytes_per_second) { flow_->SetLimit(bytes_per_second); }
+
+    const std::string& SavePath() const { return savePath_; }
+    std::string PartPath() const { return savePath_ + ".part"; }
+
+private:
+    // A slice of the file. Bytes below |done| are on disk; |next| runs
+    // ahead of it by the write in progress. A thief lowers |end|.
+    struct Segment {
+        int64_t start;
+        int64_t end;  // Exclusive; INT64_MAX while the length is unknown
+        int64_t next;
+        int64_t done;  // With verification, only at span boundaries
+        bool active;
+        size_t gateway; // Index into gateways_
+    };
+
+    const std::string url_;
+    const std::string savePath_;
+    const int maxSegments_;
+    const std::shared_ptr<BandwidthFlow> flow_;
+
+    std::atomic<int64_t> total_{-1};
+    std::atomic<int64_t> received_{0};
+    std::atomic<bool> running_{false};
+    std::atomic<bool> verified_{false};
+
+    std::mutex mutex_;
+    std::condition_variable wake_; // Segment handed back, worker exited or cancelled
+    int workers_ = 0;
+    std::shared_ptr<CancellationToken> cancel_;
+    bool probed_ = false;
+    bool rangeable_ = false;
+    bool changed_ = false;   // The server sent a different version on resume
+    bool discard_ = false;
+    std::string validator_;  // Strong ETag or Last-Modified, for If-Range
+    // Set for /ipfs/ URLs. gateways_[0] is the URL's own; the rest come
+    // from the settings.
+    std::string ipfsCid_;
+    std::string ipfsPath_;
+    std::vector<std::string> gateways_;
+    bool mapped_ = false;
+    std::vector<FileSpan> spans_; // Tile the file while verifying; empty otherwise
+    int mismatches_ = 0;
+    std::vector<std::shared_ptr<Segment>> segments_; // Tile the whole file
+    PositionalFile file_;
+    // Held while a checkpoint is taken and handed on, so they arrive in order
+    std::mutex checkpointMutex_;
+    std::function<void(const DownloadCheckpoint&)> onCheckpoint_;
+    std::atomic<int64_t> checkpointed_{0}; // received_ at the last checkpoint
+
+    void Run(std::function<void(bool, const std::string&)> on_done);
+    bool Probe(std::string& error);
+    // Works out the spans to verify against; leaves them empty when the
+    // DAG cannot be mapped, and the download then goes unchecked
+    void MapContent();
+    bool Prepare(std::string& error);
+    void RunWorker();
+    std::shared_ptr<Segment> NextSegment();
+    bool FetchSegment(const std::shared_ptr<Segment>& segment);
+    std::string SegmentUrl(const Segment& segment) const;
+    // The first span boundary at or after |position|
+    int64_t AlignToSpan(int64_t position) const;
+    size_t SpanAt(int64_t position) const;
+    // Skipped unless |force| or enough bytes arrived since the last one
+    void SaveCheckpoint(bool force);
+    bool IsComplete();
+    bool Finish(std::string& error);
+    void Reset();
+};
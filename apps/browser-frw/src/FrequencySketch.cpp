@@ -0,0 +1,66 @@
+#include "FrequencySketch.h"
+
+#include <algorithm>
+
+namespace {
+
+const int kRows = 4;
+const size_t kMinWords = 64;
+const size_t kMaxWords = size_t(1) << 22; // 32 MB of counters at most
+
+} // namespace
+
+void FrequencySketch::EnsureCapacity(size_t entries) {
+    size_t words = kMinWords;
+    while (words < entries && words < kMaxWords) words <<= 1;
+    if (words == table_.size()) return;
+
+    table_.assign(words, 0);
+    mask_ = words - 1;
+    additions_ = 0;
+    // Aging every 10 * capacity accesses, as W-TinyLFU suggests
+    sampleSize_ = std::max<size_t>(entries, kMinWords) * 10;
+}
+
+void FrequencySketch::Increment(uint64_t key) {
+    if (table_.empty()) return;
+
+    bool added = false;
+    for (int row = 0; row < kRows; ++row) {
+        uint64_t hash = Rehash(key, row);
+        uint64_t& word = table_[hash & mask_];
+        int shift = static_cast<int>((hash >> 60) & 15) * 4;
+        if (((word >> shift) & 0xF) != 0xF) {
+            word += uint64_t(1) << shift;
+            added = true;
+        }
+    }
+    if (added && ++additions_ >= sampleSize_) Reset();
+}
+
+int FrequencySketch::Estimate(uint64_t key) const {
+    if (table_.empty()) return 0;
+
+    int estimate = 15;
+    for (int row = 0; row < kRows; ++row) {
+        uint64_t hash = Rehash(key, row);
+        int shift = static_cast<int>((hash >> 60) & 15) * 4;
+        estimate = std::min(estimate, static_cast<int>((table_[hash & mask_] >> shift) & 0xF));
+    }
+    return estimate;
+}
+
+uint64_t FrequencySketch::Rehash(uint64_t key, int row) {
+    // splitmix64 finaliser, seeded per row
+    uint64_t x = key + (static_cast<uint64_t>(row) + 1) * 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+void FrequencySketch::Reset() {
+    for (uint64_t& word : table_) {
+        word = (word >> 1) & 0x7777777777777777ull;
+    }
+    additions_ /= 2;
+}
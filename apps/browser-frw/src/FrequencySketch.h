@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Approximate access counts for cache admission (TinyLFU). A count-min
+// sketch of 4-bit counters, four per key; all counters are halved once
+// enough accesses were recorded, so popularity fades over time.
+class FrequencySketch {
+public:
+    // Sizes the table for about |entries| distinct keys; resets the counts
+    // when the size changes
+    void EnsureCapacity(size_t entries);
+
+    void Increment(uint64_t key);
+    // 0..15
+    int Estimate(uint64_t key) const;
+
+private:
+    std::vector<uint64_t> table_; // 16 counters per word
+    uint64_t mask_ = 0;
+    size_t additions_ = 0;
+    size_t sampleSize_ = 0;
+
+    static uint64_t Rehash(uint64_t key, int row);
+    void Reset();
+};
@@ -0,0 +1,505 @@
+#include "FrwProviderChain.h"
+#include "FrwSchemeHandler.h"
+#include "CancellationToken.h"
+#include "ContentStore.h"
+#include "OfflineMode.h"
+#include "ResolverBridge.h"
+#include "SiteBundleManager.h"
+#include "UI/SettingsManager.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <regex>
+#include <sstream>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Contexts of requests CEF abandoned before asking for a handler
+const std::chrono::minutes kContextLifetime(5);
+const size_t kPruneThreshold = 1024;
+// The local node answers from its own blockstore or not at all
+const int kLocalNodeTimeoutMs = 2000;
+// Resolves and local node reads running at once; more wait their turn
+const size_t kMaxTierThreads = 8;
+
+// Escapes a query value; '%' is left alone because the path is already URL-encoded
+std::string EscapeQueryValue(const std::string& value) {
+    static const char kHex[] = "0123456789ABCDEF";
+    std::string out;
+    for (unsigned char c : value) {
+        if (c == '&' || c == '+' || c == '#' || c == '=' || c == ' ') {
+            out.push_back('%');
+            out.push_back(kHex[c >> 4]);
+            out.push_back(kHex[c & 0xF]);
+        } else {
+            out.push_back(static_cast<char>(c));
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+// Looks up the request's context, times the tier and records its outcome
+class FrwProviderChain::TierProvider : public CefResourceManager::Provider {
+public:
+    explicit TierProvider(Tier tier) : tier_(tier) {}
+
+    bool OnRequest(scoped_refptr<CefResourceManager::Request> request) override {
+        CEF_REQUIRE_IO_THREAD();
+        auto context = Chain().FindContext(request->request()->GetIdentifier());
+        if (!context || context->cancel->IsCancelled()) return false;
+        if (tier_ != Tier::Pinned && context->cid.empty()) return false;
+        return Handle(request, context, Clock::now());
+    }
+
+    void OnRequestCanceled(scoped_refptr<CefResourceManager::Request> request) override {
+        auto context = Chain().FindContext(request->request()->GetIdentifier());
+        if (context) context->cancel->Cancel();
+    }
+
+protected:
+    using Context = std::shared_ptr<RequestContext>;
+
+    // Returns false to pass the request on right away (after recording a
+    // miss); otherwise Finish() must be called, possibly from another thread
+    virtual bool Handle(scoped_refptr<CefResourceManager::Request> request, const Context& context,
+                        Clock::time_point started) = 0;
+
+    // Static so that worker threads never touch a provider the manager may
+    // already have deleted
+    static void Record(Tier tier, bool hit, Clock::time_point started) { Chain().Record(tier, hit, started); }
+
+    // A null |handler| hands the request to the next tier
+    static void Finish(Tier tier, scoped_refptr<CefResourceManager::Request> request,
+                       CefRefPtr<CefResourceHandler> handler, bool hit, Clock::time_point started) {
+        Record(tier, hit, started);
+        request->Continue(handler);
+    }
+
+    static FrwProviderChain& Chain() { return FrwProviderChain::Instance(); }
+    // Runs |job| on the chain's workers; false once the chain is shut down
+    static bool Post(const Context& context, std::function<void()> job) {
+        return Chain().workers_.Post(std::move(job), context->cancel);
+    }
+    static void Pin(int browser_id, const std::string& name, const std::string& cid) {
+        Chain().Pin(browser_id, name, cid);
+    }
+    static bool FindPin(int browser_id, const std::string& name, std::string& out_cid) {
+        return Chain().FindPin(browser_id, name, out_cid);
+    }
+
+    static CefRefPtr<FrwSchemeHandler> CreateHandler(const Context& context) {
+        CefRefPtr<FrwSchemeHandler> handler =
+            new FrwSchemeHandler(context->url, context->name, context->cid, context->path);
+        handler->SetCachedCopy(context->cachedCopy);
+        handler->SetTrafficClass(context->trafficClass);
+        return handler;
+    }
+
+    Tier tier_;
+};
+
+namespace {
+
+using TierProvider = FrwProviderChain::TierProvider;
+using Tier = FrwProviderChain::Tier;
+
+// Subresources reuse the CID their page was loaded from, so a page never
+// mixes two versions of a site and assets cost no name lookup. Navigations
+// (and sites the page has not loaded yet) resolve through every bootstrap
+// node at once. Offline, the last CID seen for the name is used instead.
+class PinnedCidProvider : public TierProvider {
+public:
+    PinnedCidProvider() : TierProvider(Tier::Pinned) {}
+
+protected:
+    bool Handle(scoped_refptr<CefResourceManager::Request> request, const Context& context,
+                Clock::time_point started) override {
+        if (!context->navigation && FindPin(context->browserId, context->name, context->cid)) {
+            Record(tier_, true, started);
+            return false;
+        }
+
+        // No bootstrap node to wait for: answer from the name cache right here
+        if (context->offline) {
+            if (!UseCachedRoot(context)) {
+                Finish(tier_, request, FrwSchemeHandler::CreateNotFound(context->url, context->name, 0, true), false,
+                       started);
+                return true;
+            }
+            Record(tier_, true, started);
+            return false;
+        }
+
+        Tier tier = tier_;
+        bool posted = Post(context, [tier, request, context, started]() {
+            std::string cid;
+            bool resolved = ResolverBridge::ResolveName(context->name, cid, context->cancel);
+            if (context->cancel->IsCancelled()) return;
+
+            // The resolve itself may be what showed the network is gone
+            if (!resolved && OfflineMode::Instance().IsOffline()) {
+                context->offline = true;
+                if (UseCachedRoot(context)) {
+                    Finish(tier, request, nullptr, true, started);
+                } else {
+                    Finish(tier, request, FrwSchemeHandler::CreateNotFound(context->url, context->name, 0, true),
+                           false, started);
+                }
+                return;
+            }
+
+            if (!resolved) {
+                size_t nodes = SettingsManager::Instance().GetBootstrapNodes().size();
+                Finish(tier, request, FrwSchemeHandler::CreateNotFound(context->url, context->name, nodes, false),
+                       false, started);
+                return;
+            }
+
+            ContentStore::Instance().RecordSiteRoot(context->name, cid);
+            // Fetch the rest of the site as one bundle in the background
+            SiteBundleManager::Instance().OnSiteResolved(context->name, cid);
+            Pin(context->browserId, context->name, cid);
+            context->cid = cid;
+            Finish(tier, request, nullptr, false, started);
+        });
+        if (!posted) Record(tier_, false, started);
+        return posted;
+    }
+
+private:
+    // Pins the CID the content store last recorded for the name
+    static bool UseCachedRoot(const Context& context) {
+        std::string cid;
+        if (!ContentStore::Instance().LookupSiteRoot(context->name, cid)) return false;
+        SiteBundleManager::Instance().OnSiteResolved(context->name, cid);
+        Pin(context->browserId, context->name, cid);
+        context->cid = cid;
+        context->cachedCopy = true;
+        return true;
+    }
+};
+
+class MemoryProvider : public TierProvider {
+public:
+    MemoryProvider() : TierProvider(Tier::Memory) {}
+
+protected:
+    bool Handle(scoped_refptr<CefResourceManager::Request> request, const Context& context,
+                Clock::time_point started) override {
+        std::string content;
+        if (!SiteBundleManager::Instance().Lookup(context->name, context->cid, context->path, content)) {
+            Record(tier_, false, started);
+            return false;
+        }
+        CefRefPtr<FrwSchemeHandler> handler = CreateHandler(context);
+        handler->SetBody(std::move(content));
+        Finish(tier_, request, handler, true, started);
+        return true;
+    }
+};
+
+class DiskProvider : public TierProvider {
+public:
+    DiskProvider() : TierProvider(Tier::Disk) {}
+
+protected:
+    bool Handle(scoped_refptr<CefResourceManager::Request> request, const Context& context,
+                Clock::time_point started) override {
+        auto mapping = ContentStore::Instance().Map(context->cid, context->path);
+        if (!mapping) {
+            Record(tier_, false, started);
+            return false;
+        }
+        CefRefPtr<FrwSchemeHandler> handler = CreateHandler(context);
+        handler->SetBody(std::move(mapping));
+        Finish(tier_, request, handler, true, started);
+        return true;
+    }
+};
+
+// Asks the local node's RPC API with offline=true, so it answers from its
+// own blockstore and never goes to the network on our behalf
+class LocalNodeProvider : public TierProvider {
+public:
+    LocalNodeProvider() : TierProvider(Tier::Local) {}
+
+protected:
+    bool Handle(scoped_refptr<CefResourceManager::Request> request, const Context& context,
+                Clock::time_point started) override {
+        const Settings& settings = SettingsManager::Instance().GetSettings();
+        if (!settings.useLocalIPFS || settings.localIPFSApi.empty()) {
+            Record(tier_, false, started);
+            return false;
+        }
+
+        std::string api = settings.localIPFSApi;
+        // Larger objects are left to the gateway tier, which can stream them
+        size_t limit = static_cast<size_t>(settings.parallelFetchThresholdMB) * 1024 * 1024;
+
+        Tier tier = tier_;
+        bool posted = Post(context, [tier, request, context, started, api, limit]() {
+            std::string path = context->path.substr(0, context->path.find('?'));
+            if (path.empty() || path.back() == '/') path += "index.html";
+
+            std::string content;
+            bool truncated = false;
+            HttpRequest fetch;
+            fetch.method = "POST";
+            fetch.url = api + "/api/v0/cat?arg=" + EscapeQueryValue("/ipfs/" + context->cid + path) +
+                        "&offline=true";
+            fetch.timeoutMs = kLocalNodeTimeoutMs;
+            fetch.cancel = context->cancel;
+            fetch.trafficClass = context->trafficClass;
+            fetch.onResponse = [](const HttpResponse& response) { return response.status == 200; };
+            fetch.onData = [&](const char* data, size_t size) {
+                if (limit > 0 && content.size() + size > limit) {
+                    truncated = true;
+                    return false;
+                }
+                content.append(data, size);
+                return true;
+            };
+
+            HttpResponse response;
+            bool ok = ResolverBridge::HttpGet(fetch, response) && response.status == 200 && response.complete;
+            if (context->cancel->IsCancelled()) return;
+            // Only part of the object was read; never store or serve it
+            if (!ok || truncated) {
+                Finish(tier, request, nullptr, false, started);
+                return;
+            }
+
+            ContentStore::Instance().Put(context->cid, context->path, content);
+            CefRefPtr<FrwSchemeHandler> handler = CreateHandler(context);
+            handler->SetBody(std::move(content));
+            Finish(tier, request, handler, true, started);
+        });
+        if (!posted) Record(tier_, false, started);
+        return posted;
+    }
+};
+
+// Hands the request to FrwSchemeHandler, which fetches on its own thread;
+// the tier is timed until that load completes. Offline it passes at once.
+class GatewayProvider : public TierProvider {
+public:
+    GatewayProvider() : TierProvider(Tier::Gateway) {}
+
+protected:
+    bool Handle(scoped_refptr<CefResourceManager::Request> request, const Context& context,
+                Clock::time_point started) override {
+        if (context->offline || OfflineMode::Instance().IsOffline()) {
+            Record(tier_, false, started);
+            return false;
+        }
+        CefRefPtr<FrwSchemeHandler> handler = CreateHandler(context);
+        Tier tier = tier_;
+        handler->SetLoadCallback([tier, started](bool served) { Record(tier, served, started); });
+        request->Continue(handler);
+        return true;
+    }
+};
+
+TierProvider* CreateProvider(const std::string& name) {
+    if (name == "pinned") return new PinnedCidProvider();
+    if (name == "memory") return new MemoryProvider();
+    if (name == "disk") return new DiskProvider();
+    if (name == "local") return new LocalNodeProvider();
+    if (name == "gateway") return new GatewayProvider();
+    return nullptr;
+}
+
+} // namespace
+
+FrwProviderChain& FrwProviderChain::Instance() {
+    static FrwProviderChain instance;
+    return instance;
+}
+
+FrwProviderChain::FrwProviderChain()
+    : resourceManager_(new CefResourceManager()), workers_(kMaxTierThreads) {
+    Configure(SettingsManager::Instance().GetSettings().frwProviders);
+}
+
+void FrwProviderChain::Configure(const std::vector<std::string>& tiers) {
+    std::vector<std::string> order = {"pinned"};
+    for (const auto& tier : tiers) {
+        if (std::find(order.begin(), order.end(), tier) == order.end()) order.push_back(tier);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!resourceManager_) return;
+
+    // Both calls are queued on the IO thread, so no request sees a half-built chain
+    resourceManager_->RemoveAllProviders();
+    int position = 0;
+    for (const auto& name : order) {
+        TierProvider* provider = CreateProvider(name);
+        if (provider) resourceManager_->AddProvider(provider, position++, name);
+    }
+}
+
+void FrwProviderChain::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (resourceManager_) {
+            resourceManager_->RemoveAllProviders();
+            resourceManager_ = nullptr;
+        }
+        for (auto& context : contexts_) {
+            context.second->cancel->Cancel();
+        }
+        contexts_.clear();
+    }
+    // Outside the lock, since the workers pin CIDs under it on their way out
+    workers_.Shutdown();
+}
+
+cef_return_value_t FrwProviderChain::OnBeforeResourceLoad(CefRefPtr<CefBrowser> browser,
+                                                          CefRefPtr<CefFrame> frame,
+                                                          CefRefPtr<CefRequest> request,
+                                                          CefRefPtr<CefCallback> callback) {
+    std::string url = request->GetURL().ToString();
+    std::regex frw_regex(R"(frw://([^/?#]+)([^#]*))");
+    std::smatch match;
+    if (!std::regex_match(url, match, frw_regex)) return RV_CONTINUE;
+
+    auto context = std::make_shared<RequestContext>();
+    context->url = url;
+    context->name = match[1].str();
+    context->path = match[2].str();
+    if (context->path.empty()) context->path = "/index.html";
+    context->browserId = browser ? browser->GetIdentifier() : 0;
+    cef_resource_type_t type = request->GetResourceType();
+    context->navigation = type == RT_MAIN_FRAME || type == RT_SUB_FRAME;
+    // What the renderer cannot paint without goes first
+    bool render_blocking = context->navigation || type == RT_STYLESHEET || type == RT_SCRIPT ||
+                           type == RT_FONT_RESOURCE;
+    context->trafficClass = render_blocking ? TrafficClass::RenderBlocking : TrafficClass::PageAsset;
+    context->cancel = std::make_shared<CancellationToken>();
+    context->created = Clock::now();
+    context->offline = OfflineMode::Instance().IsOffline();
+
+    CefRefPtr<CefResourceManager> manager;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!resourceManager_) return RV_CONTINUE;
+        manager = resourceManager_;
+        if (contexts_.size() >= kPruneThreshold) PruneContexts();
+        contexts_[request->GetIdentifier()] = context;
+    }
+    return manager->OnBeforeResourceLoad(browser, frame, request, callback);
+}
+
+CefRefPtr<CefResourceHandler> FrwProviderChain::GetResourceHandler(CefRefPtr<CefBrowser> browser,
+                                                                   CefRefPtr<CefFrame> frame,
+                                                                   CefRefPtr<CefRequest> request) {
+    std::shared_ptr<RequestContext> context;
+    CefRefPtr<CefResourceManager> manager;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = contexts_.find(request->GetIdentifier());
+        if (it != contexts_.end()) {
+            context = it->second;
+            contexts_.erase(it);
+        }
+        manager = resourceManager_;
+    }
+
+    // nullptr falls back to FrwSchemeHandlerFactory for a standalone fetch
+    if (!manager) return nullptr;
+    CefRefPtr<CefResourceHandler> handler = manager->GetResourceHandler(browser, frame, request);
+    if (handler || !context || context->cid.empty()) return handler;
+
+    // Every configured tier passed; going to the network anyway would
+    // defeat a chain configured without it
+    return FrwSchemeHandler::CreateUnavailable(context->url, context->name, context->cid,
+                                               context->offline || OfflineMode::Instance().IsOffline());
+}
+
+void FrwProviderChain::OnBrowserClosed(int browser_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = pins_.begin(); it != pins_.end();) {
+        if (it->first.first == browser_id) {
+            it = pins_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+FrwProviderChain::TierStats FrwProviderChain::GetStats(Tier tier) const {
+    const AtomicStats& stats = stats_[static_cast<int>(tier)];
+    TierStats snapshot;
+    snapshot.requests = stats.requests.load();
+    snapshot.hits = stats.hits.load();
+    snapshot.totalMicros = stats.totalMicros.load();
+    return snapshot;
+}
+
+std::string FrwProviderChain::Summary() const {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1) << "frw providers:";
+    for (int i = 0; i < static_cast<int>(Tier::Count); ++i) {
+        TierStats stats = GetStats(static_cast<Tier>(i));
+        if (stats.requests == 0) continue;
+        out << " " << TierName(static_cast<Tier>(i)) << " " << stats.hits << "/" << stats.requests << " hits ("
+            << 100.0 * stats.hits / stats.requests << "%, avg "
+            << stats.totalMicros / 1000.0 / stats.requests << " ms);";
+    }
+    return out.str();
+}
+
+const char* FrwProviderChain::TierName(Tier tier) {
+    switch (tier) {
+    case Tier::Pinned: return "pinned";
+    case Tier::Memory: return "memory";
+    case Tier::Disk: return "disk";
+    case Tier::Local: return "local";
+    case Tier::Gateway: return "gateway";
+    default: return "unknown";
+    }
+}
+
+std::shared_ptr<FrwProviderChain::RequestContext> FrwProviderChain::FindContext(uint64_t request_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = contexts_.find(request_id);
+    return it == contexts_.end() ? nullptr : it->second;
+}
+
+void FrwProviderChain::PruneContexts() {
+    auto cutoff = Clock::now() - kContextLifetime;
+    for (auto it = contexts_.begin(); it != contexts_.end();) {
+        if (it->second->created < cutoff) {
+            it->second->cancel->Cancel();
+            it = contexts_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void FrwProviderChain::Pin(int browser_id, const std::string& name, const std::string& cid) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pins_[{browser_id, name}] = cid;
+}
+
+bool FrwProviderChain::FindPin(int browser_id, const std::string& name, std::string& out_cid) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pins_.find({browser_id, name});
+    if (it == pins_.end()) return false;
+    out_cid = it->second;
+    return true;
+}
+
+void FrwProviderChain::Record(Tier tier, bool hit, std::chrono::steady_clock::time_point started) {
+    AtomicStats& stats = stats_[static_cast<int>(tier)];
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - started).count();
+    stats.requests++;
+    if (hit) stats.hits++;
+    stats.totalMicros += static_cast<uint64_t>(micros);
+}
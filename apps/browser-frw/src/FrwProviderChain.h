@@ -0,0 +1,105 @@
+#pragma once
+
+#include "wrapper/cef_resource_manager.h"
+#include "BandwidthScheduler.h"
+#include "WorkerPool.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+class CancellationToken;
+
+// Answers frw:// requests through CefResourceManager as an ordered chain of
+// provider tiers:
+//   pinned  - fixes the site CID: the one the page itself was loaded from, or
+//             a fresh resolve through the bootstrap nodes for navigations
+//   memory  - whole-site bundles held by SiteBundleManager
+//   disk    - the content store
+//   local   - the local IPFS node's blockstore (only with use_local_ipfs)
+//   gateway - FrwSchemeHandler fetching from the configured gateways
+// While OfflineMode reports no network, the pinned tier takes the CID from
+// the content store's name cache and the gateway tier steps aside.
+// A tier answers, passes the request on, or finishes asynchronously. The
+// order comes from the frw_providers setting and every tier is timed.
+class FrwProviderChain {
+public:
+    enum class Tier { Pinned, Memory, Disk, Local, Gateway, Count };
+
+    struct TierStats {
+        uint64_t requests = 0;
+        uint64_t hits = 0;
+        uint64_t totalMicros = 0; // Time from entering the tier to its answer
+    };
+
+    // Base of the tier providers; defined in FrwProviderChain.cpp
+    class TierProvider;
+
+    static FrwProviderChain& Instance();
+
+    // Rebuilds the chain with |tiers| (names as in the setting) in order.
+    // "pinned" is always first, since every later tier needs the CID.
+    void Configure(const std::vector<std::string>& tiers);
+    // Drops the providers and aborts the resolves and local node reads still
+    // running, waiting for them; call before CEF shuts down
+    void Shutdown();
+
+    // Forwarded by FrwClient for frw:// requests
+    cef_return_value_t OnBeforeResourceLoad(CefRefPtr<CefBrowser> browser,
+                                            CefRefPtr<CefFrame> frame,
+                                            CefRefPtr<CefRequest> request,
+                                            CefRefPtr<CefCallback> callback);
+    CefRefPtr<CefResourceHandler> GetResourceHandler(CefRefPtr<CefBrowser> browser,
+                                                     CefRefPtr<CefFrame> frame,
+                                                     CefRefPtr<CefRequest> request);
+    // Forgets the CIDs pinned by a closed browser
+    void OnBrowserClosed(int browser_id);
+
+    TierStats GetStats(Tier tier) const;
+    // One line of per-tier hit rates and average latency
+    std::string Summary() const;
+    static const char* TierName(Tier tier);
+
+private:
+    FrwProviderChain();
+
+    // What the tiers know about one request
+    struct RequestContext {
+        std::string url;
+        std::string name;
+        std::string path; // Includes the query, as FrwSchemeHandler keys it
+        std::string cid;  // Set by the pinned tier
+        int browserId = 0;
+        bool navigation = false;
+        TrafficClass trafficClass = TrafficClass::PageAsset; // From the resource type
+        bool offline = false;    // OfflineMode said so when the request started
+        bool cachedCopy = false; // The CID came from the name cache, not a resolve
+        std::shared_ptr<CancellationToken> cancel;
+        std::chrono::steady_clock::time_point created;
+    };
+
+    struct AtomicStats {
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> totalMicros{0};
+    };
+
+    mutable std::mutex mutex_;
+    CefRefPtr<CefResourceManager> resourceManager_;
+    std::unordered_map<uint64_t, std::shared_ptr<RequestContext>> contexts_; // CefRequest id -> context
+    std::map<std::pair<int, std::string>, std::string> pins_;                // (browser, name) -> CID
+    AtomicStats stats_[static_cast<int>(Tier::Count)];
+    WorkerPool workers_; // Tiers that finish asynchronously block on these
+
+    std::shared_ptr<RequestContext> FindContext(uint64_t request_id) const;
+    void PruneContexts();
+    void Pin(int browser_id, const std::string& name, const std::string& cid);
+    bool FindPin(int browser_id, const std::string& name, std::string& out_cid) const;
+    void Record(Tier tier, bool hit, std::chrono::steady_clock::time_point started);
+};
@@ -2,6 +2,18 @@
 #include "cef_parser.h"
 #include "wrapper/cef_stream_resource_handler.h"
 #include "UI/SettingsManager.h"
+#include "ContentStore.h"
+#include "MappedFile.h"
+#include "ContentStream.h"
+#include "SegmentedFetcher.h"
+#include "TrustlessFetcher.h"
+#include "SiteBundleManager.h"
+#include "PreloadScanner.h"
+#include "Prefetcher.h"
+#include "MimeTypes.h"
+#include "CancellationToken.h"
+#include "OfflineMode.h"
+#include "WorkerPool.h"
 
 #include <regex>
 #include <sstream>
@@ -9,19 +21,224 @@
 // TODO: Replace with real resolver bridge calls
 #include "ResolverBridge.h"
 
+namespace {
+
+// Loads block on the network for seconds at a time; past this many at
+// once, requests queue for a thread
+const size_t kMaxLoadThreads = 16;
+
+WorkerPool& LoadPool() {
+    static WorkerPool pool(kMaxLoadThreads);
+    return pool;
+}
+
+// A single "bytes=first-last", "bytes=first-" or "bytes=-suffix" range
+struct ByteRange {
+    int64_t first = -1;
+    int64_t last = -1;
+    int64_t suffix = -1;
+    bool overflow = false; // A position beyond int64_t; answered with 416
+};
+
+bool ParseRangeHeader(const std::string& header, ByteRange& out) {
+    // Multiple ranges are not supported; callers fall back to a full response
+    std::regex range_regex(R"(^\s*bytes\s*=\s*(\d*)\s*-\s*(\d*)\s*$)");
+    std::smatch match;
+    if (!std::regex_match(header, match, range_regex)) return false;
+
+    std::string first = match[1].str();
+    std::string last = match[2].str();
+    if (first.empty() && last.empty()) return false;
+
+    if (first.empty()) {
+        out.overflow = !ResolverBridge::ParseByteOffset(last, out.suffix);
+    } else {
+        out.overflow = !ResolverBridge::ParseByteOffset(first, out.first) ||
+                       (!last.empty() && !ResolverBridge::ParseByteOffset(last, out.last));
+        if (!out.overflow && out.last >= 0 && out.last < out.first) return false;
+    }
+    return true;
+}
+
+// Assets are keyed by CID and never change, but the name they are reached
+// through can be republished, so freshness is bounded. Documents revalidate
+// on every load, which costs a name lookup and a 304 instead of a fetch.
+const char kAssetCacheControl[] = "public, max-age=3600, immutable";
+const char kDocumentCacheControl[] = "no-cache";
+
+std::string MakeETag(const std::string& cid, const std::string& path) {
+    std::string etag = "\"" + cid;
+    for (char c : path) {
+        if (c == '"') {
+            etag += "%22";
+        } else {
+            etag.push_back(c);
+        }
+    }
+    return etag + "\"";
+}
+
+// If-None-Match holds "*" or a list of (possibly weak) entity tags
+bool MatchesETag(const std::string& header, const std::string& etag) {
+    std::stringstream ss(header);
+    std::string tag;
+    while (std::getline(ss, tag, ',')) {
+        size_t first = tag.find_first_not_of(" \t");
+        if (first == std::string::npos) continue;
+        tag = tag.substr(first, tag.find_last_not_of(" \t") - first + 1);
+        if (tag.compare(0, 2, "W/") == 0) tag = tag.substr(2);
+        if (tag == "*" || tag == etag) return true;
+    }
+    return false;
+}
+
+std::string NotFoundPage(const std::string& name, size_t nodes_checked, bool offline) {
+    std::ostringstream html;
+    html << "<!DOCTYPE html><html><head><title>FRW - Not Found</title></head><body>";
+    html << "<h1>FRW Site Not Found</h1>";
+    html << "<p>The site <strong>" << name << "</strong> could not be resolved.</p>";
+    if (offline) {
+        html << "<p>You are offline and this site has not been visited before.</p>";
+    } else {
+        html << "<p>Checked " << nodes_checked << " bootstrap nodes.</p>";
+    }
+    html << "</body></html>";
+    return html.str();
+}
+
+std::string UnavailablePage(const std::string& name, const std::string& cid, bool offline) {
+    std::ostringstream html;
+    html << "<!DOCTYPE html><html><head><title>FRW - Fetch Error</title></head><body>";
+    html << "<h1>FRW Content Unavailable</h1>";
+    if (offline) {
+        html << "<p>You are offline and this part of <strong>" << name << "</strong> is not cached.</p>";
+    } else {
+        html << "<p>Content for <strong>" << name << "</strong> could not be fetched.</p>";
+    }
+    html << "<p>CID: " << cid << "</p>";
+    html << "</body></html>";
+    return html.str();
+}
+
+std::string EscapeHtml(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        switch (c) {
+        case '<': out += "&lt;"; break;
+        case '>': out += "&gt;"; break;
+        case '&': out += "&amp;"; break;
+        case '"': out += "&quot;"; break;
+        default: out.push_back(c);
+        }
+    }
+    return out;
+}
+
+// Appended rather than prepended: markup before the doctype would switch the
+// page to quirks mode, while content after </html> still lands in the body
+std::string OfflineBanner(const std::string& name) {
+    return "\n<div id=\"frw-offline-banner\" style=\"position:fixed;left:0;right:0;bottom:0;"
+           "z-index:2147483647;padding:4px 8px;background:#fff3cd;color:#664d03;"
+           "border-top:1px solid #ffe69c;font:12px sans-serif\">"
+           "Offline: showing a cached copy of <strong>" + EscapeHtml(name) + "</strong></div>\n";
+}
+
+} // namespace
+
 FrwSchemeHandler::FrwSchemeHandler(const CefString& url)
-    : url_(url), offset_(0), handled_(false) {
+    : url_(url), offset_(0), rangeEnd_(0), status_(200), acceptRanges_(false), handled_(false),
+      partialBody_(false), cancel_(std::make_shared<CancellationToken>()), hasBody_(false), cachedCopy_(false),
+      trafficClass_(TrafficClass::PageAsset) {
+}
+
+FrwSchemeHandler::FrwSchemeHandler(const CefString& url, const std::string& site_name, const std::string& cid,
+                                   const std::string& path)
+    : FrwSchemeHandler(url) {
+    siteName_ = site_name;
+    siteCid_ = cid;
+    sitePath_ = path;
+}
+
+FrwSchemeHandler::~FrwSchemeHandler() = default;
+
+CefRefPtr<FrwSchemeHandler> FrwSchemeHandler::CreateNotFound(const CefString& url, const std::string& site_name,
+                                                             size_t nodes_checked, bool offline) {
+    CefRefPtr<FrwSchemeHandler> handler = new FrwSchemeHandler(url);
+    handler->SetErrorPage(NotFoundPage(site_name, nodes_checked, offline));
+    return handler;
+}
+
+CefRefPtr<FrwSchemeHandler> FrwSchemeHandler::CreateUnavailable(const CefString& url, const std::string& site_name,
+                                                                const std::string& cid, bool offline) {
+    CefRefPtr<FrwSchemeHandler> handler = new FrwSchemeHandler(url);
+    handler->SetErrorPage(UnavailablePage(site_name, cid, offline));
+    return handler;
+}
+
+void FrwSchemeHandler::SetCachedCopy(bool cached_copy) {
+    cachedCopy_ = cached_copy;
+}
+
+void FrwSchemeHandler::SetTrafficClass(TrafficClass traffic_class) {
+    trafficClass_ = traffic_class;
+}
+
+void FrwSchemeHandler::SetBody(std::string content) {
+    content_ = std::move(content);
+    mapping_.reset();
+    hasBody_ = true;
+}
+
+void FrwSchemeHandler::SetBody(std::shared_ptr<const MappedFile> mapping) {
+    mapping_ = std::move(mapping);
+    content_.clear();
+    hasBody_ = true;
+}
+
+void FrwSchemeHandler::SetLoadCallback(std::function<void(bool served)> on_loaded) {
+    onLoaded_ = std::move(on_loaded);
 }
 
 bool FrwSchemeHandler::ProcessRequest(CefRefPtr<CefRequest> request,
                                        CefRefPtr<CefCallback> callback) {
-    const std::string& url = request->GetURL();
+    std::string range_header = request->GetHeaderByName("Range").ToString();
+    std::string if_none_match = request->GetHeaderByName("If-None-Match").ToString();
+
+    // Error pages and bodies already in memory need no worker thread
+    if (handled_ || hasBody_) {
+        if (!handled_) Serve(range_header, if_none_match);
+        callback->Continue();
+        return true;
+    }
+
+    // Resolving and fetching can take seconds, so they run off the IO thread;
+    // Cancel() and Shutdown() abort them through cancel_
+    std::string url = request->GetURL();
+    CefRefPtr<FrwSchemeHandler> self(this);
+    return LoadPool().Post([self, callback, url, range_header, if_none_match]() {
+        self->Load(url, range_header, if_none_match);
+        if (self->cancel_->IsCancelled()) return;
+        if (self->onLoaded_) self->onLoaded_(!self->siteCid_.empty());
+        callback->Continue();
+    }, cancel_);
+}
+
+void FrwSchemeHandler::Shutdown() {
+    LoadPool().Shutdown();
+}
+
+void FrwSchemeHandler::Load(const std::string& url, const std::string& range_header,
+                            const std::string& if_none_match) {
+    if (!siteCid_.empty()) {
+        Serve(range_header, if_none_match);
+        return;
+    }
+
     std::regex frw_regex(R"(frw://([^/]+)(/.*)?)");
     std::cmatch match;
     if (!std::regex_match(url.c_str(), match, frw_regex)) {
         handled_ = false;
-        callback->Continue();
-        return true;
+        return;
     }
 
     std::string name = match[1].str();
@@ -32,56 +249,293 @@ bool FrwSchemeHandler::ProcessRequest(CefRefPtr<CefRequest> request,
     std::vector<std::string> bootstrap_nodes = SettingsManager::Instance().GetBootstrapNodes();
 
     std::string cid;
-    bool resolved = false;
-    
-    // Try each bootstrap node until we get a resolution
-    for (const auto& node : bootstrap_nodes) {
-        std::string resolve_url = node + "/api/resolve/" + name;
-        if (ResolverBridge::ResolveFromBootstrapNode(resolve_url, cid)) {
-            resolved = true;
-            break;
+    bool resolved = ResolverBridge::ResolveName(name, cid, cancel_);
+    if (cancel_->IsCancelled()) return;
+
+    // Offline (or just found to be): fall back to the last CID we saw
+    if (!resolved && OfflineMode::Instance().IsOffline()) {
+        resolved = ContentStore::Instance().LookupSiteRoot(name, cid);
+        cachedCopy_ = resolved;
+        if (!resolved) {
+            SetErrorPage(NotFoundPage(name, 0, true));
+            return;
         }
     }
-    
+
     if (!resolved) {
         // Return a simple error page
-        std::ostringstream html;
-        html << "<!DOCTYPE html><html><head><title>FRW - Not Found</title></head><body>";
-        html << "<h1>FRW Site Not Found</h1>";
-        html << "<p>The site <strong>" << name << "</strong> could not be resolved.</p>";
-        html << "<p>Checked " << bootstrap_nodes.size() << " bootstrap nodes.</p>";
-        html << "</body></html>";
-        content_ = html.str();
-        handled_ = true;
-        callback->Continue();
-        return true;
+        SetErrorPage(NotFoundPage(name, bootstrap_nodes.size(), false));
+        return;
+    }
+
+    ContentStore::Instance().RecordSiteRoot(name, cid);
+
+    // Fetch the rest of the site as one bundle in the background
+    SiteBundleManager::Instance().OnSiteResolved(name, cid);
+    siteName_ = name;
+    siteCid_ = cid;
+    sitePath_ = path;
+    Serve(range_header, if_none_match);
+}
+
+void FrwSchemeHandler::Serve(const std::string& range_header, const std::string& if_none_match) {
+    std::string cid = siteCid_;
+    std::string path = sitePath_;
+    handled_ = true;
+
+    // A copy found through the name cache may be stale and carries a banner,
+    // so it must not be validated against or stored in Chromium's cache
+    etag_ = cachedCopy_ ? std::string() : MakeETag(cid, path);
+
+    // Chromium already holds this exact object; skip the fetch entirely
+    if (!etag_.empty() && MatchesETag(if_none_match, etag_)) {
+        status_ = 304;
+        offset_ = rangeEnd_ = 0;
+        content_.clear();
+        mapping_.reset();
+        return;
+    }
+
+    if (hasBody_) {
+        AddOfflineBanner(range_header);
+        ApplyRange(range_header);
+        return;
     }
 
-    // Now fetch content via IPFS gateways from settings
+    // Content under a CID is immutable, so a local copy is always valid.
+    // A prefetch already running for this object is waited for, not repeated.
+    auto& store = ContentStore::Instance();
+    mapping_ = store.Map(cid, path);
+    if (!mapping_ && Prefetcher::Instance().Claim(cid, path, cancel_)) {
+        mapping_ = store.Map(cid, path);
+    }
+    if (mapping_) {
+        AddOfflineBanner(range_header);
+        ApplyRange(range_header);
+        return;
+    }
+
+    if (OfflineMode::Instance().IsOffline()) {
+        SetErrorPage(UnavailablePage(siteName_, cid, true));
+        return;
+    }
+
+    // Now fetch content via IPFS gateways from settings. Requests for the
+    // start of the object (or without a usable range) may turn into a parallel
+    // multi-gateway download; ranges elsewhere are forwarded as-is.
+    // In trustless mode every byte must be verified, so the whole file is
+    // always assembled and sliced locally.
+    ByteRange range;
+    bool from_start = SettingsManager::Instance().GetSettings().trustlessRetrieval ||
+                      !ParseRangeHeader(range_header, range) || range.overflow || range.first == 0;
+    bool fetched = from_start ? FetchWhole(cid, path, range_header)
+                              : FetchRange(cid, path, range_header);
+    if (cancel_->IsCancelled()) return;
+
+    if (!fetched) {
+        SetErrorPage(UnavailablePage(siteName_, cid, false));
+    }
+}
+
+void FrwSchemeHandler::AddOfflineBanner(const std::string& range_header) {
+    if (!cachedCopy_ || !range_header.empty()) return;
+    if (MimeTypes::Detect(sitePath_, ResponseData(), ContiguousSize()) != "text/html") return;
+
+    std::string document(ResponseSize(), '\0');
+    if (mapping_) {
+        mapping_->Read(0, &document[0], document.size());
+    } else {
+        document.assign(ResponseData(), ResponseSize());
+    }
+    document += OfflineBanner(siteName_);
+    content_ = std::move(document);
+    mapping_.reset();
+}
+
+bool FrwSchemeHandler::FetchWhole(const std::string& cid, const std::string& path,
+                                  const std::string& range_header) {
     std::vector<std::string> ipfs_gateways = SettingsManager::Instance().GetIPFSGateways();
+    const size_t threshold =
+        static_cast<size_t>(SettingsManager::Instance().GetSettings().parallelFetchThresholdMB) * 1024 * 1024;
+
+    if (SettingsManager::Instance().GetSettings().trustlessRetrieval) {
+        std::string verified;
+        TrustlessFetcher trustless(ipfs_gateways, cancel_, trafficClass_);
+        switch (trustless.Fetch(cid, path, verified)) {
+        case TrustlessResult::Ok:
+            content_ = std::move(verified);
+            ContentStore::Instance().Put(cid, path, content_);
+            ApplyRange(range_header);
+            return true;
+        case TrustlessResult::Failed:
+        case TrustlessResult::Unsupported:
+            // Never fall back to unverified bytes. That includes DAG shapes we
+            // cannot walk (e.g. sharded directories): gateway bytes would be
+            // cached as immutable under a CID they were never checked against.
+            return false;
+        }
+    }
+
+    // Text assets are fetched whole so the gateway can compress them; a range
+    // probe would force an uncompressed transfer
+    bool compressible = MimeTypes::IsCompressible(MimeTypes::FromPath(path));
 
-    bool fetched = false;
     for (const auto& gw : ipfs_gateways) {
-        std::string fetch_url = gw + "/ipfs/" + cid + path;
-        if (ResolverBridge::FetchFromGateway(fetch_url, content_)) {
-            fetched = true;
-            break;
+        if (cancel_->IsCancelled()) return false;
+
+        // Ask for the first |threshold| bytes only: small objects arrive whole,
+        // and for large ones the answer tells us the total size
+        HttpRequest fetch;
+        fetch.url = gw + "/ipfs/" + cid + path;
+        fetch.cancel = cancel_;
+        fetch.trafficClass = trafficClass_;
+        if (threshold > 0 && !compressible) {
+            fetch.headers.emplace_back("Range", "bytes=0-" + std::to_string(threshold - 1));
         }
+
+        HttpResponse response;
+        // A truncated body would be stored and served as immutable
+        if (!ResolverBridge::HttpGet(fetch, response) || !response.complete) continue;
+
+        int64_t first = 0, last = 0, total = 0;
+        if (response.status == 206) {
+            if (!ResolverBridge::ParseContentRange(response.headers["content-range"], first, last, total) ||
+                first != 0 || total < 0) {
+                continue;
+            }
+        } else if (response.status != 200 || response.body.empty()) {
+            continue;
+        }
+
+        if (response.status == 200 || total == static_cast<int64_t>(response.body.size())) {
+            content_ = std::move(response.body);
+            ContentStore::Instance().Put(cid, path, content_);
+            ApplyRange(range_header);
+            return true;
+        }
+
+        // Large object: stream it while the remaining ranges are fetched in
+        // parallel from every configured gateway
+        stream_ = std::make_shared<ContentStream>(static_cast<size_t>(total));
+        stream_->Write(0, response.body.data(), response.body.size());
+
+        std::vector<std::string> segment_gateways = ipfs_gateways;
+        auto fetcher = std::make_shared<SegmentedFetcher>(segment_gateways, "/ipfs/" + cid + path,
+                                                          stream_, response.body.size(), cancel_, trafficClass_);
+        auto stream = stream_;
+        fetcher->Start([stream, cid, path](bool success) {
+            if (success) ContentStore::Instance().Put(cid, path, stream->Buffer());
+        });
+
+        ApplyRange(range_header);
+        return true;
     }
+    return false;
+}
 
-    if (!fetched) {
-        std::ostringstream html;
-        html << "<!DOCTYPE html><html><head><title>FRW - Fetch Error</title></head><body>";
-        html << "<h1>FRW Content Unavailable</h1>";
-        html << "<p>Content for <strong>" << name << "</strong> could not be fetched.</p>";
-        html << "<p>CID: " << cid << "</p>";
-        html << "</body></html>";
-        content_ = html.str();
+bool FrwSchemeHandler::FetchRange(const std::string& cid, const std::string& path,
+                                  const std::string& range_header) {
+    std::vector<std::string> ipfs_gateways = SettingsManager::Instance().GetIPFSGateways();
+
+    for (const auto& gw : ipfs_gateways) {
+        if (cancel_->IsCancelled()) return false;
+
+        HttpRequest fetch;
+        fetch.url = gw + "/ipfs/" + cid + path;
+        fetch.cancel = cancel_;
+        fetch.trafficClass = trafficClass_;
+        fetch.headers.emplace_back("Range", range_header);
+
+        HttpResponse response;
+        // Even a 206 body may reach the store when the gateway ignores the range
+        if (!ResolverBridge::HttpGet(fetch, response) || !response.complete) continue;
+
+        if (response.status == 200 && !response.body.empty()) {
+            // Gateway ignored the range; cache the whole object and slice locally
+            content_ = std::move(response.body);
+            ContentStore::Instance().Put(cid, path, content_);
+            ApplyRange(range_header);
+            return true;
+        }
+
+        if (response.status == 206) {
+            int64_t first = 0, last = 0, total = 0;
+            if (!ResolverBridge::ParseContentRange(response.headers["content-range"], first, last, total)) {
+                continue;
+            }
+            content_ = std::move(response.body);
+            partialBody_ = true;
+            status_ = 206;
+            contentRange_ = response.headers["content-range"];
+            offset_ = 0;
+            rangeEnd_ = content_.size();
+            acceptRanges_ = true;
+            return true;
+        }
+
+        if (response.status == 416) {
+            status_ = 416;
+            contentRange_ = response.headers["content-range"];
+            offset_ = rangeEnd_ = 0;
+            acceptRanges_ = true;
+            return true;
+        }
     }
+    return false;
+}
 
+void FrwSchemeHandler::SetErrorPage(const std::string& html) {
+    partialBody_ = false;
+    siteCid_.clear();
+    etag_.clear();
+    mapping_.reset();
+    stream_.reset();
+    content_ = html;
+    offset_ = 0;
+    rangeEnd_ = content_.size();
+    status_ = 200;
+    acceptRanges_ = false;
     handled_ = true;
-    callback->Continue();
-    return true;
+}
+
+void FrwSchemeHandler::ApplyRange(const std::string& range_header) {
+    int64_t size = static_cast<int64_t>(ResponseSize());
+    offset_ = 0;
+    rangeEnd_ = static_cast<size_t>(size);
+    status_ = 200;
+    acceptRanges_ = true;
+
+    ByteRange range;
+    if (range_header.empty() || !ParseRangeHeader(range_header, range)) return;
+
+    if (range.overflow) {
+        status_ = 416;
+        contentRange_ = "bytes */" + std::to_string(size);
+        offset_ = rangeEnd_ = 0;
+        return;
+    }
+
+    int64_t first = 0;
+    int64_t last = size - 1;
+    if (range.suffix >= 0) {
+        first = std::max<int64_t>(0, size - range.suffix);
+        if (range.suffix == 0) first = size;
+    } else {
+        first = range.first;
+        if (range.last >= 0) last = std::min(range.last, size - 1);
+    }
+
+    if (first >= size) {
+        status_ = 416;
+        contentRange_ = "bytes */" + std::to_string(size);
+        offset_ = rangeEnd_ = 0;
+        return;
+    }
+
+    status_ = 206;
+    contentRange_ = "bytes " + std::to_string(first) + "-" + std::to_string(last) + "/" + std::to_string(size);
+    offset_ = static_cast<size_t>(first);
+    rangeEnd_ = static_cast<size_t>(last + 1);
 }
 
 void FrwSchemeHandler::GetResponseHeaders(CefRefPtr<CefResponse> response,
@@ -94,49 +548,122 @@ void FrwSchemeHandler::GetResponseHeaders(CefRefPtr<CefResponse> response,
         return;
     }
 
-    response_length = content_.size();
-    response->SetStatus(200);
-
-    // Simple MIME detection
-    std::string url_str = url_.ToString();
-    if (url_str.find(".html") != std::string::npos || content_.find("<!DOCTYPE") == 0) {
-        response->SetMimeType("text/html");
-    } else if (url_str.find(".css") != std::string::npos) {
-        response->SetMimeType("text/css");
-    } else if (url_str.find(".js") != std::string::npos) {
-        response->SetMimeType("application/javascript");
-    } else if (url_str.find(".json") != std::string::npos) {
-        response->SetMimeType("application/json");
-    } else if (url_str.find(".png") != std::string::npos) {
-        response->SetMimeType("image/png");
-    } else if (url_str.find(".jpg") != std::string::npos || url_str.find(".jpeg") != std::string::npos) {
-        response->SetMimeType("image/jpeg");
-    } else if (url_str.find(".gif") != std::string::npos) {
-        response->SetMimeType("image/gif");
-    } else if (url_str.find(".svg") != std::string::npos) {
-        response->SetMimeType("image/svg+xml");
+    response_length = static_cast<int64_t>(rangeEnd_ - offset_);
+    response->SetStatus(status_);
+    if (status_ == 206) {
+        response->SetStatusText("Partial Content");
+    } else if (status_ == 304) {
+        response->SetStatusText("Not Modified");
+    } else if (status_ == 416) {
+        response->SetStatusText("Range Not Satisfiable");
+    }
+    if (acceptRanges_) {
+        response->SetHeaderByName("Accept-Ranges", "bytes", true);
+    }
+    if (!contentRange_.empty()) {
+        response->SetHeaderByName("Content-Range", contentRange_, true);
+    }
+
+    // Error pages are always HTML; otherwise trust the extension and sniff
+    // the first bytes when there is none
+    std::string mime_type = "text/html";
+    if (!siteCid_.empty()) {
+        size_t sniff_size = 0;
+        if (!partialBody_) {
+            sniff_size = stream_ ? stream_->Available() : ContiguousSize();
+        }
+        mime_type = MimeTypes::Detect(sitePath_, ResponseData(), sniff_size);
+    }
+    response->SetMimeType(mime_type);
+    bool is_html = mime_type == "text/html";
+
+    if (cachedCopy_) {
+        response->SetHeaderByName("X-FRW-Offline", "cached", true);
+    }
+
+    // Let Chromium's caches reuse the response; error pages must not stick
+    if (etag_.empty()) {
+        response->SetHeaderByName("Cache-Control", "no-store", true);
     } else {
-        response->SetMimeType("text/plain");
+        response->SetHeaderByName("ETag", etag_, true);
+        // Directory URLs are documents even when a 304 carries no body to sniff
+        bool is_document = is_html || (!sitePath_.empty() && sitePath_.back() == '/');
+        response->SetHeaderByName("Cache-Control", is_document ? kDocumentCacheControl : kAssetCacheControl, true);
+    }
+
+    // A bundled site already has every asset in memory
+    if (is_html && status_ == 200 && !siteCid_.empty() && !SiteBundleManager::Instance().HasBundle(siteName_)) {
+        StartPreloadScan();
     }
 }
 
+void FrwSchemeHandler::StartPreloadScan() {
+    std::string name = siteName_;
+    std::string cid = siteCid_;
+    std::string base_path = sitePath_;
+    scanner_ = std::make_unique<PreloadScanner>(
+        [name, cid, base_path](const std::string& reference, PreloadScanner::Priority priority) {
+            std::string path;
+            if (!PreloadScanner::ResolvePath(name, base_path, reference, path)) return;
+            Prefetcher::Instance().Enqueue(cid, path, priority == PreloadScanner::Priority::RenderBlocking);
+        });
+}
+
 bool FrwSchemeHandler::ReadResponse(void* data_out,
                                      int bytes_to_read,
                                      int& bytes_read,
                                      CefRefPtr<CefCallback> callback) {
-    if (!handled_ || offset_ >= content_.size()) {
+    if (!handled_ || offset_ >= rangeEnd_) {
         bytes_read = 0;
         return false;
     }
 
-    int remaining = static_cast<int>(content_.size() - offset_);
-    bytes_read = std::min(bytes_to_read, remaining);
-    memcpy(data_out, content_.data() + offset_, bytes_read);
+    if (stream_) {
+        // Still downloading: wait until the bytes at offset_ have arrived
+        if (!stream_->WaitForData(offset_, [callback]() { callback->Continue(); })) {
+            bytes_read = 0;
+            return true;
+        }
+        size_t max_size = std::min(static_cast<size_t>(bytes_to_read), rangeEnd_ - offset_);
+        bytes_read = static_cast<int>(stream_->Read(offset_, static_cast<char*>(data_out), max_size));
+        offset_ += bytes_read;
+        if (scanner_) scanner_->Feed(static_cast<const char*>(data_out), bytes_read);
+        return bytes_read > 0; // A failed transfer ends the response early
+    }
+
+    // Copy straight from the mapping (or fetched buffer) into CEF's buffer;
+    // a multi-block object's mapping copies across its block boundaries
+    size_t remaining = rangeEnd_ - offset_;
+    bytes_read = static_cast<int>(std::min(static_cast<size_t>(bytes_to_read), remaining));
+    if (mapping_) {
+        mapping_->Read(offset_, data_out, bytes_read);
+    } else {
+        memcpy(data_out, content_.data() + offset_, bytes_read);
+    }
     offset_ += bytes_read;
+    if (scanner_) scanner_->Feed(static_cast<const char*>(data_out), bytes_read);
     return bytes_read > 0;
 }
 
+const char* FrwSchemeHandler::ResponseData() const {
+    if (stream_) return stream_->Data();
+    return mapping_ ? mapping_->Data() : content_.data();
+}
+
+size_t FrwSchemeHandler::ResponseSize() const {
+    if (stream_) return stream_->TotalSize();
+    return mapping_ ? mapping_->Size() : content_.size();
+}
+
+size_t FrwSchemeHandler::ContiguousSize() const {
+    if (stream_) return stream_->TotalSize();
+    return mapping_ ? mapping_->ContiguousSize() : content_.size();
+}
+
 void FrwSchemeHandler::Cancel() {
+    // Closes any open gateway or resolver connection; Load() then returns
+    // without completing the request
+    cancel_->Cancel();
 }
 
 CefRefPtr<CefResourceHandler> FrwSchemeHandlerFactory::Create(CefRefPtr<CefBrowser> browser,
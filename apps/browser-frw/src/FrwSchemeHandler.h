@@ -5,11 +5,46 @@
 #include "cef_request.h"
 #include "cef_scheme.h"
 #include "wrapper/cef_helpers.h"
+#include "BandwidthScheduler.h"
+
+#include <memory>
+#include <functional>
+
+class MappedFile;
+class ContentStream;
+class PreloadScanner;
+class CancellationToken;
 
 class FrwSchemeHandler : public CefResourceHandler {
 public:
     FrwSchemeHandler(const CefString& url);
-    ~FrwSchemeHandler() override = default;
+    // Serves |cid|/|path| of an already resolved site
+    FrwSchemeHandler(const CefString& url, const std::string& site_name, const std::string& cid,
+                     const std::string& path);
+    ~FrwSchemeHandler() override;
+
+    // Error pages for requests no provider could answer
+    static CefRefPtr<FrwSchemeHandler> CreateNotFound(const CefString& url, const std::string& site_name,
+                                                      size_t nodes_checked, bool offline);
+    static CefRefPtr<FrwSchemeHandler> CreateUnavailable(const CefString& url, const std::string& site_name,
+                                                         const std::string& cid, bool offline);
+
+    // The CID came from the name cache while offline: documents get a banner,
+    // responses an X-FRW-Offline header, and nothing is cached by Chromium
+    void SetCachedCopy(bool cached_copy);
+    // Priority of the gateway fetches; page assets unless set
+    void SetTrafficClass(TrafficClass traffic_class);
+
+    // Serve a body that is already in hand instead of fetching it
+    void SetBody(std::string content);
+    void SetBody(std::shared_ptr<const MappedFile> mapping);
+    // Runs on the load thread once the response is ready; |served| is false
+    // for error pages. Not called for cancelled requests.
+    void SetLoadCallback(std::function<void(bool served)> on_loaded);
+
+    // Aborts the loads still running and waits for them; requests made
+    // afterwards fail. Call before CEF shuts down.
+    static void Shutdown();
 
     // CefResourceHandler methods
     bool ProcessRequest(CefRefPtr<CefRequest> request,
@@ -26,8 +61,48 @@ public:
 private:
     CefString url_;
     std::string content_;
+    // Set when serving straight from the content store without copying
+    std::shared_ptr<const MappedFile> mapping_;
+    // Set while a large object is still arriving from several gateways
+    std::shared_ptr<ContentStream> stream_;
     size_t offset_;
+    size_t rangeEnd_;       // One past the last byte to send
+    int status_;
+    std::string contentRange_;
+    bool acceptRanges_;
     bool handled_;
+    bool partialBody_;      // content_ holds a gateway's 206 slice, not the object start
+    // Site the response belongs to; empty for error pages
+    std::string siteName_;
+    std::string siteCid_;
+    std::string sitePath_;
+    std::string etag_;
+    // Set for HTML documents so referenced assets are prefetched while it streams
+    std::unique_ptr<PreloadScanner> scanner_;
+    // Set by Cancel(); aborts the resolve and fetch running on the load thread
+    std::shared_ptr<CancellationToken> cancel_;
+    bool hasBody_;          // SetBody() was called
+    bool cachedCopy_;
+    TrafficClass trafficClass_;
+    std::function<void(bool served)> onLoaded_;
+
+    // Resolves and fetches the request on a worker thread
+    void Load(const std::string& url, const std::string& range_header, const std::string& if_none_match);
+    // Answers for the resolved site, from the preset body, the store or the gateways
+    void Serve(const std::string& range_header, const std::string& if_none_match);
+    void AddOfflineBanner(const std::string& range_header);
+
+    bool FetchWhole(const std::string& cid, const std::string& path, const std::string& range_header);
+    bool FetchRange(const std::string& cid, const std::string& path, const std::string& range_header);
+    void SetErrorPage(const std::string& html);
+    // Select the requested byte range of a fully available response body
+    void ApplyRange(const std::string& range_header);
+    void StartPreloadScan();
+    const char* ResponseData() const;
+    size_t ResponseSize() const;
+    // How much of ResponseData() is contiguous; less than ResponseSize()
+    // for objects mapped block by block
+    size_t ContiguousSize() const;
 
     IMPLEMENT_REFCOUNTING(FrwSchemeHandler);
     DISALLOW_COPY_AND_ASSIGN(FrwSchemeHandler);
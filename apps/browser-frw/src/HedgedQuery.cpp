@@ -0,0 +1,55 @@
+#include "HedgedQuery.h"
+#include "CancellationToken.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+HedgedQuery::Result HedgedQuery::Run(const std::vector<std::string>& targets, Query query,
+                                     const std::shared_ptr<CancellationToken>& cancel) {
+    // Shared with the query threads, which may outlive this call
+    struct State {
+        std::mutex mutex;
+        std::condition_variable changed;
+        size_t pending = 0;
+        Result result;
+    };
+    auto state = std::make_shared<State>();
+    state->pending = targets.size();
+
+    // The queries share one token: the first answer (or the caller
+    // cancelling) aborts the others instead of leaving them to finish
+    auto losers = std::make_shared<CancellationToken>();
+    int link = cancel ? cancel->Register([losers]() { losers->Cancel(); }) : 0;
+
+    for (const auto& target : targets) {
+        std::thread([state, losers, query, target]() {
+            std::string answer;
+            bool reachable = query(target, answer, losers);
+
+            bool won = false;
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->result.reachable = state->result.reachable || reachable;
+                if (!answer.empty() && !state->result.answered) {
+                    state->result.answered = true;
+                    state->result.answer = std::move(answer);
+                    won = true;
+                }
+                state->pending--;
+            }
+            if (won) losers->Cancel();
+            state->changed.notify_all();
+        }).detach();
+    }
+
+    Result result;
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->changed.wait(lock, [&state]() { return state->result.answered || state->pending == 0; });
+        result = state->result;
+    }
+
+    if (cancel) cancel->Unregister(link);
+    return result;
+}
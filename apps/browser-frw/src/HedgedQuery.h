@@ -0,0 +1,30 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CancellationToken;
+
+// Sends the same query to several targets at once and keeps the first
+// answer. As soon as one arrives the other queries are cancelled and the
+// caller returns; they unwind on their own threads instead of holding it up.
+class HedgedQuery {
+public:
+    // Leaves |out_answer| empty when the target knows no answer; returns
+    // false when it could not be reached at all
+    using Query = std::function<bool(const std::string& target, std::string& out_answer,
+                                     const std::shared_ptr<CancellationToken>& cancel)>;
+
+    struct Result {
+        bool answered = false;
+        bool reachable = false; // Some target replied, with or without an answer
+        std::string answer;
+    };
+
+    // Returns once a target answered, every query finished, or |cancel| was
+    // cancelled and the queries stopped
+    static Result Run(const std::vector<std::string>& targets, Query query,
+                      const std::shared_ptr<CancellationToken>& cancel = nullptr);
+};
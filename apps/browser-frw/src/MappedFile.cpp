@@ -0,0 +1,139 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include "Utils.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+bool MappedFile::Open(const std::string& path) {
+    Close();
+
+#ifdef _WIN32
+    std::wstring wpath = Utils::StringToWString(path);
+    file_ = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_, &file_size)) {
+        Close();
+        return false;
+    }
+    size_ = static_cast<size_t>(file_size.QuadPart);
+    opened_ = true;
+
+    // Empty files cannot be mapped, but are still valid
+    if (size_ == 0) return true;
+
+    mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_) {
+        Close();
+        return false;
+    }
+
+    data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (!data_) {
+        Close();
+        return false;
+    }
+#else
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) return false;
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        Close();
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    opened_ = true;
+
+    if (size_ == 0) return true;
+
+    void* addr = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (addr == MAP_FAILED) {
+        Close();
+        return false;
+    }
+    data_ = static_cast<const char*>(addr);
+#endif
+
+    return true;
+}
+
+bool MappedFile::OpenConcatenated(const std::vector<std::string>& paths) {
+    if (paths.size() == 1) return Open(paths[0]);
+    Close();
+
+    for (const auto& path : paths) {
+        auto part = std::make_unique<MappedFile>();
+        if (!part->Open(path)) {
+            Close();
+            return false;
+        }
+        partOffsets_.push_back(size_);
+        size_ += part->Size();
+        parts_.push_back(std::move(part));
+    }
+
+    data_ = parts_.empty() ? nullptr : parts_[0]->Data();
+    opened_ = true;
+    return true;
+}
+
+size_t MappedFile::Read(size_t offset, void* out, size_t size) const {
+    if (offset >= size_) return 0;
+    size = std::min(size, size_ - offset);
+    if (parts_.empty()) {
+        std::memcpy(out, data_ + offset, size);
+        return size;
+    }
+
+    // Find the part holding |offset|, then copy part by part
+    size_t index = std::upper_bound(partOffsets_.begin(), partOffsets_.end(), offset) - partOffsets_.begin() - 1;
+    char* dest = static_cast<char*>(out);
+    size_t copied = 0;
+    while (copied < size && index < parts_.size()) {
+        size_t within = offset + copied - partOffsets_[index];
+        size_t count = std::min(size - copied, parts_[index]->Size() - within);
+        std::memcpy(dest + copied, parts_[index]->Data() + within, count);
+        copied += count;
+        index++;
+    }
+    return copied;
+}
+
+void MappedFile::Close() {
+    if (!parts_.empty()) {
+        // The parts own the mappings; data_ points into the first
+        parts_.clear();
+        partOffsets_.clear();
+        data_ = nullptr;
+    }
+
+#ifdef _WIN32
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(mapping_);
+    if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+    mapping_ = nullptr;
+    file_ = INVALID_HANDLE_VALUE;
+#else
+    if (data_) munmap(const_cast<char*>(data_), size_);
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    opened_ = false;
+}
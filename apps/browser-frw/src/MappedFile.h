@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Read-only memory mapping of a whole file, or of several files end to end
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& path);
+    // Maps each file on its own and presents them end to end. Separate
+    // mappings cannot be made contiguous portably, so with several files
+    // Data() covers only the first one; Read() copies across all of them.
+    bool OpenConcatenated(const std::vector<std::string>& paths);
+    void Close();
+
+    bool IsOpen() const { return opened_; }
+    const char* Data() const { return data_; }
+    size_t Size() const { return size_; }
+    // Bytes readable straight from Data()
+    size_t ContiguousSize() const { return parts_.empty() ? size_ : parts_[0]->Size(); }
+    // Copies up to |size| bytes from |offset|; returns how many were copied
+    size_t Read(size_t offset, void* out, size_t size) const;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool opened_ = false;
+    // Set by OpenConcatenated for several files, with each part's offset
+    std::vector<std::unique_ptr<MappedFile>> parts_;
+    std::vector<size_t> partOffsets_;
+
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
@@ -0,0 +1,226 @@
+#include "MimeTypes.h"
+
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+struct MimeEntry {
+    std::string_view extension;
+    const char* mimeType;
+};
+
+constexpr MimeEntry kMimeTable[] = {
+    {"html", "text/html"},
+    {"htm", "text/html"},
+    {"xhtml", "application/xhtml+xml"},
+    {"css", "text/css"},
+    {"js", "text/javascript"},
+    {"mjs", "text/javascript"},
+    {"cjs", "text/javascript"},
+    {"json", "application/json"},
+    {"map", "application/json"},
+    {"jsonld", "application/ld+json"},
+    {"webmanifest", "application/manifest+json"},
+    {"wasm", "application/wasm"},
+    {"svg", "image/svg+xml"},
+    {"png", "image/png"},
+    {"apng", "image/apng"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"webp", "image/webp"},
+    {"avif", "image/avif"},
+    {"ico", "image/x-icon"},
+    {"bmp", "image/bmp"},
+    {"tif", "image/tiff"},
+    {"tiff", "image/tiff"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"ttf", "font/ttf"},
+    {"otf", "font/otf"},
+    {"eot", "application/vnd.ms-fontobject"},
+    {"mp4", "video/mp4"},
+    {"m4v", "video/mp4"},
+    {"webm", "video/webm"},
+    {"ogv", "video/ogg"},
+    {"ogg", "audio/ogg"},
+    {"oga", "audio/ogg"},
+    {"opus", "audio/ogg"},
+    {"mp3", "audio/mpeg"},
+    {"wav", "audio/wav"},
+    {"flac", "audio/flac"},
+    {"m4a", "audio/mp4"},
+    {"aac", "audio/aac"},
+    {"mpd", "application/dash+xml"},
+    {"m3u8", "application/vnd.apple.mpegurl"},
+    {"vtt", "text/vtt"},
+    {"txt", "text/plain"},
+    {"md", "text/markdown"},
+    {"csv", "text/csv"},
+    {"xml", "application/xml"},
+    {"pdf", "application/pdf"},
+    {"zip", "application/zip"},
+    {"gz", "application/gzip"},
+    {"car", "application/vnd.ipld.car"},
+};
+
+constexpr size_t kEntryCount = sizeof(kMimeTable) / sizeof(kMimeTable[0]);
+
+// FNV-1a with a seed chosen so that every extension above lands in its own
+// bucket. Adding an entry may need a new seed; the static_assert says so.
+constexpr size_t kBucketCount = 127;
+constexpr uint32_t kHashSeed = 156352;
+constexpr size_t kMaxExtensionLength = 16;
+
+constexpr uint32_t HashExtension(std::string_view extension) {
+    uint32_t hash = 2166136261u ^ kHashSeed;
+    for (char c : extension) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+struct BucketTable {
+    int8_t entry[kBucketCount];
+    bool perfect;
+};
+
+constexpr BucketTable BuildBuckets() {
+    BucketTable table{};
+    for (size_t i = 0; i < kBucketCount; ++i) table.entry[i] = -1;
+    table.perfect = true;
+    for (size_t i = 0; i < kEntryCount; ++i) {
+        size_t bucket = HashExtension(kMimeTable[i].extension) % kBucketCount;
+        if (table.entry[bucket] != -1) table.perfect = false;
+        table.entry[bucket] = static_cast<int8_t>(i);
+    }
+    return table;
+}
+
+constexpr BucketTable kBuckets = BuildBuckets();
+static_assert(kBuckets.perfect, "MIME extension table has a collision; choose another kHashSeed");
+
+// Leading bytes to look at, as in the WHATWG sniffing algorithm
+const size_t kSniffLength = 512;
+
+bool HasPrefix(const char* data, size_t size, const char* magic, size_t magic_size, size_t offset = 0) {
+    return size >= offset + magic_size && memcmp(data + offset, magic, magic_size) == 0;
+}
+
+bool HasPrefixIgnoreCase(const char* data, size_t size, const char* prefix) {
+    size_t length = strlen(prefix);
+    if (size < length) return false;
+    for (size_t i = 0; i < length; ++i) {
+        char c = data[i];
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        if (c != prefix[i]) return false;
+    }
+    return true;
+}
+
+bool LooksLikeHtml(const char* data, size_t size) {
+    static const char* const kTags[] = {"<!doctype html", "<html", "<head", "<body", "<script", "<style",
+                                        "<title", "<div", "<p", "<!--"};
+    for (const char* tag : kTags) {
+        size_t length = strlen(tag);
+        if (!HasPrefixIgnoreCase(data, size, tag)) continue;
+        // The tag name must end here, e.g. "<p>" but not "<pre"
+        if (size == length || data[length] == '>' || data[length] == ' ' || data[length] == '\t' ||
+            data[length] == '\n' || data[length] == '\r' || tag[1] == '!') {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool LooksBinary(const char* data, size_t size) {
+    for (size_t i = 0; i < size && i < kSniffLength; ++i) {
+        unsigned char c = static_cast<unsigned char>(data[i]);
+        if (c <= 0x08 || c == 0x0B || (c >= 0x0E && c <= 0x1A) || (c >= 0x1C && c <= 0x1F)) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+namespace MimeTypes {
+
+std::string FromPath(const std::string& path) {
+    size_t end = path.find_first_of("?#");
+    if (end == std::string::npos) end = path.size();
+    size_t slash = path.rfind('/', end == 0 ? 0 : end - 1);
+    size_t dot = path.rfind('.', end == 0 ? 0 : end - 1);
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return "";
+
+    size_t length = end - dot - 1;
+    if (length == 0 || length > kMaxExtensionLength) return "";
+
+    char extension[kMaxExtensionLength];
+    for (size_t i = 0; i < length; ++i) {
+        char c = path[dot + 1 + i];
+        extension[i] = (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    std::string_view key(extension, length);
+    int8_t entry = kBuckets.entry[HashExtension(key) % kBucketCount];
+    if (entry < 0 || kMimeTable[entry].extension != key) return "";
+    return kMimeTable[entry].mimeType;
+}
+
+std::string Sniff(const char* data, size_t size) {
+    if (!data || size == 0) return "";
+
+    // Binary signatures
+    if (HasPrefix(data, size, "\0asm", 4)) return "application/wasm";
+    if (HasPrefix(data, size, "\x89PNG\r\n\x1a\n", 8)) return "image/png";
+    if (HasPrefix(data, size, "\xFF\xD8\xFF", 3)) return "image/jpeg";
+    if (HasPrefix(data, size, "GIF87a", 6) || HasPrefix(data, size, "GIF89a", 6)) return "image/gif";
+    if (HasPrefix(data, size, "RIFF", 4) && HasPrefix(data, size, "WEBP", 4, 8)) return "image/webp";
+    if (HasPrefix(data, size, "RIFF", 4) && HasPrefix(data, size, "WAVE", 4, 8)) return "audio/wav";
+    if (HasPrefix(data, size, "ftypavif", 8, 4)) return "image/avif";
+    if (HasPrefix(data, size, "ftyp", 4, 4)) return "video/mp4";
+    if (HasPrefix(data, size, "\x1A\x45\xDF\xA3", 4)) return "video/webm";
+    if (HasPrefix(data, size, "OggS", 4)) return "audio/ogg";
+    if (HasPrefix(data, size, "ID3", 3)) return "audio/mpeg";
+    if (HasPrefix(data, size, "fLaC", 4)) return "audio/flac";
+    if (HasPrefix(data, size, "\0\0\1\0", 4)) return "image/x-icon";
+    if (HasPrefix(data, size, "wOFF", 4)) return "font/woff";
+    if (HasPrefix(data, size, "wOF2", 4)) return "font/woff2";
+    if (HasPrefix(data, size, "\0\1\0\0\0", 5)) return "font/ttf";
+    if (HasPrefix(data, size, "OTTO", 4)) return "font/otf";
+    if (HasPrefix(data, size, "%PDF-", 5)) return "application/pdf";
+
+    // Markup, after an optional UTF-8 BOM and leading whitespace
+    size_t pos = HasPrefix(data, size, "\xEF\xBB\xBF", 3) ? 3 : 0;
+    while (pos < size && (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\n' || data[pos] == '\r')) ++pos;
+    const char* text = data + pos;
+    size_t text_size = size - pos;
+    if (LooksLikeHtml(text, text_size)) return "text/html";
+    if (HasPrefixIgnoreCase(text, text_size, "<svg")) return "image/svg+xml";
+    if (HasPrefix(text, text_size, "<?xml", 5)) return "application/xml";
+    return "";
+}
+
+bool IsCompressible(const std::string& mime_type) {
+    if (mime_type.compare(0, 5, "text/") == 0) return true;
+    return mime_type == "application/json" || mime_type == "application/ld+json" ||
+           mime_type == "application/manifest+json" || mime_type == "application/xml" ||
+           mime_type == "application/xhtml+xml" || mime_type == "application/wasm" ||
+           mime_type == "application/dash+xml" || mime_type == "application/vnd.apple.mpegurl" ||
+           mime_type == "image/svg+xml";
+}
+
+std::string Detect(const std::string& path, const char* data, size_t size) {
+    std::string mime_type = FromPath(path);
+    if (!mime_type.empty()) return mime_type;
+
+    mime_type = Sniff(data, size);
+    if (!mime_type.empty()) return mime_type;
+
+    return LooksBinary(data, size) ? "application/octet-stream" : "text/plain";
+}
+
+} // namespace MimeTypes
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace MimeTypes {
+    // MIME type for the extension of |path| (query and fragment ignored), or
+    // an empty string when the extension is unknown
+    std::string FromPath(const std::string& path);
+
+    // MIME type recognised from the leading bytes of a body, or empty
+    std::string Sniff(const char* data, size_t size);
+
+    // Text-like types that gateways can usefully compress in transit
+    bool IsCompressible(const std::string& mime_type);
+
+    // Extension first, then magic bytes; falls back to text/plain for text
+    // and application/octet-stream for anything else
+    std::string Detect(const std::string& path, const char* data, size_t size);
+}
@@ -0,0 +1,83 @@
+#include "OfflineMode.h"
+#include "ResolverBridge.h"
+#include "UI/SettingsManager.h"
+
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const std::chrono::seconds kProbeInterval(30);
+const int kProbeTimeoutMs = 5000;
+
+} // namespace
+
+OfflineMode& OfflineMode::Instance() {
+    static OfflineMode instance;
+    return instance;
+}
+
+bool OfflineMode::IsOffline() const {
+    return IsForced() || detected_.load();
+}
+
+bool OfflineMode::IsForced() const {
+    return SettingsManager::Instance().GetSettings().offlineMode;
+}
+
+void OfflineMode::ReportBootstrapReachable(bool reachable) {
+    if (reachable) {
+        detected_ = false;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    detected_ = true;
+    if (probing_ || shutdown_) return;
+    probing_ = true;
+    std::thread([this]() { RunProbe(); }).detach();
+}
+
+void OfflineMode::Shutdown() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+    wake_.notify_all();
+}
+
+void OfflineMode::RunProbe() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (detected_ && !shutdown_) {
+        wake_.wait_for(lock, kProbeInterval, [this]() { return shutdown_; });
+        if (shutdown_) break;
+
+        lock.unlock();
+        bool reachable = ProbeBootstrapNodes();
+        lock.lock();
+        if (reachable) detected_ = false;
+    }
+    probing_ = false;
+}
+
+bool OfflineMode::ProbeBootstrapNodes() {
+    // Any HTTP answer at all means the network is back
+    std::vector<std::future<bool>> probes;
+    for (const auto& node : SettingsManager::Instance().GetBootstrapNodes()) {
+        probes.push_back(std::async(std::launch::async, [node]() {
+            HttpRequest request;
+            request.url = node + "/";
+            request.timeoutMs = kProbeTimeoutMs;
+            request.trafficClass = TrafficClass::RenderBlocking;
+            request.onResponse = [](const HttpResponse&) { return false; }; // Headers are enough
+            HttpResponse response;
+            return ResolverBridge::HttpGet(request, response);
+        }));
+    }
+
+    bool reachable = false;
+    for (auto& probe : probes) {
+        reachable = probe.get() || reachable;
+    }
+    return reachable;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+// Decides whether frw content may come from the network. Offline is either
+// forced by the offline_mode setting or detected when no bootstrap node can
+// be reached at all. While detected, a background probe checks the nodes
+// periodically, so requests answer from the local caches straight away
+// instead of waiting on connection timeouts.
+class OfflineMode {
+public:
+    static OfflineMode& Instance();
+
+    bool IsOffline() const;
+    bool IsForced() const;
+
+    // Called after querying the bootstrap nodes; false when none of them
+    // could be reached
+    void ReportBootstrapReachable(bool reachable);
+
+    // Stops the probe; call before shutdown
+    void Shutdown();
+
+private:
+    OfflineMode() = default;
+
+    std::atomic<bool> detected_{false};
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool probing_ = false;
+    bool shutdown_ = false;
+
+    void RunProbe();
+    static bool ProbeBootstrapNodes();
+};
@@ -0,0 +1,136 @@
+#include "PositionalFile.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include "Utils.h"
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+PositionalFile::~PositionalFile() {
+    Close();
+}
+
+bool PositionalFile::Open(const std::string& path) {
+    Close();
+#ifdef _WIN32
+    std::wstring wpath = Utils::StringToWString(path);
+    file_ = CreateFileW(wpath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                        nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    return file_ != INVALID_HANDLE_VALUE;
+#else
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    return fd_ >= 0;
+#endif
+}
+
+void PositionalFile::Close() {
+#ifdef _WIN32
+    if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+    file_ = INVALID_HANDLE_VALUE;
+#else
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+#endif
+}
+
+bool PositionalFile::IsOpen() const {
+#ifdef _WIN32
+    return file_ != INVALID_HANDLE_VALUE;
+#else
+    return fd_ >= 0;
+#endif
+}
+
+bool PositionalFile::Preallocate(uint64_t size) {
+    if (!IsOpen()) return false;
+#ifdef _WIN32
+    FILE_END_OF_FILE_INFO info = {};
+    info.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+    return SetFileInformationByHandle(file_, FileEndOfFileInfo, &info, sizeof(info)) != 0;
+#else
+    int result = 0;
+    do {
+        result = ftruncate(fd_, static_cast<off_t>(size));
+    } while (result != 0 && errno == EINTR);
+    if (result != 0) return false;
+#ifndef __APPLE__
+    // ftruncate alone leaves a sparse file, which can still run out of space
+    // part way; claim the blocks too where the file system allows it
+    do {
+        result = posix_fallocate(fd_, 0, static_cast<off_t>(size));
+    } while (result == EINTR);
+    if (result != 0 && result != EINVAL && result != EOPNOTSUPP) return false;
+#endif
+    return true;
+#endif
+}
+
+uint64_t PositionalFile::Size() const {
+    if (!IsOpen()) return 0;
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    return GetFileSizeEx(file_, &size) ? static_cast<uint64_t>(size.QuadPart) : 0;
+#else
+    struct stat st;
+    return fstat(fd_, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+#endif
+}
+
+bool PositionalFile::WriteAt(uint64_t offset, const char* data, size_t size) {
+    if (!IsOpen()) return false;
+    while (size > 0) {
+#ifdef _WIN32
+        // A synchronous handle still honours the offset in OVERLAPPED
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, 1u << 30));
+        DWORD written = 0;
+        if (!WriteFile(file_, data, chunk, &written, &overlapped) || written == 0) return false;
+#else
+        ssize_t written = pwrite(fd_, data, size, static_cast<off_t>(offset));
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+#endif
+        offset += static_cast<uint64_t>(written);
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool PositionalFile::ReadAt(uint64_t offset, char* out, size_t size) const {
+    if (!IsOpen()) return false;
+    while (size > 0) {
+#ifdef _WIN32
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, 1u << 30));
+        DWORD read = 0;
+        if (!ReadFile(file_, out, chunk, &read, &overlapped) || read == 0) return false;
+#else
+        ssize_t read = pread(fd_, out, size, static_cast<off_t>(offset));
+        if (read < 0 && errno == EINTR) continue;
+        if (read <= 0) return false;
+#endif
+        offset += static_cast<uint64_t>(read);
+        out += read;
+        size -= static_cast<size_t>(read);
+    }
+    return true;
+}
+
+bool PositionalFile::Flush() {
+    if (!IsOpen()) return false;
+#ifdef _WIN32
+    return FlushFileBuffers(file_) != 0;
+#else
+    return fsync(fd_) == 0;
+#endif
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Writable file for several writers at once: every write names its offset,
+// so threads filling different ranges never share a file position
+class PositionalFile {
+public:
+    PositionalFile() = default;
+    ~PositionalFile();
+
+    PositionalFile(const PositionalFile&) = delete;
+    PositionalFile& operator=(const PositionalFile&) = delete;
+
+    // Opens or creates |path| without truncating it
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const;
+
+    // Sets the length up front and, where the file system can, allocates
+    // the blocks, so running out of disk space shows here rather than part
+    // way through a download, and later writes never extend the file
+    bool Preallocate(uint64_t size);
+    uint64_t Size() const;
+
+    // Safe to call from several threads for disjoint ranges
+    bool WriteAt(uint64_t offset, const char* data, size_t size);
+    bool ReadAt(uint64_t offset, char* out, size_t size) const;
+    // Pushes written bytes to the disk
+    bool Flush();
+
+private:
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+#else
+    int fd_ = -1;
+#endif
+};
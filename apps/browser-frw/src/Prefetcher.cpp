@@ -0,0 +1,156 @@
+#include "Prefetcher.h"
+#include "ContentStore.h"
+#include "ResolverBridge.h"
+#include "TrustlessFetcher.h"
+#include "CancellationToken.h"
+#include "OfflineMode.h"
+#include "UI/SettingsManager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+const size_t kMaxSeen = 4096;
+// Upper bound on how long an on-demand request waits for a running prefetch
+const std::chrono::seconds kClaimTimeout(30);
+
+} // namespace
+
+Prefetcher& Prefetcher::Instance() {
+    static Prefetcher instance;
+    return instance;
+}
+
+std::string Prefetcher::MakeKey(const std::string& cid, const std::string& path) {
+    return cid + path;
+}
+
+void Prefetcher::Enqueue(const std::string& cid, const std::string& path, bool render_blocking) {
+    int max_workers = SettingsManager::Instance().GetSettings().preloadMaxConcurrent;
+    if (max_workers <= 0) return;
+    if (OfflineMode::Instance().IsOffline()) return;
+    if (ContentStore::Instance().Contains(cid, path)) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string key = MakeKey(cid, path);
+    if (seen_.count(key)) return; // Already queued, running or tried
+    if (seen_.size() > kMaxSeen) seen_.clear();
+    seen_.insert(key);
+
+    queued_.insert(key);
+    (render_blocking ? renderBlocking_ : normal_).push_back(Job{cid, path, render_blocking});
+
+    if (workers_ < max_workers) {
+        workers_++;
+        std::thread([this]() { RunWorker(); }).detach();
+    }
+}
+
+bool Prefetcher::Claim(const std::string& cid, const std::string& path,
+                       const std::shared_ptr<CancellationToken>& cancel) {
+    std::string key = MakeKey(cid, path);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queued_.erase(key)) {
+            // Not started yet: the caller fetches it now instead
+            for (auto* queue : {&renderBlocking_, &normal_}) {
+                queue->erase(std::remove_if(queue->begin(), queue->end(),
+                                            [&](const Job& job) { return MakeKey(job.cid, job.path) == key; }),
+                             queue->end());
+            }
+            return false;
+        }
+        if (!inFlight_.count(key)) return false;
+    }
+
+    // Registered outside mutex_, since Cancel() holds the token's lock while
+    // the callback takes ours
+    int link = 0;
+    if (cancel) {
+        link = cancel->Register([this]() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobFinished_.notify_all();
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        jobFinished_.wait_for(lock, kClaimTimeout, [&]() {
+            return !inFlight_.count(key) || (cancel && cancel->IsCancelled());
+        });
+    }
+    if (cancel) cancel->Unregister(link);
+    return true;
+}
+
+bool Prefetcher::NextJob(Job& out_job) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::deque<Job>* queue = !renderBlocking_.empty() ? &renderBlocking_ : &normal_;
+    if (queue->empty()) {
+        workers_--;
+        return false;
+    }
+
+    out_job = queue->front();
+    queue->pop_front();
+    std::string key = MakeKey(out_job.cid, out_job.path);
+    queued_.erase(key);
+    inFlight_.insert(key);
+    return true;
+}
+
+void Prefetcher::RunWorker() {
+    Job job;
+    while (NextJob(job)) {
+        FetchJob(job);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            inFlight_.erase(MakeKey(job.cid, job.path));
+        }
+        jobFinished_.notify_all();
+    }
+}
+
+bool Prefetcher::FetchJob(const Job& job) {
+    const Settings& settings = SettingsManager::Instance().GetSettings();
+    std::vector<std::string> ipfs_gateways = SettingsManager::Instance().GetIPFSGateways();
+    std::string content;
+    // A stylesheet or script found early is still one the page will wait on
+    TrafficClass traffic_class = job.renderBlocking ? TrafficClass::RenderBlocking : TrafficClass::Prefetch;
+
+    if (settings.trustlessRetrieval) {
+        TrustlessFetcher fetcher(ipfs_gateways, nullptr, traffic_class);
+        if (fetcher.Fetch(job.cid, job.path, content) != TrustlessResult::Ok) return false;
+        return ContentStore::Instance().Put(job.cid, job.path, content);
+    }
+
+    // Large objects are left to the handler, which can stream them
+    const size_t limit = static_cast<size_t>(settings.parallelFetchThresholdMB) * 1024 * 1024;
+
+    for (const auto& gw : ipfs_gateways) {
+        bool too_large = false;
+        content.clear();
+
+        HttpRequest fetch;
+        fetch.url = gw + "/ipfs/" + job.cid + job.path;
+        fetch.trafficClass = traffic_class;
+        fetch.onResponse = [](const HttpResponse& response) { return response.status == 200; };
+        fetch.onData = [&](const char* data, size_t size) {
+            if (limit > 0 && content.size() + size > limit) {
+                too_large = true;
+                return false;
+            }
+            content.append(data, size);
+            return true;
+        };
+
+        HttpResponse response;
+        bool ok = ResolverBridge::HttpGet(fetch, response);
+        if (too_large) return false;
+        if (ok && response.complete && response.status == 200 && !content.empty()) {
+            return ContentStore::Instance().Put(job.cid, job.path, content);
+        }
+    }
+    return false;
+}
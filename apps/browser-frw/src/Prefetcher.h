@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <deque>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+
+class CancellationToken;
+
+// Fetches frw subresources into the content store ahead of the renderer.
+// Render-blocking resources are served first and at most a fixed number of
+// transfers run at once. A request for an object whose prefetch is already
+// running waits for it instead of fetching the object a second time.
+class Prefetcher {
+public:
+    static Prefetcher& Instance();
+
+    void Enqueue(const std::string& cid, const std::string& path, bool render_blocking);
+
+    // Called before fetching |cid|/|path| on demand. Drops a queued prefetch
+    // and returns false; if one is in flight, waits for it (or for |cancel|)
+    // and returns true.
+    bool Claim(const std::string& cid, const std::string& path,
+               const std::shared_ptr<CancellationToken>& cancel = nullptr);
+
+private:
+    Prefetcher() = default;
+
+    struct Job {
+        std::string cid;
+        std::string path;
+        bool renderBlocking = false;
+    };
+
+    std::mutex mutex_;
+    std::condition_variable jobFinished_;
+    std::deque<Job> renderBlocking_;
+    std::deque<Job> normal_;
+    std::set<std::string> queued_;   // Keys of jobs in either queue
+    std::set<std::string> inFlight_;
+    std::set<std::string> seen_;     // Everything enqueued this session
+    int workers_ = 0;
+
+    static std::string MakeKey(const std::string& cid, const std::string& path);
+    bool NextJob(Job& out_job);
+    void RunWorker();
+    static bool FetchJob(const Job& job);
+};
@@ -0,0 +1,288 @@
+#include "PreloadScanner.h"
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+// Longer "tags" are treated as text; real markup never gets close
+const size_t kMaxTagSize = 8192;
+
+std::string ToLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+size_t FindCaseInsensitive(const std::string& text, const std::string& needle, size_t from) {
+    auto it = std::search(text.begin() + from, text.end(), needle.begin(), needle.end(),
+                          [](char a, char b) {
+                              return std::tolower(static_cast<unsigned char>(a)) ==
+                                     std::tolower(static_cast<unsigned char>(b));
+                          });
+    return it == text.end() ? std::string::npos : static_cast<size_t>(it - text.begin());
+}
+
+// Index of the '>' closing the tag that starts before |from|, skipping quoted values
+size_t FindTagEnd(const std::string& text, size_t from) {
+    char quote = 0;
+    for (size_t i = from; i < text.size(); ++i) {
+        char c = text[i];
+        if (quote) {
+            if (c == quote) quote = 0;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '>') {
+            return i;
+        }
+    }
+    return std::string::npos;
+}
+
+std::string DecodeEntities(const std::string& value) {
+    std::string out;
+    size_t pos = 0;
+    while (true) {
+        size_t amp = value.find("&amp;", pos);
+        if (amp == std::string::npos) break;
+        out.append(value, pos, amp + 1 - pos);
+        pos = amp + 5;
+    }
+    out.append(value, pos, std::string::npos);
+    return out;
+}
+
+void ParseTag(const std::string& tag, std::string& out_name, std::map<std::string, std::string>& out_attributes) {
+    size_t pos = 0;
+    while (pos < tag.size() && !std::isspace(static_cast<unsigned char>(tag[pos])) && tag[pos] != '/') ++pos;
+    out_name = ToLower(tag.substr(0, pos));
+
+    while (pos < tag.size()) {
+        while (pos < tag.size() && (std::isspace(static_cast<unsigned char>(tag[pos])) || tag[pos] == '/')) ++pos;
+        size_t name_start = pos;
+        while (pos < tag.size() && !std::isspace(static_cast<unsigned char>(tag[pos])) && tag[pos] != '=' &&
+               tag[pos] != '/') {
+            ++pos;
+        }
+        if (pos == name_start) break;
+        std::string name = ToLower(tag.substr(name_start, pos - name_start));
+
+        while (pos < tag.size() && std::isspace(static_cast<unsigned char>(tag[pos]))) ++pos;
+        std::string value;
+        if (pos < tag.size() && tag[pos] == '=') {
+            ++pos;
+            while (pos < tag.size() && std::isspace(static_cast<unsigned char>(tag[pos]))) ++pos;
+            if (pos < tag.size() && (tag[pos] == '"' || tag[pos] == '\'')) {
+                char quote = tag[pos++];
+                size_t end = tag.find(quote, pos);
+                if (end == std::string::npos) end = tag.size();
+                value = tag.substr(pos, end - pos);
+                pos = end + 1;
+            } else {
+                size_t value_start = pos;
+                while (pos < tag.size() && !std::isspace(static_cast<unsigned char>(tag[pos]))) ++pos;
+                value = tag.substr(value_start, pos - value_start);
+            }
+        }
+        out_attributes.emplace(name, DecodeEntities(value));
+    }
+}
+
+bool HasToken(const std::string& list, const std::string& token) {
+    std::istringstream ss(ToLower(list));
+    std::string item;
+    while (ss >> item) {
+        if (item == token) return true;
+    }
+    return false;
+}
+
+// Removes "." and ".." segments from an absolute path
+std::string NormalizePath(const std::string& path) {
+    std::vector<std::string> segments;
+    std::string segment;
+    std::istringstream ss(path);
+    bool trailing_slash = !path.empty() && path.back() == '/';
+    while (std::getline(ss, segment, '/')) {
+        if (segment.empty() || segment == ".") continue;
+        if (segment == "..") {
+            if (!segments.empty()) segments.pop_back();
+            continue;
+        }
+        segments.push_back(segment);
+    }
+    if (!path.empty()) {
+        size_t last = path.find_last_of('/');
+        std::string tail = path.substr(last + 1);
+        if (tail == "." || tail == "..") trailing_slash = true;
+    }
+
+    std::string out;
+    for (const auto& item : segments) out += "/" + item;
+    if (out.empty() || trailing_slash) out += "/";
+    return out;
+}
+
+// Escapes the bytes Chromium would escape, so the path matches the request URL
+std::string EscapePath(const std::string& path) {
+    static const char kHex[] = "0123456789ABCDEF";
+    std::string out;
+    for (unsigned char c : path) {
+        if (c <= 0x20 || c >= 0x7F || c == '"' || c == '<' || c == '>' || c == '`') {
+            out.push_back('%');
+            out.push_back(kHex[c >> 4]);
+            out.push_back(kHex[c & 0xF]);
+        } else {
+            out.push_back(static_cast<char>(c));
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+PreloadScanner::PreloadScanner(FoundCallback on_found)
+    : onFound_(std::move(on_found)), state_(State::Text) {
+}
+
+void PreloadScanner::Feed(const char* data, size_t size) {
+    pending_.append(data, size);
+
+    size_t pos = 0;
+    while (pos < pending_.size()) {
+        if (state_ == State::Comment) {
+            size_t end = pending_.find("-->", pos);
+            if (end == std::string::npos) {
+                pos = std::max(pos, pending_.size() - std::min<size_t>(pending_.size(), 2));
+                break;
+            }
+            pos = end + 3;
+            state_ = State::Text;
+            continue;
+        }
+
+        if (state_ == State::RawText) {
+            size_t end = FindCaseInsensitive(pending_, rawTextEnd_, pos);
+            if (end == std::string::npos) {
+                // Keep enough bytes to match an end tag split across chunks
+                size_t keep = std::min(pending_.size(), rawTextEnd_.size() - 1);
+                pos = std::max(pos, pending_.size() - keep);
+                break;
+            }
+            pos = end + rawTextEnd_.size();
+            state_ = State::Text;
+            continue;
+        }
+
+        size_t open = pending_.find('<', pos);
+        if (open == std::string::npos) {
+            pos = pending_.size();
+            break;
+        }
+        if (pending_.size() - open < 4) {
+            pos = open; // Not enough bytes yet to tell a comment from a tag
+            break;
+        }
+        if (pending_.compare(open, 4, "<!--") == 0) {
+            state_ = State::Comment;
+            pos = open + 4;
+            continue;
+        }
+
+        size_t end = FindTagEnd(pending_, open + 1);
+        if (end == std::string::npos) {
+            pos = pending_.size() - open > kMaxTagSize ? open + 1 : open;
+            break;
+        }
+        ProcessTag(pending_.substr(open + 1, end - open - 1));
+        pos = end + 1;
+    }
+
+    pending_.erase(0, pos);
+}
+
+void PreloadScanner::ProcessTag(const std::string& tag) {
+    if (tag.empty() || tag[0] == '/' || tag[0] == '!' || tag[0] == '?') return;
+
+    std::string name;
+    std::map<std::string, std::string> attributes;
+    ParseTag(tag, name, attributes);
+
+    auto attribute = [&attributes](const std::string& key) {
+        auto it = attributes.find(key);
+        return it == attributes.end() ? std::string() : it->second;
+    };
+
+    if (name == "script") {
+        std::string src = attribute("src");
+        if (!src.empty()) {
+            bool deferred = attributes.count("async") || attributes.count("defer") ||
+                            ToLower(attribute("type")) == "module";
+            onFound_(src, deferred ? Priority::Normal : Priority::RenderBlocking);
+        }
+        state_ = State::RawText;
+        rawTextEnd_ = "</script";
+    } else if (name == "style") {
+        state_ = State::RawText;
+        rawTextEnd_ = "</style";
+    } else if (name == "link") {
+        std::string href = attribute("href");
+        std::string rel = attribute("rel");
+        if (href.empty()) return;
+
+        if (HasToken(rel, "stylesheet")) {
+            std::string media = ToLower(attribute("media"));
+            bool blocking = media.empty() || media == "all" || media == "screen";
+            onFound_(href, blocking ? Priority::RenderBlocking : Priority::Normal);
+        } else if (HasToken(rel, "preload") || HasToken(rel, "modulepreload")) {
+            std::string as = ToLower(attribute("as"));
+            onFound_(href, as == "style" || as == "font" ? Priority::RenderBlocking : Priority::Normal);
+        } else if (HasToken(rel, "icon")) {
+            onFound_(href, Priority::Normal);
+        }
+    } else if (name == "img") {
+        std::string src = attribute("src");
+        if (!src.empty()) onFound_(src, Priority::Normal);
+    }
+}
+
+bool PreloadScanner::ResolvePath(const std::string& site_name, const std::string& base_path,
+                                 const std::string& reference, std::string& out_path) {
+    size_t first = reference.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) return false;
+    std::string ref = reference.substr(first, reference.find_last_not_of(" \t\r\n") - first + 1);
+
+    ref = ref.substr(0, ref.find('#'));
+    if (ref.empty() || ref.compare(0, 2, "//") == 0) return false;
+
+    // Only frw:// URLs on the same site carry a scheme we can prefetch
+    size_t colon = ref.find(':');
+    if (colon != std::string::npos && colon < ref.find_first_of("/?")) {
+        std::string prefix = "frw://" + site_name;
+        if (ToLower(ref.substr(0, prefix.size())) != ToLower(prefix)) return false;
+        ref = ref.substr(prefix.size());
+        if (!ref.empty() && ref[0] != '/' && ref[0] != '?') return false;
+        if (ref.empty() || ref[0] == '?') ref = "/" + ref;
+    }
+
+    std::string query;
+    size_t question = ref.find('?');
+    if (question != std::string::npos) {
+        query = ref.substr(question);
+        ref = ref.substr(0, question);
+    }
+
+    std::string path;
+    if (!ref.empty() && ref[0] == '/') {
+        path = ref;
+    } else {
+        std::string base = base_path.substr(0, base_path.find('?'));
+        path = base.substr(0, base.find_last_of('/') + 1) + ref;
+    }
+
+    out_path = EscapePath(NormalizePath(path) + query);
+    return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <functional>
+#include <cstddef>
+
+// Lightweight streaming tokenizer that picks subresource references out of
+// HTML as it is delivered, so they can be fetched before the renderer asks.
+// Only <link href>, <script src> and <img src> are reported; comments and
+// script/style bodies are skipped.
+class PreloadScanner {
+public:
+    enum class Priority {
+        RenderBlocking, // Stylesheets and synchronous scripts
+        Normal
+    };
+
+    using FoundCallback = std::function<void(const std::string& reference, Priority priority)>;
+
+    explicit PreloadScanner(FoundCallback on_found);
+
+    // Bytes may be split anywhere, including inside a tag
+    void Feed(const char* data, size_t size);
+
+    // Resolve |reference| found in the document at |base_path| to a path on
+    // the same frw site. Returns false for other sites, schemes and data URLs.
+    static bool ResolvePath(const std::string& site_name, const std::string& base_path,
+                            const std::string& reference, std::string& out_path);
+
+private:
+    enum class State {
+        Text,
+        Comment,
+        RawText // Inside <script> or <style>
+    };
+
+    FoundCallback onFound_;
+    State state_;
+    std::string pending_;
+    std::string rawTextEnd_; // "</script" or "</style"
+
+    void ProcessTag(const std::string& tag);
+};
@@ -1,79 +1,234 @@
 #include "ResolverBridge.h"
 #include "UI/SettingsManager.h"
+#include "TransferStats.h"
+#include "CancellationToken.h"
+#include "OfflineMode.h"
+#include "HedgedQuery.h"
 #include <iostream>
 #include <sstream>
 #include <regex>
-#include <future>
 #include <thread>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cerrno>
+#include <cstdint>
 
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #include <winhttp.h>
 #pragma comment(lib, "winhttp.lib")
+
+namespace {
+
+// Closes a WinHTTP handle on scope exit
+struct ScopedInternetHandle {
+    HINTERNET handle = nullptr;
+    ~ScopedInternetHandle() {
+        if (handle) WinHttpCloseHandle(handle);
+    }
+};
+
+// Owns a request handle. Cancelling the token closes it, which makes a
+// WinHTTP call blocked on it fail straight away and frees the connection.
+class CancellableRequestHandle {
+public:
+    CancellableRequestHandle(HINTERNET handle, std::shared_ptr<CancellationToken> cancel)
+        : handle_(handle), cancel_(std::move(cancel)), registration_(0) {
+        if (cancel_) registration_ = cancel_->Register([this]() { Close(); });
+    }
+    ~CancellableRequestHandle() {
+        if (cancel_ && registration_) cancel_->Unregister(registration_);
+        Close();
+    }
+
+    HINTERNET Get() const { return handle_.load(); }
+
+private:
+    void Close() {
+        HINTERNET handle = handle_.exchange(nullptr);
+        if (handle) WinHttpCloseHandle(handle);
+    }
+
+    std::atomic<HINTERNET> handle_;
+    std::shared_ptr<CancellationToken> cancel_;
+    int registration_;
+};
+
+} // namespace
 #else
-// Add Linux/macOS HTTP client later if needed
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace {
+
+// Owns a socket. Cancelling the token shuts it down, which makes a call
+// blocked on it return straight away.
+class CancellableSocket {
+public:
+    CancellableSocket(int fd, std::shared_ptr<CancellationToken> cancel)
+        : fd_(fd), cancel_(std::move(cancel)), registration_(0) {
+        if (cancel_) registration_ = cancel_->Register([this]() { ::shutdown(fd_, SHUT_RDWR); });
+    }
+    ~CancellableSocket() {
+        if (cancel_ && registration_) cancel_->Unregister(registration_);
+        ::close(fd_);
+    }
+
+    int Get() const { return fd_; }
+
+private:
+    int fd_;
+    std::shared_ptr<CancellationToken> cancel_;
+    int registration_;
+};
+
+bool SendAll(int fd, const std::string& data) {
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL; // A peer that hung up must not raise SIGPIPE
+#else
+    const int flags = 0;
 #endif
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t count = ::send(fd, data.data() + sent, data.size() - sent, flags);
+        if (count <= 0) return false;
+        sent += static_cast<size_t>(count);
+    }
+    return true;
+}
+
+} // namespace
+#endif
+
+namespace {
+
+// A connection that closes early still ends the body cleanly, so what
+// arrived is checked against what the server declared. Content-Length
+// counts encoded bytes, so it only applies to responses that were not decoded.
+bool MatchesDeclaredLength(const HttpResponse& response, uint64_t decoded_bytes, bool compressed) {
+    auto length = response.headers.find("content-length");
+    if (!compressed && length != response.headers.end()) {
+        errno = 0;
+        char* end = nullptr;
+        unsigned long long declared = std::strtoull(length->second.c_str(), &end, 10);
+        if (errno != 0 || end == length->second.c_str() || declared != decoded_bytes) return false;
+    }
+    auto range = response.headers.find("content-range");
+    if (response.status == 206 && range != response.headers.end()) {
+        int64_t first = 0, last = 0, total = 0;
+        return ResolverBridge::ParseContentRange(range->second, first, last, total) &&
+               static_cast<uint64_t>(last - first + 1) == decoded_bytes;
+    }
+    return true;
+}
+
+} // namespace
 
 std::vector<std::string> ResolverBridge::GetBootstrapUrls() {
     // Use configured bootstrap nodes from settings
     return SettingsManager::Instance().GetBootstrapNodes();
 }
 
-bool ResolverBridge::ResolveFromBootstrapNode(const std::string& bootstrap_url, std::string& out_cid) {
-    std::string response;
-    bool ok = FetchFromGateway(bootstrap_url, response);
-    if (ok) {
+bool ResolverBridge::QueryNode(const std::string& url, std::string& out_cid,
+                               const std::shared_ptr<CancellationToken>& cancel) {
+    out_cid.clear();
+
+    HttpRequest request;
+    request.url = url;
+    request.cancel = cancel;
+    request.trafficClass = TrafficClass::RenderBlocking; // Every page load starts with one
+    HttpResponse response;
+    if (!HttpGet(request, response)) return false;
+
+    if (response.status == 200) {
         // Parse JSON for contentCID field
         std::regex cid_regex("\"contentCID\"\\s*:\\s*\"([^\"]+)\"");
         std::smatch match;
-        if (std::regex_search(response, match, cid_regex)) {
+        if (std::regex_search(response.body, match, cid_regex)) {
             out_cid = match[1].str();
-            return true;
         }
     }
-    return false;
+    return true;
 }
 
-bool ResolverBridge::QueryBootstrapNodes(const std::string& name, std::string& out_cid) {
+bool ResolverBridge::ResolveFromBootstrapNode(const std::string& bootstrap_url, std::string& out_cid,
+                                              const std::shared_ptr<CancellationToken>& cancel) {
+    return QueryNode(bootstrap_url, out_cid, cancel) && !out_cid.empty();
+}
+
+bool ResolverBridge::QueryBootstrapNodes(const std::string& name, std::string& out_cid,
+                                         const std::shared_ptr<CancellationToken>& cancel) {
     auto nodes = GetBootstrapUrls();
-    std::vector<std::future<std::pair<std::string, bool>>> futures;
 
+    std::vector<std::string> urls;
     for (const auto& node : nodes) {
-        futures.emplace_back(std::async(std::launch::async, [node, name]() -> std::pair<std::string, bool> {
-            std::string url = node + "/api/resolve/" + name;
-            std::string response;
-            bool ok = FetchFromGateway(url, response);
-            if (ok) {
-                // Parse JSON for contentCID field
-                std::regex cid_regex("\"contentCID\"\\s*:\\s*\"([^\"]+)\"");
-                std::smatch match;
-                if (std::regex_search(response, match, cid_regex)) {
-                    return {match[1].str(), true};
-                }
-            }
-            return {"", false};
-        }));
+        urls.push_back(node + "/api/resolve/" + name);
     }
 
-    // Wait for first successful response
-    for (auto& f : futures) {
-        auto [cid, ok] = f.get();
-        if (ok && !cid.empty()) {
-            out_cid = cid;
-            return true;
-        }
+    // Returns with the first node that knows the name; the rest are cancelled
+    HedgedQuery::Result result = HedgedQuery::Run(urls, &ResolverBridge::QueryNode, cancel);
+    if (result.answered) out_cid = result.answer;
+
+    // A cancelled query says nothing about the network
+    if (!(cancel && cancel->IsCancelled()) && !nodes.empty()) {
+        OfflineMode::Instance().ReportBootstrapReachable(result.reachable);
     }
-    return false;
+    return result.answered;
 }
 
-bool ResolverBridge::ResolveName(const std::string& name, std::string& out_cid) {
-    return QueryBootstrapNodes(name, out_cid);
+bool ResolverBridge::ResolveName(const std::string& name, std::string& out_cid,
+                                 const std::shared_ptr<CancellationToken>& cancel) {
+    if (OfflineMode::Instance().IsOffline()) return false;
+    return QueryBootstrapNodes(name, out_cid, cancel);
 }
 
-bool ResolverBridge::FetchFromGateway(const std::string& url, std::string& out_content) {
+bool ResolverBridge::FetchFromGateway(const std::string& url, std::string& out_content,
+                                      const std::shared_ptr<CancellationToken>& cancel) {
     out_content.clear();
 
+    HttpRequest request;
+    request.url = url;
+    request.cancel = cancel;
+    HttpResponse response;
+    if (!HttpGet(request, response) || response.status != 200) {
+        return false;
+    }
+
+    out_content = std::move(response.body);
+    return !out_content.empty();
+}
+
+bool ResolverBridge::ParseContentRange(const std::string& value, int64_t& first, int64_t& last, int64_t& total) {
+    std::regex range_regex(R"(bytes\s+(\d+)-(\d+)/(\d+|\*))");
+    std::smatch match;
+    if (!std::regex_search(value, match, range_regex)) return false;
+
+    if (!ParseByteOffset(match[1].str(), first) || !ParseByteOffset(match[2].str(), last)) return false;
+    total = -1;
+    if (match[3].str() != "*" && !ParseByteOffset(match[3].str(), total)) return false;
+    return first <= last;
+}
+
+bool ResolverBridge::ParseByteOffset(const std::string& digits, int64_t& out) {
+    if (digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos) return false;
+    errno = 0;
+    char* end = nullptr;
+    unsigned long long value = std::strtoull(digits.c_str(), &end, 10);
+    if (errno == ERANGE || end != digits.c_str() + digits.size() ||
+        value > static_cast<unsigned long long>(INT64_MAX)) {
+        return false;
+    }
+    out = static_cast<int64_t>(value);
+    return true;
+}
+
+bool ResolverBridge::HttpGet(const HttpRequest& request, HttpResponse& out_response) {
+    out_response = HttpResponse();
+
 #ifdef _WIN32
     // Use WinHTTP for Windows
     std::wstring host, path;
@@ -83,7 +238,7 @@ bool ResolverBridge::FetchFromGateway(const std::string& url, std::string& out_c
     // Parse URL (very naive, just for demo)
     std::wregex url_regex(L"^(https?://)([^:/]+)(?::(\\d+))?(/.*)?$");
     std::wsmatch match;
-    std::wstring wurl(url.begin(), url.end());
+    std::wstring wurl(request.url.begin(), request.url.end());
     if (!std::regex_match(wurl, match, url_regex)) return false;
 
     secure = match[1].str() == L"https://";
@@ -95,74 +250,290 @@ bool ResolverBridge::FetchFromGateway(const std::string& url, std::string& out_c
     }
     path = match[4].matched ? match[4].str() : L"/";
 
-    HINTERNET hSession = WinHttpOpen(L"FRW Browser/1.0", WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
-                                    WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
-    if (!hSession) return false;
+    if (request.cancel && request.cancel->IsCancelled()) return false;
 
-    HINTERNET hConnect = WinHttpConnect(hSession, host.c_str(), port, 0);
-    if (!hConnect) {
-        WinHttpCloseHandle(hSession);
-        return false;
-    }
+    BandwidthScheduler& scheduler = BandwidthScheduler::Instance();
+    BandwidthScheduler::Transfer transfer(request.trafficClass);
 
-    HINTERNET hRequest = WinHttpOpenRequest(hConnect, L"GET", path.c_str(),
-                                            NULL, WINHTTP_NO_REFERER,
-                                            WINHTTP_DEFAULT_ACCEPT_TYPES,
-                                            secure ? WINHTTP_FLAG_SECURE : 0);
-    if (!hRequest) {
-        WinHttpCloseHandle(hConnect);
-        WinHttpCloseHandle(hSession);
-        return false;
+    ScopedInternetHandle session;
+    session.handle = WinHttpOpen(L"FRW Browser/1.0", WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
+                                 WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
+    if (!session.handle) return false;
+    if (request.timeoutMs > 0) {
+        WinHttpSetTimeouts(session.handle, request.timeoutMs, request.timeoutMs, request.timeoutMs, request.timeoutMs);
     }
 
-    BOOL result = WinHttpSendRequest(hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0,
-                                     WINHTTP_NO_REQUEST_DATA, 0, 0, 0);
-    if (!result) {
-        WinHttpCloseHandle(hRequest);
-        WinHttpCloseHandle(hConnect);
-        WinHttpCloseHandle(hSession);
-        return false;
+    ScopedInternetHandle connect;
+    connect.handle = WinHttpConnect(session.handle, host.c_str(), port, 0);
+    if (!connect.handle) return false;
+
+    std::wstring method(request.method.begin(), request.method.end());
+    HINTERNET request_handle = WinHttpOpenRequest(connect.handle, method.c_str(), path.c_str(),
+                                                  NULL, WINHTTP_NO_REFERER,
+                                                  WINHTTP_DEFAULT_ACCEPT_TYPES,
+                                                  secure ? WINHTTP_FLAG_SECURE : 0);
+    if (!request_handle) return false;
+    // Declared last so it is closed first
+    CancellableRequestHandle hRequest(request_handle, request.cancel);
+
+    // Let WinHTTP negotiate gzip/deflate and decode while streaming. A range
+    // would apply to the encoded bytes, so ranged requests stay uncompressed.
+#ifdef WINHTTP_OPTION_DECOMPRESSION
+    bool has_range = std::any_of(request.headers.begin(), request.headers.end(),
+                                 [](const std::pair<std::string, std::string>& header) {
+                                     return _stricmp(header.first.c_str(), "Range") == 0;
+                                 });
+    if (!has_range) {
+        DWORD decompression = WINHTTP_DECOMPRESSION_FLAG_ALL;
+        WinHttpSetOption(hRequest.Get(), WINHTTP_OPTION_DECOMPRESSION, &decompression, sizeof(decompression));
     }
+#endif
 
-    result = WinHttpReceiveResponse(hRequest, NULL);
-    if (!result) {
-        WinHttpCloseHandle(hRequest);
-        WinHttpCloseHandle(hConnect);
-        WinHttpCloseHandle(hSession);
-        return false;
+    std::wstring extra_headers;
+    for (const auto& header : request.headers) {
+        std::string line = header.first + ": " + header.second + "\r\n";
+        extra_headers.append(line.begin(), line.end());
     }
 
+    BOOL result = WinHttpSendRequest(hRequest.Get(),
+                                     extra_headers.empty() ? WINHTTP_NO_ADDITIONAL_HEADERS : extra_headers.c_str(),
+                                     extra_headers.empty() ? 0 : static_cast<DWORD>(-1L),
+                                     WINHTTP_NO_REQUEST_DATA, 0, 0, 0);
+    if (!result) return false;
+
+    result = WinHttpReceiveResponse(hRequest.Get(), NULL);
+    if (!result) return false;
+
     DWORD status_code = 0;
     DWORD size = sizeof(status_code);
-    WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
+    WinHttpQueryHeaders(hRequest.Get(), WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
                         WINHTTP_HEADER_NAME_BY_INDEX, &status_code, &size, WINHTTP_NO_HEADER_INDEX);
+    out_response.status = static_cast<int>(status_code);
 
-    if (status_code != 200) {
-        WinHttpCloseHandle(hRequest);
-        WinHttpCloseHandle(hConnect);
-        WinHttpCloseHandle(hSession);
-        return false;
+    // Collect response headers as "name: value" lines
+    DWORD header_size = 0;
+    WinHttpQueryHeaders(hRequest.Get(), WINHTTP_QUERY_RAW_HEADERS_CRLF, WINHTTP_HEADER_NAME_BY_INDEX,
+                        WINHTTP_NO_OUTPUT_BUFFER, &header_size, WINHTTP_NO_HEADER_INDEX);
+    if (header_size > 0) {
+        std::wstring raw(header_size / sizeof(wchar_t), L'\0');
+        if (WinHttpQueryHeaders(hRequest.Get(), WINHTTP_QUERY_RAW_HEADERS_CRLF, WINHTTP_HEADER_NAME_BY_INDEX,
+                                &raw[0], &header_size, WINHTTP_NO_HEADER_INDEX)) {
+            std::wistringstream lines(raw);
+            std::wstring wline;
+            while (std::getline(lines, wline)) {
+                size_t colon = wline.find(L':');
+                if (colon == std::wstring::npos) continue;
+                std::string name(wline.begin(), wline.begin() + colon);
+                std::string value(wline.begin() + colon + 1, wline.end());
+                std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+                value.erase(0, value.find_first_not_of(" \t"));
+                value.erase(value.find_last_not_of(" \t\r") + 1);
+                out_response.headers[name] = value;
+            }
+        }
     }
 
+    bool keep_reading = !request.onResponse || request.onResponse(out_response);
+
+    // Receive and decode cost is measured in thread cycles, excluding
+    // callbacks and time spent waiting for bandwidth
     DWORD available = 0;
-    do {
-        if (!WinHttpQueryDataAvailable(hRequest, &available)) break;
-        if (available > 0) {
-            std::vector<char> buffer(available + 1);
-            DWORD downloaded = 0;
-            if (WinHttpReadData(hRequest, buffer.data(), available, &downloaded)) {
-                buffer[downloaded] = '\0';
-                out_content.append(buffer.data(), downloaded);
-            }
+    ULONG64 read_cycles = 0;
+    uint64_t decoded_bytes = 0;
+    bool finished = false; // WinHTTP reported the end of the body
+    bool failed = false;   // A read failed or the bandwidth wait was cancelled
+    while (keep_reading && !(request.cancel && request.cancel->IsCancelled())) {
+        ULONG64 cycles_before = 0, cycles_after = 0;
+        QueryThreadCycleTime(GetCurrentThread(), &cycles_before);
+        bool queried = WinHttpQueryDataAvailable(hRequest.Get(), &available) != FALSE;
+        QueryThreadCycleTime(GetCurrentThread(), &cycles_after);
+        read_cycles += cycles_after - cycles_before;
+        if (!queried) {
+            failed = true;
+            break;
+        }
+        if (available == 0) {
+            finished = true;
+            break;
         }
-    } while (available > 0);
 
-    WinHttpCloseHandle(hRequest);
-    WinHttpCloseHandle(hConnect);
-    WinHttpCloseHandle(hSession);
-    return !out_content.empty();
+        // Data left unread stays in the socket buffer, so the sender slows down
+        size_t allowed = scheduler.Acquire(request.trafficClass, request.flow.get(), available, request.cancel);
+        if (allowed == 0) {
+            failed = true;
+            break;
+        }
+        DWORD wanted = static_cast<DWORD>(std::min<size_t>(available, allowed));
+
+        QueryThreadCycleTime(GetCurrentThread(), &cycles_before);
+        std::vector<char> buffer(wanted + 1);
+        DWORD downloaded = 0;
+        bool read = WinHttpReadData(hRequest.Get(), buffer.data(), wanted, &downloaded) != FALSE;
+        QueryThreadCycleTime(GetCurrentThread(), &cycles_after);
+        read_cycles += cycles_after - cycles_before;
+        if (!read) {
+            failed = true;
+            break;
+        }
+
+        buffer[downloaded] = '\0';
+        decoded_bytes += downloaded;
+        if (request.onData) {
+            keep_reading = request.onData(buffer.data(), downloaded);
+        } else {
+            out_response.body.append(buffer.data(), downloaded);
+        }
+    }
+
+    // Bytes on the wire differ from decoded bytes only for encoded responses
+    bool compressed = out_response.headers.count("content-encoding") > 0 &&
+                      out_response.headers["content-encoding"] != "identity";
+    uint64_t wire_bytes = decoded_bytes;
+#ifdef WINHTTP_OPTION_REQUEST_STATS
+    WINHTTP_REQUEST_STATS stats = {};
+    stats.cStats = WinHttpRequestStatLast;
+    DWORD stats_size = sizeof(stats);
+    if (WinHttpQueryOption(hRequest.Get(), WINHTTP_OPTION_REQUEST_STATS, &stats, &stats_size) &&
+        stats.rgullStats[WinHttpResponseBodyCompressedSize] > 0) {
+        wire_bytes = stats.rgullStats[WinHttpResponseBodyCompressedSize];
+        compressed = true;
+    } else
+#endif
+    if (compressed && out_response.headers.count("content-length")) {
+        wire_bytes = std::strtoull(out_response.headers["content-length"].c_str(), nullptr, 10);
+    }
+    TransferStats::Instance().Record(compressed, wire_bytes, decoded_bytes, read_cycles);
+
+    out_response.complete = finished && MatchesDeclaredLength(out_response, decoded_bytes, compressed);
+
+    if (failed) return false;
+
+    // A cancelled transfer is incomplete; callers must not use it
+    return !(request.cancel && request.cancel->IsCancelled());
 #else
-    // TODO: Add libcurl or similar for Linux/macOS
-    return false;
+    // Plain HTTP/1.0 over a socket, so no response arrives chunked or
+    // compressed. There is no TLS here; https:// URLs fail.
+    std::regex url_regex("^http://([^:/]+)(?::(\\d+))?(/.*)?$");
+    std::smatch match;
+    if (!std::regex_match(request.url, match, url_regex)) return false;
+    std::string host = match[1].str();
+    std::string port = match[2].matched ? match[2].str() : "80";
+    std::string path = match[3].matched ? match[3].str() : "/";
+
+    if (request.cancel && request.cancel->IsCancelled()) return false;
+
+    BandwidthScheduler& scheduler = BandwidthScheduler::Instance();
+    BandwidthScheduler::Transfer transfer(request.trafficClass);
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0) return false;
+    std::unique_ptr<addrinfo, decltype(&freeaddrinfo)> address_list(addresses, freeaddrinfo);
+
+    int fd = ::socket(addresses->ai_family, addresses->ai_socktype, addresses->ai_protocol);
+    if (fd < 0) return false;
+    CancellableSocket socket(fd, request.cancel);
+    if (request.timeoutMs > 0) {
+        timeval timeout = {request.timeoutMs / 1000, (request.timeoutMs % 1000) * 1000};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    }
+    if (::connect(fd, addresses->ai_addr, addresses->ai_addrlen) != 0) return false;
+
+    std::string head = request.method + " " + path + " HTTP/1.0\r\nHost: " + host +
+                       (match[2].matched ? ":" + port : "") + "\r\nUser-Agent: FRW Browser/1.0\r\n";
+    for (const auto& header : request.headers) {
+        head += header.first + ": " + header.second + "\r\n";
+    }
+    if (!SendAll(fd, head + "\r\n")) return false;
+
+    // Read up to the blank line; whatever follows it is the start of the body
+    std::string received;
+    size_t header_end = std::string::npos;
+    char buffer[16 * 1024];
+    while (header_end == std::string::npos) {
+        ssize_t count = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (count <= 0 || received.size() > 64 * 1024) return false;
+        received.append(buffer, static_cast<size_t>(count));
+        header_end = received.find("\r\n\r\n");
+    }
+
+    std::istringstream lines(received.substr(0, header_end));
+    std::string line;
+    std::getline(lines, line);
+    std::regex status_regex(R"(^HTTP/\d\.\d\s+(\d{3}))");
+    std::smatch status;
+    if (!std::regex_search(line, status, status_regex)) return false;
+    out_response.status = std::atoi(status[1].str().c_str());
+    while (std::getline(lines, line)) {
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        std::string name = line.substr(0, colon);
+        std::string value = line.substr(colon + 1);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        value.erase(0, value.find_first_not_of(" \t"));
+        value.erase(value.find_last_not_of(" \t\r") + 1);
+        out_response.headers[name] = value;
+    }
+
+    bool keep_reading = !request.onResponse || request.onResponse(out_response);
+
+    // Without a Content-Length the body runs until the server closes
+    int64_t remaining = -1;
+    auto length = out_response.headers.find("content-length");
+    if (length != out_response.headers.end() && !ParseByteOffset(length->second, remaining)) return false;
+
+    uint64_t decoded_bytes = 0;
+    bool finished = false;
+    bool failed = false;
+    std::string pending = received.substr(header_end + 4);
+    while (keep_reading && !(request.cancel && request.cancel->IsCancelled())) {
+        if (remaining == 0) {
+            finished = true;
+            break;
+        }
+        if (pending.empty()) {
+            // Data left unread stays in the socket buffer, so the sender slows down
+            size_t allowed = scheduler.Acquire(request.trafficClass, request.flow.get(), sizeof(buffer),
+                                               request.cancel);
+            if (allowed == 0) {
+                failed = true;
+                break;
+            }
+            ssize_t count = ::recv(fd, buffer, std::min(allowed, sizeof(buffer)), 0);
+            if (count < 0) {
+                failed = true;
+                break;
+            }
+            if (count == 0) {
+                // A close before the declared length is a truncated body
+                finished = remaining < 0;
+                break;
+            }
+            pending.assign(buffer, static_cast<size_t>(count));
+        }
+
+        size_t size = remaining < 0 ? pending.size() : std::min<size_t>(pending.size(), remaining);
+        decoded_bytes += size;
+        if (remaining > 0) remaining -= static_cast<int64_t>(size);
+        if (request.onData) {
+            keep_reading = request.onData(pending.data(), size);
+        } else {
+            out_response.body.append(pending.data(), size);
+        }
+        pending.clear();
+    }
+
+    // Thread cycle counts are a Windows API; the CPU cost goes unrecorded
+    TransferStats::Instance().Record(false, decoded_bytes, decoded_bytes, 0);
+
+    out_response.complete = finished && MatchesDeclaredLength(out_response, decoded_bytes, false);
+
+    if (failed) return false;
+
+    // A cancelled transfer is incomplete; callers must not use it
+    return !(request.cancel && request.cancel->IsCancelled());
 #endif
 }
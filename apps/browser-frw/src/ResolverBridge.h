@@ -1,20 +1,81 @@
 #pragma once
 
+#include "BandwidthScheduler.h"
+
 #include <string>
 #include <vector>
+#include <map>
+#include <utility>
+#include <functional>
+#include <memory>
+#include <cstdint>
+
+class CancellationToken;
+
+struct HttpResponse {
+    int status = 0;
+    std::map<std::string, std::string> headers; // Names are lower-case
+    std::string body;
+    // The server ended the body and it was as long as Content-Length (or the
+    // Content-Range span of a 206) said. False when a hook stopped the transfer.
+    bool complete = false;
+};
+
+struct HttpRequest {
+    std::string url;
+    std::string method = "GET"; // The local node's RPC API only accepts POST
+    std::vector<std::pair<std::string, std::string>> headers;
+    int timeoutMs = 0;          // Resolve/connect/send/receive limit; 0 keeps the defaults
+
+    // Optional streaming hooks. onResponse runs once the status and headers
+    // are known; when onData is set the body is handed over chunk by chunk
+    // instead of being collected in HttpResponse::body. Returning false from
+    // either hook aborts the transfer.
+    std::function<bool(const HttpResponse&)> onResponse;
+    std::function<bool(const char* data, size_t size)> onData;
+
+    // Cancelling aborts the transfer at once, even inside a blocking read
+    std::shared_ptr<CancellationToken> cancel;
+
+    // How BandwidthScheduler paces the body; |flow| optionally caps this
+    // transfer together with others sharing it
+    TrafficClass trafficClass = TrafficClass::PageAsset;
+    std::shared_ptr<BandwidthFlow> flow;
+};
 
 class ResolverBridge {
 public:
-    // Resolve an FRW name to a content CID
-    static bool ResolveName(const std::string& name, std::string& out_cid);
+    // Resolve an FRW name to a content CID, asking all bootstrap nodes at once.
+    // Fails without touching the network while OfflineMode is active.
+    static bool ResolveName(const std::string& name, std::string& out_cid,
+                            const std::shared_ptr<CancellationToken>& cancel = nullptr);
 
     // Resolve an FRW name using a specific bootstrap node
-    static bool ResolveFromBootstrapNode(const std::string& bootstrap_url, std::string& out_cid);
+    static bool ResolveFromBootstrapNode(const std::string& bootstrap_url, std::string& out_cid,
+                                         const std::shared_ptr<CancellationToken>& cancel = nullptr);
 
     // Fetch raw content from an IPFS gateway
-    static bool FetchFromGateway(const std::string& url, std::string& out_content);
+    static bool FetchFromGateway(const std::string& url, std::string& out_content,
+                                 const std::shared_ptr<CancellationToken>& cancel = nullptr);
+
+    // Perform a GET request; returns false on transport and read errors, so a
+    // true result with |complete| unset means a hook stopped the transfer or
+    // the body did not match its declared length
+    static bool HttpGet(const HttpRequest& request, HttpResponse& out_response);
+
+    // Parse "bytes first-last/total" (total may be '*', reported as -1).
+    // Offsets too large for int64_t make the value invalid.
+    static bool ParseContentRange(const std::string& value, int64_t& first, int64_t& last, int64_t& total);
+    // Parse a string of decimal digits; false if it is empty, has anything
+    // else in it, or does not fit in int64_t
+    static bool ParseByteOffset(const std::string& digits, int64_t& out);
 
 private:
-    static bool QueryBootstrapNodes(const std::string& name, std::string& out_cid);
+    // False only when the node could not be reached; |out_cid| stays empty
+    // when it answered without a CID
+    static bool QueryNode(const std::string& url, std::string& out_cid,
+                          const std::shared_ptr<CancellationToken>& cancel);
+    static bool QueryBootstrapNodes(const std::string& name, std::string& out_cid,
+                                    const std::shared_ptr<CancellationToken>& cancel);
     static std::vector<std::string> GetBootstrapUrls();
 };
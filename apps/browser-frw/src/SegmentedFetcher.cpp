@@ -0,0 +1,189 @@
+#include "SegmentedFetcher.h"
+#include "ContentStream.h"
+#include "ResolverBridge.h"
+#include "CancellationToken.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+const size_t kMinChunk = 256 * 1024;
+const size_t kInitialChunk = 1024 * 1024;
+const size_t kMaxChunk = 16 * 1024 * 1024;
+const double kTargetSecondsPerChunk = 2.0;
+const int kMaxFailures = 2;
+
+} // namespace
+
+SegmentedFetcher::SegmentedFetcher(std::vector<std::string> gateways,
+                                   std::string ipfs_path,
+                                   std::shared_ptr<ContentStream> stream,
+                                   size_t start_offset,
+                                   std::shared_ptr<CancellationToken> cancel,
+                                   TrafficClass traffic_class)
+    : ipfsPath_(std::move(ipfs_path)), stream_(std::move(stream)), cancel_(std::move(cancel)),
+      trafficClass_(traffic_class), cursor_(start_offset) {
+    for (auto& gateway : gateways) {
+        workers_.push_back({std::move(gateway), 0.0, 0});
+    }
+}
+
+void SegmentedFetcher::Start(std::function<void(bool success)> on_done) {
+    auto self = shared_from_this();
+    std::thread([self, on_done]() {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < self->workers_.size(); ++i) {
+            threads.emplace_back(&SegmentedFetcher::RunWorker, self.get(), i);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        bool success = self->stream_->IsComplete();
+        if (!success) self->stream_->Fail();
+        if (on_done) on_done(success);
+    }).detach();
+}
+
+void SegmentedFetcher::RunWorker(size_t worker) {
+    while (true) {
+        auto segment = NextSegment(worker);
+        if (!segment) return;
+
+        auto started = std::chrono::steady_clock::now();
+        bool ok = FetchSegment(worker, segment);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        WorkerState& state = workers_[worker];
+
+        // Smooth the measured rate so one slow response does not dominate
+        double sample = segment->written / std::max(seconds, 0.001);
+        state.throughput = state.throughput == 0.0 ? sample : state.throughput * 0.7 + sample * 0.3;
+
+        active_.erase(std::remove(active_.begin(), active_.end(), segment), active_.end());
+        if (segment->start + segment->written < segment->end) {
+            retry_.emplace_back(segment->start + segment->written, segment->end);
+        }
+        segmentsChanged_.notify_all();
+
+        if (ok) {
+            state.failures = 0;
+        } else if (++state.failures >= kMaxFailures) {
+            return;
+        }
+    }
+}
+
+std::shared_ptr<SegmentedFetcher::Segment> SegmentedFetcher::NextSegment(size_t worker) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const size_t total = stream_->TotalSize();
+
+    while (true) {
+        // Workers in flight abort with their requests and wake us when they finish
+        if (cancel_ && cancel_->IsCancelled()) return nullptr;
+
+        std::shared_ptr<Segment> segment;
+        size_t chunk = ChunkSizeFor(worker);
+
+        if (!retry_.empty()) {
+            // Ranges abandoned by failed workers come first
+            auto range = retry_.front();
+            retry_.pop_front();
+            if (range.second - range.first > chunk) {
+                retry_.emplace_front(range.first + chunk, range.second);
+                range.second = range.first + chunk;
+            }
+            segment = std::make_shared<Segment>(Segment{range.first, range.second, 0, worker});
+        } else if (cursor_ < total) {
+            size_t size = std::min(chunk, total - cursor_);
+            segment = std::make_shared<Segment>(Segment{cursor_, cursor_ + size, 0, worker});
+            cursor_ += size;
+        } else {
+            // Nothing unassigned: steal the tail of the range that will take longest
+            std::shared_ptr<Segment> victim;
+            double longest = 0.0;
+            for (const auto& candidate : active_) {
+                if (candidate->worker == worker) continue;
+                size_t remaining = candidate->end - (candidate->start + candidate->written);
+                if (remaining < kMinChunk * 2) continue;
+                double eta = remaining / std::max(workers_[candidate->worker].throughput, 1.0);
+                if (eta > longest) {
+                    longest = eta;
+                    victim = candidate;
+                }
+            }
+
+            if (victim) {
+                // Split the remainder in proportion to the two measured rates
+                size_t position = victim->start + victim->written;
+                size_t remaining = victim->end - position;
+                double mine = std::max(workers_[worker].throughput, 1.0);
+                double theirs = std::max(workers_[victim->worker].throughput, 1.0);
+                size_t keep = static_cast<size_t>(remaining * (theirs / (mine + theirs)));
+                keep = std::min(std::max(keep, kMinChunk), remaining - kMinChunk);
+
+                segment = std::make_shared<Segment>(Segment{position + keep, victim->end, 0, worker});
+                victim->end = position + keep;
+            }
+        }
+
+        if (segment) {
+            active_.push_back(segment);
+            return segment;
+        }
+
+        if (active_.empty()) return nullptr;
+        segmentsChanged_.wait(lock);
+    }
+}
+
+bool SegmentedFetcher::FetchSegment(size_t worker, const std::shared_ptr<Segment>& segment) {
+    HttpRequest request;
+    size_t request_end = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        request.url = workers_[worker].gateway + ipfsPath_;
+        request_end = segment->end;
+    }
+    request.headers.emplace_back("Range", "bytes=" + std::to_string(segment->start) + "-" +
+                                              std::to_string(request_end - 1));
+    request.cancel = cancel_;
+    request.trafficClass = trafficClass_;
+
+    // Only accept a partial response that starts where we asked
+    request.onResponse = [segment](const HttpResponse& response) {
+        if (response.status != 206) return false;
+        auto it = response.headers.find("content-range");
+        int64_t first = 0, last = 0, total = 0;
+        return it != response.headers.end() &&
+               ResolverBridge::ParseContentRange(it->second, first, last, total) &&
+               first == static_cast<int64_t>(segment->start);
+    };
+
+    // Write straight into the shared stream, stopping early if a thief
+    // has taken over the tail of this range
+    request.onData = [this, segment](const char* data, size_t size) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t position = segment->start + segment->written;
+        if (position >= segment->end) return false;
+        size_t count = std::min(size, segment->end - position);
+        stream_->Write(position, data, count);
+        segment->written += count;
+        return position + count < segment->end;
+    };
+
+    HttpResponse response;
+    ResolverBridge::HttpGet(request, response);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return segment->start + segment->written >= segment->end;
+}
+
+size_t SegmentedFetcher::ChunkSizeFor(size_t worker) const {
+    double throughput = workers_[worker].throughput;
+    if (throughput <= 0.0) return kInitialChunk;
+    size_t chunk = static_cast<size_t>(throughput * kTargetSecondsPerChunk);
+    return std::min(std::max(chunk, kMinChunk), kMaxChunk);
+}
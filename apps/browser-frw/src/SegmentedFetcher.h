@@ -0,0 +1,66 @@
+#pragma once
+
+#include "BandwidthScheduler.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstddef>
+
+class ContentStream;
+class CancellationToken;
+
+// Downloads one IPFS object as byte ranges from several gateways at once.
+// Each gateway gets its own worker; chunk sizes follow the throughput measured
+// per gateway, and once the unassigned tail runs out, idle workers steal the
+// remaining half of the slowest in-flight range.
+class SegmentedFetcher : public std::enable_shared_from_this<SegmentedFetcher> {
+public:
+    // |ipfs_path| is appended to each gateway, e.g. "/ipfs/<cid>/video.mp4".
+    // Bytes below |start_offset| must already be in |stream|. Cancelling
+    // |cancel| aborts every range in flight and fails the stream.
+    SegmentedFetcher(std::vector<std::string> gateways,
+                     std::string ipfs_path,
+                     std::shared_ptr<ContentStream> stream,
+                     size_t start_offset,
+                     std::shared_ptr<CancellationToken> cancel = nullptr,
+                     TrafficClass traffic_class = TrafficClass::PageAsset);
+
+    // Runs the transfer on background threads; |on_done| gets the outcome
+    void Start(std::function<void(bool success)> on_done);
+
+private:
+    struct Segment {
+        size_t start;
+        size_t end;      // Exclusive; lowered when a thief takes the tail
+        size_t written;
+        size_t worker;
+    };
+
+    struct WorkerState {
+        std::string gateway;
+        double throughput;  // Bytes per second, smoothed
+        int failures;
+    };
+
+    std::vector<WorkerState> workers_;
+    std::string ipfsPath_;
+    std::shared_ptr<ContentStream> stream_;
+    std::shared_ptr<CancellationToken> cancel_;
+    TrafficClass trafficClass_;
+
+    std::mutex mutex_;
+    std::condition_variable segmentsChanged_; // A segment finished or was split
+    size_t cursor_;                              // Next unassigned byte
+    std::deque<std::pair<size_t, size_t>> retry_; // Ranges returned by failed workers
+    std::vector<std::shared_ptr<Segment>> active_;
+
+    void RunWorker(size_t worker);
+    std::shared_ptr<Segment> NextSegment(size_t worker);
+    bool FetchSegment(size_t worker, const std::shared_ptr<Segment>& segment);
+    size_t ChunkSizeFor(size_t worker) const;
+};
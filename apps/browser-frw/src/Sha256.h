@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Incremental SHA-256 (FIPS 180-4)
+class Sha256 {
+public:
+    static const size_t kDigestSize = 32;
+
+    Sha256();
+
+    void Update(const void* data, size_t size);
+    // Returns the 32-byte digest; the object must be Reset() before reuse
+    std::string Finish();
+    void Reset();
+
+    static std::string Hash(const void* data, size_t size);
+
+private:
+    uint32_t state_[8];
+    uint8_t block_[64];
+    size_t blockSize_;
+    uint64_t totalBytes_;
+
+    void Transform(const uint8_t* block);
+};
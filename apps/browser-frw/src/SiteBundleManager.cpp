@@ -0,0 +1,337 @@
+#include "SiteBundleManager.h"
+#include "CancellationToken.h"
+#include "ContentStore.h"
+#include "Crc32.h"
+#include "OfflineMode.h"
+#include "ResolverBridge.h"
+#include "UnixFs.h"
+#include "UI/SettingsManager.h"
+#include "cef_stream.h"
+
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+const int kMaxDirectoryDepth = 32;
+const size_t kMaxZipEntries = 65535; // No zip64
+// Each build streams a whole site; more than this at once only splits
+// the bandwidth further
+const size_t kMaxBundleBuilds = 2;
+
+using BundleFiles = std::vector<std::pair<std::string, std::string>>; // path -> content
+
+void PutLe16(std::string& out, uint32_t value) {
+    out.push_back(static_cast<char>(value & 0xFF));
+    out.push_back(static_cast<char>((value >> 8) & 0xFF));
+}
+
+void PutLe32(std::string& out, uint32_t value) {
+    PutLe16(out, value & 0xFFFF);
+    PutLe16(out, value >> 16);
+}
+
+// Writes an uncompressed zip; the content is already compressed where it matters
+bool WriteStoredZip(const std::string& path, const BundleFiles& files) {
+    if (files.size() > kMaxZipEntries) return false;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+
+    const uint32_t kDosDate = (0 << 9) | (1 << 5) | 1; // 1980-01-01
+    const uint32_t kUtf8Names = 0x0800;
+    std::string central;
+    uint64_t offset = 0;
+
+    for (const auto& entry : files) {
+        const std::string& name = entry.first;
+        const std::string& content = entry.second;
+        uint32_t crc = Crc32(content);
+
+        std::string header;
+        PutLe32(header, 0x04034B50);
+        PutLe16(header, 10);          // Version needed
+        PutLe16(header, kUtf8Names);
+        PutLe16(header, 0);           // Stored
+        PutLe16(header, 0);           // Time
+        PutLe16(header, kDosDate);
+        PutLe32(header, crc);
+        PutLe32(header, static_cast<uint32_t>(content.size()));
+        PutLe32(header, static_cast<uint32_t>(content.size()));
+        PutLe16(header, static_cast<uint32_t>(name.size()));
+        PutLe16(header, 0);           // Extra field length
+        header += name;
+
+        PutLe32(central, 0x02014B50);
+        PutLe16(central, 20);         // Version made by
+        PutLe16(central, 10);
+        PutLe16(central, kUtf8Names);
+        PutLe16(central, 0);
+        PutLe16(central, 0);
+        PutLe16(central, kDosDate);
+        PutLe32(central, crc);
+        PutLe32(central, static_cast<uint32_t>(content.size()));
+        PutLe32(central, static_cast<uint32_t>(content.size()));
+        PutLe16(central, static_cast<uint32_t>(name.size()));
+        PutLe16(central, 0);          // Extra field length
+        PutLe16(central, 0);          // Comment length
+        PutLe16(central, 0);          // Disk number
+        PutLe16(central, 0);          // Internal attributes
+        PutLe32(central, 0);          // External attributes
+        PutLe32(central, static_cast<uint32_t>(offset));
+        central += name;
+
+        file.write(header.data(), header.size());
+        file.write(content.data(), content.size());
+        offset += header.size() + content.size();
+        if (offset > 0xFFFFFFFFu) return false;
+    }
+
+    std::string end;
+    PutLe32(end, 0x06054B50);
+    PutLe16(end, 0);
+    PutLe16(end, 0);
+    PutLe16(end, static_cast<uint32_t>(files.size()));
+    PutLe16(end, static_cast<uint32_t>(files.size()));
+    PutLe32(end, static_cast<uint32_t>(central.size()));
+    PutLe32(end, static_cast<uint32_t>(offset));
+    PutLe16(end, 0);
+
+    file.write(central.data(), central.size());
+    file.write(end.data(), end.size());
+    return file.good();
+}
+
+// Collects every file below |dir|. Fails on sharded directories or missing
+// blocks so that a partial bundle never shadows the per-file path.
+bool CollectFiles(const Cid& dir, const std::string& prefix, const UnixFs::BlockLookup& lookup,
+                  BundleFiles& out, int depth) {
+    if (depth > kMaxDirectoryDepth) return false;
+
+    std::string block;
+    UnixFsNode node;
+    if (!lookup(dir, block) || !UnixFs::DecodeNode(dir, block, node)) return false;
+    if (node.type != UnixFsNode::Directory) return false;
+
+    for (const auto& link : node.links) {
+        if (link.name.empty() || link.name.find('/') != std::string::npos) return false;
+
+        UnixFsNode child;
+        if (!lookup(link.cid, block) || !UnixFs::DecodeNode(link.cid, block, child)) return false;
+
+        if (child.type == UnixFsNode::Directory) {
+            if (!CollectFiles(link.cid, prefix + link.name + "/", lookup, out, depth + 1)) return false;
+        } else if (child.type == UnixFsNode::File || child.type == UnixFsNode::Raw) {
+            std::string content;
+            if (!UnixFs::ReadFile(link.cid, lookup, content)) return false;
+            out.emplace_back(prefix + link.name, std::move(content));
+        } else if (child.type == UnixFsNode::HamtShard) {
+            return false;
+        }
+        // Symlinks and metadata nodes are left to the gateway
+    }
+    return true;
+}
+
+int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Maps a URL path ("/dir/", "/a%20b.css?v=1") to the entry name stored in
+// the archive ("dir/index.html", "a b.css")
+std::string BundleEntryName(const std::string& path) {
+    std::string base = path.substr(0, std::min(path.find('?'), path.find('#')));
+    std::string decoded;
+    for (size_t i = 0; i < base.size(); ++i) {
+        if (base[i] == '%' && i + 2 < base.size() && HexValue(base[i + 1]) >= 0 && HexValue(base[i + 2]) >= 0) {
+            decoded.push_back(static_cast<char>(HexValue(base[i + 1]) * 16 + HexValue(base[i + 2])));
+            i += 2;
+        } else {
+            decoded.push_back(base[i]);
+        }
+    }
+    if (decoded.empty() || decoded.back() == '/') decoded += "index.html";
+    if (decoded[0] == '/') decoded.erase(0, 1);
+    return decoded;
+}
+
+} // namespace
+
+SiteBundleManager& SiteBundleManager::Instance() {
+    static SiteBundleManager instance;
+    return instance;
+}
+
+SiteBundleManager::SiteBundleManager()
+    : builders_(kMaxBundleBuilds), cancel_(std::make_shared<CancellationToken>()) {
+}
+
+void SiteBundleManager::OnSiteResolved(const std::string& name, const std::string& cid) {
+    size_t max_bytes = static_cast<size_t>(SettingsManager::Instance().GetSettings().siteBundleMaxMB) * 1024 * 1024;
+    if (max_bytes == 0) return;
+
+    std::string zip_path = ContentStore::Instance().GetBundlePath(cid);
+    if (zip_path.empty()) return;
+
+    // Offline, a bundle already on disk is still worth loading; building one is not
+    std::error_code ec;
+    bool on_disk = std::filesystem::exists(zip_path, ec);
+    if (!on_disk && OfflineMode::Instance().IsOffline()) return;
+
+    std::string stale_cid;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (shutdown_) return;
+
+        auto it = sites_.find(name);
+        if (it != sites_.end()) {
+            if (it->second.cid == cid) return;
+            // The site was republished; its old bundle no longer applies
+            stale_cid = it->second.cid;
+        }
+        sites_[name] = SiteEntry{cid, BundleState::Building, nullptr};
+
+        for (const auto& site : sites_) {
+            if (site.second.cid == stale_cid) stale_cid.clear();
+        }
+    }
+
+    if (!stale_cid.empty()) {
+        std::filesystem::remove(ContentStore::Instance().GetBundlePath(stale_cid), ec);
+    }
+
+    // Bundles are keyed by root CID, so one from an earlier session is still valid
+    if (on_disk) {
+        FinishBundle(name, cid, zip_path, true);
+        return;
+    }
+
+    builders_.Post([this, name, cid, max_bytes]() { BuildBundle(name, cid, max_bytes); }, cancel_);
+}
+
+bool SiteBundleManager::HasBundle(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sites_.find(name);
+    return it != sites_.end() && it->second.state == BundleState::Ready;
+}
+
+bool SiteBundleManager::Lookup(const std::string& name, const std::string& cid, const std::string& path,
+                               std::string& out_content) const {
+    CefRefPtr<CefZipArchive> archive;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = sites_.find(name);
+        if (it == sites_.end() || it->second.cid != cid || !it->second.archive) return false;
+        archive = it->second.archive;
+    }
+
+    CefRefPtr<CefZipArchive::File> file = archive->GetFile(BundleEntryName(path));
+    if (!file) return false;
+    out_content.assign(reinterpret_cast<const char*>(file->GetData()), file->GetDataSize());
+    return true;
+}
+
+void SiteBundleManager::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutdown_ = true;
+        sites_.clear();
+    }
+    // Builds finish under mutex_, so they are drained outside it
+    builders_.Shutdown();
+}
+
+void SiteBundleManager::BuildBundle(const std::string& name, const std::string& cid, size_t max_bytes) {
+    std::string zip_path = ContentStore::Instance().GetBundlePath(cid);
+    Cid root;
+    if (zip_path.empty() || !Cid::Parse(cid, root) || !root.IsVerifiable()) {
+        FinishBundle(name, cid, zip_path, false);
+        return;
+    }
+
+    std::unordered_map<std::string, std::string> blocks; // CID bytes -> verified block
+    auto lookup = [&blocks](const Cid& block_cid, std::string& out_block) {
+        auto it = blocks.find(block_cid.Bytes());
+        if (it == blocks.end()) return false;
+        out_block = it->second;
+        return true;
+    };
+
+    BundleFiles files;
+    bool collected = false;
+    for (const auto& gw : SettingsManager::Instance().GetIPFSGateways()) {
+        if (cancel_->IsCancelled()) break;
+        CarReader reader([&blocks](const Cid& block_cid, std::string block) {
+            blocks.emplace(block_cid.Bytes(), std::move(block));
+        });
+
+        size_t received = 0;
+        bool too_large = false;
+
+        HttpRequest request;
+        request.url = gw + "/ipfs/" + cid + "?format=car&dag-scope=all";
+        request.trafficClass = TrafficClass::Prefetch;
+        request.cancel = cancel_;
+        request.headers.emplace_back("Accept", "application/vnd.ipld.car");
+        request.onResponse = [](const HttpResponse& response) { return response.status == 200; };
+        request.onData = [&](const char* data, size_t size) {
+            received += size;
+            if (received > max_bytes) {
+                too_large = true;
+                return false;
+            }
+            return reader.Feed(data, size);
+        };
+
+        HttpResponse response;
+        ResolverBridge::HttpGet(request, response);
+        if (too_large) break; // Large sites stay on per-file fetches
+
+        // Blocks from a truncated or corrupt stream are still verified, so
+        // another gateway only has to supply what is missing
+        files.clear();
+        if (CollectFiles(root, "", lookup, files, 0)) {
+            collected = true;
+            break;
+        }
+    }
+
+    bool written = false;
+    if (collected && !files.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(zip_path).parent_path(), ec);
+        std::string tmp_path = zip_path + ".tmp";
+        if (WriteStoredZip(tmp_path, files)) {
+            std::filesystem::rename(tmp_path, zip_path, ec);
+            written = !ec;
+        }
+        if (!written) std::filesystem::remove(tmp_path, ec);
+    }
+
+    FinishBundle(name, cid, zip_path, written);
+}
+
+void SiteBundleManager::FinishBundle(const std::string& name, const std::string& cid,
+                                     const std::string& zip_path, bool success) {
+    // Load outside the lock; requests the archive cannot answer fall through
+    // to the next provider tier
+    CefRefPtr<CefZipArchive> archive;
+    if (success) {
+        CefRefPtr<CefStreamReader> stream = CefStreamReader::CreateForFile(zip_path);
+        archive = new CefZipArchive();
+        if (!stream || archive->Load(stream, "", true) == 0) archive = nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sites_.find(name);
+    if (it == sites_.end() || it->second.cid != cid) return; // Republished meanwhile
+
+    it->second.state = archive ? BundleState::Ready : BundleState::Unavailable;
+    it->second.archive = archive;
+}
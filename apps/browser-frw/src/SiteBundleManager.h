@@ -0,0 +1,59 @@
+#pragma once
+
+#include "wrapper/cef_zip_archive.h"
+#include "WorkerPool.h"
+
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+
+class CancellationToken;
+
+// Prefetches a whole frw site (its root directory CID) as one verified CAR
+// stream after the first navigation, stores it as a zip next to the content
+// store and keeps it loaded in memory. The memory tier of FrwProviderChain
+// answers later asset requests from it; sites over the size cap, or that
+// cannot be walked, keep using per-file fetches.
+class SiteBundleManager {
+public:
+    static SiteBundleManager& Instance();
+
+    // Called once a site name resolves; builds the bundle on first sight of |cid|
+    void OnSiteResolved(const std::string& name, const std::string& cid);
+    bool HasBundle(const std::string& name) const;
+
+    // Copies |path| (as in the URL, "/" meaning index.html) out of the loaded
+    // bundle of |name|, if that bundle was built from |cid|
+    bool Lookup(const std::string& name, const std::string& cid, const std::string& path,
+                std::string& out_content) const;
+
+    // Drops the loaded archives and aborts the builds still running,
+    // waiting for them; call before CEF shuts down
+    void Shutdown();
+
+private:
+    SiteBundleManager();
+
+    enum class BundleState {
+        Building,
+        Ready,
+        Unavailable // Too large, unsupported layout or fetch failed
+    };
+
+    struct SiteEntry {
+        std::string cid;
+        BundleState state;
+        CefRefPtr<CefZipArchive> archive; // Set once Ready
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::string, SiteEntry> sites_; // frw name -> bundle for its current CID
+    bool shutdown_ = false;
+    WorkerPool builders_;
+    std::shared_ptr<CancellationToken> cancel_; // Set by Shutdown()
+
+    void BuildBundle(const std::string& name, const std::string& cid, size_t max_bytes);
+    void FinishBundle(const std::string& name, const std::string& cid, const std::string& zip_path,
+                      bool success);
+};
@@ -0,0 +1,260 @@
+#include "SuggestionIndex.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+// Subtrees with this many keys keep a cache; below half of it they drop
+// it again, so a subtree near the line does not keep building and dropping
+const size_t kCacheThreshold = 64;
+
+std::string ToLower(const std::string& value) {
+    std::string lower = value;
+    for (char& c : lower) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return lower;
+}
+
+size_t CommonPrefix(const std::string& label, const std::string& key, size_t pos) {
+    size_t length = std::min(label.size(), key.size() - pos);
+    size_t i = 0;
+    while (i < length && label[i] == key[pos + i]) ++i;
+    return i;
+}
+
+} // namespace
+
+SuggestionIndex::SuggestionIndex() : root_(std::make_unique<TrieNode>()) {}
+
+SuggestionIndex::~SuggestionIndex() = default;
+
+std::string SuggestionIndex::Normalize(const std::string& text) {
+    std::string key = ToLower(text);
+    size_t scheme = key.find("://");
+    if (scheme != std::string::npos && std::all_of(key.begin(), key.begin() + scheme, [](char c) {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == '+' || c == '-' || c == '.';
+        })) {
+        key.erase(0, scheme + 3);
+    }
+    if (key.compare(0, 4, "www.") == 0) {
+        key.erase(0, 4);
+    }
+    return key;
+}
+
+void SuggestionIndex::Update(const std::string& url, double score) {
+    auto inserted = items_.emplace(url, score);
+    Item* item = &*inserted.first;
+    if (inserted.second) {
+        Insert(Normalize(url), item);
+        return;
+    }
+
+    bool raised = score >= item->second;
+    item->second = score;
+    for (TrieNode* node = Descend(Normalize(url)); node; node = node->parent) {
+        if (!node->top) continue;
+        if (raised) {
+            Offer(node, item);
+        } else if (std::find(node->top->begin(), node->top->end(), item) != node->top->end()) {
+            // Something below may now beat it
+            RefreshCache(node);
+        }
+    }
+}
+
+void SuggestionIndex::Remove(const std::string& url) {
+    auto it = items_.find(url);
+    if (it == items_.end()) return;
+    Erase(Normalize(url), &*it);
+    items_.erase(it);
+}
+
+void SuggestionIndex::Clear() {
+    root_ = std::make_unique<TrieNode>();
+    items_.clear();
+}
+
+std::vector<std::string> SuggestionIndex::Lookup(const std::string& prefix, size_t count) const {
+    std::vector<std::string> urls;
+    TrieNode* node = Descend(Normalize(prefix));
+    if (!node || count == 0) return urls;
+
+    std::vector<Item*> best;
+    if (node->top && count <= kCachedResults) {
+        best.assign(node->top->begin(), node->top->begin() + std::min(count, node->top->size()));
+    } else {
+        // A small subtree, or more results than are cached
+        CollectAll(node, best);
+        KeepBest(best, count);
+    }
+    for (const Item* item : best) {
+        urls.push_back(item->first);
+    }
+    return urls;
+}
+
+void SuggestionIndex::Insert(const std::string& key, Item* item) {
+    TrieNode* node = root_.get();
+    size_t pos = 0;
+    while (pos < key.size()) {
+        TrieNode* child = FindChild(node, static_cast<unsigned char>(key[pos]));
+        if (!child) {
+            auto leaf = std::make_unique<TrieNode>();
+            leaf->label = key.substr(pos);
+            TrieNode* added = leaf.get();
+            AddChild(node, std::move(leaf));
+            node = added;
+            break;
+        }
+
+        size_t common = CommonPrefix(child->label, key, pos);
+        if (common < child->label.size()) {
+            // Split the edge; the new middle node covers the same keys
+            auto middle = std::make_unique<TrieNode>();
+            middle->label = child->label.substr(0, common);
+            middle->count = child->count;
+            if (child->top) middle->top = std::make_unique<std::vector<Item*>>(*child->top);
+            middle->parent = node;
+
+            auto& slot = *std::find_if(node->children.begin(), node->children.end(),
+                                       [child](const std::unique_ptr<TrieNode>& c) { return c.get() == child; });
+            std::unique_ptr<TrieNode> lower = std::move(slot);
+            lower->label.erase(0, common);
+            lower->parent = middle.get();
+            middle->children.push_back(std::move(lower));
+            slot = std::move(middle);
+            child = slot.get();
+        }
+        node = child;
+        pos += common;
+    }
+    node->items.push_back(item);
+
+    for (; node; node = node->parent) {
+        node->count++;
+        if (node->top) {
+            Offer(node, item);
+        } else if (node->count >= kCacheThreshold) {
+            RefreshCache(node);
+        }
+    }
+}
+
+void SuggestionIndex::Erase(const std::string& key, Item* item) {
+    TrieNode* node = Descend(key);
+    // Descend may stop inside an edge; the key itself ends at a node
+    if (!node) return;
+    auto it = std::find(node->items.begin(), node->items.end(), item);
+    if (it == node->items.end()) return;
+    node->items.erase(it);
+
+    for (TrieNode* up = node; up; up = up->parent) {
+        up->count--;
+        if (!up->top) continue;
+        if (up->count < kCacheThreshold / 2) {
+            up->top.reset();
+        } else if (std::find(up->top->begin(), up->top->end(), item) != up->top->end()) {
+            RefreshCache(up);
+        }
+    }
+    Prune(node);
+}
+
+SuggestionIndex::TrieNode* SuggestionIndex::Descend(const std::string& prefix) const {
+    TrieNode* node = root_.get();
+    size_t pos = 0;
+    while (pos < prefix.size()) {
+        TrieNode* child = FindChild(node, static_cast<unsigned char>(prefix[pos]));
+        if (!child) return nullptr;
+        size_t common = CommonPrefix(child->label, prefix, pos);
+        if (pos + common == prefix.size()) return child; // Ends on or inside this edge
+        if (common < child->label.size()) return nullptr;
+        node = child;
+        pos += common;
+    }
+    return node;
+}
+
+SuggestionIndex::TrieNode* SuggestionIndex::FindChild(const TrieNode* node, unsigned char first) const {
+    auto it = std::lower_bound(node->children.begin(), node->children.end(), first,
+                               [](const std::unique_ptr<TrieNode>& child, unsigned char value) {
+                                   return static_cast<unsigned char>(child->label[0]) < value;
+                               });
+    if (it == node->children.end() || static_cast<unsigned char>((*it)->label[0]) != first) return nullptr;
+    return it->get();
+}
+
+void SuggestionIndex::AddChild(TrieNode* node, std::unique_ptr<TrieNode> child) {
+    child->parent = node;
+    unsigned char first = static_cast<unsigned char>(child->label[0]);
+    auto it = std::lower_bound(node->children.begin(), node->children.end(), first,
+                               [](const std::unique_ptr<TrieNode>& existing, unsigned char value) {
+                                   return static_cast<unsigned char>(existing->label[0]) < value;
+                               });
+    node->children.insert(it, std::move(child));
+}
+
+void SuggestionIndex::Prune(TrieNode* node) {
+    while (node != root_.get() && node->items.empty() && node->children.size() <= 1) {
+        TrieNode* parent = node->parent;
+        auto& slot = *std::find_if(parent->children.begin(), parent->children.end(),
+                                   [node](const std::unique_ptr<TrieNode>& c) { return c.get() == node; });
+        if (node->children.empty()) {
+            parent->children.erase(parent->children.begin() + (&slot - parent->children.data()));
+            node = parent;
+            continue;
+        }
+        // One child left: it takes this node's place, label first
+        std::unique_ptr<TrieNode> only = std::move(node->children.front());
+        only->label = node->label + only->label;
+        only->parent = parent;
+        slot = std::move(only);
+        return;
+    }
+}
+
+void SuggestionIndex::Offer(TrieNode* node, Item* item) {
+    auto& top = *node->top;
+    auto it = std::find(top.begin(), top.end(), item);
+    if (it != top.end()) {
+        top.erase(it);
+    } else if (top.size() >= kCachedResults && !Better(item, top.back())) {
+        return;
+    }
+    top.insert(std::upper_bound(top.begin(), top.end(), item, Better), item);
+    if (top.size() > kCachedResults) top.pop_back();
+}
+
+void SuggestionIndex::RefreshCache(TrieNode* node) {
+    std::vector<Item*> candidates(node->items.begin(), node->items.end());
+    for (const auto& child : node->children) {
+        if (child->top) {
+            candidates.insert(candidates.end(), child->top->begin(), child->top->end());
+        } else {
+            CollectAll(child.get(), candidates);
+        }
+    }
+    KeepBest(candidates, kCachedResults);
+    node->top = std::make_unique<std::vector<Item*>>(std::move(candidates));
+}
+
+void SuggestionIndex::CollectAll(const TrieNode* node, std::vector<Item*>& out) const {
+    out.insert(out.end(), node->items.begin(), node->items.end());
+    for (const auto& child : node->children) {
+        CollectAll(child.get(), out);
+    }
+}
+
+void SuggestionIndex::KeepBest(std::vector<Item*>& items, size_t count) {
+    size_t keep = std::min(count, items.size());
+    std::partial_sort(items.begin(), items.begin() + keep, items.end(), Better);
+    items.resize(keep);
+}
+
+bool SuggestionIndex::Better(const Item* a, const Item* b) {
+    if (a->second != b->second) return a->second > b->second;
+    return a->first < b->first;
+}
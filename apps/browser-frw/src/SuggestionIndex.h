@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstddef>
+
+// Completes what has been typed into the address bar. URLs and typed text
+// alike are normalized (lowercased, without scheme or a leading "www."), so
+// "exa", "www.exa" and "https://exa" all find http://www.example.com/, and
+// frw://name/ is found by its name. The normalized URLs live in a radix
+// tree; any subtree holding enough of them keeps its best URLs by score and
+// updates them as scores change, so a lookup walks the typed prefix and
+// reads off the answer without visiting the rest of the history.
+class SuggestionIndex {
+public:
+    // Lookups of up to this many results are answered from the caches
+    static const size_t kCachedResults = 16;
+
+    SuggestionIndex();
+    ~SuggestionIndex();
+
+    SuggestionIndex(const SuggestionIndex&) = delete;
+    SuggestionIndex& operator=(const SuggestionIndex&) = delete;
+
+    // Adds |url| or changes its score; higher scores rank first
+    void Update(const std::string& url, double score);
+    void Remove(const std::string& url);
+    void Clear();
+    size_t Size() const { return items_.size(); }
+
+    // Up to |count| URLs whose normalized form starts with that of
+    // |prefix|, best first
+    std::vector<std::string> Lookup(const std::string& prefix, size_t count) const;
+
+    static std::string Normalize(const std::string& text);
+
+private:
+    // A URL and its score; nodes of items_ never move, so the tree points
+    // straight at them
+    using Item = std::pair<const std::string, double>;
+
+    // An edge of the radix tree and the node below it
+    struct TrieNode {
+        std::string label;
+        TrieNode* parent = nullptr;
+        std::vector<std::unique_ptr<TrieNode>> children; // By first byte of label
+        std::vector<Item*> items;                         // Keys that end here
+        size_t count = 0;                                 // Keys in the subtree
+        std::unique_ptr<std::vector<Item*>> top; // Best items of the subtree, if cached
+    };
+
+    std::unordered_map<std::string, double> items_; // Score by URL
+    std::unique_ptr<TrieNode> root_;
+
+    void Insert(const std::string& key, Item* item);
+    void Erase(const std::string& key, Item* item);
+    // The node where |prefix| ends, inside its edge or at its end
+    TrieNode* Descend(const std::string& prefix) const;
+    TrieNode* FindChild(const TrieNode* node, unsigned char first) const;
+    void AddChild(TrieNode* node, std::unique_ptr<TrieNode> child);
+    // Joins a node left without keys to its only child, or drops it
+    void Prune(TrieNode* node);
+
+    // Considers |item|, whose score went up or which was just added
+    void Offer(TrieNode* node, Item* item);
+    // Rebuilds the node's cache from its keys and its children's caches
+    void RefreshCache(TrieNode* node);
+    void CollectAll(const TrieNode* node, std::vector<Item*>& out) const;
+    // Sorts best first and keeps at most |count|
+    static void KeepBest(std::vector<Item*>& items, size_t count);
+    static bool Better(const Item* a, const Item* b);
+};
@@ -0,0 +1,41 @@
+#include "TransferStats.h"
+
+#include <sstream>
+#include <iomanip>
+
+TransferStats& TransferStats::Instance() {
+    static TransferStats instance;
+    return instance;
+}
+
+void TransferStats::Record(bool compressed, uint64_t wire_bytes, uint64_t decoded_bytes, uint64_t read_cycles) {
+    requests_++;
+    if (compressed) compressedResponses_++;
+    wireBytes_ += wire_bytes;
+    decodedBytes_ += decoded_bytes;
+    readCycles_ += read_cycles;
+}
+
+TransferStats::Snapshot TransferStats::GetSnapshot() const {
+    Snapshot snapshot;
+    snapshot.requests = requests_.load();
+    snapshot.compressedResponses = compressedResponses_.load();
+    snapshot.wireBytes = wireBytes_.load();
+    snapshot.decodedBytes = decodedBytes_.load();
+    snapshot.readCycles = readCycles_.load();
+    return snapshot;
+}
+
+std::string TransferStats::Summary() const {
+    Snapshot snapshot = GetSnapshot();
+    double saved = snapshot.decodedBytes > 0
+        ? 100.0 * (1.0 - static_cast<double>(snapshot.wireBytes) / static_cast<double>(snapshot.decodedBytes))
+        : 0.0;
+
+    std::ostringstream ss;
+    ss << snapshot.requests << " gateway requests (" << snapshot.compressedResponses << " compressed), "
+       << snapshot.wireBytes / 1024 << " KB on the wire for " << snapshot.decodedBytes / 1024 << " KB of content ("
+       << std::fixed << std::setprecision(1) << saved << "% saved), "
+       << snapshot.readCycles / 1000000 << " Mcycles receiving";
+    return ss.str();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+
+// Process-wide counters for gateway transfers, used to judge what compressed
+// transfer saves on the wire and what it costs in CPU
+class TransferStats {
+public:
+    struct Snapshot {
+        uint64_t requests;
+        uint64_t compressedResponses;
+        uint64_t wireBytes;     // Body bytes as received, before decoding
+        uint64_t decodedBytes;  // Body bytes handed to callers
+        uint64_t readCycles;    // CPU cycles spent receiving and decoding bodies
+    };
+
+    static TransferStats& Instance();
+
+    void Record(bool compressed, uint64_t wire_bytes, uint64_t decoded_bytes, uint64_t read_cycles);
+    Snapshot GetSnapshot() const;
+    std::string Summary() const;
+
+private:
+    TransferStats() = default;
+
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> compressedResponses_{0};
+    std::atomic<uint64_t> wireBytes_{0};
+    std::atomic<uint64_t> decodedBytes_{0};
+    std::atomic<uint64_t> readCycles_{0};
+};
@@ -0,0 +1,135 @@
+#include "TrigramIndex.h"
+
+#include <algorithm>
+
+namespace {
+
+// Dead ids tolerated before a compaction, beyond the live ones
+const size_t kCompactSlack = 4096;
+
+inline uint32_t FoldCase(unsigned char c) {
+    return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+} // namespace
+
+void TrigramIndex::Update(const std::string& key, const std::vector<std::string>& fields) {
+    std::vector<uint32_t> trigrams;
+    for (const auto& field : fields) {
+        Trigrams(field, trigrams);
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    auto inserted = ids_.emplace(key, 0);
+    if (!inserted.second) Kill(inserted.first->second);
+
+    // The newest id is the largest, so every list stays sorted
+    DocId id = static_cast<DocId>(docs_.size());
+    inserted.first->second = id;
+    docs_.push_back(&inserted.first->first);
+    for (uint32_t trigram : trigrams) {
+        postings_[trigram].push_back(id);
+    }
+
+    if (dead_ > ids_.size() + kCompactSlack) Compact();
+}
+
+void TrigramIndex::Remove(const std::string& key) {
+    auto it = ids_.find(key);
+    if (it == ids_.end()) return;
+    Kill(it->second);
+    ids_.erase(it);
+    if (dead_ > ids_.size() + kCompactSlack) Compact();
+}
+
+void TrigramIndex::Clear() {
+    ids_.clear();
+    docs_.clear();
+    postings_.clear();
+    dead_ = 0;
+}
+
+bool TrigramIndex::Candidates(const std::string& query, std::vector<const std::string*>& keys) const {
+    keys.clear();
+    std::vector<uint32_t> trigrams;
+    Trigrams(query, trigrams);
+    if (trigrams.empty()) return false;
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    std::vector<const std::vector<DocId>*> lists;
+    for (uint32_t trigram : trigrams) {
+        auto it = postings_.find(trigram);
+        if (it == postings_.end()) return true; // Nothing holds this one
+        lists.push_back(&it->second);
+    }
+    std::sort(lists.begin(), lists.end(),
+              [](const std::vector<DocId>* a, const std::vector<DocId>* b) { return a->size() < b->size(); });
+
+    // Start from the shortest list and look each survivor up in the longer
+    // ones, which only ever moves forward through them
+    std::vector<DocId> matches;
+    for (DocId id : *lists.front()) {
+        if (docs_[id]) matches.push_back(id);
+    }
+    for (size_t i = 1; i < lists.size() && !matches.empty(); ++i) {
+        const auto& list = *lists[i];
+        auto from = list.begin();
+        size_t kept = 0;
+        for (DocId id : matches) {
+            from = std::lower_bound(from, list.end(), id);
+            if (from == list.end()) break;
+            if (*from == id) matches[kept++] = id;
+        }
+        matches.resize(kept);
+    }
+
+    keys.reserve(matches.size());
+    for (DocId id : matches) {
+        keys.push_back(docs_[id]);
+    }
+    return true;
+}
+
+void TrigramIndex::Trigrams(const std::string& text, std::vector<uint32_t>& out) {
+    for (size_t i = 0; i + 3 <= text.size(); ++i) {
+        out.push_back(FoldCase(text[i]) << 16 | FoldCase(text[i + 1]) << 8 | FoldCase(text[i + 2]));
+    }
+}
+
+void TrigramIndex::Kill(DocId id) {
+    docs_[id] = nullptr;
+    dead_++;
+}
+
+void TrigramIndex::Compact() {
+    std::vector<DocId> renumbered(docs_.size());
+    std::vector<const std::string*> docs;
+    docs.reserve(ids_.size());
+    for (size_t id = 0; id < docs_.size(); ++id) {
+        if (!docs_[id]) continue;
+        renumbered[id] = static_cast<DocId>(docs.size());
+        docs.push_back(docs_[id]);
+    }
+
+    for (auto it = postings_.begin(); it != postings_.end();) {
+        auto& list = it->second;
+        size_t kept = 0;
+        for (DocId id : list) {
+            if (docs_[id]) list[kept++] = renumbered[id];
+        }
+        if (kept == 0) {
+            it = postings_.erase(it);
+            continue;
+        }
+        list.resize(kept);
+        list.shrink_to_fit();
+        ++it;
+    }
+    for (auto& entry : ids_) {
+        entry.second = renumbered[entry.second];
+    }
+    docs_ = std::move(docs);
+    dead_ = 0;
+}
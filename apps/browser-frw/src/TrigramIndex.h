@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+// Narrows a substring search down to the documents that could match. Each
+// document, keyed by a string such as its URL, is filed under every three
+// byte sequence (trigram) of its fields, ASCII case folded. A query can only
+// occur in documents holding all of its trigrams, so intersecting their
+// posting lists, shortest first, leaves a handful of candidates for the
+// caller to check against the real strings.
+//
+// Documents get ids in the order they are added and posting lists stay in
+// id order, so indexing a document only appends. A changed or removed
+// document is merely marked dead; the lists are compacted once the dead
+// outnumber the living.
+class TrigramIndex {
+public:
+    // Adds the document or replaces its fields
+    void Update(const std::string& key, const std::vector<std::string>& fields);
+    void Remove(const std::string& key);
+    void Clear();
+    size_t Size() const { return ids_.size(); }
+
+    // Keys of the documents holding every trigram of |query|, in the order
+    // they were last updated. False when the query is shorter than a
+    // trigram and narrows nothing down.
+    bool Candidates(const std::string& query, std::vector<const std::string*>& keys) const;
+
+private:
+    using DocId = uint32_t;
+
+    std::unordered_map<std::string, DocId> ids_;
+    std::vector<const std::string*> docs_; // Keys by id; null once dead
+    std::unordered_map<uint32_t, std::vector<DocId>> postings_;
+    size_t dead_ = 0;
+
+    static void Trigrams(const std::string& text, std::vector<uint32_t>& out);
+    void Kill(DocId id);
+    // Drops dead ids and renumbers the rest from zero, keeping their order
+    void Compact();
+};
@@ -0,0 +1,397 @@
+#include "TrustlessFetcher.h"
+#include "ResolverBridge.h"
+#include "CancellationToken.h"
+#include "Sha256.h"
+#include <future>
+#include <sstream>
+
+namespace {
+
+const size_t kMaxParallelBlocks = 16;
+const int kMaxDagDepth = 64;
+
+std::string PercentDecode(const std::string& text) {
+    std::string out;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '%' && i + 2 < text.size() && isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+            isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+            out.push_back(static_cast<char>(std::stoi(text.substr(i + 1, 2), nullptr, 16)));
+            i += 2;
+        } else {
+            out.push_back(text[i]);
+        }
+    }
+    return out;
+}
+
+size_t VarintSize(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+// UnixFS message of a leaf: Type, Data, filesize
+uint64_t LeafDataSize(uint64_t size) {
+    return 2 + 1 + VarintSize(size) + size + 1 + VarintSize(size);
+}
+
+// Size of the dag-pb block importers write for a leaf of |size| bytes
+uint64_t LeafBlockSize(uint64_t size) {
+    uint64_t data = LeafDataSize(size);
+    return 1 + VarintSize(data) + data;
+}
+
+// The bytes around the file data in that block:
+// PBNode { Data: UnixFS { Type: |type|, Data: <bytes>, filesize: |size| } }
+void LeafFraming(uint64_t size, int type, std::string& out_prefix, std::string& out_suffix) {
+    out_prefix.assign(1, '\x0a');
+    AppendVarint(out_prefix, LeafDataSize(size));
+    out_prefix.push_back('\x08');
+    AppendVarint(out_prefix, static_cast<uint64_t>(type));
+    out_prefix.push_back('\x12');
+    AppendVarint(out_prefix, size);
+    out_suffix.assign(1, '\x18');
+    AppendVarint(out_suffix, size);
+}
+
+std::vector<std::string> SplitPath(const std::string& path) {
+    std::vector<std::string> segments;
+    std::stringstream ss(path);
+    std::string segment;
+    while (std::getline(ss, segment, '/')) {
+        if (!segment.empty()) segments.push_back(PercentDecode(segment));
+    }
+    return segments;
+}
+
+} // namespace
+
+TrustlessFetcher::TrustlessFetcher(std::vector<std::string> gateways,
+                                   std::shared_ptr<CancellationToken> cancel,
+                                   TrafficClass traffic_class)
+    : gateways_(std::move(gateways)), nextGateway_(0), cancel_(std::move(cancel)),
+      trafficClass_(traffic_class) {
+}
+
+TrustlessResult TrustlessFetcher::Fetch(const std::string& root_cid, const std::string& path,
+                                        std::string& out_content) {
+    out_content.clear();
+
+    Cid root;
+    if (!Cid::Parse(root_cid, root) || !root.IsVerifiable()) return TrustlessResult::Unsupported;
+    if (gateways_.empty()) return TrustlessResult::Failed;
+
+    // One CAR stream usually carries every block we need; whatever it
+    // misses (or a gateway refuses to send) is filled in block by block
+    PrefetchCar(root, path);
+    if (IsCancelled()) return TrustlessResult::Failed;
+
+    Cid file;
+    TrustlessResult result = ResolvePath(root, path, file);
+    if (result != TrustlessResult::Ok) return result;
+
+    result = Assemble(file, out_content);
+    if (IsCancelled()) {
+        out_content.clear();
+        return TrustlessResult::Failed;
+    }
+    return result;
+}
+
+TrustlessResult TrustlessFetcher::MapFile(const std::string& root_cid, const std::string& path,
+                                          uint64_t file_size, std::vector<FileSpan>& out_spans) {
+    out_spans.clear();
+
+    Cid file;
+    if (!Cid::Parse(root_cid, file) || !file.IsVerifiable()) return TrustlessResult::Unsupported;
+    if (gateways_.empty()) return TrustlessResult::Failed;
+    if (!path.empty() && path != "/") {
+        Cid root = file;
+        TrustlessResult result = ResolvePath(root, path, file);
+        if (result != TrustlessResult::Ok) return result;
+    }
+
+    // A single raw block: the file bytes are the block
+    if (file.Codec() == Cid::kCodecRaw) {
+        if (file.HashCode() != Cid::kHashSha256) return TrustlessResult::Unsupported;
+        FileSpan span;
+        span.size = file_size;
+        span.digest = file.Digest();
+        out_spans.push_back(std::move(span));
+        return TrustlessResult::Ok;
+    }
+
+    // Spans in file order; inner nodes are expanded one level per pass, with
+    // each level's blocks fetched in parallel
+    struct Item {
+        FileSpan span;
+        bool inner;
+        Cid cid;
+    };
+    std::vector<Item> items;
+    items.push_back(Item{FileSpan(), true, file});
+    items.back().span.size = file_size;
+
+    Cid sample; // A predicted dag-pb leaf, fetched once to check the framing
+    uint64_t sample_size = 0;
+
+    for (int depth = 0;; ++depth) {
+        std::vector<Cid> inner;
+        for (const auto& item : items) {
+            if (!item.inner) continue;
+            if (!item.cid.IsVerifiable()) return TrustlessResult::Unsupported;
+            inner.push_back(item.cid);
+        }
+        if (inner.empty()) break;
+        if (depth > kMaxDagDepth) return TrustlessResult::Unsupported;
+        if (!FetchBlocks(inner)) return TrustlessResult::Failed;
+
+        std::vector<Item> next;
+        for (auto& item : items) {
+            if (!item.inner) {
+                next.push_back(std::move(item));
+                continue;
+            }
+
+            std::string block;
+            UnixFsNode node;
+            if (!GetBlock(item.cid, block) || !UnixFs::DecodeNode(item.cid, block, node)) {
+                return TrustlessResult::Unsupported;
+            }
+            if (node.type != UnixFsNode::File && node.type != UnixFsNode::Raw) return TrustlessResult::Unsupported;
+            if (node.blockSizes.size() != node.links.size()) return TrustlessResult::Unsupported;
+
+            uint64_t offset = item.span.offset;
+            // Bytes inside a fetched node are already verified
+            if (!node.data.empty()) {
+                Item known{FileSpan(), false, Cid()};
+                known.span.offset = offset;
+                known.span.size = node.data.size();
+                known.span.digest = Sha256::Hash(node.data.data(), node.data.size());
+                next.push_back(std::move(known));
+                offset += node.data.size();
+            }
+            for (size_t i = 0; i < node.links.size(); ++i) {
+                const DagPbLink& link = node.links[i];
+                uint64_t size = node.blockSizes[i];
+                if (size == 0) continue;
+                if (link.cid.HashCode() != Cid::kHashSha256) return TrustlessResult::Unsupported;
+
+                Item child{FileSpan(), false, Cid()};
+                child.span.offset = offset;
+                child.span.size = size;
+                offset += size;
+                if (link.cid.Codec() == Cid::kCodecRaw) {
+                    child.span.digest = link.cid.Digest();
+                } else if (link.size == LeafBlockSize(size)) {
+                    // Sized exactly like a leaf: check it without fetching
+                    LeafFraming(size, UnixFsNode::File, child.span.prefix, child.span.suffix);
+                    child.span.digest = link.cid.Digest();
+                    if (sample_size == 0) {
+                        sample = link.cid;
+                        sample_size = size;
+                    }
+                } else {
+                    child.inner = true;
+                    child.cid = link.cid;
+                }
+                next.push_back(std::move(child));
+            }
+            // The sizes a parent records must add up to what it covers
+            if (offset != item.span.offset + item.span.size) return TrustlessResult::Unsupported;
+        }
+        items = std::move(next);
+    }
+
+    // Importers differ in the UnixFS type they give leaves; one real block
+    // tells which framing this file uses
+    if (sample_size > 0) {
+        std::string block;
+        if (!FetchBlock(sample, block)) return TrustlessResult::Failed;
+        int leaf_type = -1;
+        for (int type : {static_cast<int>(UnixFsNode::File), static_cast<int>(UnixFsNode::Raw)}) {
+            std::string prefix, suffix;
+            LeafFraming(sample_size, type, prefix, suffix);
+            if (block.size() == prefix.size() + sample_size + suffix.size() &&
+                block.compare(0, prefix.size(), prefix) == 0 &&
+                block.compare(block.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                leaf_type = type;
+                break;
+            }
+        }
+        if (leaf_type < 0) return TrustlessResult::Unsupported;
+        if (leaf_type != UnixFsNode::File) {
+            for (auto& item : items) {
+                if (!item.span.prefix.empty()) {
+                    LeafFraming(item.span.size, leaf_type, item.span.prefix, item.span.suffix);
+                }
+            }
+        }
+    }
+
+    for (auto& item : items) {
+        out_spans.push_back(std::move(item.span));
+    }
+    return IsCancelled() ? TrustlessResult::Failed : TrustlessResult::Ok;
+}
+
+size_t TrustlessFetcher::BlocksVerified() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return blocks_.size();
+}
+
+void TrustlessFetcher::PrefetchCar(const Cid& root, const std::string& path) {
+    CarReader reader([this](const Cid& cid, std::string block) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        blocks_.emplace(cid.Bytes(), std::move(block));
+    });
+
+    HttpRequest request;
+    request.url = gateways_[nextGateway_++ % gateways_.size()] + "/ipfs/" + root.ToString() + path +
+                  "?format=car&dag-scope=entity";
+    request.headers.emplace_back("Accept", "application/vnd.ipld.car");
+    request.cancel = cancel_;
+    request.trafficClass = trafficClass_;
+    request.onResponse = [](const HttpResponse& response) { return response.status == 200; };
+    // Stop at the first block that fails verification; earlier ones stay valid
+    request.onData = [&reader](const char* data, size_t size) { return reader.Feed(data, size); };
+
+    HttpResponse response;
+    ResolverBridge::HttpGet(request, response);
+}
+
+bool TrustlessFetcher::FetchBlock(const Cid& cid, std::string& out_block) {
+    if (GetBlock(cid, out_block)) return true;
+    if (!cid.IsVerifiable()) return false;
+
+    // Rotate the starting gateway so parallel fetches spread across all of them
+    size_t start = nextGateway_++;
+    for (size_t i = 0; i < gateways_.size() && !IsCancelled(); ++i) {
+        HttpRequest request;
+        request.url = gateways_[(start + i) % gateways_.size()] + "/ipfs/" + cid.ToString() + "?format=raw";
+        request.headers.emplace_back("Accept", "application/vnd.ipld.raw");
+        request.cancel = cancel_;
+        request.trafficClass = trafficClass_;
+
+        HttpResponse response;
+        if (!ResolverBridge::HttpGet(request, response) || response.status != 200) continue;
+        if (!cid.Verify(response.body)) continue; // Wrong bytes: try the next gateway
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        out_block = response.body;
+        blocks_.emplace(cid.Bytes(), std::move(response.body));
+        return true;
+    }
+    return false;
+}
+
+bool TrustlessFetcher::FetchBlocks(const std::vector<Cid>& cids) {
+    std::vector<Cid> missing;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& cid : cids) {
+            if (!blocks_.count(cid.Bytes())) missing.push_back(cid);
+        }
+    }
+
+    for (size_t i = 0; i < missing.size(); i += kMaxParallelBlocks) {
+        if (IsCancelled()) return false;
+        std::vector<std::future<bool>> wave;
+        for (size_t j = i; j < missing.size() && j < i + kMaxParallelBlocks; ++j) {
+            wave.push_back(std::async(std::launch::async, [this, &missing, j]() {
+                std::string block;
+                return FetchBlock(missing[j], block);
+            }));
+        }
+
+        bool all_ok = true;
+        for (auto& result : wave) {
+            all_ok = result.get() && all_ok;
+        }
+        if (!all_ok) return false;
+    }
+    return true;
+}
+
+bool TrustlessFetcher::IsCancelled() const {
+    return cancel_ && cancel_->IsCancelled();
+}
+
+bool TrustlessFetcher::GetBlock(const Cid& cid, std::string& out_block) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = blocks_.find(cid.Bytes());
+    if (it == blocks_.end()) return false;
+    out_block = it->second;
+    return true;
+}
+
+TrustlessResult TrustlessFetcher::ResolvePath(const Cid& root, const std::string& path, Cid& out_file) {
+    std::vector<std::string> segments = SplitPath(path);
+    Cid current = root;
+
+    for (size_t i = 0; i <= segments.size(); ++i) {
+        std::string block;
+        UnixFsNode node;
+        if (!FetchBlock(current, block)) return TrustlessResult::Failed;
+        if (!UnixFs::DecodeNode(current, block, node)) return TrustlessResult::Unsupported;
+
+        if (node.type == UnixFsNode::HamtShard) return TrustlessResult::Unsupported;
+        if (node.type != UnixFsNode::Directory) {
+            if (i < segments.size()) return TrustlessResult::Failed; // Path continues below a file
+            out_file = current;
+            return TrustlessResult::Ok;
+        }
+
+        // Directories resolve to their index page, like gateways do
+        std::string name = i < segments.size() ? segments[i] : "index.html";
+        bool found = false;
+        for (const auto& link : node.links) {
+            if (link.name == name) {
+                current = link.cid;
+                found = true;
+                break;
+            }
+        }
+        if (!found) return TrustlessResult::Failed;
+        if (i == segments.size()) {
+            out_file = current;
+            return TrustlessResult::Ok;
+        }
+    }
+    return TrustlessResult::Failed;
+}
+
+TrustlessResult TrustlessFetcher::Assemble(const Cid& file, std::string& out_content) {
+    // Walk the file DAG one level at a time, fetching each level's missing
+    // blocks in parallel, then concatenate the leaves in link order
+    std::vector<Cid> level = {file};
+    for (int depth = 0; !level.empty(); ++depth) {
+        if (depth > kMaxDagDepth) return TrustlessResult::Unsupported;
+        for (const auto& cid : level) {
+            if (!cid.IsVerifiable()) return TrustlessResult::Unsupported;
+        }
+        if (!FetchBlocks(level)) return TrustlessResult::Failed;
+
+        std::vector<Cid> next;
+        for (const auto& cid : level) {
+            std::string block;
+            UnixFsNode node;
+            if (!GetBlock(cid, block) || !UnixFs::DecodeNode(cid, block, node)) {
+                return TrustlessResult::Unsupported;
+            }
+            if (node.type != UnixFsNode::File && node.type != UnixFsNode::Raw) {
+                return TrustlessResult::Unsupported;
+            }
+            for (const auto& link : node.links) {
+                next.push_back(link.cid);
+            }
+        }
+        level = std::move(next);
+    }
+
+    auto lookup = [this](const Cid& cid, std::string& block) { return GetBlock(cid, block); };
+    return UnixFs::ReadFile(file, lookup, out_content) ? TrustlessResult::Ok : TrustlessResult::Failed;
+}
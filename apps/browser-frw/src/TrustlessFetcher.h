@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Cid.h"
+#include "UnixFs.h"
+#include "BandwidthScheduler.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+
+class CancellationToken;
+
+enum class TrustlessResult {
+    Ok,
+    Unsupported, // The DAG uses features we cannot verify or walk (e.g. HAMT directories)
+    Failed       // Content missing, or no gateway returned verifiable blocks
+};
+
+// A run of file bytes and how to check them as they stream in, without the
+// block that holds them: SHA-256 over prefix + bytes + suffix is |digest|
+struct FileSpan {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    std::string prefix;
+    std::string suffix;
+    std::string digest;
+};
+
+// Retrieves UnixFS files without trusting any gateway. A CAR stream for the
+// path is requested first and every block in it is hashed as it arrives; any
+// blocks still missing are then fetched as raw blocks, in parallel, spread
+// over all gateways. The file is assembled locally from verified blocks only.
+class TrustlessFetcher {
+public:
+    // Cancelling |cancel| aborts the transfers and makes Fetch return Failed
+    explicit TrustlessFetcher(std::vector<std::string> gateways,
+                              std::shared_ptr<CancellationToken> cancel = nullptr,
+                              TrafficClass traffic_class = TrafficClass::PageAsset);
+
+    TrustlessResult Fetch(const std::string& root_cid, const std::string& path, std::string& out_content);
+    // Splits the |file_size| bytes at |path| into spans that tile the file,
+    // fetching only the inner nodes of its DAG. Raw leaves are checked
+    // against their CID directly, dag-pb leaves by rebuilding their block
+    // around the bytes, so the file itself can come from a plain gateway GET.
+    TrustlessResult MapFile(const std::string& root_cid, const std::string& path, uint64_t file_size,
+                            std::vector<FileSpan>& out_spans);
+    size_t BlocksVerified() const;
+
+private:
+    std::vector<std::string> gateways_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::string> blocks_; // CID bytes -> verified block
+    std::atomic<size_t> nextGateway_;
+    std::shared_ptr<CancellationToken> cancel_;
+    TrafficClass trafficClass_;
+
+    void PrefetchCar(const Cid& root, const std::string& path);
+    bool FetchBlock(const Cid& cid, std::string& out_block);
+    bool FetchBlocks(const std::vector<Cid>& cids);
+    bool GetBlock(const Cid& cid, std::string& out_block) const;
+    bool IsCancelled() const;
+
+    TrustlessResult ResolvePath(const Cid& root, const std::string& path, Cid& out_file);
+    TrustlessResult Assemble(const Cid& file, std::string& out_content);
+};
@@ -2,6 +2,7 @@
 #include "TabManager.h"
 #include "HistoryManager.h"
 #include "SettingsManager.h"
+#include "ContentStore.h"
 #include "cef_browser.h"
 #include "cef_client.h"
 #include "cef_frame.h"
@@ -256,6 +257,8 @@ void ContextMenuManager::OnAddToBookmarks() {
     auto& tabManager = TabManager::Instance();
     Tab* activeTab = tabManager.GetActiveTab();
     if (activeTab) {
+        // Pin bookmarked frw sites so their content is never evicted
+        ContentStore::Instance().PinSiteForUrl(activeTab->url);
         // TODO: Show bookmark dialog
     }
 }
@@ -1,5 +1,7 @@
 #include "DownloadManager.h"
-#include "../Utils.h"
+#include "SettingsManager.h"
+#include "../DownloadTask.h"
+#include "../BandwidthScheduler.h"
 #include <algorithm>
 #include <filesystem>
 #include <sstream>
@@ -7,124 +9,289 @@
 #include <iomanip>
 #include <locale>
 #include <codecvt>
+#include <thread>
 
 #ifdef _WIN32
+#include "../Utils.h"
 #include <windows.h>
 #include <shlobj.h>
 #endif
 
+namespace {
+
+// How long Shutdown() lets cancelled transfers write their last checkpoint
+const std::chrono::seconds kShutdownWait(2);
+
+int64_t ToMilliseconds(std::chrono::system_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point FromMilliseconds(int64_t milliseconds) {
+    return std::chrono::system_clock::time_point(std::chrono::milliseconds(milliseconds));
+}
+
+} // namespace
+
+DownloadEntry::DownloadEntry(int id, std::string url, std::string filename, std::string savePath,
+                             std::shared_ptr<DownloadTask> task)
+    : id(id), url(std::move(url)), filename(std::move(filename)), savePath(std::move(savePath)),
+      task(std::move(task)), status_(std::make_shared<DownloadStatus>()) {}
+
+std::shared_ptr<const DownloadStatus> DownloadEntry::Status() const {
+    return std::atomic_load(&status_);
+}
+
+void DownloadEntry::Publish(std::shared_ptr<const DownloadStatus> status) {
+    std::atomic_store(&status_, std::move(status));
+}
+
+Download DownloadEntry::Snapshot() const {
+    return Snapshot(*Status());
+}
+
+Download DownloadEntry::Snapshot(const DownloadStatus& status) const {
+    Download download;
+    download.id = id;
+    download.url = url;
+    download.filename = filename;
+    download.savePath = savePath;
+    download.state = status.state;
+    download.startTime = status.startTime;
+    download.endTime = status.endTime;
+    download.speedLimit = status.speedLimit;
+    download.errorMessage = status.errorMessage;
+    download.totalSize = status.totalSize;
+    download.receivedSize = status.receivedSize;
+    download.speed = 0.0;
+    download.verified = false;
+    if (task) {
+        int64_t total = task->TotalSize();
+        download.totalSize = total > 0 ? total : 0;
+        download.receivedSize = task->ReceivedSize();
+        download.verified = task->IsVerified();
+        if (status.state == DownloadState::InProgress) download.speed = task->Speed();
+    }
+    return download;
+}
+
+DownloadManager::DownloadManager()
+    : registry_(std::make_shared<Registry>()), epoch_(0), nextDownloadId_(1), shuttingDown_(false) {}
+
 DownloadManager& DownloadManager::Instance() {
     static DownloadManager instance;
     return instance;
 }
 
+void DownloadManager::LoadDownloads() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<DownloadRecord> records;
+    if (!journal_.Open(GetJournalFilePath(), records)) return;
+
+    // Published once, after every entry is in
+    auto registry = std::make_shared<Registry>(*LoadRegistry());
+    std::vector<std::shared_ptr<DownloadEntry>> resume;
+    for (auto& record : records) {
+        auto status = std::make_shared<DownloadStatus>();
+        bool known = record.state >= static_cast<int>(DownloadState::Pending) &&
+                     record.state <= static_cast<int>(DownloadState::Cancelled);
+        status->state = known ? static_cast<DownloadState>(record.state) : DownloadState::Failed;
+        status->startTime = FromMilliseconds(record.startTime);
+        status->endTime = FromMilliseconds(record.endTime);
+        status->speedLimit = record.speedLimit;
+        status->errorMessage = record.errorMessage;
+        status->totalSize = std::max<int64_t>(record.checkpoint.total, 0);
+        status->receivedSize = status->state == DownloadState::Completed ? status->totalSize : 0;
+        status->epoch = epoch_.load();
+        nextDownloadId_ = std::max(nextDownloadId_, record.id + 1);
+
+        // Failed and cancelled downloads keep their progress for a retry
+        std::shared_ptr<DownloadTask> task;
+        if (status->state != DownloadState::Completed) {
+            task = CreateTask(record.id, record.url, record.savePath, record.speedLimit);
+            task->Restore(record.checkpoint);
+        }
+        auto entry = std::make_shared<DownloadEntry>(record.id, record.url, record.filename, record.savePath, task);
+        entry->Publish(std::move(status));
+        if (entry->Status()->state == DownloadState::Pending || entry->Status()->state == DownloadState::InProgress) {
+            resume.push_back(entry);
+        }
+        registry->byId[entry->id] = entry;
+        registry->entries.push_back(std::move(entry));
+    }
+    epoch_++;
+    PublishRegistry(std::move(registry));
+
+    for (const auto& entry : resume) {
+        Launch(*entry);
+    }
+}
+
+void DownloadManager::Shutdown() {
+    std::vector<std::shared_ptr<DownloadTask>> running;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shuttingDown_ = true;
+        for (const auto& entry : LoadRegistry()->entries) {
+            if (!entry->task) continue;
+            entry->task->Cancel();
+            running.push_back(entry->task);
+        }
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + kShutdownWait;
+    for (const auto& task : running) {
+        while (task->IsRunning() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    journal_.Close();
+}
+
 int DownloadManager::StartDownload(const std::string& url, const std::string& suggestedFilename) {
-    auto download = std::make_unique<Download>();
-    download->id = nextDownloadId_++;
-    download->url = url;
-    download->filename = GenerateFilename(url, suggestedFilename);
-    download->savePath = GetDefaultDownloadDirectory() + "/" + download->filename;
-    download->totalSize = 0;
-    download->receivedSize = 0;
-    download->state = DownloadState::Pending;
-    download->startTime = std::chrono::system_clock::now();
-    download->speed = 0.0;
-    
-    // TODO: Start actual download using CEF or HTTP client
-    // For now, simulate download
-    download->state = DownloadState::InProgress;
-    
-    int downloadId = download->id;
-    downloads_.push_back(std::move(download));
-    
+    std::lock_guard<std::mutex> lock(mutex_);
+    int downloadId = nextDownloadId_++;
+    std::string savePath = MakeUniquePath(GetDefaultDownloadPath(), GenerateFilename(url, suggestedFilename));
+    std::string filename = std::filesystem::path(savePath).filename().string();
+    int64_t speedLimit = static_cast<int64_t>(SettingsManager::Instance().GetSettings().downloadLimitKBps) * 1024;
+
+    auto entry = std::make_shared<DownloadEntry>(downloadId, url, filename, savePath,
+                                                 CreateTask(downloadId, url, savePath, speedLimit));
+    auto status = std::make_shared<DownloadStatus>();
+    status->state = DownloadState::Pending;
+    status->startTime = std::chrono::system_clock::now();
+    status->speedLimit = speedLimit;
+    status->epoch = epoch_.load();
+    entry->Publish(status);
+
+    DownloadRecord record;
+    record.id = downloadId;
+    record.url = url;
+    record.filename = filename;
+    record.savePath = savePath;
+    record.speedLimit = speedLimit;
+    record.state = static_cast<int>(status->state);
+    record.startTime = ToMilliseconds(status->startTime);
+    journal_.Add(record);
+
+    AddEntry(entry);
+    Launch(*entry);
     return downloadId;
 }
 
 void DownloadManager::CancelDownload(int downloadId) {
-    Download* download = FindDownload(downloadId);
-    if (download && (download->state == DownloadState::Pending || download->state == DownloadState::InProgress)) {
-        download->state = DownloadState::Cancelled;
-        download->endTime = std::chrono::system_clock::now();
-        // TODO: Cancel actual download
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry = FindEntry(downloadId);
+    if (!entry) return;
+    DownloadState state = entry->Status()->state;
+    if (state == DownloadState::Pending || state == DownloadState::InProgress) {
+        UpdateStatus(*entry, [](DownloadStatus& status) {
+            status.state = DownloadState::Cancelled;
+            status.endTime = std::chrono::system_clock::now();
+        });
+        SaveState(*entry);
+        // The partial file stays, so a retry resumes
+        if (entry->task) entry->task->Cancel();
     }
 }
 
 void DownloadManager::RetryDownload(int downloadId) {
-    Download* download = FindDownload(downloadId);
-    if (download && (download->state == DownloadState::Failed || download->state == DownloadState::Cancelled)) {
-        // Reset download state
-        download->receivedSize = 0;
-        download->state = DownloadState::Pending;
-        download->startTime = std::chrono::system_clock::now();
-        download->speed = 0.0;
-        download->errorMessage.clear();
-        // TODO: Restart download
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry = FindEntry(downloadId);
+    if (!entry || !entry->task) return;
+    DownloadState state = entry->Status()->state;
+    if (state == DownloadState::Failed || state == DownloadState::Cancelled) {
+        // Resume from the bytes already on disk
+        UpdateStatus(*entry, [](DownloadStatus& status) {
+            status.state = DownloadState::Pending;
+            status.startTime = std::chrono::system_clock::now();
+            status.errorMessage.clear();
+        });
+        Launch(*entry);
     }
 }
 
 void DownloadManager::RemoveDownload(int downloadId) {
-    downloads_.erase(std::remove_if(downloads_.begin(), downloads_.end(),
-                                   [downloadId](const auto& d) { return d->id == downloadId; }),
-                    downloads_.end());
+    std::lock_guard<std::mutex> lock(mutex_);
+    RemoveEntries([downloadId](const DownloadEntry& entry) { return entry.id == downloadId; });
 }
 
 void DownloadManager::ClearCompleted() {
-    downloads_.erase(std::remove_if(downloads_.begin(), downloads_.end(),
-                                   [](const auto& d) { 
-                                       return d->state == DownloadState::Completed || 
-                                              d->state == DownloadState::Failed || 
-                                              d->state == DownloadState::Cancelled; 
-                                   }),
-                    downloads_.end());
+    std::lock_guard<std::mutex> lock(mutex_);
+    RemoveEntries([](const DownloadEntry& entry) {
+        DownloadState state = entry.Status()->state;
+        return state == DownloadState::Completed || state == DownloadState::Failed ||
+               state == DownloadState::Cancelled;
+    });
 }
 
 void DownloadManager::ClearAll() {
-    // Cancel all active downloads first
-    for (auto& download : downloads_) {
-        if (download->state == DownloadState::Pending || download->state == DownloadState::InProgress) {
-            download->state = DownloadState::Cancelled;
-            download->endTime = std::chrono::system_clock::now();
-        }
-    }
-    downloads_.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    RemoveEntries([](const DownloadEntry&) { return true; });
+}
+
+void DownloadManager::SetDownloadSpeedLimit(int downloadId, int64_t bytesPerSecond) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry = FindEntry(downloadId);
+    if (!entry) return;
+    int64_t speedLimit = std::max<int64_t>(bytesPerSecond, 0);
+    UpdateStatus(*entry, [speedLimit](DownloadStatus& status) { status.speedLimit = speedLimit; });
+    journal_.SetSpeedLimit(downloadId, speedLimit);
+    if (entry->task) entry->task->SetSpeedLimit(speedLimit);
 }
 
-Download* DownloadManager::GetDownload(int downloadId) {
-    return FindDownload(downloadId);
+bool DownloadManager::GetDownload(int downloadId, Download& download) const {
+    auto entry = FindEntry(downloadId);
+    if (!entry) return false;
+    download = entry->Snapshot();
+    return true;
 }
 
-std::vector<Download*> DownloadManager::GetAllDownloads() {
-    std::vector<Download*> result;
-    for (const auto& download : downloads_) {
-        result.push_back(download.get());
+std::vector<Download> DownloadManager::GetAllDownloads() const {
+    std::vector<Download> result;
+    for (const auto& entry : LoadRegistry()->entries) {
+        result.push_back(entry->Snapshot());
     }
     return result;
 }
 
-std::vector<Download*> DownloadManager::GetActiveDownloads() {
-    std::vector<Download*> result;
-    for (const auto& download : downloads_) {
-        if (download->state == DownloadState::Pending || download->state == DownloadState::InProgress) {
-            result.push_back(download.get());
+std::vector<Download> DownloadManager::GetActiveDownloads() const {
+    std::vector<Download> result;
+    for (const auto& entry : LoadRegistry()->entries) {
+        DownloadState state = entry->Status()->state;
+        if (state == DownloadState::Pending || state == DownloadState::InProgress) {
+            result.push_back(entry->Snapshot());
         }
     }
     return result;
 }
 
-std::vector<Download*> DownloadManager::GetCompletedDownloads() {
-    std::vector<Download*> result;
-    for (const auto& download : downloads_) {
-        if (download->state == DownloadState::Completed) {
-            result.push_back(download.get());
+std::vector<Download> DownloadManager::GetCompletedDownloads() const {
+    std::vector<Download> result;
+    for (const auto& entry : LoadRegistry()->entries) {
+        if (entry->Status()->state == DownloadState::Completed) {
+            result.push_back(entry->Snapshot());
         }
     }
     return result;
 }
 
+DownloadSnapshot DownloadManager::GetSnapshot() const {
+    // One generation carries every entry's status as of its epoch, so no
+    // download shows a state from before or after the others'
+    auto registry = LoadRegistry();
+    DownloadSnapshot snapshot;
+    snapshot.epoch = registry->epoch;
+    for (size_t i = 0; i < registry->entries.size(); ++i) {
+        snapshot.downloads.push_back(registry->entries[i]->Snapshot(*registry->statuses[i]));
+    }
+    return snapshot;
+}
+
 int DownloadManager::GetActiveDownloadCount() const {
     int count = 0;
-    for (const auto& download : downloads_) {
-        if (download->state == DownloadState::Pending || download->state == DownloadState::InProgress) {
+    for (const auto& entry : LoadRegistry()->entries) {
+        DownloadState state = entry->Status()->state;
+        if (state == DownloadState::Pending || state == DownloadState::InProgress) {
             count++;
         }
     }
@@ -133,25 +300,20 @@ int DownloadManager::GetActiveDownloadCount() const {
 
 int64_t DownloadManager::GetTotalDownloadSize() const {
     int64_t total = 0;
-    for (const auto& download : downloads_) {
-        if (download->state == DownloadState::Completed) {
-            total += download->totalSize;
+    for (const auto& entry : LoadRegistry()->entries) {
+        if (entry->Status()->state == DownloadState::Completed) {
+            total += entry->Snapshot().totalSize;
         }
     }
     return total;
 }
 
 double DownloadManager::GetCurrentDownloadSpeed() const {
-    double totalSpeed = 0.0;
-    for (const auto& download : downloads_) {
-        if (download->state == DownloadState::InProgress) {
-            totalSpeed += download->speed;
-        }
-    }
-    return totalSpeed;
+    return BandwidthScheduler::Instance().Rate(TrafficClass::Download);
 }
 
 void DownloadManager::SetDefaultDownloadPath(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
     defaultDownloadPath_ = path;
 }
 
@@ -159,10 +321,149 @@ std::string DownloadManager::GetDefaultDownloadPath() const {
     return defaultDownloadPath_.empty() ? GetDefaultDownloadDirectory() : defaultDownloadPath_;
 }
 
-Download* DownloadManager::FindDownload(int downloadId) {
-    auto it = std::find_if(downloads_.begin(), downloads_.end(),
-                          [downloadId](const auto& d) { return d->id == downloadId; });
-    return (it != downloads_.end()) ? it->get() : nullptr;
+std::shared_ptr<const DownloadManager::Registry> DownloadManager::LoadRegistry() const {
+    return std::atomic_load(&registry_);
+}
+
+std::shared_ptr<DownloadEntry> DownloadManager::FindEntry(int downloadId) const {
+    auto registry = LoadRegistry();
+    auto it = registry->byId.find(downloadId);
+    return it != registry->byId.end() ? it->second : nullptr;
+}
+
+void DownloadManager::AddEntry(std::shared_ptr<DownloadEntry> entry) {
+    // Readers still holding the old registry keep it alive until they finish
+    auto registry = std::make_shared<Registry>(*LoadRegistry());
+    registry->byId[entry->id] = entry;
+    registry->entries.push_back(std::move(entry));
+    epoch_++;
+    PublishRegistry(std::move(registry));
+}
+
+void DownloadManager::PublishRegistry(std::shared_ptr<Registry> registry) {
+    registry->statuses.clear();
+    for (const auto& entry : registry->entries) {
+        registry->statuses.push_back(entry->Status());
+    }
+    registry->epoch = epoch_.load();
+    std::atomic_store(&registry_, std::shared_ptr<const Registry>(std::move(registry)));
+}
+
+template <typename Predicate>
+void DownloadManager::RemoveEntries(Predicate remove) {
+    auto registry = std::make_shared<Registry>();
+    bool removed = false;
+    for (const auto& entry : LoadRegistry()->entries) {
+        if (!remove(*entry)) {
+            registry->byId[entry->id] = entry;
+            registry->entries.push_back(entry);
+            continue;
+        }
+        removed = true;
+        // Cancel active downloads first; only completed files are kept
+        DownloadState state = entry->Status()->state;
+        if (state == DownloadState::Pending || state == DownloadState::InProgress) {
+            UpdateStatus(*entry, [](DownloadStatus& status) {
+                status.state = DownloadState::Cancelled;
+                status.endTime = std::chrono::system_clock::now();
+            });
+        }
+        DropTask(*entry, entry->Status()->state == DownloadState::Completed);
+        journal_.Remove(entry->id);
+    }
+    if (!removed) return;
+    epoch_++;
+    PublishRegistry(std::move(registry));
+}
+
+template <typename Change>
+void DownloadManager::UpdateStatus(DownloadEntry& entry, Change change) {
+    auto status = std::make_shared<DownloadStatus>(*entry.Status());
+    change(*status);
+    status->epoch = ++epoch_;
+    entry.Publish(std::move(status));
+    // Status changes are rare next to progress, so copying the registry for
+    // each keeps snapshots consistent at little cost
+    PublishRegistry(std::make_shared<Registry>(*LoadRegistry()));
+}
+
+std::shared_ptr<DownloadTask> DownloadManager::CreateTask(int downloadId, const std::string& url,
+                                                          const std::string& savePath, int64_t speedLimit) {
+    int segments = SettingsManager::Instance().GetSettings().downloadSegments;
+    auto task = std::make_shared<DownloadTask>(url, savePath, segments);
+    task->SetSpeedLimit(speedLimit);
+    // Comes from transfer threads; the journal has its own lock
+    task->SetCheckpointCallback([this, downloadId](const DownloadCheckpoint& checkpoint) {
+        journal_.SetCheckpoint(downloadId, checkpoint);
+    });
+    return task;
+}
+
+void DownloadManager::SaveState(const DownloadEntry& entry) {
+    auto status = entry.Status();
+    journal_.SetState(entry.id, static_cast<int>(status->state), ToMilliseconds(status->startTime),
+                      ToMilliseconds(status->endTime), status->errorMessage);
+}
+
+void DownloadManager::Launch(DownloadEntry& entry) {
+    if (!entry.task || shuttingDown_) return;
+
+    UpdateStatus(entry, [](DownloadStatus& status) { status.state = DownloadState::InProgress; });
+    SaveState(entry);
+    if (entry.task->IsRunning()) {
+        relaunch_.insert(entry.id);
+        return;
+    }
+    // A transfer stops running just before it reports; a retry in between
+    // starts a new run, and the old one's report must then be ignored
+    int downloadId = entry.id;
+    uint64_t launch = ++launches_[downloadId];
+    entry.task->Start([this, downloadId, launch](bool success, const std::string& error) {
+        OnTaskDone(downloadId, launch, success, error);
+    });
+}
+
+void DownloadManager::OnTaskDone(int downloadId, uint64_t launch, bool success, const std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry = FindEntry(downloadId);
+    // Transfers stopped by Shutdown() stay in progress for the next session
+    if (!entry || shuttingDown_) return;
+    if (launches_[downloadId] != launch) return;
+
+    if (relaunch_.erase(downloadId) && entry->Status()->state == DownloadState::InProgress) {
+        Launch(*entry);
+        return;
+    }
+    // A cancel already settled the state; the transfer just confirmed it
+    if (entry->Status()->state != DownloadState::InProgress) return;
+
+    UpdateStatus(*entry, [success, &error](DownloadStatus& status) {
+        status.endTime = std::chrono::system_clock::now();
+        status.state = success ? DownloadState::Completed : DownloadState::Failed;
+        if (!success) status.errorMessage = error;
+    });
+    SaveState(*entry);
+}
+
+void DownloadManager::DropTask(DownloadEntry& entry, bool keepFile) {
+    relaunch_.erase(entry.id);
+    launches_.erase(entry.id);
+    if (!entry.task) return;
+    entry.task->Cancel();
+    if (!keepFile) entry.task->DiscardPartial();
+}
+
+std::string DownloadManager::MakeUniquePath(const std::string& directory, const std::string& filename) const {
+    // "name.ext", then "name (1).ext", ...; a partial download counts as taken
+    std::filesystem::path name(filename);
+    std::string stem = name.stem().string();
+    std::string extension = name.extension().string();
+    std::string path = directory + "/" + filename;
+    std::error_code ec;
+    for (int i = 1; std::filesystem::exists(path, ec) || std::filesystem::exists(path + ".part", ec); ++i) {
+        path = directory + "/" + stem + " (" + std::to_string(i) + ")" + extension;
+    }
+    return path;
 }
 
 std::string DownloadManager::GenerateFilename(const std::string& url, const std::string& suggested) {
@@ -181,6 +482,21 @@ std::string DownloadManager::GenerateFilename(const std::string& url, const std:
     return "download";
 }
 
+std::string DownloadManager::GetJournalFilePath() const {
+    std::string appDataDir;
+#ifdef _WIN32
+    wchar_t* path = nullptr;
+    if (SUCCEEDED(SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, nullptr, &path))) {
+        appDataDir = Utils::WStringToString(std::wstring(path, wcslen(path)));
+        CoTaskMemFree(path);
+    }
+    std::replace(appDataDir.begin(), appDataDir.end(), '\\', '/');
+#else
+    appDataDir = std::getenv("HOME") ? std::getenv("HOME") : "";
+#endif
+    return appDataDir + "/FRW Browser/downloads.journal";
+}
+
 std::string DownloadManager::GetDefaultDownloadDirectory() const {
     std::string downloadDir;
     
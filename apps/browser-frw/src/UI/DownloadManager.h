@@ -4,6 +4,13 @@
 #include <vector>
 #include <chrono>
 #include <memory>
+#include <unordered_map>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include "../DownloadJournal.h"
+
+class DownloadTask;
 
 enum class DownloadState {
     Pending,
@@ -13,24 +20,82 @@ enum class DownloadState {
     Cancelled
 };
 
+// A copy of one download's state, taken without waiting on any transfer
 struct Download {
     int id;
     std::string url;
     std::string filename;
     std::string savePath;
-    int64_t totalSize;
-    int64_t receivedSize;
+    int64_t totalSize;     // 0 while unknown
+    int64_t receivedSize;  // Bytes on disk; kept across retries, which resume
     DownloadState state;
     std::chrono::system_clock::time_point startTime;
     std::chrono::system_clock::time_point endTime;
     double speed; // bytes per second
+    int64_t speedLimit; // Bytes per second over all connections; 0 for none
+    bool verified;      // /ipfs/ content checked against its CID while downloading
+    std::string errorMessage;
+};
+
+// Every download's state as of one epoch. Byte counts and speed are read
+// live, since progress does not move the epoch.
+struct DownloadSnapshot {
+    uint64_t epoch;
+    std::vector<Download> downloads; // Oldest first
+};
+
+// What changes about a download other than its progress. Never modified
+// once published: a change publishes a new copy, so a reader holds either
+// the old state or the new one, never half of each.
+struct DownloadStatus {
+    DownloadState state = DownloadState::Pending;
+    std::chrono::system_clock::time_point startTime;
+    std::chrono::system_clock::time_point endTime;
+    int64_t speedLimit = 0;
     std::string errorMessage;
+    // Progress of a download without a transfer, i.e. one completed in an
+    // earlier session; otherwise the transfer's own counters are used
+    int64_t totalSize = 0;
+    int64_t receivedSize = 0;
+    uint64_t epoch = 0; // DownloadManager's epoch when this was published
+};
+
+// One download in DownloadManager's registry. Readers never take a lock
+// here: the status is swapped atomically and progress comes from the
+// transfer's atomic counters, which its threads update as bytes land.
+class DownloadEntry {
+public:
+    DownloadEntry(int id, std::string url, std::string filename, std::string savePath,
+                  std::shared_ptr<DownloadTask> task);
+
+    const int id;
+    const std::string url;
+    const std::string filename;
+    const std::string savePath;
+    const std::shared_ptr<DownloadTask> task; // Null for downloads completed in an earlier session
+
+    std::shared_ptr<const DownloadStatus> Status() const;
+    // Callers serialize publishing among themselves
+    void Publish(std::shared_ptr<const DownloadStatus> status);
+    Download Snapshot() const;
+    // With |status| in place of the current one
+    Download Snapshot(const DownloadStatus& status) const;
+
+private:
+    std::shared_ptr<const DownloadStatus> status_; // Accessed with std::atomic_load/store
 };
 
 class DownloadManager {
 public:
     static DownloadManager& Instance();
-    
+
+    // Rebuilds the list from the journal and resumes the downloads that
+    // were running when the last session ended
+    void LoadDownloads();
+    // Stops the transfers without marking them cancelled, so the next
+    // session resumes them
+    void Shutdown();
+
     // Download management
     int StartDownload(const std::string& url, const std::string& suggestedFilename = "");
     void CancelDownload(int downloadId);
@@ -38,29 +103,79 @@ public:
     void RemoveDownload(int downloadId);
     void ClearCompleted();
     void ClearAll();
-    
-    // Download queries
-    Download* GetDownload(int downloadId);
-    std::vector<Download*> GetAllDownloads();
-    std::vector<Download*> GetActiveDownloads();
-    std::vector<Download*> GetCompletedDownloads();
-    
+    // Caps one download; 0 lifts the cap. The default comes from download_limit_kbps.
+    void SetDownloadSpeedLimit(int downloadId, int64_t bytesPerSecond);
+
+    // Download queries. None of them take the manager's lock or wait on a
+    // transfer, so the UI can poll them as often as it likes.
+    bool GetDownload(int downloadId, Download& download) const;
+    std::vector<Download> GetAllDownloads() const;
+    std::vector<Download> GetActiveDownloads() const;
+    std::vector<Download> GetCompletedDownloads() const;
+    // Moves on whenever a download is added, removed or changes state;
+    // progress alone does not move it
+    uint64_t GetEpoch() const { return epoch_.load(); }
+    // Every download, all taken from the registry generation of one epoch
+    DownloadSnapshot GetSnapshot() const;
+
     // Statistics
     int GetActiveDownloadCount() const;
     int64_t GetTotalDownloadSize() const;
-    double GetCurrentDownloadSpeed() const;
-    
+    double GetCurrentDownloadSpeed() const; // All downloads together, from BandwidthScheduler
+
     // Settings
     void SetDefaultDownloadPath(const std::string& path);
     std::string GetDefaultDownloadPath() const;
 
 private:
-    DownloadManager() : nextDownloadId_(1) {}
-    std::vector<std::unique_ptr<Download>> downloads_;
+    // The registry as readers see it; replaced whole whenever a download is
+    // added, removed or changes state
+    struct Registry {
+        uint64_t epoch = 0;
+        std::vector<std::shared_ptr<DownloadEntry>> entries; // Oldest first
+        std::vector<std::shared_ptr<const DownloadStatus>> statuses; // Of |entries|, as of |epoch|
+        std::unordered_map<int, std::shared_ptr<DownloadEntry>> byId;
+    };
+
+    DownloadManager();
+    // Serializes changes; readers go through registry_ instead
+    mutable std::mutex mutex_;
+    std::shared_ptr<const Registry> registry_; // Accessed with std::atomic_load/store
+    std::atomic<uint64_t> epoch_;
+    std::set<int> relaunch_; // Retried while the cancelled transfer was still stopping
+    // How many times each download's transfer was started. A transfer
+    // reports its outcome with the count it was started under, so a run
+    // that was superseded cannot settle the state of the one after it.
+    std::unordered_map<int, uint64_t> launches_;
     int nextDownloadId_;
     std::string defaultDownloadPath_;
-    
-    Download* FindDownload(int downloadId);
+    DownloadJournal journal_;
+    bool shuttingDown_;
+
+    std::shared_ptr<const Registry> LoadRegistry() const;
+    // Records every entry's current status and the epoch in |registry| and
+    // makes it the one readers see; the caller holds mutex_
+    void PublishRegistry(std::shared_ptr<Registry> registry);
+    std::shared_ptr<DownloadEntry> FindEntry(int downloadId) const;
+    void AddEntry(std::shared_ptr<DownloadEntry> entry);
+    // Drops the entries |remove| picks; the caller holds mutex_
+    template <typename Predicate>
+    void RemoveEntries(Predicate remove);
+    // Publishes a copy of the entry's status with |change| applied
+    template <typename Change>
+    void UpdateStatus(DownloadEntry& entry, Change change);
+
     std::string GenerateFilename(const std::string& url, const std::string& suggested);
     std::string GetDefaultDownloadDirectory() const;
+    std::string GetJournalFilePath() const;
+    std::string MakeUniquePath(const std::string& directory, const std::string& filename) const;
+
+    std::shared_ptr<DownloadTask> CreateTask(int downloadId, const std::string& url, const std::string& savePath,
+                                             int64_t speedLimit);
+    // Records the download's state in the journal
+    void SaveState(const DownloadEntry& entry);
+    // Runs (or resumes) the download's transfer
+    void Launch(DownloadEntry& entry);
+    void OnTaskDone(int downloadId, uint64_t launch, bool success, const std::string& error);
+    void DropTask(DownloadEntry& entry, bool keepFile);
 };
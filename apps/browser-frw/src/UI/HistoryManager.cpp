@@ -1,145 +1,342 @@
 #include "HistoryManager.h"
-#include "../Utils.h"
+#include "../CaseInsensitiveFinder.h"
 #include <fstream>
 #include <sstream>
 #include <algorithm>
 #include <locale>
 #include <codecvt>
 #include <filesystem>
+#include <iomanip>
+#include <unordered_map>
+#include <cmath>
+#include <cstdio>
 
 #ifdef _WIN32
 #include <windows.h>
 #include <shlobj.h>
+#include "../Utils.h"
 #endif
 
+namespace {
+
+// Writes wait for this long a lull, but never longer than the maximum
+const std::chrono::milliseconds kWriteQuietPeriod(500);
+const std::chrono::seconds kMaxWriteDelay(2);
+const size_t kMaxEntries = 500000;
+// Superseded lines tolerated before a rewrite, beyond the live ones
+const size_t kCompactSlack = 1024;
+const size_t kMaxSuggestions = 10;
+// A search whose candidates exceed 1/kScanFraction of the history walks it instead
+const size_t kScanFraction = 4;
+// A visit counts half as much after this long
+const double kFrecencyHalfLifeSeconds = 30.0 * 24 * 60 * 60;
+
+// Frecency sums 2^(-age / half-life) over the visits. Every score decays at
+// the same rate, so it is kept as log(sum of e^(decay * visit time)): that
+// orders entries the same way at any later moment, and only a visit changes
+// it, which is what lets the suggestion index keep its rankings up to date.
+double VisitScore(std::chrono::system_clock::time_point time) {
+    double seconds = std::chrono::duration<double>(time.time_since_epoch()).count();
+    return seconds * std::log(2.0) / kFrecencyHalfLifeSeconds;
+}
+
+double AddVisit(double frecency, std::chrono::system_clock::time_point time) {
+    double visit = VisitScore(time);
+    double high = std::max(frecency, visit);
+    return high + std::log1p(std::exp(std::min(frecency, visit) - high));
+}
+
+bool MatchesQuery(const HistoryEntry& entry, const CaseInsensitiveFinder& query) {
+    return query.IsIn(entry.url) || query.IsIn(entry.title);
+}
+
+// For history that kept no frecency: as if every visit was the last one
+double EstimateFrecency(const HistoryEntry& entry) {
+    return VisitScore(entry.timestamp) + std::log(static_cast<double>(std::max(entry.visitCount, 1)));
+}
+
+// Log lines are tab-separated; a line cut short by a crash has no newline
+// and is ignored
+//   P <timestamp ms> <visit count> <url> <title> [<frecency>]
+//   D <url>
+std::string EscapeField(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+            case '\\': escaped += "\\\\"; break;
+            case '\t': escaped += "\\t"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\r': escaped += "\\r"; break;
+            default: escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string UnescapeField(const std::string& value) {
+    std::string unescaped;
+    unescaped.reserve(value.size());
+    for (size_t i = 0; i < value.size(); ++i) {
+        if (value[i] != '\\' || i + 1 == value.size()) {
+            unescaped += value[i];
+            continue;
+        }
+        char c = value[++i];
+        unescaped += c == 't' ? '\t' : c == 'n' ? '\n' : c == 'r' ? '\r' : c;
+    }
+    return unescaped;
+}
+
+void AppendPut(std::string& out, const HistoryEntry& entry) {
+    auto milliseconds =
+        std::chrono::duration_cast<std::chrono::milliseconds>(entry.timestamp.time_since_epoch()).count();
+    out += "P\t" + std::to_string(milliseconds) + "\t" + std::to_string(entry.visitCount) + "\t" +
+           EscapeField(entry.url) + "\t" + EscapeField(entry.title) + "\t";
+    char frecency[32];
+    std::snprintf(frecency, sizeof(frecency), "%.17g", entry.frecency);
+    out += frecency;
+    out += "\n";
+}
+
+void AppendDelete(std::string& out, const std::string& url) {
+    out += "D\t" + EscapeField(url) + "\n";
+}
+
+} // namespace
+
 HistoryManager& HistoryManager::Instance() {
     static HistoryManager instance;
     return instance;
 }
 
+HistoryManager::~HistoryManager() {
+    Shutdown();
+}
+
 void HistoryManager::AddEntry(const std::string& url, const std::string& title) {
-    // Check if entry already exists
-    auto it = std::find_if(history_.begin(), history_.end(),
-                           [&url](const HistoryEntry& entry) { return entry.url == url; });
-    
-    if (it != history_.end()) {
-        // Update existing entry
-        it->title = title;
-        it->timestamp = std::chrono::system_clock::now();
-        it->visitCount++;
+    std::lock_guard<std::mutex> lock(mutex_);
+    Node* node = Find(url);
+    if (node) {
+        // Update existing entry; it moves to the front of both orders
+        Unlink(node);
+        if (!title.empty() && node->entry.title != title) {
+            node->entry.title = title;
+            IndexText(node->entry);
+        }
+        node->entry.timestamp = std::chrono::system_clock::now();
+        node->entry.visitCount++;
+        node->entry.frecency = AddVisit(node->entry.frecency, node->entry.timestamp);
     } else {
         // Add new entry
-        HistoryEntry entry;
-        entry.url = url;
-        entry.title = title;
-        entry.timestamp = std::chrono::system_clock::now();
-        entry.visitCount = 1;
-        history_.push_back(entry);
-    }
-    
-    // Keep history size manageable (keep last 1000 entries)
-    if (history_.size() > 1000) {
-        std::sort(history_.begin(), history_.end(),
-                  [](const HistoryEntry& a, const HistoryEntry& b) {
-                      return a.timestamp > b.timestamp;
-                  });
-        history_.resize(1000);
+        auto created = std::make_unique<Node>();
+        created->entry.url = url;
+        created->entry.title = title;
+        created->entry.timestamp = std::chrono::system_clock::now();
+        created->entry.visitCount = 1;
+        created->entry.frecency = VisitScore(created->entry.timestamp);
+        node = created.get();
+        entries_.emplace(url, std::move(created));
+        IndexText(node->entry);
     }
+    Link(node);
+    suggestions_.Update(url, node->entry.frecency);
+    MarkDirty(url);
     
-    SaveHistory();
+    EnforceLimit();
+}
+
+void HistoryManager::UpdateTitle(const std::string& url, const std::string& title) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Node* node = Find(url);
+    if (!node || node->entry.title == title) return;
+    node->entry.title = title;
+    IndexText(node->entry);
+    MarkDirty(url);
 }
 
 void HistoryManager::RemoveEntry(const std::string& url) {
-    history_.erase(std::remove_if(history_.begin(), history_.end(),
-                                  [&url](const HistoryEntry& entry) { return entry.url == url; }),
-                   history_.end());
-    SaveHistory();
+    std::lock_guard<std::mutex> lock(mutex_);
+    Node* node = Find(url);
+    if (!node) return;
+    Erase(node);
+    MarkDirty(url);
 }
 
 void HistoryManager::ClearHistory() {
-    history_.clear();
-    SaveHistory();
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    newest_ = oldest_ = nullptr;
+    byVisits_.clear();
+    suggestions_.Clear();
+    searchIndex_.Clear();
+    MarkDirty(std::string());
+    // An empty rewrite drops everything, so single deletes are not needed
+    dirty_.clear();
+    rewrite_ = true;
 }
 
 std::vector<HistoryEntry> HistoryManager::GetHistory() const {
-    // Return sorted by most recent
-    auto sorted = history_;
-    std::sort(sorted.begin(), sorted.end(),
-              [](const HistoryEntry& a, const HistoryEntry& b) {
-                  return a.timestamp > b.timestamp;
-              });
-    return sorted;
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Most recent first
+    std::vector<HistoryEntry> result;
+    result.reserve(entries_.size());
+    for (const Node* node = newest_; node; node = node->older) {
+        result.push_back(node->entry);
+    }
+    return result;
 }
 
 std::vector<HistoryEntry> HistoryManager::SearchHistory(const std::string& query) const {
+    std::lock_guard<std::mutex> lock(mutex_);
     std::vector<HistoryEntry> results;
-    std::string lowerQuery = query;
-    std::transform(lowerQuery.begin(), lowerQuery.end(), lowerQuery.begin(), ::tolower);
-    
-    for (const auto& entry : history_) {
-        std::string lowerUrl = entry.url;
-        std::string lowerTitle = entry.title;
-        std::transform(lowerUrl.begin(), lowerUrl.end(), lowerUrl.begin(), ::tolower);
-        std::transform(lowerTitle.begin(), lowerTitle.end(), lowerTitle.begin(), ::tolower);
-        
-        if (lowerUrl.find(lowerQuery) != std::string::npos ||
-            lowerTitle.find(lowerQuery) != std::string::npos) {
-            results.push_back(entry);
+    CaseInsensitiveFinder finder(query);
+
+    // The index only says which entries hold all the query's trigrams, not
+    // that they hold them in order, so each candidate is checked
+    std::vector<const std::string*> candidates;
+    if (searchIndex_.Candidates(query, candidates) && candidates.size() < entries_.size() / kScanFraction) {
+        std::vector<const Node*> matches;
+        for (const std::string* url : candidates) {
+            const Node* node = Find(*url);
+            if (node && MatchesQuery(node->entry, finder)) matches.push_back(node);
+        }
+        // By relevance: visit count, then recency
+        std::sort(matches.begin(), matches.end(), [](const Node* a, const Node* b) {
+            if (a->entry.visitCount != b->entry.visitCount) return a->entry.visitCount > b->entry.visitCount;
+            return a->entry.timestamp > b->entry.timestamp;
+        });
+        results.reserve(matches.size());
+        for (const Node* node : matches) {
+            results.push_back(node->entry);
         }
+        return results;
     }
-    
-    // Sort by relevance (visit count and recency)
-    std::sort(results.begin(), results.end(),
-              [](const HistoryEntry& a, const HistoryEntry& b) {
-                  if (a.visitCount != b.visitCount) {
-                      return a.visitCount > b.visitCount;
-                  }
-                  return a.timestamp > b.timestamp;
-              });
-    
+
+    // Queries too short to index, or found nearly everywhere: walking the
+    // visit order yields results by relevance without sorting
+    for (const auto& bucket : byVisits_) {
+        for (const Node* node = bucket.second.first; node; node = node->nextVisit) {
+            if (MatchesQuery(node->entry, finder)) {
+                results.push_back(node->entry);
+            }
+        }
+    }
+
     return results;
 }
 
 std::vector<HistoryEntry> HistoryManager::GetRecentEntries(int count) const {
-    auto sorted = history_;
-    std::sort(sorted.begin(), sorted.end(),
-              [](const HistoryEntry& a, const HistoryEntry& b) {
-                  return a.timestamp > b.timestamp;
-              });
-    
-    if (sorted.size() > static_cast<size_t>(count)) {
-        sorted.resize(count);
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<HistoryEntry> recent;
+    for (const Node* node = newest_; node && recent.size() < static_cast<size_t>(std::max(count, 0));
+         node = node->older) {
+        recent.push_back(node->entry);
     }
-    
-    return sorted;
+    return recent;
 }
 
 std::vector<std::string> HistoryManager::GetSuggestions(const std::string& partial) const {
-    std::vector<std::string> suggestions;
-    std::string lowerPartial = partial;
-    std::transform(lowerPartial.begin(), lowerPartial.end(), lowerPartial.begin(), ::tolower);
-    
-    for (const auto& entry : history_) {
-        std::string lowerUrl = entry.url;
-        std::transform(lowerUrl.begin(), lowerUrl.end(), lowerUrl.begin(), ::tolower);
-        
-        if (lowerUrl.find(lowerPartial) == 0) {
-            suggestions.push_back(entry.url);
-            if (suggestions.size() >= 10) break; // Limit suggestions
+    std::lock_guard<std::mutex> lock(mutex_);
+    return suggestions_.Lookup(partial, kMaxSuggestions);
+}
+
+bool HistoryManager::LoadHistory() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (writer_.joinable()) return true;
+    }
+
+    std::ifstream file(GetHistoryFilePath(), std::ios::binary);
+    bool ok = true;
+    if (!file.is_open()) {
+        ok = ImportLegacyHistory(); // No log yet; maybe a history.csv
+    } else {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Replay; a later line for a URL replaces what came before
+        std::unordered_map<std::string, size_t> positions;
+        std::vector<HistoryEntry> entries;
+        std::vector<bool> removed;
+        std::string line;
+        size_t records = 0;
+        while (std::getline(file, line)) {
+            if (file.eof()) {
+                rewrite_ = true; // Torn last line
+                break;
+            }
+            // Split by hand: getline would drop an empty title at the end
+            std::vector<std::string> fields;
+            size_t start = 0;
+            for (size_t tab = line.find('\t'); tab != std::string::npos; tab = line.find('\t', start)) {
+                fields.push_back(UnescapeField(line.substr(start, tab - start)));
+                start = tab + 1;
+            }
+            fields.push_back(UnescapeField(line.substr(start)));
+            records++;
+
+            // Lines written before frecency was kept have five fields
+            if ((fields.size() == 5 || fields.size() == 6) && fields[0] == "P") {
+                HistoryEntry entry;
+                entry.timestamp = std::chrono::system_clock::time_point(
+                    std::chrono::milliseconds(std::strtoll(fields[1].c_str(), nullptr, 10)));
+                entry.visitCount = std::atoi(fields[2].c_str());
+                entry.url = fields[3];
+                entry.title = fields[4];
+                entry.frecency = fields.size() == 6 ? std::strtod(fields[5].c_str(), nullptr) : EstimateFrecency(entry);
+                auto inserted = positions.emplace(entry.url, entries.size());
+                if (inserted.second) {
+                    entries.push_back(std::move(entry));
+                    removed.push_back(false);
+                } else {
+                    entries[inserted.first->second] = std::move(entry);
+                    removed[inserted.first->second] = false;
+                }
+            } else if (fields.size() == 2 && fields[0] == "D") {
+                auto it = positions.find(fields[1]);
+                if (it != positions.end()) removed[it->second] = true;
+            }
+        }
+
+        std::vector<HistoryEntry> live;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (!removed[i]) live.push_back(std::move(entries[i]));
         }
+        Rebuild(std::move(live));
+        logRecords_ = records;
+        rewrite_ = rewrite_ || logRecords_ > entries_.size() * 2 + kCompactSlack;
+        EnforceLimit();
     }
-    
-    return suggestions;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = false;
+    writer_ = std::thread(&HistoryManager::RunWriter, this);
+    if (rewrite_ || !dirty_.empty()) MarkDirty(std::string());
+    return ok;
 }
 
-bool HistoryManager::LoadHistory() {
-    std::string filePath = GetHistoryFilePath();
-    std::ifstream file(filePath);
+bool HistoryManager::SaveHistory() {
+    return WritePending();
+}
+
+void HistoryManager::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!writer_.joinable()) return;
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    writer_.join();
+    WritePending();
+}
+
+bool HistoryManager::ImportLegacyHistory() {
+    std::ifstream file(GetLegacyHistoryFilePath());
     
     if (!file.is_open()) {
         return true; // No history file yet, that's OK
     }
     
+    std::vector<HistoryEntry> entries;
     try {
         std::string line;
         while (std::getline(file, line)) {
@@ -169,44 +366,193 @@ bool HistoryManager::LoadHistory() {
                 
                 // Parse visit count
                 entry.visitCount = std::stoi(fields[3]);
+                entry.frecency = EstimateFrecency(entry);
                 
-                history_.push_back(entry);
+                entries.push_back(entry);
             }
         }
         file.close();
-        return true;
     } catch (...) {
-        history_.clear();
         return false;
     }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Rebuild(std::move(entries));
+    // The log takes over from here
+    rewrite_ = true;
+    EnforceLimit();
+    return true;
 }
 
-bool HistoryManager::SaveHistory() {
-    std::string filePath = GetHistoryFilePath();
-    
+void HistoryManager::Rebuild(std::vector<HistoryEntry> entries) {
+    entries_.clear();
+    newest_ = oldest_ = nullptr;
+    byVisits_.clear();
+    suggestions_.Clear();
+    searchIndex_.Clear();
+    // Oldest first, so each one linked is the newest so far
+    std::stable_sort(entries.begin(), entries.end(), [](const HistoryEntry& a, const HistoryEntry& b) {
+        return a.timestamp < b.timestamp;
+    });
+    entries_.reserve(entries.size());
+    for (auto& entry : entries) {
+        auto node = std::make_unique<Node>();
+        node->entry = std::move(entry);
+        Node* linked = node.get();
+        // A URL listed twice keeps its later copy
+        auto inserted = entries_.emplace(linked->entry.url, nullptr);
+        if (!inserted.second) Unlink(inserted.first->second.get());
+        inserted.first->second = std::move(node);
+        Link(linked);
+        suggestions_.Update(linked->entry.url, linked->entry.frecency);
+        IndexText(linked->entry);
+    }
+}
+
+void HistoryManager::Link(Node* node) {
+    node->older = newest_;
+    node->newer = nullptr;
+    if (newest_) newest_->newer = node;
+    newest_ = node;
+    if (!oldest_) oldest_ = node;
+
+    VisitBucket& bucket = byVisits_[node->entry.visitCount];
+    node->prevVisit = nullptr;
+    node->nextVisit = bucket.first;
+    if (bucket.first) bucket.first->prevVisit = node;
+    bucket.first = node;
+    if (!bucket.last) bucket.last = node;
+}
+
+void HistoryManager::Unlink(Node* node) {
+    (node->newer ? node->newer->older : newest_) = node->older;
+    (node->older ? node->older->newer : oldest_) = node->newer;
+    node->newer = node->older = nullptr;
+
+    auto it = byVisits_.find(node->entry.visitCount);
+    if (it == byVisits_.end()) return;
+    VisitBucket& bucket = it->second;
+    (node->prevVisit ? node->prevVisit->nextVisit : bucket.first) = node->nextVisit;
+    (node->nextVisit ? node->nextVisit->prevVisit : bucket.last) = node->prevVisit;
+    node->prevVisit = node->nextVisit = nullptr;
+    if (!bucket.first) byVisits_.erase(it);
+}
+
+void HistoryManager::Erase(Node* node) {
+    Unlink(node);
+    std::string url = node->entry.url; // The key dies with the node
+    suggestions_.Remove(url);
+    searchIndex_.Remove(url);
+    entries_.erase(url);
+}
+
+void HistoryManager::IndexText(const HistoryEntry& entry) {
+    searchIndex_.Update(entry.url, {entry.url, entry.title});
+}
+
+HistoryManager::Node* HistoryManager::Find(const std::string& url) const {
+    auto it = entries_.find(url);
+    return it != entries_.end() ? it->second.get() : nullptr;
+}
+
+void HistoryManager::EnforceLimit() {
+    // Keep history size manageable (drop the oldest entries)
+    while (entries_.size() > kMaxEntries) {
+        MarkDirty(oldest_->entry.url);
+        Erase(oldest_);
+    }
+}
+
+void HistoryManager::MarkDirty(const std::string& url) {
+    auto now = Clock::now();
+    if (dirty_.empty() && !rewrite_) firstChange_ = now;
+    lastChange_ = now;
+    if (!url.empty() && !rewrite_) dirty_.insert(url);
+    wake_.notify_all();
+}
+
+void HistoryManager::RunWriter() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (dirty_.empty() && !rewrite_) {
+            wake_.wait(lock);
+            continue;
+        }
+        // Let a burst of changes settle, up to a point
+        auto due = std::min(lastChange_ + kWriteQuietPeriod, firstChange_ + kMaxWriteDelay);
+        if (Clock::now() < due) {
+            wake_.wait_until(lock, due);
+            continue;
+        }
+        lock.unlock();
+        bool written = WritePending();
+        lock.lock();
+        // Try again after another quiet period rather than spin
+        if (!written) firstChange_ = lastChange_ = Clock::now();
+    }
+}
+
+bool HistoryManager::WritePending() {
+    std::lock_guard<std::mutex> writeLock(writeMutex_);
+    std::string path = GetHistoryFilePath();
+    std::string buffer;
+    bool rewrite = false;
+    size_t records = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (dirty_.empty() && !rewrite_) return true;
+        rewrite = rewrite_ || logRecords_ + dirty_.size() > entries_.size() * 2 + kCompactSlack;
+        if (rewrite) {
+            for (const Node* node = oldest_; node; node = node->newer) {
+                AppendPut(buffer, node->entry);
+            }
+            records = entries_.size();
+        } else {
+            for (const auto& url : dirty_) {
+                const Node* node = Find(url);
+                if (node) {
+                    AppendPut(buffer, node->entry);
+                } else {
+                    AppendDelete(buffer, url);
+                }
+            }
+            records = dirty_.size();
+        }
+        dirty_.clear();
+        rewrite_ = false;
+    }
+
     // Create directory if it doesn't exist
-    std::filesystem::path dir = std::filesystem::path(filePath).parent_path();
-    if (!std::filesystem::exists(dir)) {
-        std::filesystem::create_directories(dir);
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+    bool ok = false;
+    if (rewrite) {
+        std::string tmpPath = path + ".tmp";
+        {
+            std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+            file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            file.flush();
+            ok = file.good();
+        }
+        if (ok) {
+            std::filesystem::rename(tmpPath, path, ec);
+            ok = !ec;
+        }
+    } else {
+        std::ofstream file(path, std::ios::binary | std::ios::app);
+        file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        file.flush();
+        ok = file.good();
     }
-    
-    std::ofstream file(filePath);
-    if (!file.is_open()) {
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ok) {
+        // What went unwritten is not known line by line any more
+        rewrite_ = true;
         return false;
     }
-    
-    for (const auto& entry : history_) {
-        // Convert timestamp to string
-        auto time_t = std::chrono::system_clock::to_time_t(entry.timestamp);
-        std::tm tm = *std::localtime(&time_t);
-        
-        file << "\"" << entry.url << "\","
-             << "\"" << entry.title << "\","
-             << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << ","
-             << entry.visitCount << "\n";
-    }
-    
-    file.close();
+    logRecords_ = rewrite ? records : logRecords_ + records;
     return true;
 }
 
@@ -223,7 +569,12 @@ std::string HistoryManager::GetHistoryFilePath() const {
     appDataDir = std::getenv("HOME") ? std::getenv("HOME") : "";
 #endif
     
-    return appDataDir + "/FRW Browser/history.csv";
+    return appDataDir + "/FRW Browser/history.log";
+}
+
+std::string HistoryManager::GetLegacyHistoryFilePath() const {
+    std::string path = GetHistoryFilePath();
+    return path.substr(0, path.size() - 3) + "csv";
 }
 
 void HistoryManager::CleanupOldEntries() {
@@ -231,9 +582,9 @@ void HistoryManager::CleanupOldEntries() {
     auto now = std::chrono::system_clock::now();
     auto six_months_ago = now - std::chrono::hours(24 * 30 * 6);
     
-    history_.erase(std::remove_if(history_.begin(), history_.end(),
-                                 [six_months_ago](const HistoryEntry& entry) {
-                                     return entry.timestamp < six_months_ago;
-                                 }),
-                  history_.end());
+    // The oldest are at the tail of the recency order
+    while (oldest_ && oldest_->entry.timestamp < six_months_ago) {
+        MarkDirty(oldest_->entry.url);
+        Erase(oldest_);
+    }
 }
@@ -3,40 +3,120 @@
 #include <string>
 #include <vector>
 #include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <unordered_set>
+#include <unordered_map>
+#include <map>
+#include <memory>
+#include <functional>
+#include "../SuggestionIndex.h"
+#include "../TrigramIndex.h"
 
 struct HistoryEntry {
     std::string url;
     std::string title;
     std::chrono::system_clock::time_point timestamp;
     int visitCount;
+    // Visits, each worth less as it ages; kept as a logarithm, see VisitScore
+    double frecency;
 };
 
+// Browsing history, kept in memory and persisted to an append-only log.
+// Entries are indexed by URL and threaded onto two intrusive orders, by
+// recency and by visit count, so a visit, a lookup and the k most recent
+// entries cost O(1), O(1) and O(k) however long the history grows.
+// Suggestions come from a prefix index ranked by frecency, and searches
+// from a trigram index over URLs and titles.
+// Changes only mark their URL dirty; a background thread writes the dirty
+// entries once the history has been quiet for a moment, so a burst of
+// title changes costs one line per URL rather than a rewrite of the file.
+// The log is rewritten from memory once superseded lines outnumber live ones.
 class HistoryManager {
 public:
     static HistoryManager& Instance();
-    
+
     // History management
+    // Records a visit to |url|; an empty |title| keeps the entry's current one
     void AddEntry(const std::string& url, const std::string& title);
+    // Retitles |url|'s entry, if there is one, without counting a visit
+    void UpdateTitle(const std::string& url, const std::string& title);
     void RemoveEntry(const std::string& url);
     void ClearHistory();
-    
+
     // Query history
     std::vector<HistoryEntry> GetHistory() const;
     std::vector<HistoryEntry> SearchHistory(const std::string& query) const;
     std::vector<HistoryEntry> GetRecentEntries(int count = 10) const;
-    
-    // Auto-complete suggestions
+
+    // Auto-complete suggestions: URLs starting with |partial|, with or
+    // without scheme and "www.", the most frequently and recently visited first
     std::vector<std::string> GetSuggestions(const std::string& partial) const;
-    
+
     // Persistence
+    // Replays the log (or imports the older history.csv) and starts the
+    // background writer
     bool LoadHistory();
+    // Writes out the changes the background writer has not got to yet
     bool SaveHistory();
+    // Saves and stops the background writer
+    void Shutdown();
 
 private:
+    using Clock = std::chrono::steady_clock;
+
     HistoryManager() = default;
-    std::vector<HistoryEntry> history_;
-    std::string historyFile_;
-    
+    ~HistoryManager();
+
+    // An entry and its links into both orders
+    struct Node {
+        HistoryEntry entry;
+        Node* newer = nullptr;
+        Node* older = nullptr;
+        Node* prevVisit = nullptr; // Same visit count, more recent
+        Node* nextVisit = nullptr;
+    };
+    // Entries sharing a visit count, most recent first
+    struct VisitBucket {
+        Node* first = nullptr;
+        Node* last = nullptr;
+    };
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_; // Something changed, or shutting down
+    std::unordered_map<std::string, std::unique_ptr<Node>> entries_; // By URL
+    Node* newest_ = nullptr;
+    Node* oldest_ = nullptr;
+    std::map<int, VisitBucket, std::greater<int>> byVisits_; // Most visited first
+    SuggestionIndex suggestions_;
+    TrigramIndex searchIndex_;
+    // Changed since the last write; a URL no longer in entries_ was removed
+    std::unordered_set<std::string> dirty_;
+    bool rewrite_ = false;     // The log must be rewritten from memory
+    size_t logRecords_ = 0;    // Lines in the log
+    Clock::time_point firstChange_; // Oldest change not yet written
+    Clock::time_point lastChange_;
+    std::thread writer_;
+    bool stopping_ = false;
+    // Held across a whole write, so two writes never interleave
+    std::mutex writeMutex_;
+
     std::string GetHistoryFilePath() const;
+    std::string GetLegacyHistoryFilePath() const;
+    bool ImportLegacyHistory();
     void CleanupOldEntries();
+    // Replaces the history with |entries|, in any order
+    void Rebuild(std::vector<HistoryEntry> entries);
+    // The entry must be the newest and not yet linked
+    void Link(Node* node);
+    void Unlink(Node* node);
+    void Erase(Node* node);
+    void IndexText(const HistoryEntry& entry);
+    Node* Find(const std::string& url) const;
+    // Drops the oldest entries beyond the cap; the caller holds mutex_
+    void EnforceLimit();
+    void MarkDirty(const std::string& url);
+    void RunWriter();
+    bool WritePending();
 };
@@ -4,6 +4,7 @@
 #include "HistoryManager.h"
 #include "SettingsManager.h"
 #include "DownloadManager.h"
+#include "ContentStore.h"
 #include "CEFConfig.h"
 #include "cef_browser.h"
 #include "cef_client.h"
@@ -459,6 +460,8 @@ void MenuManager::OnBookmarksAddBookmark() {
     auto& tabManager = TabManager::Instance();
     Tab* activeTab = tabManager.GetActiveTab();
     if (activeTab) {
+        // Pin bookmarked frw sites so their content is never evicted
+        ContentStore::Instance().PinSiteForUrl(activeTab->url);
         // TODO: Show bookmark dialog
     }
 }
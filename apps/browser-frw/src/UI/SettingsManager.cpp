@@ -1,5 +1,4 @@
 #include "SettingsManager.h"
-#include "../Utils.h"
 #include <fstream>
 #include <sstream>
 #include <algorithm>
@@ -8,6 +7,7 @@
 #include <filesystem>
 
 #ifdef _WIN32
+#include "../Utils.h"
 #include <windows.h>
 #include <shlobj.h>
 #endif
@@ -32,6 +32,9 @@ bool SettingsManager::LoadSettings() {
         return SaveSettings();
     }
     
+    // Start from defaults so keys missing from older files stay initialized
+    InitializeDefaults();
+    
     try {
         std::string line;
         while (std::getline(file, line)) {
@@ -49,6 +52,28 @@ bool SettingsManager::LoadSettings() {
                     settings_.useLocalIPFS = (value == "true");
                 } else if (key == "local_ipfs_api") {
                     settings_.localIPFSApi = value;
+                } else if (key == "content_cache_max_mb") {
+                    settings_.contentCacheMaxMB = std::stoi(value);
+                } else if (key == "content_cache_max_entries") {
+                    settings_.contentCacheMaxEntries = std::stoi(value);
+                } else if (key == "parallel_fetch_threshold_mb") {
+                    settings_.parallelFetchThresholdMB = std::stoi(value);
+                } else if (key == "trustless_retrieval") {
+                    settings_.trustlessRetrieval = (value == "true");
+                } else if (key == "site_bundle_max_mb") {
+                    settings_.siteBundleMaxMB = std::stoi(value);
+                } else if (key == "preload_max_concurrent") {
+                    settings_.preloadMaxConcurrent = std::stoi(value);
+                } else if (key == "frw_providers") {
+                    settings_.frwProviders = ParseStringList(value);
+                } else if (key == "offline_mode") {
+                    settings_.offlineMode = (value == "true");
+                } else if (key == "download_segments") {
+                    settings_.downloadSegments = std::stoi(value);
+                } else if (key == "bandwidth_limit_kbps") {
+                    settings_.bandwidthLimitKBps = std::stoi(value);
+                } else if (key == "download_limit_kbps") {
+                    settings_.downloadLimitKBps = std::stoi(value);
                 } else if (key == "theme") {
                     settings_.theme = value;
                 } else if (key == "font_size") {
@@ -73,6 +98,7 @@ bool SettingsManager::LoadSettings() {
             }
         }
         file.close();
+        ClampLimits();
         return true;
     } catch (...) {
         InitializeDefaults();
@@ -92,6 +118,17 @@ bool SettingsManager::SaveSettings() {
     file << "ipfs_gateways=" << JoinStringList(settings_.ipfsGateways) << "\n";
     file << "use_local_ipfs=" << (settings_.useLocalIPFS ? "true" : "false") << "\n";
     file << "local_ipfs_api=" << settings_.localIPFSApi << "\n";
+    file << "content_cache_max_mb=" << settings_.contentCacheMaxMB << "\n";
+    file << "content_cache_max_entries=" << settings_.contentCacheMaxEntries << "\n";
+    file << "parallel_fetch_threshold_mb=" << settings_.parallelFetchThresholdMB << "\n";
+    file << "trustless_retrieval=" << (settings_.trustlessRetrieval ? "true" : "false") << "\n";
+    file << "site_bundle_max_mb=" << settings_.siteBundleMaxMB << "\n";
+    file << "preload_max_concurrent=" << settings_.preloadMaxConcurrent << "\n";
+    file << "frw_providers=" << JoinStringList(settings_.frwProviders) << "\n";
+    file << "offline_mode=" << (settings_.offlineMode ? "true" : "false") << "\n";
+    file << "download_segments=" << settings_.downloadSegments << "\n";
+    file << "bandwidth_limit_kbps=" << settings_.bandwidthLimitKBps << "\n";
+    file << "download_limit_kbps=" << settings_.downloadLimitKBps << "\n";
     file << "theme=" << settings_.theme << "\n";
     file << "font_size=" << settings_.fontSize << "\n";
     file << "show_bookmarks_bar=" << (settings_.showBookmarksBar ? "true" : "false") << "\n";
@@ -109,6 +146,7 @@ bool SettingsManager::SaveSettings() {
 
 void SettingsManager::SetSettings(const Settings& newSettings) {
     settings_ = newSettings;
+    ClampLimits();
     SaveSettings();
 }
 
@@ -178,6 +216,17 @@ void SettingsManager::InitializeDefaults() {
     // Default settings
     settings_.useLocalIPFS = false;
     settings_.localIPFSApi = "http://localhost:5001";
+    settings_.contentCacheMaxMB = 1024;
+    settings_.contentCacheMaxEntries = 65536;
+    settings_.parallelFetchThresholdMB = 8;
+    settings_.trustlessRetrieval = false;
+    settings_.siteBundleMaxMB = 32;
+    settings_.preloadMaxConcurrent = 6;
+    settings_.frwProviders = {"pinned", "memory", "disk", "local", "gateway"};
+    settings_.offlineMode = false;
+    settings_.downloadSegments = 4;
+    settings_.bandwidthLimitKBps = 0;
+    settings_.downloadLimitKBps = 0;
     settings_.theme = "default";
     settings_.fontSize = 14;
     settings_.showBookmarksBar = true;
@@ -190,6 +239,19 @@ void SettingsManager::InitializeDefaults() {
     settings_.userAgent = "FRW Browser/1.0 (Windows)";
 }
 
+// Sizes and counts are handed on unsigned, where a negative value from a
+// hand-edited file would turn into a huge limit
+void SettingsManager::ClampLimits() {
+    settings_.contentCacheMaxMB = std::max(settings_.contentCacheMaxMB, 0);
+    settings_.contentCacheMaxEntries = std::max(settings_.contentCacheMaxEntries, 0);
+    settings_.parallelFetchThresholdMB = std::max(settings_.parallelFetchThresholdMB, 0);
+    settings_.siteBundleMaxMB = std::max(settings_.siteBundleMaxMB, 0);
+    settings_.preloadMaxConcurrent = std::max(settings_.preloadMaxConcurrent, 0);
+    settings_.downloadSegments = std::max(settings_.downloadSegments, 1);
+    settings_.bandwidthLimitKBps = std::max(settings_.bandwidthLimitKBps, 0);
+    settings_.downloadLimitKBps = std::max(settings_.downloadLimitKBps, 0);
+}
+
 std::string SettingsManager::GetSettingsFilePath() const {
     std::string appDataDir;
 #ifdef _WIN32
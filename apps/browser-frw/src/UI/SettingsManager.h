@@ -10,6 +10,17 @@ struct Settings {
     std::vector<std::string> ipfsGateways;
     bool useLocalIPFS;
     std::string localIPFSApi;
+    int contentCacheMaxMB;
+    int contentCacheMaxEntries;
+    int parallelFetchThresholdMB;
+    bool trustlessRetrieval;
+    int siteBundleMaxMB; // 0 disables whole-site bundles
+    int preloadMaxConcurrent; // 0 disables subresource prefetch
+    std::vector<std::string> frwProviders; // Provider tiers for frw:// requests, in order
+    bool offlineMode; // Serve frw sites from local caches only, even when online
+    int downloadSegments; // Parallel connections per download
+    int bandwidthLimitKBps; // Cap on all network traffic; 0 for none
+    int downloadLimitKBps;  // Cap given to each new download; 0 for none
     
     // UI settings
     std::string theme;
@@ -62,6 +73,7 @@ private:
     std::string settingsFile_;
     
     void InitializeDefaults();
+    void ClampLimits();
     std::string GetSettingsFilePath() const;
     
     // Helper methods for string list parsing/joining
@@ -0,0 +1,192 @@
+#include "UnixFs.h"
+
+namespace {
+
+// Largest CAR section we accept; real blocks are at most a few MiB
+const uint64_t kMaxSectionSize = 4 * 1024 * 1024;
+const int kMaxDagDepth = 64;
+
+// Walks the fields of a protobuf message, calling |on_field| with the field
+// number, wire type, varint value (wire type 0) or payload (wire type 2).
+template <typename Handler>
+bool ForEachField(const std::string& message, Handler on_field) {
+    const uint8_t* pos = reinterpret_cast<const uint8_t*>(message.data());
+    const uint8_t* end = pos + message.size();
+
+    while (pos < end) {
+        uint64_t key = 0;
+        if (!ReadVarint(pos, end, key)) return false;
+        uint32_t field = static_cast<uint32_t>(key >> 3);
+        uint32_t wire_type = static_cast<uint32_t>(key & 7);
+
+        uint64_t value = 0;
+        std::string payload;
+        switch (wire_type) {
+        case 0:
+            if (!ReadVarint(pos, end, value)) return false;
+            break;
+        case 1:
+            if (end - pos < 8) return false;
+            pos += 8;
+            continue;
+        case 2:
+            if (!ReadVarint(pos, end, value) || static_cast<uint64_t>(end - pos) < value) return false;
+            payload.assign(reinterpret_cast<const char*>(pos), static_cast<size_t>(value));
+            pos += value;
+            break;
+        case 5:
+            if (end - pos < 4) return false;
+            pos += 4;
+            continue;
+        default:
+            return false;
+        }
+
+        if (!on_field(field, wire_type, value, payload)) return false;
+    }
+    return true;
+}
+
+bool DecodeLink(const std::string& message, DagPbLink& out) {
+    bool has_hash = false;
+    bool ok = ForEachField(message, [&](uint32_t field, uint32_t wire_type, uint64_t value,
+                                        const std::string& payload) {
+        if (field == 1 && wire_type == 2) {
+            const uint8_t* pos = reinterpret_cast<const uint8_t*>(payload.data());
+            has_hash = Cid::FromBytes(pos, pos + payload.size(), out.cid);
+            return has_hash;
+        }
+        if (field == 2 && wire_type == 2) out.name = payload;
+        if (field == 3 && wire_type == 0) out.size = value;
+        return true;
+    });
+    return ok && has_hash;
+}
+
+bool AppendFileData(const Cid& cid, const UnixFs::BlockLookup& lookup, std::string& out, int depth) {
+    if (depth > kMaxDagDepth) return false;
+
+    std::string block;
+    UnixFsNode node;
+    if (!lookup(cid, block) || !UnixFs::DecodeNode(cid, block, node)) return false;
+    if (node.type != UnixFsNode::File && node.type != UnixFsNode::Raw) return false;
+
+    out += node.data;
+    for (const auto& link : node.links) {
+        if (!AppendFileData(link.cid, lookup, out, depth + 1)) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+namespace UnixFs {
+
+bool DecodeNode(const Cid& cid, const std::string& block, UnixFsNode& out) {
+    out = UnixFsNode();
+
+    if (cid.Codec() == Cid::kCodecRaw) {
+        out.type = UnixFsNode::Raw;
+        out.data = block;
+        out.fileSize = block.size();
+        return true;
+    }
+    if (cid.Codec() != Cid::kCodecDagPb) return false;
+
+    // PBNode: Data = 1, Links = 2
+    std::string unixfs_data;
+    bool ok = ForEachField(block, [&](uint32_t field, uint32_t wire_type, uint64_t,
+                                      const std::string& payload) {
+        if (wire_type != 2) return true;
+        if (field == 1) {
+            unixfs_data = payload;
+        } else if (field == 2) {
+            DagPbLink link;
+            if (!DecodeLink(payload, link)) return false;
+            out.links.push_back(std::move(link));
+        }
+        return true;
+    });
+    if (!ok) return false;
+
+    // UnixFS Data: Type = 1, Data = 2, filesize = 3, blocksizes = 4 (packed or not)
+    return ForEachField(unixfs_data, [&](uint32_t field, uint32_t wire_type, uint64_t value,
+                                         const std::string& payload) {
+        if (field == 1 && wire_type == 0) out.type = static_cast<int>(value);
+        if (field == 2 && wire_type == 2) out.data = payload;
+        if (field == 3 && wire_type == 0) out.fileSize = value;
+        if (field == 4 && wire_type == 0) out.blockSizes.push_back(value);
+        if (field == 4 && wire_type == 2) {
+            const uint8_t* pos = reinterpret_cast<const uint8_t*>(payload.data());
+            const uint8_t* end = pos + payload.size();
+            uint64_t size = 0;
+            while (pos < end) {
+                if (!ReadVarint(pos, end, size)) return false;
+                out.blockSizes.push_back(size);
+            }
+        }
+        return true;
+    });
+}
+
+bool ReadFile(const Cid& file, const BlockLookup& lookup, std::string& out_content) {
+    out_content.clear();
+    return AppendFileData(file, lookup, out_content, 0);
+}
+
+} // namespace UnixFs
+
+CarReader::CarReader(BlockCallback on_block)
+    : onBlock_(std::move(on_block)) {
+}
+
+bool CarReader::Feed(const char* data, size_t size) {
+    if (failed_) return false;
+    pending_.append(data, size);
+
+    while (true) {
+        const uint8_t* begin = reinterpret_cast<const uint8_t*>(pending_.data()) + consumed_;
+        const uint8_t* end = reinterpret_cast<const uint8_t*>(pending_.data()) + pending_.size();
+        const uint8_t* pos = begin;
+
+        // Every section (and the header) is prefixed by its varint length
+        uint64_t length = 0;
+        if (!ReadVarint(pos, end, length)) {
+            if (end - begin >= 10) failed_ = true; // Longer than any valid varint
+            break;
+        }
+        if (length > kMaxSectionSize) {
+            failed_ = true;
+            break;
+        }
+        if (static_cast<uint64_t>(end - pos) < length) break;
+
+        const uint8_t* section_end = pos + length;
+        if (!headerDone_) {
+            // The dag-cbor header only names roots; blocks are verified individually
+            headerDone_ = true;
+        } else {
+            Cid cid;
+            if (!Cid::FromBytes(pos, section_end, cid)) {
+                failed_ = true;
+                break;
+            }
+            const char* block = reinterpret_cast<const char*>(pos);
+            size_t block_size = static_cast<size_t>(section_end - pos);
+            if (!cid.Verify(block, block_size)) {
+                failed_ = true;
+                break;
+            }
+            blockCount_++;
+            onBlock_(cid, std::string(block, block_size));
+        }
+        consumed_ += static_cast<size_t>(section_end - begin);
+    }
+
+    // Drop consumed bytes once they dominate the buffer
+    if (consumed_ > 0 && consumed_ * 2 >= pending_.size()) {
+        pending_.erase(0, consumed_);
+        consumed_ = 0;
+    }
+    return !failed_;
+}
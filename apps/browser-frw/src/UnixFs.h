@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Cid.h"
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+struct DagPbLink {
+    Cid cid;
+    std::string name;
+    uint64_t size = 0;
+};
+
+// A decoded UnixFS node (dag-pb with a UnixFS Data message, or a raw leaf)
+struct UnixFsNode {
+    enum Type {
+        Raw = 0,
+        Directory = 1,
+        File = 2,
+        Metadata = 3,
+        Symlink = 4,
+        HamtShard = 5
+    };
+
+    int type = Raw;
+    std::string data;       // Inline file bytes
+    uint64_t fileSize = 0;
+    std::vector<uint64_t> blockSizes; // File bytes under each link
+    std::vector<DagPbLink> links;
+};
+
+namespace UnixFs {
+    // Looks up an already verified block
+    using BlockLookup = std::function<bool(const Cid& cid, std::string& out_block)>;
+
+    // Decode a verified block; raw-codec blocks become a single Raw leaf
+    bool DecodeNode(const Cid& cid, const std::string& block, UnixFsNode& out);
+    // Concatenate a file DAG whose blocks are all available through |lookup|
+    bool ReadFile(const Cid& file, const BlockLookup& lookup, std::string& out_content);
+}
+
+// Incremental CARv1 parser. Every block is checked against its CID as it
+// arrives; a block that fails verification stops the stream.
+class CarReader {
+public:
+    using BlockCallback = std::function<void(const Cid& cid, std::string block)>;
+
+    explicit CarReader(BlockCallback on_block);
+
+    // Returns false once the stream is malformed or a block fails verification
+    bool Feed(const char* data, size_t size);
+    size_t BlockCount() const { return blockCount_; }
+
+private:
+    BlockCallback onBlock_;
+    std::string pending_;
+    size_t consumed_ = 0;
+    bool headerDone_ = false;
+    bool failed_ = false;
+    size_t blockCount_ = 0;
+};
@@ -0,0 +1,75 @@
+#include "WorkerPool.h"
+#include "CancellationToken.h"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(size_t max_threads)
+    : maxThreads_(std::max<size_t>(max_threads, 1)), running_(maxThreads_) {
+}
+
+WorkerPool::~WorkerPool() {
+    Shutdown();
+}
+
+bool WorkerPool::Post(std::function<void()> job, std::shared_ptr<CancellationToken> cancel) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (shutdown_) return false;
+    queue_.push_back(Job{std::move(job), std::move(cancel)});
+    // Idle threads take what they can; only the surplus needs a new one
+    if (queue_.size() > idle_ && threads_.size() < maxThreads_) {
+        threads_.emplace_back(&WorkerPool::Run, this, threads_.size());
+    } else {
+        wake_.notify_one();
+    }
+    return true;
+}
+
+void WorkerPool::Shutdown() {
+    std::vector<std::thread> threads;
+    std::deque<Job> dropped;
+    std::vector<std::shared_ptr<CancellationToken>> running;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutdown_ = true;
+        threads.swap(threads_);
+        dropped.swap(queue_);
+        for (const auto& cancel : running_) {
+            if (cancel) running.push_back(cancel);
+        }
+        wake_.notify_all();
+    }
+
+    // Outside the lock: a token's callbacks may take locks of their own
+    for (const auto& cancel : running) {
+        cancel->Cancel();
+    }
+    for (const auto& job : dropped) {
+        if (job.cancel) job.cancel->Cancel();
+    }
+    dropped.clear();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::Run(size_t index) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        idle_++;
+        wake_.wait(lock, [this]() { return shutdown_ || !queue_.empty(); });
+        idle_--;
+        if (shutdown_) return;
+
+        Job job = std::move(queue_.front());
+        queue_.pop_front();
+        running_[index] = job.cancel;
+        lock.unlock();
+
+        job.run();
+        job = Job(); // What the job captured goes before the next one starts
+
+        lock.lock();
+        running_[index] = nullptr;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CancellationToken;
+
+// Runs posted jobs on at most a fixed number of threads, started as the
+// queue needs them. Unlike detached threads it can account for every job:
+// Shutdown() cancels the running ones through their tokens, drops those
+// still queued and joins the threads, so no job outlives what it uses.
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t max_threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Queues |job|. |cancel|, if given, is cancelled when Shutdown() finds
+    // the job running or drops it. Returns false once shut down.
+    bool Post(std::function<void()> job, std::shared_ptr<CancellationToken> cancel = nullptr);
+
+    // Returns once every job has either finished or been dropped. Must not
+    // be called from a job.
+    void Shutdown();
+
+private:
+    struct Job {
+        std::function<void()> run;
+        std::shared_ptr<CancellationToken> cancel;
+    };
+
+    const size_t maxThreads_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<Job> queue_;
+    std::vector<std::thread> threads_;
+    std::vector<std::shared_ptr<CancellationToken>> running_; // Per thread
+    size_t idle_ = 0;
+    bool shutdown_ = false;
+
+    void Run(size_t index);
+};
@@ -1,9 +1,15 @@
 #include "CEFIntegration.h"
 #include "CEFWindow.h"
 #include "FrwSchemeHandler.h"
+#include "ContentStore.h"
+#include "SiteBundleManager.h"
+#include "FrwProviderChain.h"
+#include "OfflineMode.h"
+#include "TransferStats.h"
 #include "UI/BrowserWindow.h"
 #include "UI/SettingsManager.h"
 #include "UI/HistoryManager.h"
+#include "UI/DownloadManager.h"
 #include "UI/DevToolsManager.h"
 #include "UI/MenuManager.h"
 #include "UI/ContextMenuManager.h"
@@ -22,6 +28,12 @@ int main(int argc, char* argv[]) {
     // Initialize all managers
     SettingsManager::Instance().LoadSettings();
     HistoryManager::Instance().LoadHistory();
+    ContentStore::Instance().SetMaxSize(
+        static_cast<uint64_t>(SettingsManager::Instance().GetSettings().contentCacheMaxMB) * 1024 * 1024);
+    ContentStore::Instance().SetMaxEntries(
+        static_cast<size_t>(SettingsManager::Instance().GetSettings().contentCacheMaxEntries));
+    ContentStore::Instance().Open();
+    DownloadManager::Instance().LoadDownloads();
     PrivacyManager::Instance().LoadSettings();
     ExtensionsManager::Instance().InstallDefaultFRWExtensions();
     
@@ -46,11 +58,23 @@ int main(int argc, char* argv[]) {
         FRWCEF::RunMessageLoop();
     } catch (const std::exception& e) {
         std::cout << "FRW Browser: Exception occurred: " << e.what() << std::endl;
+        // Flush the last batch of visits before the writer thread is torn down
+        HistoryManager::Instance().Shutdown();
         FRWCEF::ShutdownCEF();
         return 1;
     }
 
     std::cout << "FRW Browser: Shutting down..." << std::endl;
+    std::cout << "FRW Browser: " << TransferStats::Instance().Summary() << std::endl;
+    std::cout << "FRW Browser: " << FrwProviderChain::Instance().Summary() << std::endl;
+    std::cout << "FRW Browser: " << ContentStore::Instance().Summary() << std::endl;
+    FrwProviderChain::Instance().Shutdown();
+    FrwSchemeHandler::Shutdown();
+    SiteBundleManager::Instance().Shutdown();
+    OfflineMode::Instance().Shutdown();
+    DownloadManager::Instance().Shutdown();
+    HistoryManager::Instance().Shutdown();
+    ContentStore::Instance().Close();
     FRWCEF::ShutdownCEF();
     return 0;
 }
@@ -0,0 +1,98 @@
+#include "TestHarness.h"
+#include "BandwidthScheduler.h"
+#include "CancellationToken.h"
+#include "UI/SettingsManager.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Bytes granted to one connection asking for 64 KiB at a time over
+// |duration|; |out_seconds| is how long that actually took
+int64_t Drain(TrafficClass traffic_class, BandwidthFlow* flow, std::chrono::milliseconds duration,
+              double& out_seconds) {
+    auto started = Clock::now();
+    int64_t granted = 0;
+    while (Clock::now() - started < duration) {
+        granted += static_cast<int64_t>(BandwidthScheduler::Instance().Acquire(traffic_class, flow, 64 * 1024,
+                                                                               nullptr));
+    }
+    out_seconds = std::chrono::duration<double>(Clock::now() - started).count();
+    return granted;
+}
+
+// Sets bandwidth_limit_kbps for the scope; settings are saved on every
+// change, so into a scratch home
+class GlobalLimit {
+public:
+    explicit GlobalLimit(int kbps) : previous_(SettingsManager::Instance().GetSettings()) {
+        setenv("HOME", home_.Path().c_str(), 1);
+        Settings settings = previous_;
+        settings.bandwidthLimitKBps = kbps;
+        SettingsManager::Instance().SetSettings(settings);
+    }
+    ~GlobalLimit() { SettingsManager::Instance().SetSettings(previous_); }
+
+private:
+    TestHarness::ScratchDirectory home_;
+    Settings previous_;
+};
+
+} // namespace
+
+FRW_TEST(BandwidthFlowStaysWithinItsCap) {
+    GlobalLimit unlimited(0);
+    const double kCap = 512 * 1024;
+    BandwidthFlow flow(static_cast<int64_t>(kCap));
+    double seconds = 0;
+    int64_t granted = Drain(TrafficClass::Download, &flow, std::chrono::milliseconds(1000), seconds);
+
+    // The first tenth of a second comes at once, as the bucket's burst
+    EXPECT_TRUE(granted <= kCap * seconds + kCap * 0.1);
+    EXPECT_TRUE(granted >= kCap * seconds * 0.7);
+}
+
+FRW_TEST(BandwidthSchedulerHoldsDownloadsToAShareWhileAPageLoads) {
+    // With a global limit the share is a known tenth of it
+    GlobalLimit limit(10 * 1024);
+    const double kShare = 1024 * 1024;
+    double seconds = 0;
+    int64_t granted = 0;
+    {
+        BandwidthScheduler::Transfer page(TrafficClass::RenderBlocking);
+        granted = Drain(TrafficClass::Download, nullptr, std::chrono::milliseconds(500), seconds);
+    }
+    EXPECT_TRUE(granted <= kShare * seconds + kShare * 0.1);
+    // Held down, but never stalled
+    EXPECT_TRUE(granted >= kShare * seconds * 0.5);
+
+    // The page is done: the download gets the whole link back
+    granted = Drain(TrafficClass::Download, nullptr, std::chrono::milliseconds(500), seconds);
+    EXPECT_TRUE(granted >= kShare * seconds * 4);
+}
+
+FRW_TEST(BandwidthSchedulerAcquireReturnsOnceCancelled) {
+    GlobalLimit unlimited(0);
+    // 1 KiB/s: once the burst is spent, the next grant is seconds away
+    BandwidthFlow flow(1024);
+    auto cancel = std::make_shared<CancellationToken>();
+    EXPECT_TRUE(BandwidthScheduler::Instance().Acquire(TrafficClass::Download, &flow, 64 * 1024, cancel) > 0);
+
+    std::thread canceller([cancel]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        cancel->Cancel();
+    });
+    auto started = Clock::now();
+    size_t granted = BandwidthScheduler::Instance().Acquire(TrafficClass::Download, &flow, 64 * 1024, cancel);
+    auto waited = Clock::now() - started;
+    canceller.join();
+
+    EXPECT_EQ(size_t(0), granted);
+    EXPECT_TRUE(waited < std::chrono::milliseconds(500));
+    // Already cancelled: no wait at all
+    EXPECT_EQ(size_t(0), BandwidthScheduler::Instance().Acquire(TrafficClass::Download, &flow, 64 * 1024, cancel));
+}
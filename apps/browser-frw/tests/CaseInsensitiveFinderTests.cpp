@@ -0,0 +1,64 @@
+#include "TestHarness.h"
+#include "CaseInsensitiveFinder.h"
+
+#include <algorithm>
+#include <cctype>
+#include <random>
+#include <string>
+
+namespace {
+
+size_t ReferenceFind(std::string haystack, std::string needle) {
+    std::transform(haystack.begin(), haystack.end(), haystack.begin(), ::tolower);
+    std::transform(needle.begin(), needle.end(), needle.begin(), ::tolower);
+    return haystack.find(needle);
+}
+
+// Runs |check| once under every kernel this CPU supports
+template <typename Check>
+void ForEachKernel(Check check) {
+    std::string original = CaseInsensitiveFinder::Implementation();
+    for (const auto& kernel : CaseInsensitiveFinder::Implementations()) {
+        EXPECT_TRUE(CaseInsensitiveFinder::UseImplementation(kernel));
+        check();
+    }
+    CaseInsensitiveFinder::UseImplementation(original);
+}
+
+} // namespace
+
+FRW_TEST(CaseInsensitiveFinderFoldsOnlyAsciiLetters) {
+    ForEachKernel([]() {
+        EXPECT_EQ(size_t(7), CaseInsensitiveFinder("example").FindIn(std::string("http://EXAMPLE.com")));
+        EXPECT_EQ(size_t(0), CaseInsensitiveFinder("").FindIn(std::string("anything")));
+        EXPECT_TRUE(!CaseInsensitiveFinder("longer than it").IsIn("short"));
+        // '@' and '`' differ from letters only in the 0x20 bit, and must not match them
+        EXPECT_TRUE(!CaseInsensitiveFinder("a").IsIn("@`"));
+        EXPECT_TRUE(!CaseInsensitiveFinder("[").IsIn("{"));
+        // UTF-8 bytes match exactly: "É" is not folded to "é"
+        EXPECT_TRUE(CaseInsensitiveFinder("caf\xc3\xa9").IsIn("CAF\xc3\xa9 au lait"));
+        EXPECT_TRUE(!CaseInsensitiveFinder("caf\xc3\xa9").IsIn("CAF\xc3\x89"));
+    });
+}
+
+FRW_TEST(CaseInsensitiveFinderKernelsAgreeWithLowercaseFind) {
+    std::mt19937 random(3);
+    const std::string alphabet = "abAB@`{[ \xc3\xa9";
+    for (int i = 0; i < 2000; ++i) {
+        // Lengths around the 16- and 32-byte blocks and their tails
+        std::string haystack(random() % 80, ' ');
+        for (auto& c : haystack) c = alphabet[random() % alphabet.size()];
+        std::string needle(1 + random() % 4, ' ');
+        for (auto& c : needle) c = alphabet[random() % alphabet.size()];
+
+        size_t expected = ReferenceFind(haystack, needle);
+        ForEachKernel([&]() { EXPECT_EQ(expected, CaseInsensitiveFinder(needle).FindIn(haystack)); });
+    }
+}
+
+FRW_TEST(CaseInsensitiveFinderRejectsUnknownKernels) {
+    EXPECT_TRUE(!CaseInsensitiveFinder::UseImplementation("neon512"));
+    EXPECT_TRUE(CaseInsensitiveFinder::UseImplementation("scalar"));
+    EXPECT_EQ(std::string("scalar"), std::string(CaseInsensitiveFinder::Implementation()));
+    CaseInsensitiveFinder::UseImplementation(CaseInsensitiveFinder::Implementations().front());
+}
@@ -0,0 +1,148 @@
+#include "TestHarness.h"
+#include "Cid.h"
+#include "UnixFs.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+// A CARv1 of the two-leaf file "hello world", rooted at kFileRoot: the
+// dag-pb root names raw leaves "hello " and "world". Built with a reference
+// encoder, so it checks our parser against the format rather than itself.
+const char kFileRoot[] = "bafybeieawq5zxtuzklbx7l6qhz63ob62tvimtjq2q7nb462d5o32mzgu3m";
+const char kFileCar[] =
+    "\x3a\xa2\x65\x72\x6f\x6f\x74\x73\x81\xd8\x2a\x58\x25\x00\x01\x70\x12\x20\x80\xb4\x3b\x9b\xce\x99\x52\xc3\x7f\xaf\xd0\x3e\x7d\xb7"
+    "\x07\xda\x9d\x50\xc9\xa6\x1a\x87\xda\x1e\x7b\x43\xeb\xb7\xa6\x64\xd4\xdb\x67\x76\x65\x72\x73\x69\x6f\x6e\x01\x86\x01\x01\x70\x12"
+    "\x20\x80\xb4\x3b\x9b\xce\x99\x52\xc3\x7f\xaf\xd0\x3e\x7d\xb7\x07\xda\x9d\x50\xc9\xa6\x1a\x87\xda\x1e\x7b\x43\xeb\xb7\xa6\x64\xd4"
+    "\xdb\x12\x2a\x0a\x24\x01\x55\x12\x20\x5e\x32\x35\xa8\x34\x6e\x5a\x45\x85\xf8\xc5\x85\x62\xf5\x05\x2b\x8f\xe2\x6a\x3b\xb1\x22\xe1"
+    "\xe9\x6c\x76\x78\x49\x64\xdf\xc4\x61\x12\x00\x18\x06\x12\x2a\x0a\x24\x01\x55\x12\x20\x48\x6e\xa4\x62\x24\xd1\xbb\x4f\xb6\x80\xf3"
+    "\x4f\x7c\x9a\xd9\x6a\x8f\x24\xec\x88\xbe\x73\xea\x8e\x5a\x6c\x65\x26\x0e\x9c\xb8\xa7\x12\x00\x18\x05\x0a\x08\x08\x02\x18\x0b\x20"
+    "\x06\x20\x05\x2a\x01\x55\x12\x20\x5e\x32\x35\xa8\x34\x6e\x5a\x45\x85\xf8\xc5\x85\x62\xf5\x05\x2b\x8f\xe2\x6a\x3b\xb1\x22\xe1\xe9"
+    "\x6c\x76\x78\x49\x64\xdf\xc4\x61\x68\x65\x6c\x6c\x6f\x20\x29\x01\x55\x12\x20\x48\x6e\xa4\x62\x24\xd1\xbb\x4f\xb6\x80\xf3\x4f\x7c"
+    "\x9a\xd9\x6a\x8f\x24\xec\x88\xbe\x73\xea\x8e\x5a\x6c\x65\x26\x0e\x9c\xb8\xa7\x77\x6f\x72\x6c\x64";
+// Where "world", the last block, starts
+const size_t kWorldOffset = 275;
+
+std::string FileCar() {
+    return std::string(kFileCar, sizeof(kFileCar) - 1);
+}
+
+// Every block of |car|, keyed by binary CID, fed |chunk| bytes at a time
+bool ReadCar(const std::string& car, size_t chunk, std::map<std::string, std::string>& blocks) {
+    CarReader reader([&blocks](const Cid& cid, std::string block) { blocks[cid.Bytes()] = std::move(block); });
+    for (size_t offset = 0; offset < car.size(); offset += chunk) {
+        if (!reader.Feed(car.data() + offset, std::min(chunk, car.size() - offset))) return false;
+    }
+    return reader.BlockCount() == blocks.size();
+}
+
+Cid ParseCid(const std::string& text) {
+    Cid cid;
+    EXPECT_TRUE(Cid::Parse(text, cid));
+    return cid;
+}
+
+} // namespace
+
+FRW_TEST(CidParsesBothVersionsAndChecksBlocks) {
+    // The empty UnixFS directory, as every IPFS implementation names it
+    Cid directory = ParseCid("QmUNLLsPACCz1vLxQVkXqqLX5R1X345qqfHbsf67hvA3Nn");
+    EXPECT_EQ(0, directory.Version());
+    EXPECT_TRUE(directory.Codec() == Cid::kCodecDagPb);
+    EXPECT_TRUE(directory.Verify(std::string("\x0a\x02\x08\x01", 4)));
+    EXPECT_TRUE(!directory.Verify(std::string("\x0a\x02\x08\x02", 4)));
+    // Upgraded to v1 text, which parses back to the same digest
+    Cid upgraded = ParseCid(directory.ToString());
+    EXPECT_EQ(1, upgraded.Version());
+    EXPECT_TRUE(upgraded.Digest() == directory.Digest());
+
+    Cid hello = ParseCid("bafkreifzjut3te2nhyekklss27nh3k72ysco7y32koao5eei66wof36n5e");
+    EXPECT_TRUE(hello.Codec() == Cid::kCodecRaw && hello.HashCode() == Cid::kHashSha256);
+    EXPECT_EQ(std::string("bafkreifzjut3te2nhyekklss27nh3k72ysco7y32koao5eei66wof36n5e"), hello.ToString());
+    EXPECT_TRUE(hello.Verify(std::string("hello world")));
+    EXPECT_TRUE(!hello.Verify(std::string("hello world\n")));
+    EXPECT_TRUE(!hello.Verify(std::string("hello worle")));
+
+    // An identity CID carries its block in place of a digest
+    std::string bytes;
+    AppendVarint(bytes, 1);
+    AppendVarint(bytes, Cid::kCodecRaw);
+    AppendVarint(bytes, Cid::kHashIdentity);
+    AppendVarint(bytes, 3);
+    bytes += "abc";
+    const uint8_t* pos = reinterpret_cast<const uint8_t*>(bytes.data());
+    Cid inline_cid;
+    EXPECT_TRUE(Cid::FromBytes(pos, pos + bytes.size(), inline_cid));
+    EXPECT_TRUE(inline_cid.IsVerifiable());
+    EXPECT_TRUE(inline_cid.Verify(std::string("abc")));
+    EXPECT_TRUE(!inline_cid.Verify(std::string("abd")));
+
+    Cid cid;
+    EXPECT_TRUE(!Cid::Parse("", cid));
+    EXPECT_TRUE(!Cid::Parse("zb2rhe5P4gXftAwvA4eXQ5HJwsER2owDyS9sKaQRRVQPn93bA", cid)); // base58 v1
+    EXPECT_TRUE(!Cid::Parse("QmUNLLsPACCz1vLxQVkXqqLX5R1X345qqfHbsf67hvA3N0", cid));
+    // A digest cut short
+    EXPECT_TRUE(!Cid::Parse("bafkreifzjut3te2nhyekklss27nh3k72ysco7y32koao5eei66wof36", cid));
+}
+
+FRW_TEST(CarReaderDeliversEveryVerifiedBlockOfAKnownFile) {
+    Cid root = ParseCid(kFileRoot);
+    // Whole, and a byte at a time, which splits every varint and section
+    for (size_t chunk : {FileCar().size(), size_t(1), size_t(7)}) {
+        std::map<std::string, std::string> blocks;
+        EXPECT_TRUE(ReadCar(FileCar(), chunk, blocks));
+        EXPECT_EQ(size_t(3), blocks.size());
+
+        UnixFsNode node;
+        EXPECT_TRUE(UnixFs::DecodeNode(root, blocks[root.Bytes()], node));
+        EXPECT_EQ(int(UnixFsNode::File), node.type);
+        EXPECT_EQ(uint64_t(11), node.fileSize);
+        EXPECT_TRUE((std::vector<uint64_t>{6, 5}) == node.blockSizes);
+        EXPECT_EQ(size_t(2), node.links.size());
+
+        auto lookup = [&blocks](const Cid& cid, std::string& out) {
+            auto it = blocks.find(cid.Bytes());
+            if (it == blocks.end()) return false;
+            out = it->second;
+            return true;
+        };
+        std::string content;
+        EXPECT_TRUE(UnixFs::ReadFile(root, lookup, content));
+        EXPECT_EQ(std::string("hello world"), content);
+
+        // A leaf missing from the store leaves the file unreadable
+        blocks.erase(node.links.back().cid.Bytes());
+        EXPECT_TRUE(!UnixFs::ReadFile(root, lookup, content));
+    }
+}
+
+FRW_TEST(CarReaderRejectsATamperedFile) {
+    // One byte of the last leaf changed in transit
+    std::string tampered = FileCar();
+    EXPECT_EQ(std::string("world"), tampered.substr(kWorldOffset));
+    tampered[kWorldOffset] = 'W';
+    std::map<std::string, std::string> blocks;
+    EXPECT_TRUE(!ReadCar(tampered, tampered.size(), blocks));
+    // The blocks before it verified; the tampered one never reaches the store
+    EXPECT_EQ(size_t(2), blocks.size());
+
+    // A section claiming more than the largest block we accept
+    std::string oversized = FileCar().substr(0, 59);
+    AppendVarint(oversized, uint64_t(64) * 1024 * 1024);
+    blocks.clear();
+    EXPECT_TRUE(!ReadCar(oversized, oversized.size(), blocks));
+
+    // A truncated stream is incomplete, not wrong: Feed waits for the rest
+    std::string truncated = FileCar().substr(0, FileCar().size() - 2);
+    blocks.clear();
+    EXPECT_TRUE(ReadCar(truncated, truncated.size(), blocks));
+    EXPECT_EQ(size_t(2), blocks.size());
+
+    // A dag-pb block that is not a protobuf
+    Cid root = ParseCid(kFileRoot);
+    UnixFsNode node;
+    EXPECT_TRUE(!UnixFs::DecodeNode(root, std::string("\x12\xff", 2), node));
+}
@@ -0,0 +1,271 @@
+#include "TestHarness.h"
+#include "ContentStore.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+
+namespace {
+
+const size_t kBlock = 256 * 1024;
+
+std::string RandomBytes(size_t size, unsigned seed) {
+    std::mt19937 random(seed);
+    std::string bytes(size, '\0');
+    for (auto& byte : bytes) {
+        byte = static_cast<char>(random());
+    }
+    return bytes;
+}
+
+// The store is a process-wide singleton; each case opens it on a scratch
+// directory of its own with the budgets it needs, and closes it afterwards
+class ScratchStore {
+public:
+    explicit ScratchStore(uint64_t max_bytes = 1024ull * 1024 * 1024, size_t max_entries = 65536) {
+        Store().SetMaxSize(max_bytes);
+        Store().SetMaxEntries(max_entries);
+        Reopen();
+    }
+    ~ScratchStore() { Store().Close(); }
+
+    ContentStore& Store() const { return ContentStore::Instance(); }
+    const std::string& Path() const { return directory_.Path(); }
+    std::string IndexPath() const { return Path() + "/index.log"; }
+
+    bool Reopen() {
+        Store().Close();
+        return Store().Open(Path());
+    }
+
+    // Block files on disk, leaving out any temporary file a write left behind
+    size_t BlockFiles() const {
+        size_t count = 0;
+        std::error_code ec;
+        for (std::filesystem::recursive_directory_iterator it(Path() + "/blocks", ec), end; !ec && it != end;
+             it.increment(ec)) {
+            if (it->is_regular_file(ec) && it->path().extension() != ".tmp") count++;
+        }
+        return count;
+    }
+
+private:
+    TestHarness::ScratchDirectory directory_;
+};
+
+bool Holds(ContentStore& store, const std::string& cid, const std::string& path, const std::string& content) {
+    std::string read;
+    return store.Get(cid, path, read) && read == content;
+}
+
+} // namespace
+
+FRW_TEST(ContentStoreStoresABlockSharedByTwoSitesOnce) {
+    ScratchStore scratch;
+    ContentStore& store = scratch.Store();
+    // The same two-block framework shipped by both sites, beside a page of
+    // each site's own
+    std::string framework = RandomBytes(2 * kBlock, 1);
+    std::string first_page = RandomBytes(kBlock, 2);
+    std::string second_page = RandomBytes(kBlock / 2, 3);
+    EXPECT_TRUE(store.Put("bafyfirst", "/lib/framework.js", framework));
+    EXPECT_TRUE(store.Put("bafyfirst", "/index.html", first_page));
+    EXPECT_TRUE(store.Put("bafysecond", "/vendor/framework.js", framework));
+    EXPECT_TRUE(store.Put("bafysecond", "/index.html", second_page));
+
+    ContentStore::Stats stats = store.GetStats();
+    EXPECT_EQ(size_t(4), stats.blocks);
+    EXPECT_EQ(size_t(4), scratch.BlockFiles());
+    EXPECT_EQ(uint64_t(5 * kBlock + kBlock / 2), stats.logicalBytes);
+    EXPECT_EQ(uint64_t(3 * kBlock + kBlock / 2), stats.storedBytes);
+    EXPECT_EQ(stats.storedBytes, store.GetTotalSize());
+    EXPECT_TRUE(Holds(store, "bafyfirst", "/lib/framework.js", framework));
+    EXPECT_TRUE(Holds(store, "bafysecond", "/vendor/framework.js", framework));
+
+    // 5.5 blocks held in 3.5: a ratio of 11/7, and two blocks (0.5 MB) saved
+    std::string summary = store.Summary();
+    EXPECT_TRUE(summary.find("4 objects in 4 blocks") != std::string::npos);
+    EXPECT_TRUE(summary.find("dedup 1.57x (0.5 MB saved)") != std::string::npos);
+}
+
+FRW_TEST(ContentStoreKeepsASharedBlockUntilItsLastObjectIsRemoved) {
+    ScratchStore scratch;
+    ContentStore& store = scratch.Store();
+    std::string framework = RandomBytes(2 * kBlock, 4);
+    EXPECT_TRUE(store.Put("bafyfirst", "/framework.js", framework));
+    EXPECT_TRUE(store.Put("bafysecond", "/framework.js", framework));
+    EXPECT_EQ(size_t(2), scratch.BlockFiles());
+
+    store.Remove("bafyfirst", "/framework.js");
+    EXPECT_TRUE(!store.Contains("bafyfirst", "/framework.js"));
+    EXPECT_EQ(size_t(2), scratch.BlockFiles());
+    EXPECT_EQ(uint64_t(2 * kBlock), store.GetStats().storedBytes);
+    EXPECT_TRUE(Holds(store, "bafysecond", "/framework.js", framework));
+
+    store.Remove("bafysecond", "/framework.js");
+    EXPECT_EQ(size_t(0), scratch.BlockFiles());
+    ContentStore::Stats stats = store.GetStats();
+    EXPECT_EQ(size_t(0), stats.blocks);
+    EXPECT_EQ(uint64_t(0), stats.storedBytes);
+    EXPECT_EQ(uint64_t(0), stats.logicalBytes);
+}
+
+FRW_TEST(ContentStoreReopenReplaysTheIndexWithBlockReferencesIntact) {
+    ScratchStore scratch;
+    ContentStore& store = scratch.Store();
+    std::string framework = RandomBytes(3 * kBlock, 5);
+    std::string page = RandomBytes(1000, 6);
+    EXPECT_TRUE(store.Put("bafyfirst", "/framework.js", framework));
+    EXPECT_TRUE(store.Put("bafysecond", "/framework.js", framework));
+    EXPECT_TRUE(store.Put("bafysecond", "/index.html", page));
+    ContentStore::Stats before = store.GetStats();
+
+    EXPECT_TRUE(scratch.Reopen());
+    ContentStore::Stats after = store.GetStats();
+    EXPECT_EQ(size_t(3), store.GetEntryCount());
+    EXPECT_EQ(before.blocks, after.blocks);
+    EXPECT_EQ(before.logicalBytes, after.logicalBytes);
+    EXPECT_EQ(before.storedBytes, after.storedBytes);
+    EXPECT_TRUE(Holds(store, "bafyfirst", "/framework.js", framework));
+    EXPECT_TRUE(Holds(store, "bafysecond", "/index.html", page));
+
+    // Each shared block came back with both of its references
+    store.Remove("bafyfirst", "/framework.js");
+    EXPECT_EQ(size_t(4), scratch.BlockFiles());
+    EXPECT_TRUE(Holds(store, "bafysecond", "/framework.js", framework));
+    store.Remove("bafysecond", "/framework.js");
+    EXPECT_EQ(size_t(1), scratch.BlockFiles());
+}
+
+FRW_TEST(ContentStoreIgnoresATornIndexTail) {
+    ScratchStore scratch;
+    ContentStore& store = scratch.Store();
+    std::string kept = RandomBytes(kBlock + 10, 7);
+    EXPECT_TRUE(store.Put("bafykept", "/kept.bin", kept));
+    uintmax_t intact = std::filesystem::file_size(scratch.IndexPath());
+
+    // A put cut short by a crash: its put and identity records reached the
+    // log, its block records only in part
+    std::string torn = RandomBytes(2 * kBlock, 8);
+    EXPECT_TRUE(store.Put("bafytorn", "/torn.bin", torn));
+    EXPECT_EQ(size_t(4), scratch.BlockFiles());
+    std::string log;
+    {
+        std::ifstream file(scratch.IndexPath(), std::ios::binary);
+        log.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    // Close() compacts the log, so the crashed session's log is put back after
+    store.Close();
+    {
+        std::ofstream file(scratch.IndexPath(), std::ios::binary | std::ios::trunc);
+        file.write(log.data(), static_cast<std::streamsize>(intact + 3 * 128 + 50));
+    }
+
+    EXPECT_TRUE(store.Open(scratch.Path()));
+    EXPECT_EQ(size_t(1), store.GetEntryCount());
+    EXPECT_TRUE(Holds(store, "bafykept", "/kept.bin", kept));
+    EXPECT_TRUE(!store.Contains("bafytorn", "/torn.bin"));
+    // The torn put's blocks are unreferenced and were collected
+    EXPECT_EQ(size_t(2), scratch.BlockFiles());
+    EXPECT_EQ(uint64_t(kBlock + 10), store.GetStats().storedBytes);
+    // And the log was rewritten without the torn records
+    EXPECT_EQ(uintmax_t(4 * 128), std::filesystem::file_size(scratch.IndexPath()));
+}
+
+FRW_TEST(ContentStoreKeepsAHotWorkingSetThroughAOneOffScan) {
+    const size_t kHot = 20;
+    ScratchStore scratch(4 * 1024 * 1024, 1000);
+    ContentStore& store = scratch.Store();
+    for (size_t i = 0; i < kHot; ++i) {
+        EXPECT_TRUE(store.Put("bafysite", "/asset" + std::to_string(i), RandomBytes(16 * 1024, 100 + i)));
+    }
+    std::string content;
+    for (int round = 0; round < 3; ++round) {
+        for (size_t i = 0; i < kHot; ++i) {
+            EXPECT_TRUE(store.Get("bafysite", "/asset" + std::to_string(i), content));
+        }
+    }
+
+    // A video four times the cache's size, read through once
+    for (size_t i = 0; i < 64; ++i) {
+        store.Put("bafyvideo", "/chunk" + std::to_string(i), RandomBytes(kBlock, 200 + i));
+        EXPECT_TRUE(store.GetTotalSize() <= uint64_t(4 * 1024 * 1024));
+    }
+
+    for (size_t i = 0; i < kHot; ++i) {
+        EXPECT_TRUE(store.Contains("bafysite", "/asset" + std::to_string(i)));
+    }
+    EXPECT_TRUE(store.GetStats().rejected > 0);
+}
+
+FRW_TEST(ContentStoreNeverEvictsAPinnedSiteAndKeepsThePinAcrossReopen) {
+    const size_t kPinned = 5;
+    ScratchStore scratch(1024ull * 1024 * 1024, 10);
+    ContentStore& store = scratch.Store();
+    store.RecordSiteRoot("docs", "bafypinned");
+    store.PinSite("docs");
+    for (size_t i = 0; i < kPinned; ++i) {
+        EXPECT_TRUE(store.Put("bafypinned", "/page" + std::to_string(i), RandomBytes(1000, 300 + i)));
+    }
+
+    // Far more, and more often used, objects than fit beside them
+    std::string content;
+    for (size_t i = 0; i < 100; ++i) {
+        std::string path = "/other" + std::to_string(i);
+        store.Put("bafyother", path, RandomBytes(1000, 400 + i));
+        for (int hit = 0; hit < 4; ++hit) store.Get("bafyother", path, content);
+        EXPECT_TRUE(store.GetEntryCount() <= 10);
+    }
+    for (size_t i = 0; i < kPinned; ++i) {
+        EXPECT_TRUE(store.Contains("bafypinned", "/page" + std::to_string(i)));
+    }
+
+    // After a restart the pin still holds, even with a budget below the site
+    EXPECT_TRUE(scratch.Reopen());
+    EXPECT_TRUE(store.IsSitePinned("docs"));
+    std::string root;
+    EXPECT_TRUE(store.LookupSiteRoot("docs", root));
+    EXPECT_EQ(std::string("bafypinned"), root);
+    store.SetMaxEntries(3);
+    EXPECT_EQ(kPinned, store.GetEntryCount());
+    for (size_t i = 0; i < kPinned; ++i) {
+        EXPECT_TRUE(store.Contains("bafypinned", "/page" + std::to_string(i)));
+    }
+
+    // Unpinned, the site is held to the budget like any other
+    store.UnpinSite("docs");
+    EXPECT_EQ(size_t(3), store.GetEntryCount());
+}
+
+FRW_TEST(ContentStoreEnforcesBothTheByteAndTheEntryLimit) {
+    {
+        // Many small objects: the entry limit binds
+        ScratchStore scratch(1024ull * 1024 * 1024, 20);
+        ContentStore& store = scratch.Store();
+        for (size_t i = 0; i < 100; ++i) {
+            store.Put("bafysmall", "/" + std::to_string(i), RandomBytes(100, 500 + i));
+            EXPECT_TRUE(store.GetEntryCount() <= 20);
+        }
+        EXPECT_EQ(size_t(20), store.GetEntryCount());
+        store.SetMaxEntries(4);
+        EXPECT_EQ(size_t(4), store.GetEntryCount());
+    }
+    {
+        // Fewer, larger ones: the byte limit binds, counted after dedup
+        ScratchStore scratch(1024 * 1024, 1000);
+        ContentStore& store = scratch.Store();
+        for (size_t i = 0; i < 40; ++i) {
+            store.Put("bafylarge", "/" + std::to_string(i), RandomBytes(100 * 1024, 600 + i));
+            EXPECT_TRUE(store.GetTotalSize() <= uint64_t(1024 * 1024));
+        }
+        EXPECT_TRUE(store.GetEntryCount() >= 9);
+        store.SetMaxSize(300 * 1024);
+        EXPECT_TRUE(store.GetTotalSize() <= uint64_t(300 * 1024));
+        EXPECT_EQ(size_t(3), store.GetEntryCount());
+        // One larger than the whole budget is not stored at all
+        EXPECT_TRUE(!store.Put("bafylarge", "/huge", RandomBytes(400 * 1024, 700)));
+    }
+}
@@ -0,0 +1,175 @@
+#include "TestHarness.h"
+#include "DownloadJournal.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace {
+
+DownloadRecord MakeRecord(int id) {
+    DownloadRecord record;
+    record.id = id;
+    record.url = "https://example.com/file" + std::to_string(id) + ".bin";
+    record.filename = "file" + std::to_string(id) + ".bin";
+    record.savePath = "/downloads/" + record.filename;
+    record.state = 1;
+    record.startTime = 1000 * id;
+    return record;
+}
+
+DownloadCheckpoint MakeCheckpoint(int64_t done) {
+    DownloadCheckpoint checkpoint;
+    checkpoint.total = 4096;
+    checkpoint.rangeable = true;
+    checkpoint.validator = "\"v1\"";
+    checkpoint.segments = {{0, 2048, done}, {2048, 4096, 2048 + done / 2}};
+    return checkpoint;
+}
+
+// What a fresh journal replays from |path|, as after a restart
+std::vector<DownloadRecord> Replay(const std::string& path) {
+    DownloadJournal journal;
+    std::vector<DownloadRecord> records;
+    EXPECT_TRUE(journal.Open(path, records));
+    return records;
+}
+
+// Replays a copy, so the journal under test is neither closed nor compacted
+std::vector<DownloadRecord> ReplayCopy(const std::string& path) {
+    std::string copy = path + ".copy";
+    std::filesystem::copy_file(path, copy, std::filesystem::copy_options::overwrite_existing);
+    std::vector<DownloadRecord> records = Replay(copy);
+    std::filesystem::remove(copy);
+    return records;
+}
+
+void AppendBytes(const std::string& path, const std::string& bytes) {
+    std::ofstream file(path, std::ios::binary | std::ios::app);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+} // namespace
+
+FRW_TEST(DownloadJournalReplaysTheLastWordOnEachDownload) {
+    TestHarness::ScratchDirectory directory;
+    std::string path = directory.Path() + "/downloads.journal";
+    {
+        DownloadJournal journal;
+        std::vector<DownloadRecord> records;
+        EXPECT_TRUE(journal.Open(path, records));
+        EXPECT_TRUE(records.empty());
+        for (int id = 1; id <= 3; ++id) journal.Add(MakeRecord(id));
+        journal.SetCheckpoint(1, MakeCheckpoint(100));
+        journal.SetCheckpoint(1, MakeCheckpoint(900));
+        journal.SetSpeedLimit(1, 65536);
+        journal.SetState(2, 3, 2000, 2500, "Network error");
+        journal.Remove(3);
+        // A transfer reporting in after its download was removed
+        journal.SetCheckpoint(3, MakeCheckpoint(50));
+    }
+
+    std::vector<DownloadRecord> records = Replay(path);
+    EXPECT_EQ(size_t(2), records.size());
+    if (records.size() != 2) return;
+    EXPECT_EQ(1, records[0].id);
+    EXPECT_EQ(std::string("https://example.com/file1.bin"), records[0].url);
+    EXPECT_EQ(std::string("/downloads/file1.bin"), records[0].savePath);
+    EXPECT_EQ(int64_t(65536), records[0].speedLimit);
+    EXPECT_EQ(int64_t(900), records[0].checkpoint.segments[0].done);
+    EXPECT_EQ(int64_t(2048 + 450), records[0].checkpoint.segments[1].done);
+    EXPECT_EQ(std::string("\"v1\""), records[0].checkpoint.validator);
+    EXPECT_TRUE(records[0].checkpoint.rangeable);
+    EXPECT_EQ(2, records[1].id);
+    EXPECT_EQ(3, records[1].state);
+    EXPECT_EQ(int64_t(2500), records[1].endTime);
+    EXPECT_EQ(std::string("Network error"), records[1].errorMessage);
+    EXPECT_TRUE(records[1].checkpoint.segments.empty());
+}
+
+FRW_TEST(DownloadJournalStopsAtATornTailAndAppendsPastIt) {
+    TestHarness::ScratchDirectory directory;
+    std::string path = directory.Path() + "/downloads.journal";
+    {
+        DownloadJournal journal;
+        std::vector<DownloadRecord> records;
+        EXPECT_TRUE(journal.Open(path, records));
+        journal.Add(MakeRecord(1));
+        journal.Add(MakeRecord(2));
+    }
+    // A crash part way through writing the next frame's header
+    AppendBytes(path, std::string("\x20\x00\x00", 3));
+
+    DownloadJournal journal;
+    std::vector<DownloadRecord> records;
+    EXPECT_TRUE(journal.Open(path, records));
+    EXPECT_EQ(size_t(2), records.size());
+    journal.Add(MakeRecord(3));
+    EXPECT_EQ(size_t(3), ReplayCopy(path).size());
+}
+
+FRW_TEST(DownloadJournalCutsATornTailOffWhenItCannotRewrite) {
+    TestHarness::ScratchDirectory directory;
+    std::string path = directory.Path() + "/downloads.journal";
+    {
+        DownloadJournal journal;
+        std::vector<DownloadRecord> records;
+        EXPECT_TRUE(journal.Open(path, records));
+        journal.Add(MakeRecord(1));
+    }
+    std::string torn(8, '\0');
+    torn[0] = 16; // A 16-byte payload, none of which arrived
+    AppendBytes(path, torn);
+
+    // A directory, not empty, where the rewrite's temporary file goes makes
+    // it fail
+    std::filesystem::create_directories(path + ".tmp/in-the-way");
+    DownloadJournal journal;
+    std::vector<DownloadRecord> records;
+    EXPECT_TRUE(journal.Open(path, records));
+    EXPECT_EQ(size_t(1), records.size());
+    journal.Add(MakeRecord(2));
+
+    // The record appended is not lost behind the torn bytes
+    records = ReplayCopy(path);
+    EXPECT_EQ(size_t(2), records.size());
+    EXPECT_TRUE(records.size() == 2 && records[1].id == 2);
+    std::filesystem::remove_all(path + ".tmp");
+}
+
+FRW_TEST(DownloadJournalCompactsSupersededCheckpoints) {
+    TestHarness::ScratchDirectory directory;
+    std::string path = directory.Path() + "/downloads.journal";
+    DownloadJournal journal;
+    std::vector<DownloadRecord> records;
+    EXPECT_TRUE(journal.Open(path, records));
+    journal.Add(MakeRecord(1));
+    journal.Add(MakeRecord(2));
+    journal.Remove(2);
+
+    // Progress reports pile up until the background rewrite drops them.
+    // Each is over 100 bytes, so uncompacted they would take 500 KB.
+    for (int64_t done = 1; done <= 5000; ++done) {
+        journal.SetCheckpoint(1, MakeCheckpoint(done % 2048));
+    }
+    const uintmax_t kCompacted = 200 * 1024;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (std::filesystem::file_size(path) >= kCompacted && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_TRUE(std::filesystem::file_size(path) < kCompacted);
+    EXPECT_TRUE(!std::filesystem::exists(path + ".tmp"));
+
+    // Appends made during and after the rewrite are kept
+    journal.SetCheckpoint(1, MakeCheckpoint(1234));
+    records = ReplayCopy(path);
+    EXPECT_EQ(size_t(1), records.size());
+    EXPECT_TRUE(!records.empty() && records[0].checkpoint.segments[0].done == 1234);
+
+    journal.Close();
+    records = Replay(path);
+    EXPECT_EQ(size_t(1), records.size());
+    // Closing leaves only the live records: metadata, state and checkpoint
+    EXPECT_TRUE(std::filesystem::file_size(path) < 1024);
+}
@@ -0,0 +1,374 @@
+#include "TestHarness.h"
+#include "LocalHttpServer.h"
+#include "Cid.h"
+#include "DownloadTask.h"
+#include "Sha256.h"
+#include "UI/DownloadManager.h"
+#include "UI/SettingsManager.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+
+// Segments are at least 1 MiB, so this splits four ways
+const size_t kFileSize = 6 * 1024 * 1024;
+const milliseconds kTimeout(30000);
+
+std::string RandomBytes(size_t size, unsigned seed) {
+    std::mt19937 random(seed);
+    std::string bytes(size, '\0');
+    for (auto& byte : bytes) {
+        byte = static_cast<char>(random());
+    }
+    return bytes;
+}
+
+std::string ReadFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// A save path in a directory of its own, removed afterwards
+class ScratchPath {
+public:
+    std::string File() const { return directory_.Path() + "/file.bin"; }
+
+private:
+    TestHarness::ScratchDirectory directory_;
+};
+
+// Collects what Start() reports
+struct Outcome {
+    std::mutex mutex;
+    std::condition_variable done;
+    bool finished = false;
+    bool success = false;
+    std::string error;
+
+    std::function<void(bool, const std::string&)> Callback() {
+        return [this](bool ok, const std::string& message) {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished = true;
+            success = ok;
+            error = message;
+            done.notify_all();
+        };
+    }
+
+    bool Wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        return done.wait_for(lock, kTimeout, [this]() { return finished; });
+    }
+};
+
+bool RunToEnd(const std::shared_ptr<DownloadTask>& task, Outcome& outcome) {
+    task->Start(outcome.Callback());
+    return outcome.Wait();
+}
+
+bool WaitForBytes(const std::shared_ptr<DownloadTask>& task, int64_t bytes) {
+    auto deadline = Clock::now() + kTimeout;
+    while (task->ReceivedSize() < bytes && task->IsRunning() && Clock::now() < deadline) {
+        std::this_thread::sleep_for(milliseconds(5));
+    }
+    return task->ReceivedSize() >= bytes;
+}
+
+// A UnixFS file of raw leaves, |leaf_size| bytes each, under one dag-pb
+// root; returns the root block and sets |out_root| to its CID
+std::string RawLeafRoot(const std::string& body, size_t leaf_size, Cid& out_root) {
+    auto field = [](std::string& out, uint64_t key, const std::string& bytes) {
+        AppendVarint(out, key);
+        AppendVarint(out, bytes.size());
+        out += bytes;
+    };
+    std::string links, unixfs("\x08\x02", 2); // Type: File
+    unixfs.push_back('\x18');
+    AppendVarint(unixfs, body.size());
+    for (size_t offset = 0; offset < body.size(); offset += leaf_size) {
+        std::string leaf = body.substr(offset, leaf_size);
+        std::string cid("\x01\x55\x12\x20", 4);
+        cid += Sha256::Hash(leaf.data(), leaf.size());
+        std::string link;
+        field(link, 0x0a, cid);
+        link.push_back('\x18');
+        AppendVarint(link, leaf.size());
+        field(links, 0x12, link);
+        unixfs.push_back('\x20');
+        AppendVarint(unixfs, leaf.size());
+    }
+    std::string block = links;
+    field(block, 0x0a, unixfs);
+
+    std::string root("\x01\x70\x12\x20", 4);
+    root += Sha256::Hash(block.data(), block.size());
+    const uint8_t* pos = reinterpret_cast<const uint8_t*>(root.data());
+    EXPECT_TRUE(Cid::FromBytes(pos, pos + root.size(), out_root));
+    return block;
+}
+
+// Requests that resumed part way into a segment rather than at its start
+int ResumedRanges(const LocalHttpServer& server, int segments) {
+    int resumed = 0;
+    for (const auto& range : server.Ranges()) {
+        if (range.empty() || range == "bytes=0-0") continue;
+        int64_t start = std::strtoll(range.c_str() + 6, nullptr, 10);
+        if (start % static_cast<int64_t>(kFileSize / segments) != 0) resumed++;
+    }
+    return resumed;
+}
+
+} // namespace
+
+FRW_TEST(DownloadTaskFetchesSegmentsInParallelAndResumesDroppedConnections) {
+    std::string body = RandomBytes(kFileSize, 1);
+    LocalHttpServer::Options options;
+    options.bytesPerSecond = 8 * 1024 * 1024;
+    options.dropConnections = 2;
+    LocalHttpServer server(body, options);
+    EXPECT_TRUE(server.IsListening());
+
+    ScratchPath scratch;
+    auto task = std::make_shared<DownloadTask>(server.Url(), scratch.File(), 4);
+    Outcome outcome;
+    EXPECT_TRUE(RunToEnd(task, outcome));
+
+    EXPECT_TRUE(outcome.success);
+    EXPECT_TRUE(body == ReadFile(scratch.File()));
+    EXPECT_TRUE(!std::filesystem::exists(task->PartPath()));
+    EXPECT_EQ(static_cast<int64_t>(kFileSize), task->ReceivedSize());
+    EXPECT_TRUE(server.MaxConcurrent() >= 2);
+    // Each cut connection was picked up from the byte it stopped at
+    EXPECT_EQ(2, server.Dropped());
+    EXPECT_EQ(2, ResumedRanges(server, 4));
+}
+
+FRW_TEST(DownloadTaskResumesFromWhereItWasCancelled) {
+    std::string body = RandomBytes(kFileSize, 2);
+    LocalHttpServer::Options options;
+    options.bytesPerSecond = 1024 * 1024;
+    LocalHttpServer server(body, options);
+
+    ScratchPath scratch;
+    auto task = std::make_shared<DownloadTask>(server.Url(), scratch.File(), 2);
+    Outcome cancelled;
+    task->Start(cancelled.Callback());
+    EXPECT_TRUE(WaitForBytes(task, 1024 * 1024));
+    task->Cancel();
+    EXPECT_TRUE(cancelled.Wait());
+    EXPECT_TRUE(!cancelled.success);
+    EXPECT_EQ(std::string("Cancelled"), cancelled.error);
+    EXPECT_TRUE(std::filesystem::exists(task->PartPath()));
+
+    int64_t kept = task->ReceivedSize();
+    EXPECT_TRUE(kept >= 1024 * 1024);
+    size_t requests = server.Ranges().size();
+    server.SetBytesPerSecond(0);
+
+    Outcome resumed;
+    EXPECT_TRUE(RunToEnd(task, resumed));
+    EXPECT_TRUE(resumed.success);
+    EXPECT_TRUE(body == ReadFile(scratch.File()));
+
+    // No second probe, and no segment started over
+    std::vector<std::string> ranges = server.Ranges();
+    for (size_t i = requests; i < ranges.size(); ++i) {
+        EXPECT_TRUE(ranges[i] != "bytes=0-0");
+        EXPECT_TRUE(std::strtoll(ranges[i].c_str() + 6, nullptr, 10) % static_cast<int64_t>(kFileSize / 2) != 0);
+    }
+}
+
+FRW_TEST(DownloadTaskResumesFromACheckpointAfterARestart) {
+    std::string body = RandomBytes(kFileSize, 3);
+    LocalHttpServer::Options options;
+    options.bytesPerSecond = 1024 * 1024;
+    LocalHttpServer server(body, options);
+
+    ScratchPath scratch;
+    std::mutex mutex;
+    DownloadCheckpoint saved;
+    {
+        auto task = std::make_shared<DownloadTask>(server.Url(), scratch.File(), 2);
+        task->SetCheckpointCallback([&](const DownloadCheckpoint& checkpoint) {
+            std::lock_guard<std::mutex> lock(mutex);
+            saved = checkpoint;
+        });
+        Outcome cancelled;
+        task->Start(cancelled.Callback());
+        EXPECT_TRUE(WaitForBytes(task, 1024 * 1024));
+        task->Cancel();
+        EXPECT_TRUE(cancelled.Wait());
+    }
+
+    // The checkpoint taken as the transfer stopped covers what reached disk
+    int64_t done = 0;
+    for (const auto& segment : saved.segments) {
+        done += segment.done - segment.start;
+    }
+    EXPECT_TRUE(saved.rangeable);
+    EXPECT_EQ(static_cast<int64_t>(kFileSize), saved.total);
+    EXPECT_TRUE(done >= 1024 * 1024);
+
+    server.SetBytesPerSecond(0);
+    size_t requests = server.Ranges().size();
+    auto restarted = std::make_shared<DownloadTask>(server.Url(), scratch.File(), 2);
+    restarted->Restore(saved);
+    EXPECT_EQ(done, restarted->ReceivedSize());
+
+    Outcome outcome;
+    EXPECT_TRUE(RunToEnd(restarted, outcome));
+    EXPECT_TRUE(outcome.success);
+    EXPECT_TRUE(body == ReadFile(scratch.File()));
+    std::vector<std::string> ranges = server.Ranges();
+    for (size_t i = requests; i < ranges.size(); ++i) {
+        EXPECT_TRUE(ranges[i] != "bytes=0-0");
+    }
+}
+
+FRW_TEST(DownloadTaskStartsOverWhenTheFileChangedOnTheServer) {
+    std::string before = RandomBytes(kFileSize, 4);
+    std::string after = RandomBytes(kFileSize, 5);
+    LocalHttpServer::Options options;
+    options.bytesPerSecond = 1024 * 1024;
+    LocalHttpServer server(before, options);
+
+    ScratchPath scratch;
+    auto task = std::make_shared<DownloadTask>(server.Url(), scratch.File(), 2);
+    Outcome cancelled;
+    task->Start(cancelled.Callback());
+    EXPECT_TRUE(WaitForBytes(task, 1024 * 1024));
+    task->Cancel();
+    EXPECT_TRUE(cancelled.Wait());
+
+    // If-Range no longer matches, so the resume is refused rather than
+    // stitching the two versions together
+    server.Replace(after);
+    server.SetBytesPerSecond(0);
+    Outcome refused;
+    EXPECT_TRUE(RunToEnd(task, refused));
+    EXPECT_TRUE(!refused.success);
+    EXPECT_EQ(0, task->ReceivedSize());
+
+    Outcome retried;
+    EXPECT_TRUE(RunToEnd(task, retried));
+    EXPECT_TRUE(retried.success);
+    EXPECT_TRUE(after == ReadFile(scratch.File()));
+}
+
+FRW_TEST(DownloadTaskUsesOneConnectionWhenTheServerIgnoresRanges) {
+    std::string body = RandomBytes(kFileSize, 6);
+    LocalHttpServer::Options options;
+    options.ranges = false;
+    LocalHttpServer server(body, options);
+
+    ScratchPath scratch;
+    auto task = std::make_shared<DownloadTask>(server.Url(), scratch.File(), 4);
+    Outcome outcome;
+    EXPECT_TRUE(RunToEnd(task, outcome));
+
+    EXPECT_TRUE(outcome.success);
+    EXPECT_TRUE(body == ReadFile(scratch.File()));
+    // The probe, then a single transfer
+    EXPECT_EQ(2, server.Requests());
+}
+
+FRW_TEST(DownloadTaskRefetchesASpanThatFailsVerificationFromTheNextGateway) {
+    const size_t kLeafSize = 256 * 1024;
+    const size_t kCorrupt = 13 * kLeafSize + 1000;
+    std::string body = RandomBytes(kFileSize, 9);
+    Cid root;
+    std::string root_block = RawLeafRoot(body, kLeafSize, root);
+
+    // The gateway named in the URL flips one byte of the file; the one
+    // configured after it serves it intact. Both hold the root block.
+    std::string corrupted = body;
+    corrupted[kCorrupt] ^= 0x01;
+    LocalHttpServer bad(corrupted, LocalHttpServer::Options());
+    LocalHttpServer good(body, LocalHttpServer::Options());
+    std::string block_target = "/ipfs/" + root.ToString() + "?format=raw";
+    bad.Route(block_target, root_block);
+    good.Route(block_target, root_block);
+
+    // Settings are saved on every change, so into a scratch home
+    TestHarness::ScratchDirectory home;
+    setenv("HOME", home.Path().c_str(), 1);
+    std::vector<std::string> gateways = SettingsManager::Instance().GetIPFSGateways();
+    SettingsManager::Instance().SetIPFSGateways({good.Origin()});
+
+    ScratchPath scratch;
+    auto task = std::make_shared<DownloadTask>(bad.Origin() + "/ipfs/" + root.ToString(), scratch.File(), 4);
+    Outcome outcome;
+    EXPECT_TRUE(RunToEnd(task, outcome));
+    SettingsManager::Instance().SetIPFSGateways(gateways);
+
+    EXPECT_TRUE(outcome.success);
+    EXPECT_TRUE(task->IsVerified());
+    EXPECT_TRUE(body == ReadFile(scratch.File()));
+    // The bad span was fetched again from its first byte, from the other
+    // gateway, and nothing before it was
+    const std::string refetch = "bytes=" + std::to_string(13 * kLeafSize) + "-";
+    int refetched = 0;
+    for (const auto& range : good.Ranges()) {
+        if (range.empty()) continue; // The root block
+        EXPECT_TRUE(range.compare(0, refetch.size(), refetch) == 0);
+        refetched++;
+    }
+    EXPECT_EQ(1, refetched);
+}
+
+FRW_TEST(DownloadManagerRetryRightAfterCancelRunsToCompletion) {
+    std::string body = RandomBytes(kFileSize, 7);
+    LocalHttpServer::Options options;
+    options.bytesPerSecond = 128 * 1024; // The file outlasts the retries
+    LocalHttpServer server(body, options);
+
+    // The journal and the download land in a scratch home
+    TestHarness::ScratchDirectory home;
+    setenv("HOME", home.Path().c_str(), 1);
+    DownloadManager& manager = DownloadManager::Instance();
+    manager.LoadDownloads();
+    manager.SetDefaultDownloadPath(home.Path());
+    int id = manager.StartDownload(server.Url(), "file.bin");
+
+    // Each retry lands at a different point of the cancelled transfer
+    // winding down: while it still runs, as it stops, or after it reported.
+    // Whichever it is, the retried transfer must stay in progress and not
+    // be settled by the report of the run it replaced.
+    Download download;
+    std::mt19937 random(8);
+    int settled = 0;
+    for (int round = 0; round < 1000; ++round) {
+        manager.CancelDownload(id);
+        // Spun rather than slept, for steps of a microsecond
+        auto retry_at = Clock::now() + std::chrono::microseconds(random() % 200);
+        while (Clock::now() < retry_at) {
+        }
+        manager.RetryDownload(id);
+        std::this_thread::sleep_for(milliseconds(2));
+        EXPECT_TRUE(manager.GetDownload(id, download));
+        if (download.state != DownloadState::InProgress) settled++;
+    }
+    EXPECT_EQ(0, settled);
+
+    server.SetBytesPerSecond(0);
+    auto deadline = Clock::now() + kTimeout;
+    while (manager.GetDownload(id, download) && download.state == DownloadState::InProgress &&
+           Clock::now() < deadline) {
+        std::this_thread::sleep_for(milliseconds(5));
+    }
+    EXPECT_TRUE(download.state == DownloadState::Completed);
+    EXPECT_TRUE(body == ReadFile(download.savePath));
+    manager.Shutdown();
+}
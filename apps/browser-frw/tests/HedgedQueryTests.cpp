@@ -0,0 +1,144 @@
+#include "TestHarness.h"
+#include "HedgedQuery.h"
+#include "CancellationToken.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+
+// Generous next to the microseconds cancellation takes, but far below how
+// long the blocked queries would otherwise run
+const milliseconds kBound(500);
+const milliseconds kBlockFor(10000);
+
+// Stands in for a node that never answers: blocks until cancelled or
+// |kBlockFor| passes. Shared so it outlives queries still unwinding.
+struct SlowNode {
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> finished{false};
+    Clock::time_point cancelledAt;
+
+    bool Block(const std::shared_ptr<CancellationToken>& cancel) {
+        std::mutex mutex;
+        std::condition_variable woken;
+        bool stop = false;
+        int id = cancel->Register([&]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+            woken.notify_all();
+        });
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            woken.wait_for(lock, kBlockFor, [&]() { return stop; });
+            if (stop) cancelledAt = Clock::now();
+        }
+        if (id) cancel->Unregister(id);
+        cancelled = stop;
+        finished = true;
+        return false;
+    }
+};
+
+bool WaitFor(const std::atomic<bool>& flag, milliseconds limit) {
+    auto deadline = Clock::now() + limit;
+    while (!flag && Clock::now() < deadline) {
+        std::this_thread::sleep_for(milliseconds(1));
+    }
+    return flag;
+}
+
+} // namespace
+
+FRW_TEST(HedgedQueryReturnsFirstAnswerWithoutWaitingForSlowerTargets) {
+    auto slow = std::make_shared<SlowNode>();
+    auto query = [slow](const std::string& target, std::string& out_answer,
+                        const std::shared_ptr<CancellationToken>& cancel) {
+        if (target == "slow") return slow->Block(cancel);
+        out_answer = "bafy-answer";
+        return true;
+    };
+
+    // The slow target comes first, as node 0 of the bootstrap list
+    auto started = Clock::now();
+    HedgedQuery::Result result = HedgedQuery::Run({"slow", "fast"}, query);
+    auto elapsed = Clock::now() - started;
+
+    EXPECT_TRUE(result.answered);
+    EXPECT_EQ(std::string("bafy-answer"), result.answer);
+    EXPECT_TRUE(result.reachable);
+    EXPECT_TRUE(elapsed < kBound);
+
+    // The loser is cancelled, and stops, once the answer is in
+    EXPECT_TRUE(WaitFor(slow->finished, kBound));
+    EXPECT_TRUE(slow->cancelled);
+    EXPECT_TRUE(slow->cancelledAt - started < kBound);
+}
+
+FRW_TEST(HedgedQueryStopsEveryTargetWhenTheCallerCancels) {
+    auto first = std::make_shared<SlowNode>();
+    auto second = std::make_shared<SlowNode>();
+    auto query = [first, second](const std::string& target, std::string&,
+                                 const std::shared_ptr<CancellationToken>& cancel) {
+        return (target == "first" ? first : second)->Block(cancel);
+    };
+
+    auto cancel = std::make_shared<CancellationToken>();
+    std::thread canceller([cancel]() {
+        std::this_thread::sleep_for(milliseconds(20));
+        cancel->Cancel();
+    });
+
+    auto started = Clock::now();
+    HedgedQuery::Result result = HedgedQuery::Run({"first", "second"}, query, cancel);
+    auto elapsed = Clock::now() - started;
+    canceller.join();
+
+    EXPECT_TRUE(!result.answered);
+    EXPECT_TRUE(!result.reachable);
+    EXPECT_TRUE(elapsed < kBound);
+    EXPECT_TRUE(first->finished && first->cancelled);
+    EXPECT_TRUE(second->finished && second->cancelled);
+}
+
+FRW_TEST(HedgedQueryWaitsForEveryTargetWhenNoneAnswers) {
+    std::atomic<int> calls{0};
+    auto query = [&calls](const std::string& target, std::string&, const std::shared_ptr<CancellationToken>&) {
+        std::this_thread::sleep_for(milliseconds(target == "late" ? 30 : 0));
+        calls++;
+        return target != "down";
+    };
+
+    HedgedQuery::Result result = HedgedQuery::Run({"down", "late", "empty"}, query);
+
+    EXPECT_EQ(3, calls.load());
+    EXPECT_TRUE(!result.answered);
+    EXPECT_TRUE(result.reachable);
+}
+
+FRW_TEST(HedgedQueryWithNoTargetsReturnsAtOnce) {
+    HedgedQuery::Result result = HedgedQuery::Run({}, [](const std::string&, std::string&,
+                                                         const std::shared_ptr<CancellationToken>&) { return true; });
+    EXPECT_TRUE(!result.answered);
+    EXPECT_TRUE(!result.reachable);
+}
+
+FRW_TEST(CancellationTokenRunsLateRegistrationsAtOnce) {
+    CancellationToken token;
+    int runs = 0;
+    int id = token.Register([&runs]() { runs++; });
+    token.Unregister(id);
+    token.Cancel();
+    EXPECT_EQ(0, runs);
+
+    EXPECT_EQ(0, token.Register([&runs]() { runs++; }));
+    EXPECT_EQ(1, runs);
+    EXPECT_TRUE(token.IsCancelled());
+}
@@ -0,0 +1,118 @@
+#include "TestHarness.h"
+#include "UI/HistoryManager.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// The history as a plain list, in the order of each URL's last visit
+struct ReferenceEntry {
+    std::string url;
+    std::string title;
+    int visits;
+};
+
+class ReferenceHistory {
+public:
+    void Visit(const std::string& url, const std::string& title) {
+        auto it = Find(url);
+        ReferenceEntry entry{url, title, 1};
+        if (it != entries_.end()) {
+            entry.visits = it->visits + 1;
+            if (title.empty()) entry.title = it->title;
+            entries_.erase(it);
+        }
+        entries_.push_back(entry);
+    }
+
+    void Retitle(const std::string& url, const std::string& title) {
+        auto it = Find(url);
+        if (it != entries_.end()) it->title = title;
+    }
+
+    void Remove(const std::string& url) {
+        auto it = Find(url);
+        if (it != entries_.end()) entries_.erase(it);
+    }
+
+    // Most recent first
+    std::vector<ReferenceEntry> ByRecency() const {
+        return std::vector<ReferenceEntry>(entries_.rbegin(), entries_.rend());
+    }
+
+    // Most visited first, the most recent first among equals
+    std::vector<ReferenceEntry> ByVisits() const {
+        std::vector<ReferenceEntry> sorted = ByRecency();
+        std::stable_sort(sorted.begin(), sorted.end(),
+                         [](const ReferenceEntry& a, const ReferenceEntry& b) { return a.visits > b.visits; });
+        return sorted;
+    }
+
+private:
+    std::vector<ReferenceEntry> entries_;
+
+    std::vector<ReferenceEntry>::iterator Find(const std::string& url) {
+        return std::find_if(entries_.begin(), entries_.end(),
+                            [&url](const ReferenceEntry& entry) { return entry.url == url; });
+    }
+};
+
+bool Same(const std::vector<ReferenceEntry>& expected, const std::vector<HistoryEntry>& actual) {
+    if (expected.size() != actual.size()) return false;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        if (expected[i].url != actual[i].url || expected[i].title != actual[i].title ||
+            expected[i].visits != actual[i].visitCount) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+// HistoryManager is a singleton; without LoadHistory it keeps to memory,
+// so nothing here reaches the disk
+FRW_TEST(HistoryManagerKeepsItsRecencyAndVisitOrdersLikeAList) {
+    HistoryManager& history = HistoryManager::Instance();
+    history.ClearHistory();
+    ReferenceHistory reference;
+    std::mt19937 random(6);
+
+    for (int step = 0; step < 5000; ++step) {
+        // Few enough URLs that visit counts climb and buckets fill and empty
+        std::string url = "https://site" + std::to_string(random() % 150) + ".example/";
+        int action = random() % 10;
+        if (action == 0) {
+            history.RemoveEntry(url);
+            reference.Remove(url);
+        } else if (action < 3) {
+            // A title change is no visit, and moves nothing
+            std::string title = "Retitled " + std::to_string(step);
+            history.UpdateTitle(url, title);
+            reference.Retitle(url, title);
+        } else {
+            std::string title = action == 3 ? std::string() : "Page " + std::to_string(step % 7);
+            history.AddEntry(url, title);
+            reference.Visit(url, title);
+        }
+
+        if (step % 250 == 249) {
+            EXPECT_TRUE(Same(reference.ByRecency(), history.GetHistory()));
+            std::vector<ReferenceEntry> recent = reference.ByRecency();
+            recent.resize(std::min<size_t>(recent.size(), 10));
+            EXPECT_TRUE(Same(recent, history.GetRecentEntries(10)));
+            // An empty query walks the visit buckets
+            EXPECT_TRUE(Same(reference.ByVisits(), history.SearchHistory("")));
+        }
+    }
+
+    history.ClearHistory();
+    EXPECT_TRUE(history.GetHistory().empty());
+    EXPECT_TRUE(history.SearchHistory("").empty());
+    history.AddEntry("https://after.example/", "After");
+    EXPECT_EQ(size_t(1), history.GetRecentEntries(5).size());
+    history.ClearHistory();
+}
@@ -0,0 +1,220 @@
+#include "LocalHttpServer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t kChunkSize = 16 * 1024;
+
+bool SendAll(int fd, const char* data, size_t size) {
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL; // Clients hang up mid-body on purpose
+#else
+    const int flags = 0;
+#endif
+    while (size > 0) {
+        ssize_t count = ::send(fd, data, size, flags);
+        if (count <= 0) return false;
+        data += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+
+// The value of header |name| in a lower-cased request head
+std::string HeaderValue(const std::string& head, const std::string& name) {
+    size_t at = head.find("\r\n" + name + ":");
+    if (at == std::string::npos) return "";
+    size_t start = head.find_first_not_of(' ', at + name.size() + 3);
+    size_t end = head.find("\r\n", start);
+    return head.substr(start, end - start);
+}
+
+} // namespace
+
+LocalHttpServer::LocalHttpServer(std::string body, Options options)
+    : options_(options), rate_(options.bytesPerSecond) {
+    Replace(std::move(body));
+
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return;
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0; // Any free port
+    socklen_t length = sizeof(address);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 16) != 0 ||
+        ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+        ::close(fd);
+        return;
+    }
+    listener_ = fd;
+    port_ = ntohs(address.sin_port);
+    acceptor_ = std::thread(&LocalHttpServer::Accept, this);
+}
+
+LocalHttpServer::~LocalHttpServer() {
+    stopping_ = true;
+    if (listener_ >= 0) {
+        ::shutdown(listener_, SHUT_RDWR);
+        acceptor_.join();
+        ::close(listener_);
+    }
+
+    std::vector<std::shared_ptr<Connection>> connections;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connections = connections_;
+        for (const auto& connection : connections) {
+            if (connection->fd >= 0) ::shutdown(connection->fd, SHUT_RDWR);
+        }
+    }
+    for (const auto& connection : connections) {
+        connection->thread.join();
+    }
+}
+
+std::string LocalHttpServer::Url() const {
+    return Origin() + "/file.bin";
+}
+
+std::string LocalHttpServer::Origin() const {
+    return "http://127.0.0.1:" + std::to_string(port_);
+}
+
+void LocalHttpServer::Route(const std::string& target, std::string body) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    routes_[target] = std::make_shared<const std::string>(std::move(body));
+}
+
+void LocalHttpServer::Replace(std::string body) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    body_ = std::make_shared<const std::string>(std::move(body));
+    etag_ = "\"v" + std::to_string(++version_) + "\"";
+}
+
+std::vector<std::string> LocalHttpServer::Ranges() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ranges_;
+}
+
+void LocalHttpServer::Accept() {
+    while (!stopping_) {
+        int fd = ::accept(listener_, nullptr, nullptr);
+        if (fd < 0) continue; // Shut down, or a connection that went away
+        auto connection = std::make_shared<Connection>();
+        connection->fd = fd;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            ::close(fd);
+            break;
+        }
+        connection->thread = std::thread(&LocalHttpServer::Serve, this, connection);
+        connections_.push_back(connection);
+    }
+}
+
+void LocalHttpServer::Serve(const std::shared_ptr<Connection>& connection) {
+    const int fd = connection->fd;
+    std::string head;
+    char buffer[4096];
+    while (head.find("\r\n\r\n") == std::string::npos && head.size() < 64 * 1024) {
+        ssize_t count = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (count <= 0) break;
+        head.append(buffer, static_cast<size_t>(count));
+    }
+    std::transform(head.begin(), head.end(), head.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    std::shared_ptr<const std::string> body;
+    std::string etag;
+    std::string range = HeaderValue(head, "range");
+    // "get <target> http/1.1"
+    size_t target_start = head.find(' ') + 1;
+    std::string target = head.substr(target_start, head.find(' ', target_start) - target_start);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto route = routes_.find(target);
+        body = route != routes_.end() ? route->second : body_;
+        etag = etag_;
+        ranges_.push_back(range);
+    }
+    requests_++;
+
+    // A range that does not parse, or an outdated If-Range, gets the whole file
+    int64_t total = static_cast<int64_t>(body->size());
+    int64_t first = 0;
+    int64_t last = total - 1;
+    bool partial = false;
+    if (options_.ranges && range.compare(0, 6, "bytes=") == 0) {
+        std::string if_range = HeaderValue(head, "if-range");
+        size_t dash = range.find('-');
+        if ((if_range.empty() || if_range == etag) && dash != std::string::npos && dash > 6) {
+            first = std::strtoll(range.c_str() + 6, nullptr, 10);
+            if (dash + 1 < range.size()) {
+                last = std::min<int64_t>(last, std::strtoll(range.c_str() + dash + 1, nullptr, 10));
+            }
+            partial = first <= last;
+        }
+    }
+    if (!partial) {
+        first = 0;
+        last = total - 1;
+    }
+
+    std::string response = partial ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n";
+    response += "Content-Length: " + std::to_string(last - first + 1) + "\r\n";
+    if (partial) {
+        response += "Content-Range: bytes " + std::to_string(first) + "-" + std::to_string(last) + "/" +
+                    std::to_string(total) + "\r\n";
+    }
+    if (options_.ranges) response += "Accept-Ranges: bytes\r\nETag: " + etag + "\r\n";
+    response += "Connection: close\r\n\r\n";
+
+    int concurrent = ++active_;
+    int seen = maxConcurrent_.load();
+    while (concurrent > seen && !maxConcurrent_.compare_exchange_weak(seen, concurrent)) {
+    }
+
+    bool drop = false;
+    if (options_.dropConnections > 0 && last - first + 1 > options_.dropAfter) {
+        drop = ++dropped_ <= options_.dropConnections;
+        if (!drop) dropped_--;
+    }
+
+    // Paced per connection, each chunk only once its time has come, so
+    // reconnecting often gains nothing. The rate is read per chunk so tests
+    // can lift it.
+    auto started = std::chrono::steady_clock::now();
+    bool ok = SendAll(fd, response.data(), response.size());
+    int64_t sent = 0;
+    while (ok && !stopping_ && first + sent <= last) {
+        int64_t limit = drop ? options_.dropAfter : last - first + 1;
+        size_t size = static_cast<size_t>(std::min<int64_t>(kChunkSize, limit - sent));
+        if (size == 0) break;
+        int64_t rate = rate_.load();
+        if (rate > 0) {
+            auto due = started + std::chrono::microseconds((sent + static_cast<int64_t>(size)) * 1000000 / rate);
+            // In short naps, so a lifted limit takes effect at once
+            while (!stopping_ && std::chrono::steady_clock::now() < due && rate_.load() > 0) {
+                std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+                    due - std::chrono::steady_clock::now(), std::chrono::milliseconds(10)));
+            }
+        }
+        ok = SendAll(fd, body->data() + first + sent, size);
+        sent += static_cast<int64_t>(size);
+    }
+    active_--;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ::close(fd);
+    connection->fd = -1;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Serves one file over plain HTTP on a loopback port, badly on purpose:
+// every connection is throttled, and the first few can be dropped part way
+// through the body. Honours "Range: bytes=a-b" and If-Range against a
+// strong ETag unless ranges are switched off. Any path gets the file, bar
+// those given a body of their own with Route(). POSIX sockets only.
+class LocalHttpServer {
+public:
+    struct Options {
+        bool ranges = true;
+        int64_t bytesPerSecond = 0;    // Per connection; 0 for no limit
+        int dropConnections = 0;       // How many bodies to cut short
+        int64_t dropAfter = 256 * 1024; // Body bytes sent before the cut
+    };
+
+    LocalHttpServer(std::string body, Options options);
+    ~LocalHttpServer();
+
+    LocalHttpServer(const LocalHttpServer&) = delete;
+    LocalHttpServer& operator=(const LocalHttpServer&) = delete;
+
+    bool IsListening() const { return listener_ >= 0; }
+    std::string Url() const;
+    // The server's origin, for use as a gateway
+    std::string Origin() const;
+
+    // Serves |body| instead of the file to requests for exactly |target|,
+    // path and query, which must be lower case
+    void Route(const std::string& target, std::string body);
+
+    // Serves |body| under a new ETag from the next request on
+    void Replace(std::string body);
+    void SetBytesPerSecond(int64_t rate) { rate_ = rate; }
+
+    int Requests() const { return requests_.load(); }
+    int Dropped() const { return dropped_.load(); }
+    // Most connections sending a body at the same time
+    int MaxConcurrent() const { return maxConcurrent_.load(); }
+    // The Range header of every request, "" where there was none
+    std::vector<std::string> Ranges() const;
+
+private:
+    struct Connection {
+        int fd; // -1 once closed
+        std::thread thread;
+    };
+
+    const Options options_;
+    int listener_ = -1;
+    int port_ = 0;
+    std::atomic<bool> stopping_{false};
+    std::atomic<int64_t> rate_;
+    std::atomic<int> requests_{0};
+    std::atomic<int> dropped_{0};
+    std::atomic<int> active_{0};
+    std::atomic<int> maxConcurrent_{0};
+
+    mutable std::mutex mutex_;
+    std::shared_ptr<const std::string> body_;
+    std::map<std::string, std::shared_ptr<const std::string>> routes_;
+    std::string etag_;
+    int version_ = 0;
+    std::vector<std::string> ranges_;
+    std::vector<std::shared_ptr<Connection>> connections_;
+    std::thread acceptor_;
+
+    void Accept();
+    void Serve(const std::shared_ptr<Connection>& connection);
+};
@@ -0,0 +1,128 @@
+#include "TestHarness.h"
+#include "SuggestionIndex.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// What Lookup must return, worked out by scanning every URL
+std::vector<std::string> ReferenceLookup(const std::map<std::string, double>& scores, const std::string& prefix,
+                                         size_t count) {
+    std::string key = SuggestionIndex::Normalize(prefix);
+    std::vector<std::pair<double, std::string>> matches;
+    for (const auto& pair : scores) {
+        if (SuggestionIndex::Normalize(pair.first).compare(0, key.size(), key) == 0) {
+            matches.emplace_back(-pair.second, pair.first);
+        }
+    }
+    std::sort(matches.begin(), matches.end());
+    std::vector<std::string> urls;
+    for (size_t i = 0; i < matches.size() && i < count; ++i) {
+        urls.push_back(matches[i].second);
+    }
+    return urls;
+}
+
+// URLs over a small alphabet, so they share long prefixes and the tree
+// splits and merges edges at every depth
+std::string RandomUrl(std::mt19937& random) {
+    static const char* const kSchemes[] = {"https://", "http://www.", "frw://", "https://www."};
+    std::string url = kSchemes[random() % 4];
+    size_t length = 1 + random() % 10;
+    for (size_t i = 0; i < length; ++i) {
+        url += "abc/."[random() % 5];
+    }
+    return url;
+}
+
+bool MatchesEveryPrefix(const SuggestionIndex& index, const std::map<std::string, double>& scores,
+                        const std::vector<std::string>& prefixes) {
+    for (const auto& prefix : prefixes) {
+        std::vector<std::string> expected = ReferenceLookup(scores, prefix, 40);
+        // From the caches, and past them
+        for (size_t count : {size_t(1), size_t(5), SuggestionIndex::kCachedResults, size_t(40)}) {
+            std::vector<std::string> head(expected.begin(), expected.begin() + std::min(count, expected.size()));
+            if (index.Lookup(prefix, count) != head) return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+FRW_TEST(SuggestionIndexSplitsAndPrunesEdges) {
+    SuggestionIndex index;
+    index.Update("https://example.com/docs", 1.0);
+    index.Update("https://example.com/download", 2.0);
+    index.Update("https://exam.net/", 3.0);
+    // "exam" splits "example.com/do" twice over
+    EXPECT_TRUE((std::vector<std::string>{"https://exam.net/", "https://example.com/download",
+                                          "https://example.com/docs"}) == index.Lookup("exam", 10));
+    EXPECT_TRUE((std::vector<std::string>{"https://example.com/download", "https://example.com/docs"}) ==
+                index.Lookup("www.example.com/do", 10));
+
+    // Removing a key merges its node back into the edge below it
+    index.Remove("https://example.com/docs");
+    index.Remove("https://exam.net/");
+    EXPECT_EQ(size_t(1), index.Size());
+    EXPECT_TRUE(std::vector<std::string>{"https://example.com/download"} == index.Lookup("EXAMPLE.COM/", 10));
+    EXPECT_TRUE(index.Lookup("example.com/doc", 10).empty());
+    EXPECT_TRUE(index.Lookup("exam.", 10).empty());
+
+    // A key that is a prefix of another ends at an inner node
+    index.Update("frw://example.com", 0.5);
+    EXPECT_TRUE((std::vector<std::string>{"https://example.com/download", "frw://example.com"}) ==
+                index.Lookup("example.com", 10));
+    index.Remove("https://example.com/download");
+    EXPECT_TRUE(std::vector<std::string>{"frw://example.com"} == index.Lookup("e", 10));
+}
+
+FRW_TEST(SuggestionIndexMatchesAScanAsScoresRiseAndFall) {
+    std::mt19937 random(3);
+    SuggestionIndex index;
+    std::map<std::string, double> scores;
+    // Enough URLs that each is visited several times, and the subtrees near
+    // the root grow past the size at which they cache their best
+    std::vector<std::string> urls(3000);
+    for (auto& url : urls) url = RandomUrl(random);
+    std::vector<std::string> prefixes = {"", "a", "ab", "a.", "abc", "b/", "cab", "www.a", "https://b"};
+    for (int i = 0; i < 200; ++i) {
+        const std::string& url = urls[random() % urls.size()];
+        prefixes.push_back(url.substr(0, url.size() - random() % 4));
+    }
+
+    for (int step = 0; step < 20000; ++step) {
+        const std::string& url = urls[random() % urls.size()];
+        auto it = scores.find(url);
+        int action = random() % 10;
+        if (it != scores.end() && action == 0) {
+            index.Remove(url);
+            scores.erase(it);
+        } else if (it != scores.end() && action < 5) {
+            // Lowering a score may let something below it into a cache
+            double lowered = it->second - static_cast<double>(random() % 50);
+            index.Update(url, lowered);
+            it->second = lowered;
+        } else {
+            // Added, or raised; some ties, which break by URL
+            double score = (it != scores.end() ? it->second : 0.0) + static_cast<double>(random() % 20);
+            index.Update(url, score);
+            scores[url] = score;
+        }
+        if (step % 1000 == 999) {
+            EXPECT_EQ(scores.size(), index.Size());
+            EXPECT_TRUE(MatchesEveryPrefix(index, scores, prefixes));
+        }
+    }
+    // Cached subtrees dropping their caches again as they shrink
+    while (!scores.empty()) {
+        index.Remove(scores.begin()->first);
+        scores.erase(scores.begin());
+        if (scores.size() % 200 == 0) EXPECT_TRUE(MatchesEveryPrefix(index, scores, prefixes));
+    }
+    EXPECT_EQ(size_t(0), index.Size());
+}
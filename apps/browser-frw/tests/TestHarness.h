@@ -0,0 +1,45 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Minimal self-registering test cases for the parts of the browser that
+// build without CEF; tests/main.cpp runs them all
+namespace TestHarness {
+    struct Case {
+        const char* name;
+        std::function<void()> run;
+    };
+
+    std::vector<Case>& Cases();
+    // Records a failed expectation of the running case
+    void Fail(const char* file, int line, const std::string& what);
+
+    struct Registrar {
+        Registrar(const char* name, std::function<void()> run) { Cases().push_back({name, std::move(run)}); }
+    };
+
+    // A fresh directory under the system temp directory, removed by the destructor
+    class ScratchDirectory {
+    public:
+        ScratchDirectory();
+        ~ScratchDirectory();
+        const std::string& Path() const { return path_; }
+
+    private:
+        std::string path_;
+    };
+}
+
+#define FRW_TEST(name)                                                  \
+    static void name();                                                 \
+    static TestHarness::Registrar name##Registrar(#name, name);         \
+    static void name()
+
+#define EXPECT_TRUE(condition)                                          \
+    do {                                                                \
+        if (!(condition)) TestHarness::Fail(__FILE__, __LINE__, #condition); \
+    } while (0)
+
+#define EXPECT_EQ(expected, actual) EXPECT_TRUE((expected) == (actual))
@@ -0,0 +1,115 @@
+#include "TestHarness.h"
+#include "TrigramIndex.h"
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Document {
+    std::vector<std::string> fields;
+    uint64_t updated; // Order of the last update
+};
+
+std::string Lower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return text;
+}
+
+// Every document holding each of the query's trigrams in one of its
+// fields, in the order they were last updated
+std::vector<std::string> ReferenceCandidates(const std::map<std::string, Document>& documents,
+                                             const std::string& query) {
+    std::string lower = Lower(query);
+    std::vector<std::pair<uint64_t, std::string>> matches;
+    for (const auto& pair : documents) {
+        bool all = true;
+        for (size_t i = 0; i + 3 <= lower.size() && all; ++i) {
+            all = false;
+            for (const auto& field : pair.second.fields) {
+                if (Lower(field).find(lower.substr(i, 3)) != std::string::npos) all = true;
+            }
+        }
+        if (all) matches.emplace_back(pair.second.updated, pair.first);
+    }
+    std::sort(matches.begin(), matches.end());
+    std::vector<std::string> keys;
+    for (const auto& match : matches) keys.push_back(match.second);
+    return keys;
+}
+
+std::vector<std::string> Candidates(const TrigramIndex& index, const std::string& query) {
+    std::vector<const std::string*> found;
+    EXPECT_TRUE(index.Candidates(query, found));
+    std::vector<std::string> keys;
+    for (const std::string* key : found) keys.push_back(*key);
+    return keys;
+}
+
+std::string RandomText(std::mt19937& random, size_t size) {
+    std::string text;
+    for (size_t i = 0; i < size; ++i) text += "abcdABCD./"[random() % 10];
+    return text;
+}
+
+} // namespace
+
+FRW_TEST(TrigramIndexNeedsAWholeTrigram) {
+    TrigramIndex index;
+    index.Update("https://example.com/", {"https://example.com/", "Example Domain"});
+    std::vector<const std::string*> keys;
+    EXPECT_TRUE(!index.Candidates("ex", keys));
+    EXPECT_TRUE(keys.empty());
+    EXPECT_TRUE(index.Candidates("DOMAIN", keys));
+    EXPECT_EQ(size_t(1), keys.size());
+    EXPECT_TRUE(index.Candidates("zzz", keys));
+    EXPECT_TRUE(keys.empty());
+
+    // No trigram spans the end of one field and the start of the next
+    index.Update("frw://docs/", {"frw://docs/", "Manual"});
+    EXPECT_TRUE(index.Candidates("/ma", keys));
+    EXPECT_TRUE(keys.empty());
+}
+
+FRW_TEST(TrigramIndexMatchesAScanThroughCompactions) {
+    std::mt19937 random(4);
+    TrigramIndex index;
+    std::map<std::string, Document> documents;
+    std::vector<std::string> keys(400);
+    for (size_t i = 0; i < keys.size(); ++i) keys[i] = "https://site" + std::to_string(i) + "/";
+    uint64_t updates = 0;
+
+    // Ten times as many updates as documents, so dead ids pile up past the
+    // point of compaction several times over
+    for (int step = 0; step < 40000; ++step) {
+        const std::string& key = keys[random() % keys.size()];
+        if (random() % 8 == 0) {
+            index.Remove(key);
+            documents.erase(key);
+        } else {
+            std::vector<std::string> fields = {key + RandomText(random, 6), RandomText(random, 4 + random() % 12)};
+            index.Update(key, fields);
+            documents[key] = Document{fields, updates++};
+        }
+
+        if (step % 2000 == 1999) {
+            EXPECT_EQ(documents.size(), index.Size());
+            for (int query = 0; query < 50; ++query) {
+                std::string text = RandomText(random, 3 + random() % 3);
+                EXPECT_TRUE(ReferenceCandidates(documents, text) == Candidates(index, text));
+            }
+            EXPECT_TRUE(ReferenceCandidates(documents, "SITE1") == Candidates(index, "SITE1"));
+        }
+    }
+
+    // Removing everything leaves nothing behind to match
+    for (const auto& key : keys) index.Remove(key);
+    EXPECT_EQ(size_t(0), index.Size());
+    EXPECT_TRUE(Candidates(index, "site").empty());
+}
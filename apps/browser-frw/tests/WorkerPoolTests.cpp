@@ -0,0 +1,82 @@
+#include "TestHarness.h"
+#include "WorkerPool.h"
+#include "CancellationToken.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Blocks until |cancel| is cancelled
+void WaitForCancel(const std::shared_ptr<CancellationToken>& cancel) {
+    std::mutex mutex;
+    std::condition_variable cancelled;
+    int link = cancel->Register([&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled.notify_all();
+    });
+    std::unique_lock<std::mutex> lock(mutex);
+    cancelled.wait(lock, [&]() { return cancel->IsCancelled(); });
+    lock.unlock();
+    cancel->Unregister(link);
+}
+
+} // namespace
+
+FRW_TEST(WorkerPoolRunsEveryJobOnNoMoreThreadsThanItsBound) {
+    WorkerPool pool(3);
+    std::atomic<int> active{0};
+    std::atomic<int> most{0};
+    std::atomic<int> finished{0};
+    for (int i = 0; i < 30; ++i) {
+        EXPECT_TRUE(pool.Post([&]() {
+            int now = ++active;
+            int seen = most.load();
+            while (now > seen && !most.compare_exchange_weak(seen, now)) {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            active--;
+            finished++;
+        }));
+    }
+
+    auto deadline = Clock::now() + std::chrono::seconds(10);
+    while (finished.load() < 30 && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(30, finished.load());
+    EXPECT_EQ(3, most.load());
+}
+
+FRW_TEST(WorkerPoolShutdownCancelsRunningJobsAndDropsQueuedOnes) {
+    WorkerPool pool(1);
+    auto running = std::make_shared<CancellationToken>();
+    auto queued = std::make_shared<CancellationToken>();
+    std::atomic<bool> started{false};
+    std::atomic<bool> returned{false};
+    std::atomic<bool> ran_queued{false};
+
+    EXPECT_TRUE(pool.Post([&, running]() {
+        started = true;
+        WaitForCancel(running);
+        returned = true;
+    }, running));
+    EXPECT_TRUE(pool.Post([&]() { ran_queued = true; }, queued));
+    while (!started.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // The job blocks until cancelled, so this only returns because it was
+    pool.Shutdown();
+    EXPECT_TRUE(returned.load());
+    EXPECT_TRUE(!ran_queued.load());
+    EXPECT_TRUE(queued->IsCancelled());
+    EXPECT_TRUE(!pool.Post([&]() { ran_queued = true; }));
+    pool.Shutdown();
+    EXPECT_TRUE(!ran_queued.load());
+}
@@ -0,0 +1,52 @@
+#include "TestHarness.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+int failures = 0;
+}
+
+std::vector<TestHarness::Case>& TestHarness::Cases() {
+    static std::vector<Case> cases;
+    return cases;
+}
+
+TestHarness::ScratchDirectory::ScratchDirectory() {
+    static std::atomic<int> count{0};
+    auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+    path_ = (std::filesystem::temp_directory_path() /
+             ("frw-test-" + std::to_string(stamp) + "-" + std::to_string(count++)))
+                .string();
+    std::filesystem::create_directories(path_);
+}
+
+TestHarness::ScratchDirectory::~ScratchDirectory() {
+    std::error_code ec;
+    std::filesystem::remove_all(path_, ec);
+}
+
+void TestHarness::Fail(const char* file, int line, const std::string& what) {
+    std::cerr << "  " << file << ":" << line << ": expected " << what << "\n";
+    failures++;
+}
+
+// Runs every case, or those whose name contains the first argument
+int main(int argc, char** argv) {
+    int failed_cases = 0;
+    int run = 0;
+    for (const auto& test : TestHarness::Cases()) {
+        if (argc > 1 && !std::strstr(test.name, argv[1])) continue;
+        int before = failures;
+        test.run();
+        run++;
+        bool passed = failures == before;
+        if (!passed) failed_cases++;
+        std::cout << (passed ? "[ OK ] " : "[FAIL] ") << test.name << "\n";
+    }
+    std::cout << run - failed_cases << "/" << run << " passed\n";
+    return failed_cases == 0 ? 0 : 1;
+}